@@ -0,0 +1,99 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Phong shading, compiled once per permutation.
+    NORMAL_MAP    : perturbs the normal with a tangent space normal map
+    TEXTURE_ARRAY : textures come from a bank, at the material's slice
+    ALPHA_TEST    : discards pixels whose diffuse alpha is under a half
+    LIGHT_CLASS   : 0 ambient, 1 and the sun, 2 and the clustered lights
+Keys and defines are laid out in ShaderPermutations.h.
+----------------------------------------------*/
+#include "../PhongCommon.hlsli"
+
+#define LIGHT_CLASS_SUN       1
+#define LIGHT_CLASS_CLUSTERED 2
+
+struct VertexOut
+{
+    float4 position : SV_POSITION;
+    float4 color    : COLOR;
+    float3 normal   : NORMAL;
+    float2 uv       : TEXCOORD;
+    float3 worldPos : POSITION;
+    float3 tangent  : TANGENT;
+    float3 binormal : BINORMAL;
+};
+
+cbuffer PSPerMaterial : register(b11)
+{
+    float4 colorTint;
+    float  specularity;
+    uint   textureSlice;
+}
+
+#if TEXTURE_ARRAY
+// Texture banks: every material in the bank binds the same arrays and only differs by slice
+Texture2DArray diffuseTexture : register(t0);
+Texture2DArray normalMap      : register(t1);
+#else
+Texture2D diffuseTexture      : register(t0);
+Texture2D normalMap           : register(t1);
+#endif
+SamplerState samplerOptions   : register(s0);
+
+float4 main(VertexOut input) : SV_TARGET
+{
+    #if TEXTURE_ARRAY
+    float3 uv = float3(input.uv, textureSlice);
+    #else
+    float2 uv = input.uv;
+    #endif
+
+    // Sample diffuse texture
+    float4 surfaceColor = diffuseTexture.Sample(samplerOptions, uv);
+    #if ALPHA_TEST
+    clip(surfaceColor.a - 0.5);
+    #endif
+
+    // Normalize normal vector
+    input.normal = normalize(input.normal);
+
+    #if NORMAL_MAP
+    // Normal map(unpacked), into world space through TBN
+    float3 sampledNormal = normalMap.Sample(samplerOptions, uv).rgb * 2 - 1;
+    input.tangent = normalize(input.tangent - dot(input.tangent, input.normal) * input.normal);
+    input.binormal = normalize(input.binormal);
+
+    float3x3 TBN = float3x3(input.tangent, input.binormal, input.normal);
+    input.normal = mul(sampledNormal, TBN);
+    #endif
+
+    // Holds the total light for this pixel
+    float3 totalLight = 0;
+    float3 toCamera = normalize(cameraWorldPos - input.worldPos);
+
+    #if LIGHT_CLASS >= LIGHT_CLASS_SUN
+    // Diffuse Color
+    float3 diffuseLighting = directionalLight.diffuseColor.rgb *
+        DiffuseAmount(input.normal, directionalLight.toLight);
+
+    // Specular Color
+    float3 specularLighting = directionalLight.diffuseColor.rgb *
+        SpecularPhong(input.normal, -directionalLight.toLight, toCamera, specularity) * any(diffuseLighting);
+
+    // Add to totallight, less what the shadow maps say doesn't reach it
+    totalLight += (diffuseLighting + specularLighting) * SunVisibility(input.worldPos, input.position.w);
+    #endif
+
+    #if LIGHT_CLASS >= LIGHT_CLASS_CLUSTERED
+    // Point and spot lights, only the ones binned into this pixel's cluster
+    totalLight += ClusteredLighting(input.position, input.worldPos, input.normal, toCamera, specularity);
+    #endif
+
+    // Finally, add the ambient color
+    totalLight += ambientColor;
+
+    totalLight *= surfaceColor.rgb;
+
+    return float4(totalLight, 1);
+}
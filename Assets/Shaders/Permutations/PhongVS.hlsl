@@ -1,3 +1,12 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Vertex shader for PhongPS, compiled once per permutation.
+    INSTANCED : the world matrix comes in per instance, not per entity
+Keys and defines are laid out in ShaderPermutations.h.
+----------------------------------------------*/
+#include "../VS_Common.hlsli"
+
 struct VertexIn
 {
     float3 position : POSITION;
@@ -6,8 +15,9 @@ struct VertexIn
     float3 tangent  : TANGENT;
     float3 binormal : BINORMAL;
 
-    // Instancing
+    #if INSTANCED
     float4x4 world  : INSTANCE_WORLDMATRIX;
+    #endif
 };
 
 struct VertexOut
@@ -21,36 +31,36 @@ struct VertexOut
     float3 binormal : BINORMAL;
 };
 
-// Basic camera matrix passed in every frame
-cbuffer VSPerPass : register(b10)
-{
-    float4x4 vp;
-}
-
 VertexOut main( VertexIn vi)
 {
     VertexOut vo;
 
+    #if INSTANCED
+    float4x4 worldMatrix = vi.world;
+    #else
+    float4x4 worldMatrix = world;
+    #endif
+
     // Construct wvp matrix
-    matrix wvp = mul(vp, vi.world);
+    matrix wvp = mul(viewProjection, worldMatrix);
 
     // Transform position by camera matrix
     vo.position = mul(wvp, float4(vi.position, 1.0f));
 
     // Transform normal too
-    vo.normal = mul((float3x3)vi.world, vi.normal);
+    vo.normal = mul((float3x3)worldMatrix, vi.normal);
 
     // Pass along UVs
     vo.uv = vi.uv;
 
     // Pass along world position
-    vo.worldPos = mul((float3x3)vi.world, vi.position);
+    vo.worldPos = mul(worldMatrix, float4(vi.position, 1.0f)).xyz;
 
     // Transform tangent, binormal
-    vo.tangent = mul((float3x3)vi.world, vi.tangent);
-    vo.binormal = mul((float3x3)vi.world, vi.binormal);
+    vo.tangent = mul((float3x3)worldMatrix, vi.tangent);
+    vo.binormal = mul((float3x3)worldMatrix, vi.binormal);
 
     vo.color = float4(1, 1, 1, 1);
-    
+
     return vo;
-}
\ No newline at end of file
+}
@@ -24,6 +24,94 @@ struct DirectionalLight
     float3 toLight;
 };
 
+// cbLighting in CBufferStructs.h
+cbuffer PSPerFrame : register(b10)
+{
+    float3 ambientColor;
+    DirectionalLight directionalLight;
+    float3 cameraWorldPos;
+    float4 clusterParams;   // Slice scale and bias, then tiles per pixel in x and y
+    uint4  clusterDims;     // Clusters in x, y and z, then how many lights were binned
+}
+
+// ClusterLight in ClusteredLighting.h. A point light's cone takes in everything.
+struct ClusterLight
+{
+    float3 position;
+    float  range;
+    float3 color;
+    float  cosOuter;
+    float3 direction;
+    float  cosInner;
+};
+
+// Written by LightingManager every frame: the lights in view, then each cluster's first index and count into lightIndices
+StructuredBuffer<ClusterLight> clusterLights : register(t8);
+StructuredBuffer<uint2>        clusterRanges : register(t9);
+StructuredBuffer<uint>         lightIndices  : register(t10);
+
+// Diffuse and specular from the lights in the cluster a pixel falls in. SV_Position's w is the view space depth.
+float3 ClusteredLighting(float4 aPosition, float3 aWorldPos, float3 aNormal, float3 aToCamera, float aSpec)
+{
+    uint3 cell;
+    cell.xy = min(uint2(aPosition.xy * clusterParams.zw), clusterDims.xy - 1);
+    cell.z = (uint)clamp(log(aPosition.w) * clusterParams.x + clusterParams.y, 0, clusterDims.z - 1);
+    uint2 range = clusterRanges[(cell.z * clusterDims.y + cell.y) * clusterDims.x + cell.x];
+
+    float3 totalLight = 0;
+    for (uint i = 0; i != range.y; ++i)
+    {
+        ClusterLight light = clusterLights[lightIndices[range.x + i]];
+
+        float3 toLight = light.position - aWorldPos;
+        float lightDistance = length(toLight);
+        toLight /= max(lightDistance, 0.0001);
+
+        // Fades out to nothing at the range, and across the cone's edge
+        float falloff = saturate(1 - lightDistance / light.range);
+        float cone = saturate((dot(-toLight, light.direction) - light.cosOuter) / (light.cosInner - light.cosOuter));
+        float3 color = light.color * (falloff * falloff * cone);
+
+        float diffuse = DiffuseAmount(aNormal, toLight);
+        totalLight += color * (diffuse + SpecularPhong(aNormal, -toLight, aToCamera, aSpec) * (diffuse > 0));
+    }
+
+    return totalLight;
+}
+
+// cbShadows in CBufferStructs.h, written by ShadowRenderer every frame
+cbuffer PSShadows : register(b12)
+{
+    float4x4 cascadeViewProjection[4];
+    float4   cascadeSplits;     // View space depth each cascade ends at
+    float4   shadowParams;      // A shadow map texel in uv, then how many cascades there are
+}
+
+Texture2DArray         shadowMap     : register(t7);
+SamplerComparisonState shadowSampler : register(s1);
+
+// How much of the sun reaches a point, from the cascade its view space depth falls in. 3x3 PCF.
+float SunVisibility(float3 aWorldPos, float aViewDepth)
+{
+    uint cascade = (uint)dot(float4(cascadeSplits < aViewDepth), 1);
+    if (cascade >= (uint)shadowParams.y)
+        return 1;
+
+    float4 lightPos = mul(cascadeViewProjection[cascade], float4(aWorldPos, 1));
+    float2 uv = lightPos.xy * float2(0.5, -0.5) + 0.5;
+
+    float visibility = 0;
+    [unroll]
+    for (int y = -1; y <= 1; ++y)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; ++x)
+            visibility += shadowMap.SampleCmpLevelZero(shadowSampler, float3(uv + float2(x, y) * shadowParams.x, cascade), lightPos.z);
+    }
+
+    return visibility / 9;
+}
+
 
 
 #endif
\ No newline at end of file
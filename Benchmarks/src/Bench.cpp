@@ -0,0 +1,40 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of Bench.h
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace Bench {
+
+Statistics ComputeStatistics(std::vector<double> samples)
+{
+    Statistics stats;
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+
+    const size_t count = samples.size();
+    stats.Min = samples.front();
+    stats.Max = samples.back();
+    stats.Median = count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+
+    double sum = 0.0;
+    for (double sample : samples)
+        sum += sample;
+    stats.Mean = sum / (double)count;
+
+    // Sample standard deviation, there are only a handful of repetitions
+    double squares = 0.0;
+    for (double sample : samples)
+        squares += (sample - stats.Mean) * (sample - stats.Mean);
+    stats.StdDev = count > 1 ? sqrt(squares / (double)(count - 1)) : 0.0;
+
+    return stats;
+}
+
+}
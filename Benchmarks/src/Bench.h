@@ -0,0 +1,184 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Minimal microbenchmark harness. Cases register themselves
+with ESL_BENCHMARK, or are made at startup by an ESL_BENCHMARK_GENERATOR
+when they depend on what's on disk, and are run by main().
+Each case is warmed up, then timed for a number of repetitions. Every
+repetition runs the body in batches until a minimum duration has passed
+and yields one ns/op sample. The spread of the samples is reported next to
+their median, so a noisy result can be told apart from a real change.
+----------------------------------------------*/
+#ifndef EASEL_BENCH_H
+#define EASEL_BENCH_H
+
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace Bench {
+
+// Keeps the optimizer from deleting work whose result is never used
+template<typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(_MSC_VER)
+    static volatile const void* sink;
+    sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+// Set from the command line before anything runs, see main.cpp
+struct Options
+{
+    double      WarmupSeconds = 0.1;
+    double      MinSeconds = 0.1;    // Per repetition
+    uint32_t    Repetitions = 10;
+    std::string AssetPath = "Assets/";
+};
+
+inline Options& GetOptions()
+{
+    static Options options;
+    return options;
+}
+
+// Summary of the per repetition samples, all in ns per op
+struct Statistics
+{
+    double Min = 0.0;
+    double Median = 0.0;
+    double Mean = 0.0;
+    double StdDev = 0.0;
+    double Max = 0.0;
+};
+
+Statistics ComputeStatistics(std::vector<double> samples);
+
+class State
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // Ops per batch, so results come out per op instead of per batch
+    void SetOpsPerBatch(uint64_t ops) { mOpsPerBatch = ops; }
+
+    // Warms up, then takes one sample per repetition. Returns the median ns per op.
+    template<typename TFunc>
+    double Run(const TFunc& body)
+    {
+        const Options& options = GetOptions();
+
+        // Warm caches, branch predictors and the clock speed
+        double warmup = 0.0;
+        do
+        {
+            warmup += TimeBatch(body);
+            ++mWarmupBatches;
+        } while (warmup < options.WarmupSeconds);
+
+        mSamples.clear();
+        for (uint32_t i = 0; i != options.Repetitions; ++i)
+        {
+            double total = 0.0;
+            uint64_t batches = 0;
+            do
+            {
+                total += TimeBatch(body);
+                ++batches;
+            } while (total < options.MinSeconds);
+
+            mBatches += batches;
+            mSamples.push_back(total * 1e9 / (double)(batches * mOpsPerBatch));
+        }
+
+        mStatistics = ComputeStatistics(mSamples);
+        return mStatistics.Median;
+    }
+
+    const Statistics&          GetStatistics() const    { return mStatistics; }
+    const std::vector<double>& GetSamples() const       { return mSamples; }
+    uint64_t                   GetOpsPerBatch() const   { return mOpsPerBatch; }
+    uint64_t                   GetBatches() const       { return mBatches; }
+    uint64_t                   GetWarmupBatches() const { return mWarmupBatches; }
+
+    // Marks the case as not run, e.g. when its inputs are missing
+    void Skip(const std::string& reason) { mSkipReason = reason; }
+    const std::string& GetSkipReason() const { return mSkipReason; }
+
+private:
+    template<typename TFunc>
+    static double TimeBatch(const TFunc& body)
+    {
+        const Clock::time_point start = Clock::now();
+        body();
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    uint64_t            mOpsPerBatch = 1;
+    uint64_t            mBatches = 0;
+    uint64_t            mWarmupBatches = 0;
+    std::vector<double> mSamples;
+    Statistics          mStatistics;
+    std::string         mSkipReason;
+};
+
+typedef std::function<void(State& state)> BenchmarkFunc;
+
+struct Benchmark
+{
+    std::string   Name;
+    BenchmarkFunc Func;
+};
+
+inline std::vector<Benchmark>& GetRegistry()
+{
+    static std::vector<Benchmark> registry;
+    return registry;
+}
+
+inline void Register(const std::string& name, const BenchmarkFunc& func)
+{
+    GetRegistry().push_back({ name, func });
+}
+
+// Generators run once the options are known and Register() one case each
+typedef void (*GeneratorFunc)(const Options& options);
+
+inline std::vector<GeneratorFunc>& GetGenerators()
+{
+    static std::vector<GeneratorFunc> generators;
+    return generators;
+}
+
+struct Registrar
+{
+    Registrar(const char* name, void (*func)(State&)) { Register(name, func); }
+    explicit Registrar(GeneratorFunc generator)       { GetGenerators().push_back(generator); }
+};
+
+}
+
+#define ESL_BENCH_CONCAT_INNER(a, b) a##b
+#define ESL_BENCH_CONCAT(a, b) ESL_BENCH_CONCAT_INNER(a, b)
+
+#define ESL_BENCHMARK(name)                                                                   \
+    static void name(Bench::State& state);                                                    \
+    static Bench::Registrar ESL_BENCH_CONCAT(s_Registrar_, name)(#name, &name);               \
+    static void name(Bench::State& state)
+
+#define ESL_BENCHMARK_GENERATOR(name)                                                         \
+    static void name(const Bench::Options& options);                                          \
+    static Bench::Registrar ESL_BENCH_CONCAT(s_Registrar_, name)(&name);                      \
+    static void name(const Bench::Options& options)
+
+#endif
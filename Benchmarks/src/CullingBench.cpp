@@ -0,0 +1,150 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Frustum culling and instance buffer fills. The scene is a
+grid of unit cubes like EntityRenderer's, seen by a camera that takes in
+about three quarters of it. Fill_Copy is the old path that uploads every matrix,
+Fill_Culled culls first and gathers only the visible ones.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Renderer/Culling.h>
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+using Renderer::BoundingSphere;
+using Renderer::Culling;
+using Renderer::Frustum;
+
+// Layout of an XMFLOAT4X4, which is what the instance buffer holds
+struct Matrix
+{
+    float M[16];
+};
+
+Matrix Multiply(const Matrix& a, const Matrix& b)
+{
+    Matrix out;
+    for (int row = 0; row != 4; ++row)
+        for (int col = 0; col != 4; ++col)
+            out.M[row * 4 + col] = a.M[row * 4 + 0] * b.M[0 * 4 + col] + a.M[row * 4 + 1] * b.M[1 * 4 + col] +
+                                   a.M[row * 4 + 2] * b.M[2 * 4 + col] + a.M[row * 4 + 3] * b.M[3 * 4 + col];
+    return out;
+}
+
+// Same as XMMatrixLookToLH followed by XMMatrixPerspectiveFovLH, looking down +Z from eye
+Matrix MakeViewProjection(float eyeX, float eyeY, float eyeZ, float fovY, float aspect, float nearZ, float farZ)
+{
+    Matrix view = {{ 1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1, 0,   -eyeX, -eyeY, -eyeZ, 1 }};
+
+    const float yScale = 1.0f / tanf(fovY * 0.5f);
+    const float range = farZ / (farZ - nearZ);
+    Matrix projection = {{ yScale / aspect, 0, 0, 0,   0, yScale, 0, 0,   0, 0, range, 1,   0, 0, -range * nearZ, 0 }};
+
+    return Multiply(view, projection);
+}
+
+struct Scene
+{
+    std::vector<Matrix>         World;
+    std::vector<BoundingSphere> LocalBounds;
+    std::vector<BoundingSphere> WorldBounds;
+    std::vector<uint32_t>       Visible;
+    std::vector<Matrix>         InstanceBuffer; // Stands in for the mapped dynamic buffer
+    Frustum                     View;
+
+    explicit Scene(uint32_t width)
+    {
+        const uint32_t count = width * width;
+        World.resize(count);
+        LocalBounds.resize(count);
+        WorldBounds.resize(count);
+        Visible.resize(count);
+        InstanceBuffer.resize(count);
+
+        // Unit cubes laid out in the XZ plane, like EntityRenderer::InitEntities
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            const float x = (float)(i % width) * 2.0f;
+            const float z = (float)(i / width) * 2.0f;
+            World[i] = {{ 1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1, 0,   x, 0, z, 1 }};
+            LocalBounds[i] = { 0.0f, 0.0f, 0.0f, 0.8660254f };
+        }
+
+        // From the middle of the grid's near edge, a 90 degree view leaves out the front corners
+        const float middle = (float)width;
+        const Matrix viewProjection = MakeViewProjection(middle, 2.0f, -2.0f, 1.5707963f, 1.0f, 0.1f, 2.0f * middle);
+        Culling::ExtractFrustum(viewProjection.M, &View);
+    }
+
+    uint32_t Cull()
+    {
+        const uint32_t count = (uint32_t)World.size();
+        for (uint32_t i = 0; i != count; ++i)
+            WorldBounds[i] = Culling::TransformSphere(LocalBounds[i], World[i].M);
+        return Culling::CullSpheres(View, WorldBounds.data(), count, Visible.data());
+    }
+};
+
+void RunCullSpheres(Bench::State& state, uint32_t width)
+{
+    Scene scene(width);
+    state.SetOpsPerBatch(width * width);
+    state.Run([&]()
+    {
+        Bench::DoNotOptimize(scene.Cull());
+    });
+}
+
+void RunFillCopy(Bench::State& state, uint32_t width)
+{
+    Scene scene(width);
+    state.SetOpsPerBatch(width * width);
+    state.Run([&]()
+    {
+        memcpy(scene.InstanceBuffer.data(), scene.World.data(), sizeof(Matrix) * scene.World.size());
+        Bench::DoNotOptimize(scene.InstanceBuffer.front());
+    });
+}
+
+void RunFillCulled(Bench::State& state, uint32_t width)
+{
+    Scene scene(width);
+    state.SetOpsPerBatch(width * width);
+    state.Run([&]()
+    {
+        const uint32_t visibleCount = scene.Cull();
+        Culling::Gather(scene.World.data(), sizeof(Matrix), scene.Visible.data(), visibleCount, scene.InstanceBuffer.data());
+        Bench::DoNotOptimize(scene.InstanceBuffer.front());
+    });
+}
+
+}
+
+ESL_BENCHMARK(Culling_ExtractFrustum)
+{
+    const Matrix viewProjection = MakeViewProjection(1.0f, 2.0f, 3.0f, 1.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+    static const uint32_t kFrustumsPerBatch = 1024;
+
+    Frustum frustum;
+    state.SetOpsPerBatch(kFrustumsPerBatch);
+    state.Run([&]()
+    {
+        for (uint32_t i = 0; i != kFrustumsPerBatch; ++i)
+        {
+            Culling::ExtractFrustum(viewProjection.M, &frustum);
+            Bench::DoNotOptimize(frustum);
+        }
+    });
+}
+
+ESL_BENCHMARK(Culling_Spheres_20x20)                { RunCullSpheres(state, 20); }
+ESL_BENCHMARK(Culling_Spheres_128x128)              { RunCullSpheres(state, 128); }
+ESL_BENCHMARK(InstanceBuffer_Fill_Copy_20x20)       { RunFillCopy(state, 20); }
+ESL_BENCHMARK(InstanceBuffer_Fill_Culled_20x20)     { RunFillCulled(state, 20); }
+ESL_BENCHMARK(InstanceBuffer_Fill_Copy_128x128)     { RunFillCopy(state, 128); }
+ESL_BENCHMARK(InstanceBuffer_Fill_Culled_128x128)   { RunFillCulled(state, 128); }
@@ -0,0 +1,77 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : fnv1a at runtime, on names shaped like the ones the codex
+hashes: short file names, longer asset paths and wide shader names, plus the
+64-bit variant the AssetCache runs over whole files.
+Reported per character hashed.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Renderer/hash_util.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+static const uint32_t kStringsPerBatch = 256;
+
+template<typename TString>
+void RunHash(Bench::State& state, const std::vector<TString>& strings)
+{
+    uint64_t units = 0;
+    for (const TString& str : strings)
+        units += str.size();
+
+    state.SetOpsPerBatch(units);
+    state.Run([&]()
+    {
+        uint32_t hash = 0;
+        for (const TString& str : strings)
+            hash ^= fnv1a(str);
+        Bench::DoNotOptimize(hash);
+    });
+}
+
+std::vector<std::string> MakeNames(const char* prefix, const char* suffix)
+{
+    std::vector<std::string> names;
+    for (uint32_t i = 0; i != kStringsPerBatch; ++i)
+        names.push_back(prefix + std::to_string(i) + suffix);
+    return names;
+}
+
+}
+
+ESL_BENCHMARK(Hash_Fnv1a_FileName)
+{
+    RunHash(state, MakeNames("mesh_", ".obj"));
+}
+
+ESL_BENCHMARK(Hash_Fnv1a_AssetPath)
+{
+    RunHash(state, MakeNames("../../Assets/Textures/Environment/Lunar/lunar_surface_", "_normal.dds"));
+}
+
+ESL_BENCHMARK(Hash_Fnv1a_Wide)
+{
+    std::vector<std::wstring> names;
+    for (uint32_t i = 0; i != kStringsPerBatch; ++i)
+        names.push_back(L"InstancedPhongVS_" + std::to_wstring(i) + L".cso");
+    RunHash(state, names);
+}
+
+// The AssetCache's source hash, over a buffer the size of a small model file
+ESL_BENCHMARK(Hash_Fnv1a64_Content)
+{
+    std::vector<uint8_t> content(64 * 1024);
+    for (size_t i = 0; i != content.size(); ++i)
+        content[i] = (uint8_t)(i * 31);
+
+    state.SetOpsPerBatch(content.size());
+    state.Run([&]()
+    {
+        Bench::DoNotOptimize(fnv1a_64(content.data(), content.size()));
+    });
+}
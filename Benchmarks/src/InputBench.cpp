@@ -0,0 +1,115 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Chord evaluation, what InputSystem::update does for every
+command each frame. Uses GameInput's default key map, and a set of two key
+chords on top, against a stream of keyboard states shaped like real play.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Input/InputBinding.h>
+
+#include <array>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Input::Binding;
+using Input::Chord;
+using Input::KeyState;
+
+static const uint32_t kFramesPerBatch = 256;
+
+typedef std::array<uint8_t, 256> Keyboard;
+
+// Win32 virtual keys, spelled out since WinApp.h isn't included here
+enum : unsigned int
+{
+    kKeyRightButton = 0x02,
+    kKeySpace       = 0x20,
+    kKeyEscape      = 0x1B,
+    kKeyShift       = 0x10,
+    kKeyControl     = 0x11,
+    kKeyF9          = 0x78
+};
+
+std::vector<Chord> MakeDefaultKeyMap()
+{
+    // Mirrors GameInput::SetDefaultKeyMap
+    std::vector<Chord> chords;
+    chords.emplace_back(L"Quit", kKeyEscape, KeyState::JustReleased);
+    chords.emplace_back(L"Move Forward", 'W', KeyState::StillPressed);
+    chords.emplace_back(L"Move Backward", 'S', KeyState::StillPressed);
+    chords.emplace_back(L"Move Left", 'A', KeyState::StillPressed);
+    chords.emplace_back(L"Move Right", 'D', KeyState::StillPressed);
+    chords.emplace_back(L"Move Up", kKeySpace, KeyState::StillPressed);
+    chords.emplace_back(L"Roll Left", 'Q', KeyState::StillPressed);
+    chords.emplace_back(L"Roll Right", 'E', KeyState::StillPressed);
+    chords.emplace_back(L"Camera Rotation", kKeyRightButton, KeyState::StillPressed);
+    chords.emplace_back(L"Toggle Profiler Capture", kKeyF9, KeyState::JustReleased);
+    return chords;
+}
+
+void AddModifierChords(std::vector<Chord>* out_chords)
+{
+    for (unsigned int key = '0'; key <= '9'; ++key)
+    {
+        out_chords->emplace_back(L"Save Slot", std::vector<Binding>{ Binding(kKeyControl, KeyState::StillPressed), Binding(key, KeyState::JustPressed) });
+        out_chords->emplace_back(L"Load Slot", std::vector<Binding>{ Binding(kKeyShift, KeyState::StillPressed), Binding(key, KeyState::JustPressed) });
+    }
+}
+
+// Keys held for a few frames at a time, mostly movement, like someone playing
+std::vector<Keyboard> MakeKeyboardStream()
+{
+    static const unsigned int kKeys[] = { 'W', 'A', 'S', 'D', 'Q', 'E', kKeySpace, kKeyRightButton, kKeyShift, kKeyControl, '1', '2' };
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<uint32_t> pickKey(0, sizeof(kKeys) / sizeof(kKeys[0]) - 1);
+    std::bernoulli_distribution toggle(0.15);
+
+    std::vector<Keyboard> stream(kFramesPerBatch + 1);
+    Keyboard current = {};
+    for (Keyboard& keyboard : stream)
+    {
+        if (toggle(rng))
+        {
+            const unsigned int key = kKeys[pickKey(rng)];
+            current[key] = current[key] ? 0 : 1;
+        }
+        keyboard = current;
+    }
+    return stream;
+}
+
+void RunChords(Bench::State& state, const std::vector<Chord>& chords)
+{
+    const std::vector<Keyboard> stream = MakeKeyboardStream();
+
+    state.SetOpsPerBatch((uint64_t)kFramesPerBatch * chords.size());
+    state.Run([&]()
+    {
+        uint32_t active = 0;
+        for (uint32_t frame = 0; frame != kFramesPerBatch; ++frame)
+        {
+            for (const Chord& chord : chords)
+                active += chord.IsActive(stream[frame].data(), stream[frame + 1].data()) ? 1 : 0;
+        }
+        Bench::DoNotOptimize(active);
+    });
+}
+
+}
+
+ESL_BENCHMARK(Input_Chords_Default)
+{
+    RunChords(state, MakeDefaultKeyMap());
+}
+
+ESL_BENCHMARK(Input_Chords_WithModifiers)
+{
+    std::vector<Chord> chords = MakeDefaultKeyMap();
+    AddModifierChords(&chords);
+    RunChords(state, chords);
+}
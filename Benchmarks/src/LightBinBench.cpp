@@ -0,0 +1,115 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Renderer::LightBinner on the scene LightingManager lights,
+a 32x32 grid of point and spot lights over the cubes, and on 4096 lights
+scattered through a larger space, the most a packet holds. Both are seen
+from the game's starting camera with its projection. Reported per light.
+Serial is one thread doing every slice, Pool splits slices over workers.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Core/WorkerPool.h>
+#include <Easel/Renderer/ClusteredLighting.h>
+
+#include <math.h>
+#include <vector>
+
+namespace {
+
+using Core::WorkerPool;
+using Renderer::ClusteredLights;
+using Renderer::LightBinner;
+using Renderer::LightSet;
+
+// The same grid LightingManager starts with
+LightSet MakeGrid()
+{
+    LightSet lights;
+    const int kGridWidth = 32;
+    for (int i = 0; i != kGridWidth * kGridWidth; ++i)
+    {
+        const int x = i % kGridWidth;
+        const int z = i / kGridWidth;
+        const float position[3] = { -3.0f + x * 0.8f, 1.0f + 0.25f * (float)((x + z) % 3), -3.0f + z * 0.8f };
+        const float color[3] = { 1.0f, 1.0f, 1.0f };
+        const float down[3] = { 0.0f, -1.0f, 0.0f };
+        if (i % 4 == 3)
+            lights.AddSpotLight(position, 3.0f, color, down, 0.35f, 0.6f);
+        else
+            lights.AddPointLight(position, 1.5f, color);
+    }
+    return lights;
+}
+
+// A fixed scatter over 80x10x80 in front of the camera, ranges from 0.5 to 4.5
+LightSet MakeScatter()
+{
+    LightSet lights;
+    uint32_t seed = 12345;
+    auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return (float)(seed >> 8) / 16777216.0f; };
+    for (uint32_t i = 0; i != LightBinner::kMaxLights; ++i)
+    {
+        const float position[3] = { next() * 80.0f - 30.0f, next() * 10.0f - 2.0f, next() * 80.0f - 30.0f };
+        const float color[3] = { 1.0f, 1.0f, 1.0f };
+        lights.AddPointLight(position, 0.5f + next() * 4.0f, color);
+    }
+    return lights;
+}
+
+// XMMatrixLookAtLH from Game's (-5, 5, -5) towards the origin
+void MakeView(float* out)
+{
+    const float eye[3] = { -5.0f, 5.0f, -5.0f };
+    float z[3] = { 5.0f, -5.0f, 5.0f };
+    float length = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+    for (float& f : z)
+        f /= length;
+
+    float x[3] = { z[2], 0.0f, -z[0] };     // (0, 1, 0) x z
+    length = sqrtf(x[0] * x[0] + x[2] * x[2]);
+    x[0] /= length;
+    x[2] /= length;
+    const float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+    const float view[16] = { x[0], y[0], z[0], 0,   x[1], y[1], z[1], 0,   x[2], y[2], z[2], 0,
+        -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]), -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]), -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1 };
+    for (int i = 0; i != 16; ++i)
+        out[i] = view[i];
+}
+
+void RunBin(Bench::State& state, LightSet const& lights, bool pooled)
+{
+    // The simulation thread is the caller here, the render thread would keep one more core busy
+    WorkerPool pool;
+    if (pooled)
+        pool.Init(WorkerPool::GetDefaultWorkerCount(2));
+
+    std::vector<uint8_t> memory(LightBinner::GetOutputBytes());
+    ClusteredLights clusters;
+    LightBinner::InitOutput(memory.data(), &clusters);
+
+    float view[16];
+    MakeView(view);
+
+    // XMMatrixPerspectiveFovLH(XM_PIDIV4, 16:9, 0.1, 100) like Game's camera
+    const float yScale = 1.0f / tanf(0.3926991f);
+    const float xScale = yScale * 9.0f / 16.0f;
+
+    LightBinner binner;
+    state.SetOpsPerBatch(lights.GetCount());
+    state.Run([&]()
+    {
+        binner.Bin(lights, view, xScale, yScale, 0.1f, 100.0f, &clusters, &pool);
+        Bench::DoNotOptimize(clusters.IndexCount);
+    });
+
+    pool.Shutdown();
+}
+
+}
+
+ESL_BENCHMARK(LightBin_Grid1k_Serial)    { RunBin(state, MakeGrid(), false); }
+ESL_BENCHMARK(LightBin_Grid1k_Pool)      { RunBin(state, MakeGrid(), true); }
+ESL_BENCHMARK(LightBin_Scatter4k_Serial) { RunBin(state, MakeScatter(), false); }
+ESL_BENCHMARK(LightBin_Scatter4k_Pool)   { RunBin(state, MakeScatter(), true); }
@@ -0,0 +1,92 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Core::Mailbox, which hands frame packets from the simulation
+thread to the render thread. SameThread is the bookkeeping alone, one
+Publish and one Acquire. CrossThread has a second thread publishing as fast
+as it can and reports per packet acquired, so it includes the cache misses
+of a slot coming from another core.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Core/Mailbox.h>
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+static const uint32_t kHandoffsPerBatch = 1024;
+
+// About the size of a packet's camera and light data
+struct Payload
+{
+    uint64_t Index = 0;
+    float    Data[40] = {};
+};
+
+void Fill(Payload& payload, uint64_t index)
+{
+    payload.Index = index;
+    for (float& f : payload.Data)
+        f = (float)index;
+}
+
+}
+
+ESL_BENCHMARK(Mailbox_Handoff_SameThread)
+{
+    Core::Mailbox<Payload> mailbox;
+    uint64_t index = 0;
+
+    state.SetOpsPerBatch(kHandoffsPerBatch);
+    state.Run([&]()
+    {
+        for (uint32_t i = 0; i != kHandoffsPerBatch; ++i)
+        {
+            Fill(mailbox.GetWriteSlot(), ++index);
+            mailbox.Publish();
+            mailbox.Acquire();
+            Bench::DoNotOptimize(mailbox.GetReadSlot().Data[0]);
+        }
+    });
+}
+
+ESL_BENCHMARK(Mailbox_Handoff_CrossThread)
+{
+    Core::Mailbox<Payload> mailbox;
+    std::atomic<bool> running{true};
+
+    std::thread producer([&]()
+    {
+        uint64_t index = 0;
+        while (running.load(std::memory_order_relaxed))
+        {
+            Fill(mailbox.GetWriteSlot(), ++index);
+            mailbox.Publish();
+        }
+    });
+
+    state.SetOpsPerBatch(kHandoffsPerBatch);
+    state.Run([&]()
+    {
+        for (uint32_t acquired = 0; acquired != kHandoffsPerBatch;)
+        {
+            // Wait the way the render thread does, so a machine with fewer cores than threads isn't just spinning
+            if (!mailbox.Acquire())
+            {
+                mailbox.WaitForPublish(1000);
+                continue;
+            }
+
+            float sum = 0.0f;
+            for (float f : mailbox.GetReadSlot().Data)
+                sum += f;
+            Bench::DoNotOptimize(sum);
+            ++acquired;
+        }
+    });
+
+    running.store(false);
+    producer.join();
+}
@@ -0,0 +1,70 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Reading a material library far bigger than the game's: 4096
+materials shaped like the ones in Assets/materials.xml, with every kind of
+element the library knows about. Parse is the XML pass alone, Load is
+that plus turning the document into MaterialDescs, which is what startup
+and every materials hot reload pay. Reported per material.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Assets/MaterialLibrary.h>
+#include <Easel/Assets/XmlDocument.h>
+
+#include <string>
+
+namespace {
+
+static const uint32_t kMaterialCount = 4096;
+
+std::string MakeLibrary()
+{
+    std::string text = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<!-- Generated -->\n<materials>\n";
+    for (uint32_t i = 0; i != kMaterialCount; ++i)
+    {
+        const std::string index = std::to_string(i);
+        text += "\t<material name=\"Material" + index + "\">\n";
+        text += "\t\t<shader type=\"VS\" name=\"PhongVS\" />\n";
+        text += "\t\t<shader type=\"PS\" name=\"PhongPS\" />\n";
+        text += "\t\t<features normalmap=\"true\" instanced=\"true\" lights=\"clustered\" />\n";
+        text += "\t\t<textures name=\"Set" + index + "\" />\n";
+        text += "\t\t<params>\n\t\t\t<tint>1.0,0.5,0.25,1.0</tint>\n\t\t\t<specular>" + std::to_string(i % 256) + ".0</specular>\n\t\t</params>\n";
+
+        // Every fourth one overrides its states, like the sky and the wireframe
+        if (i % 4 == 0)
+        {
+            text += "\t\t<raster fill=\"solid\" cull=\"front\" depthclip=\"true\" />\n";
+            text += "\t\t<depth enable=\"true\" write=\"true\" func=\"less_equal\" />\n";
+            text += "\t\t<blend mode=\"alpha\" />\n";
+        }
+        text += "\t</material>\n";
+    }
+    text += "</materials>\n";
+    return text;
+}
+
+}
+
+ESL_BENCHMARK(MaterialLibrary_Parse_4k)
+{
+    const std::string text = MakeLibrary();
+    Assets::XmlDocument document;
+    state.SetOpsPerBatch(kMaterialCount);
+    state.Run([&]()
+    {
+        Bench::DoNotOptimize(document.Parse(text.data(), text.size()));
+    });
+}
+
+ESL_BENCHMARK(MaterialLibrary_Load_4k)
+{
+    const std::string text = MakeLibrary();
+    Assets::MaterialLibrary library;
+    state.SetOpsPerBatch(kMaterialCount);
+    state.Run([&]()
+    {
+        library.LoadFromMemory(text.data(), text.size());
+        Bench::DoNotOptimize(library.GetMaterials().size());
+    });
+}
@@ -0,0 +1,100 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Mesh import for every model in Assets/Models, laid out for
+the instanced PhongVS. Import is the cold path through Assimp, Cooked is what a
+warm AssetCache hit costs once the blob is in memory. Reported per model.
+Only built where Assimp can be linked, see premake5.lua.
+----------------------------------------------*/
+#include "Bench.h"
+
+#if defined(ESL_BENCH_MESH_IMPORT)
+#include <Easel/Assets/MeshImporter.h>
+
+#include <algorithm>
+#include <filesystem>
+
+namespace {
+
+using Renderer::Semantics;
+
+// POSITION, NORMAL, TEXCOORD, TANGENT, BINORMAL, as reflected from the instanced PhongVS
+Semantics sPhongSemantics[] = { Semantics::POSITION, Semantics::NORMAL, Semantics::TEXCOORD, Semantics::TANGENT, Semantics::BINORMAL };
+uint16_t  sPhongOffsets[]   = { 0, 12, 24, 32, 44 };
+const Renderer::VertexBufferDescription kPhongLayout = { sPhongSemantics, sPhongOffsets, 5, 56 };
+
+void RunImport(Bench::State& state, const std::string& path)
+{
+    Assets::CookedMesh mesh;
+    std::string error;
+    if (!Assets::MeshImporter::Import(path, kPhongLayout, &mesh, &error))
+    {
+        state.Skip(error);
+        return;
+    }
+
+    state.Run([&]()
+    {
+        Assets::MeshImporter::Import(path, kPhongLayout, &mesh);
+        Bench::DoNotOptimize(mesh.Indices.size());
+    });
+}
+
+void RunCooked(Bench::State& state, const std::string& path)
+{
+    Assets::CookedMesh mesh;
+    std::string error;
+    if (!Assets::MeshImporter::Import(path, kPhongLayout, &mesh, &error))
+    {
+        state.Skip(error);
+        return;
+    }
+
+    std::vector<uint8_t> blob;
+    Assets::MeshImporter::Serialize(mesh, &blob);
+
+    state.Run([&]()
+    {
+        Assets::MeshImporter::Deserialize(blob.data(), blob.size(), &mesh);
+        Bench::DoNotOptimize(mesh.Indices.size());
+    });
+}
+
+}
+
+ESL_BENCHMARK_GENERATOR(MeshImport_Models)
+{
+    namespace fs = std::filesystem;
+
+    const fs::path modelPath = fs::path(options.AssetPath) / "Models";
+    std::error_code ec;
+    if (!fs::is_directory(modelPath, ec))
+    {
+        const std::string reason = "no models in '" + modelPath.string() + "', pass --assets";
+        Bench::Register("MeshImport", [reason](Bench::State& state) { state.Skip(reason); });
+        return;
+    }
+
+    // Sorted so runs line up when diffed
+    std::vector<fs::path> models;
+    for (const fs::directory_entry& entry : fs::directory_iterator(modelPath, ec))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".obj")
+            models.push_back(entry.path());
+    }
+    std::sort(models.begin(), models.end());
+
+    for (const fs::path& model : models)
+    {
+        const std::string path = model.string();
+        const std::string name = model.stem().string();
+        Bench::Register("MeshImport_Import_" + name, [path](Bench::State& state) { RunImport(state, path); });
+        Bench::Register("MeshImport_Cooked_" + name, [path](Bench::State& state) { RunCooked(state, path); });
+    }
+}
+#else
+ESL_BENCHMARK(MeshImport)
+{
+    state.Skip("built without Assimp (ESL_BENCH_MESH_IMPORT)");
+}
+#endif
@@ -0,0 +1,143 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Occlusion culling for a dense scene: a 100x100 grid of unit
+cubes, 10k occludees, behind a staggered row of eight walls like the
+inside of a building. Rasterize is the occluder pass alone, Test is every
+cube tested against the result, Frame is both, which is what the culling
+task pays on top of the frustum. Reported per occludee, except Rasterize.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Core/WorkerPool.h>
+#include <Easel/Renderer/OcclusionCulling.h>
+
+#include <math.h>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+using Core::WorkerPool;
+using Renderer::BoundingSphere;
+using Renderer::OcclusionCuller;
+
+static const uint32_t kGridWidth = 100;
+static const uint32_t kWallCount = 8;
+
+// Unit cube, clockwise from outside
+static const float kBoxPositions[] =
+{
+    -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,  -0.5f, 0.5f, -0.5f,   0.5f, 0.5f, -0.5f,
+    -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,  -0.5f, 0.5f,  0.5f,   0.5f, 0.5f,  0.5f
+};
+static const uint32_t kBoxIndices[] =
+{
+    1, 3, 7, 1, 7, 5,   4, 6, 2, 4, 2, 0,   6, 7, 3, 6, 3, 2,
+    0, 1, 5, 0, 5, 4,   5, 7, 6, 5, 6, 4,   0, 2, 3, 0, 3, 1
+};
+
+void Multiply(const float* a, const float* b, float* out)
+{
+    for (int row = 0; row != 4; ++row)
+        for (int col = 0; col != 4; ++col)
+            out[row * 4 + col] = a[row * 4 + 0] * b[0 * 4 + col] + a[row * 4 + 1] * b[1 * 4 + col] +
+                                 a[row * 4 + 2] * b[2 * 4 + col] + a[row * 4 + 3] * b[3 * 4 + col];
+}
+
+struct Scene
+{
+    OcclusionCuller             Culler;
+    WorkerPool                  Pool;
+    uint32_t                    Box = 0;
+    float                       ViewProjection[16];
+    std::vector<float>          Walls;
+    std::vector<BoundingSphere> Spheres;
+    std::vector<uint32_t>       Indices;
+
+    explicit Scene(bool pooled)
+    {
+        // The simulation thread is the caller here, the render thread would keep one more core busy
+        if (pooled)
+            Pool.Init(WorkerPool::GetDefaultWorkerCount(2));
+
+        Culler.Init(256, 128);
+        Box = Culler.AddOccluderMesh(kBoxPositions, 8, kBoxIndices, 36);
+
+        // Cubes laid out in the XZ plane, 2 apart like CullingBench's, ahead of the camera
+        for (uint32_t i = 0; i != kGridWidth * kGridWidth; ++i)
+            Spheres.push_back({ (float)(i % kGridWidth) * 2.0f - (float)kGridWidth, 0.0f, 5.0f + (float)(i / kGridWidth) * 2.0f, 0.8660254f });
+        Indices.resize(Spheres.size());
+
+        // 6 wide, 4 tall and 0.3 thick, at three depths so they overlap on screen
+        for (uint32_t i = 0; i != kWallCount; ++i)
+        {
+            const float wall[16] = { 6, 0, 0, 0,   0, 4, 0, 0,   0, 0, 0.3f, 0,   -24.0f + (float)i * 7.0f, 1.0f, 3.0f + (float)(i % 3) * 4.0f, 1 };
+            Walls.insert(Walls.end(), wall, wall + 16);
+        }
+
+        // XMMatrixLookToLH from (0, 1, -5) down +Z, then XMMatrixPerspectiveFovLH with a 60 degree 16:9 view
+        const float view[16] = { 1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1, 0,   0, -1, 5, 1 };
+        const float yScale = 1.0f / tanf(0.5235988f);
+        const float range = 1000.0f / (1000.0f - 0.1f);
+        const float projection[16] = { yScale * 9.0f / 16.0f, 0, 0, 0,   0, yScale, 0, 0,   0, 0, range, 1,   0, 0, -range * 0.1f, 0 };
+        Multiply(view, projection, ViewProjection);
+    }
+
+    void Rasterize()
+    {
+        Culler.BeginFrame(ViewProjection);
+        Culler.AddOccluders(Box, Walls.data(), nullptr, kWallCount);
+        Culler.RasterizeOccluders(&Pool);
+    }
+
+    uint32_t Test()
+    {
+        std::iota(Indices.begin(), Indices.end(), 0u);
+        return Culler.CullSpheres(Spheres.data(), Indices.data(), (uint32_t)Indices.size(), &Pool);
+    }
+};
+
+void RunRasterize(Bench::State& state, bool pooled)
+{
+    Scene scene(pooled);
+    state.Run([&]()
+    {
+        scene.Rasterize();
+        Bench::DoNotOptimize(scene.Culler.GetDepth()[0]);
+    });
+    scene.Pool.Shutdown();
+}
+
+void RunTest(Bench::State& state, bool pooled)
+{
+    Scene scene(pooled);
+    scene.Rasterize();
+    state.SetOpsPerBatch(kGridWidth * kGridWidth);
+    state.Run([&]()
+    {
+        Bench::DoNotOptimize(scene.Test());
+    });
+    scene.Pool.Shutdown();
+}
+
+void RunFrame(Bench::State& state, bool pooled)
+{
+    Scene scene(pooled);
+    state.SetOpsPerBatch(kGridWidth * kGridWidth);
+    state.Run([&]()
+    {
+        scene.Rasterize();
+        Bench::DoNotOptimize(scene.Test());
+    });
+    scene.Pool.Shutdown();
+}
+
+}
+
+ESL_BENCHMARK(Occlusion_Rasterize_Walls_Serial) { RunRasterize(state, false); }
+ESL_BENCHMARK(Occlusion_Rasterize_Walls_Pool)   { RunRasterize(state, true); }
+ESL_BENCHMARK(Occlusion_Test_10k_Serial)        { RunTest(state, false); }
+ESL_BENCHMARK(Occlusion_Test_10k_Pool)          { RunTest(state, true); }
+ESL_BENCHMARK(Occlusion_Frame_10k_Serial)       { RunFrame(state, false); }
+ESL_BENCHMARK(Occlusion_Frame_10k_Pool)         { RunFrame(state, true); }
@@ -0,0 +1,59 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Cost of ESL_PROFILE_ZONE, which has to stay under 50ns to be
+left on in Release. Zone_Empty is the recording cost alone, Zone_Nested
+a zone inside a zone, and Zone_Drained adds the per-frame drain and tree
+building that Profiler::NewFrame does, amortized over a frame's worth of zones.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Core/Profiler.h>
+
+namespace {
+
+static const uint32_t kZonesPerBatch = 4096; // Half a ring, so NewFrame never drops any
+
+}
+
+ESL_BENCHMARK(Profiler_Zone_Empty)
+{
+    state.SetOpsPerBatch(kZonesPerBatch);
+    state.Run([&]()
+    {
+        for (uint32_t i = 0; i != kZonesPerBatch; ++i)
+        {
+            ESL_PROFILE_ZONE("Empty");
+        }
+    });
+    Core::Profiler::NewFrame();
+}
+
+ESL_BENCHMARK(Profiler_Zone_Nested)
+{
+    state.SetOpsPerBatch(kZonesPerBatch);
+    state.Run([&]()
+    {
+        for (uint32_t i = 0; i != kZonesPerBatch / 2; ++i)
+        {
+            ESL_PROFILE_ZONE("Outer");
+            {
+                ESL_PROFILE_ZONE("Inner");
+            }
+        }
+    });
+    Core::Profiler::NewFrame();
+}
+
+ESL_BENCHMARK(Profiler_Zone_Drained)
+{
+    state.SetOpsPerBatch(kZonesPerBatch);
+    state.Run([&]()
+    {
+        for (uint32_t i = 0; i != kZonesPerBatch; ++i)
+        {
+            ESL_PROFILE_ZONE("Drained");
+        }
+        Core::Profiler::NewFrame();
+    });
+}
@@ -0,0 +1,203 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Renderer::SoftwareRasterizer drawing what headless image
+output draws: a 20x20 grid of normal mapped cubes, seen from above one
+corner at 1280x800. The cube and its textures are made here, so nothing
+is read from Assets/. Reported per frame. Serial is one thread doing both
+phases, Pool splits them over the workers the way Game does.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Assets/MeshImporter.h>
+#include <Easel/Assets/MipGenerator.h>
+#include <Easel/Core/WorkerPool.h>
+#include <Easel/Renderer/SoftwareRasterizer.h>
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+using Core::WorkerPool;
+using Renderer::Semantics;
+using Renderer::SoftwareRasterizer;
+
+static const uint32_t kGridWidth = 20;
+
+// POSITION, NORMAL, TEXCOORD, TANGENT, BINORMAL, as reflected from the instanced PhongVS
+Semantics sPhongSemantics[] = { Semantics::POSITION, Semantics::NORMAL, Semantics::TEXCOORD, Semantics::TANGENT, Semantics::BINORMAL };
+uint16_t  sPhongOffsets[]   = { 0, 12, 24, 32, 44 };
+const Renderer::VertexBufferDescription kPhongLayout = { sPhongSemantics, sPhongOffsets, 5, 56 };
+
+struct PhongVertex
+{
+    float Position[3];
+    float Normal[3];
+    float UV[2];
+    float Tangent[3];
+    float Binormal[3];
+};
+
+// Unit cube, four vertices a face so every face gets its own normal and uvs
+Assets::CookedMesh MakeCube()
+{
+    static const float kNormals[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    static const float kCorners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+
+    std::vector<PhongVertex> vertices;
+    Assets::CookedMesh mesh;
+    for (const float* n : kNormals)
+    {
+        // u along x, or along y on the top and bottom faces, and v = n x u so the winding is clockwise from outside
+        const float u[3] = { fabsf(n[1]) > 0.5f ? 1.0f : 0.0f, fabsf(n[1]) > 0.5f ? 0.0f : 1.0f, 0.0f };
+        const float v[3] = { n[1] * u[2] - n[2] * u[1], n[2] * u[0] - n[0] * u[2], n[0] * u[1] - n[1] * u[0] };
+
+        const uint32_t base = (uint32_t)vertices.size();
+        for (const float* corner : kCorners)
+        {
+            PhongVertex vertex;
+            for (int i = 0; i != 3; ++i)
+            {
+                vertex.Position[i] = 0.5f * (n[i] + corner[0] * u[i] + corner[1] * v[i]);
+                vertex.Normal[i] = n[i];
+                vertex.Tangent[i] = u[i];
+                vertex.Binormal[i] = v[i];
+            }
+            vertex.UV[0] = corner[0] * 0.5f + 0.5f;
+            vertex.UV[1] = corner[1] * 0.5f + 0.5f;
+            vertices.push_back(vertex);
+        }
+        mesh.Indices.insert(mesh.Indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+    }
+
+    mesh.Stride = sizeof(PhongVertex);
+    mesh.Vertices.resize(vertices.size() * sizeof(PhongVertex));
+    memcpy(mesh.Vertices.data(), vertices.data(), mesh.Vertices.size());
+    return mesh;
+}
+
+// Full chain of an 8x8 checker, or of a flat normal map. Levels too small for the checker come out flat.
+Assets::MipChain MakeChain(uint32_t size, bool normalMap)
+{
+    Assets::MipChain chain;
+    size_t offset = 0;
+    for (uint32_t width = size; width; width /= 2)
+    {
+        chain.Levels.push_back({ width, width, width * 4, offset });
+        offset += (size_t)width * width * 4;
+    }
+    chain.Pixels.resize(offset);
+
+    for (const Assets::MipLevel& level : chain.Levels)
+    {
+        for (uint32_t y = 0; y != level.Height; ++y)
+        {
+            for (uint32_t x = 0; x != level.Width; ++x)
+            {
+                uint8_t* pTexel = chain.Pixels.data() + level.Offset + y * level.RowPitch + x * 4;
+                const bool light = level.Width >= 8 && ((x * 8 / level.Width + y * 8 / level.Height) & 1);
+                pTexel[0] = normalMap ? 128 : (light ? 230 : 40);
+                pTexel[1] = normalMap ? 128 : (light ? 200 : 60);
+                pTexel[2] = normalMap ? 255 : (light ? 160 : 120);
+                pTexel[3] = 255;
+            }
+        }
+    }
+    return chain;
+}
+
+void Multiply(const float* a, const float* b, float* out)
+{
+    for (int row = 0; row != 4; ++row)
+        for (int col = 0; col != 4; ++col)
+            out[row * 4 + col] = a[row * 4 + 0] * b[0 * 4 + col] + a[row * 4 + 1] * b[1 * 4 + col] +
+                                 a[row * 4 + 2] * b[2 * 4 + col] + a[row * 4 + 3] * b[3 * 4 + col];
+}
+
+// Same as XMMatrixLookAtLH followed by XMMatrixPerspectiveFovLH
+void MakeViewProjection(const float* eye, const float* at, float aspect, float* out)
+{
+    float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+    float length = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+    for (float& f : z)
+        f /= length;
+
+    float x[3] = { z[2], 0.0f, -z[0] };     // (0, 1, 0) x z
+    length = sqrtf(x[0] * x[0] + x[2] * x[2]);
+    x[0] /= length;
+    x[2] /= length;
+    const float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+    const float view[16] = { x[0], y[0], z[0], 0,   x[1], y[1], z[1], 0,   x[2], y[2], z[2], 0,
+        -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]), -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]), -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]), 1 };
+
+    const float nearZ = 0.1f, farZ = 100.0f;
+    const float yScale = 1.0f / tanf(0.6f);
+    const float range = farZ / (farZ - nearZ);
+    const float projection[16] = { yScale / aspect, 0, 0, 0,   0, yScale, 0, 0,   0, 0, range, 1,   0, 0, -range * nearZ, 0 };
+
+    Multiply(view, projection, out);
+}
+
+void RunCubeGrid(Bench::State& state, bool pooled)
+{
+    // The render thread is the caller here, the simulation thread would keep one more core busy
+    WorkerPool pool;
+    if (pooled)
+        pool.Init(WorkerPool::GetDefaultWorkerCount(2));
+
+    SoftwareRasterizer rasterizer;
+    rasterizer.Init(1280, 800, &pool);
+    const uint32_t cube = rasterizer.AddMesh(MakeCube(), kPhongLayout);
+
+    const Assets::MipChain diffuse = MakeChain(256, false);
+    const Assets::MipChain normal = MakeChain(64, true);
+    Renderer::SoftwareMaterial material;
+    material.pDiffuse = &diffuse;
+    material.pNormal = &normal;
+    material.Specularity = 128.0f;
+
+    // Turned about y by a different angle each, so no two cubes show the same faces
+    std::vector<float> world(kGridWidth * kGridWidth * 16, 0.0f);
+    for (uint32_t i = 0; i != kGridWidth * kGridWidth; ++i)
+    {
+        float* m = &world[i * 16];
+        const float angle = (float)i * 0.3f;
+        m[0] = cosf(angle);  m[2] = -sinf(angle);
+        m[5] = 1.0f;
+        m[8] = sinf(angle);  m[10] = cosf(angle);
+        m[12] = (float)(i / kGridWidth);  m[14] = (float)(i % kGridWidth);  m[15] = 1.0f;
+    }
+
+    const float eye[3] = { -5.0f, 5.0f, -5.0f };
+    const float at[3] = { 5.0f, 0.0f, 5.0f };
+    float viewProjection[16];
+    MakeViewProjection(eye, at, 1280.0f / 800.0f, viewProjection);
+
+    const Renderer::SoftwareLighting lighting = { { 0.1f, 0.1f, 0.1f }, { 1.0f, 1.0f, 1.0f }, { -1.0f, 0.5f, -1.3f }, { eye[0], eye[1], eye[2] } };
+    const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+    state.Run([&]()
+    {
+        rasterizer.BeginFrame(viewProjection, lighting, clearColor);
+        rasterizer.DrawInstanced(cube, material, world.data(), kGridWidth * kGridWidth);
+        rasterizer.EndFrame();
+        Bench::DoNotOptimize(rasterizer.GetStats().ShadedPixels);
+    });
+
+    pool.Shutdown();
+}
+
+}
+
+ESL_BENCHMARK(Raster_CubeGrid_Serial)
+{
+    RunCubeGrid(state, false);
+}
+
+ESL_BENCHMARK(Raster_CubeGrid_Pool)
+{
+    RunCubeGrid(state, true);
+}
@@ -0,0 +1,118 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Codex lookups, the old unordered_map<ID, T> path (find, then at)
+against ResourceTable handles. Both resolve the same shuffled stream of
+resources, like a frame's worth of draws would. Find is the ID to handle
+resolution that load time code does before it caches the handle.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Renderer/ResourceTable.h>
+#include <Easel/Renderer/hash_util.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// Same size and layout as Renderer::Mesh, without dragging in d3d11.h
+struct FakeMesh
+{
+    void*    VertexBuffer;
+    void*    IndexBuffer;
+    uint32_t IndexCount;
+    uint32_t Stride;
+};
+
+static const uint32_t kLookupsPerBatch = 16 * 1024;
+
+struct Fixture
+{
+    std::unordered_map<uint32_t, FakeMesh>              Map;
+    Renderer::ResourceTable<FakeMesh>                   Table;
+    std::vector<uint32_t>                               IDStream;
+    std::vector<Renderer::ResourceHandle<FakeMesh>>     HandleStream;
+
+    explicit Fixture(uint32_t resourceCount)
+    {
+        std::vector<uint32_t> ids;
+        for (uint32_t i = 0; i != resourceCount; ++i)
+        {
+            const std::string name = "mesh_" + std::to_string(i) + ".obj";
+            const uint32_t id = fnv1a(name.c_str());
+
+            FakeMesh mesh = { nullptr, nullptr, i * 3, 32 };
+            Map.insert(std::make_pair(id, mesh));
+            Table.Insert(id, mesh);
+            ids.push_back(id);
+        }
+
+        std::mt19937 rng(1234);
+        std::uniform_int_distribution<uint32_t> pick(0, resourceCount - 1);
+        for (uint32_t i = 0; i != kLookupsPerBatch; ++i)
+        {
+            const uint32_t id = ids[pick(rng)];
+            IDStream.push_back(id);
+            HandleStream.push_back(Table.Find(id)); // Resolved once, like at load time
+        }
+    }
+};
+
+void RunMap(Bench::State& state, uint32_t resourceCount)
+{
+    Fixture fixture(resourceCount);
+    state.SetOpsPerBatch(kLookupsPerBatch);
+    state.Run([&]()
+    {
+        uint64_t sum = 0;
+        for (uint32_t id : fixture.IDStream)
+        {
+            // Mirrors the old ResourceCodex::GetMesh
+            const FakeMesh* pMesh = fixture.Map.find(id) != fixture.Map.end() ? &fixture.Map.at(id) : nullptr;
+            sum += pMesh->IndexCount;
+        }
+        Bench::DoNotOptimize(sum);
+    });
+}
+
+void RunTable(Bench::State& state, uint32_t resourceCount)
+{
+    Fixture fixture(resourceCount);
+    state.SetOpsPerBatch(kLookupsPerBatch);
+    state.Run([&]()
+    {
+        uint64_t sum = 0;
+        for (Renderer::ResourceHandle<FakeMesh> handle : fixture.HandleStream)
+            sum += fixture.Table.Get(handle)->IndexCount;
+        Bench::DoNotOptimize(sum);
+    });
+}
+
+// Resolving IDs to handles, what Find*() costs every time it's called instead of cached
+void RunTableFind(Bench::State& state, uint32_t resourceCount)
+{
+    Fixture fixture(resourceCount);
+    state.SetOpsPerBatch(kLookupsPerBatch);
+    state.Run([&]()
+    {
+        uint64_t sum = 0;
+        for (uint32_t id : fixture.IDStream)
+            sum += fixture.Table.Find(id).Value;
+        Bench::DoNotOptimize(sum);
+    });
+}
+
+}
+
+ESL_BENCHMARK(ResourceLookup_Map_16)        { RunMap(state, 16); }
+ESL_BENCHMARK(ResourceLookup_Table_16)      { RunTable(state, 16); }
+ESL_BENCHMARK(ResourceLookup_Map_1024)      { RunMap(state, 1024); }
+ESL_BENCHMARK(ResourceLookup_Table_1024)    { RunTable(state, 1024); }
+ESL_BENCHMARK(ResourceLookup_Map_65536)     { RunMap(state, 65536); }
+ESL_BENCHMARK(ResourceLookup_Table_65536)   { RunTable(state, 65536); }
+ESL_BENCHMARK(ResourceLookup_Find_16)       { RunTableFind(state, 16); }
+ESL_BENCHMARK(ResourceLookup_Find_1024)     { RunTableFind(state, 1024); }
+ESL_BENCHMARK(ResourceLookup_Find_65536)    { RunTableFind(state, 65536); }
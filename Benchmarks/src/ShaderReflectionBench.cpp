@@ -0,0 +1,79 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : What startup pays per vertex shader for its layout. Load is
+reading a .refl back in, which is all ShaderFactory does when the build
+wrote them. Build is the signature to formats and offsets step that used
+to run after every D3DReflect, with its semantic name comparisons. The
+shader is the instanced PhongVS with its camera cbuffer.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Renderer/ShaderReflection.h>
+
+#include <string.h>
+#include <vector>
+
+namespace {
+
+using Renderer::ComponentType;
+using Renderer::ShaderReflection;
+using Renderer::ShaderReflector;
+using Renderer::SignatureParameter;
+
+const SignatureParameter kPhongSignature[] =
+{
+    { "POSITION", 0, 7, ComponentType::FLOAT32 },
+    { "NORMAL", 0, 7, ComponentType::FLOAT32 },
+    { "TEXCOORD", 0, 3, ComponentType::FLOAT32 },
+    { "TANGENT", 0, 7, ComponentType::FLOAT32 },
+    { "BINORMAL", 0, 7, ComponentType::FLOAT32 },
+    { "INSTANCE_WORLDMATRIX", 0, 15, ComponentType::FLOAT32 },
+    { "INSTANCE_WORLDMATRIX", 1, 15, ComponentType::FLOAT32 },
+    { "INSTANCE_WORLDMATRIX", 2, 15, ComponentType::FLOAT32 },
+    { "INSTANCE_WORLDMATRIX", 3, 15, ComponentType::FLOAT32 }
+};
+static const uint32_t kParamCount = sizeof(kPhongSignature) / sizeof(kPhongSignature[0]);
+
+std::vector<uint8_t> MakeBlob()
+{
+    ShaderReflection reflection;
+    ShaderReflector::BuildInputs(kPhongSignature, kParamCount, &reflection);
+
+    Renderer::ReflectedCBuffer camera = {};
+    strcpy(camera.Name, "VSPerPass");
+    camera.Register = 10;
+    camera.Size = 64;
+    camera.VariableCount = 1;
+    reflection.CBuffers.push_back(camera);
+
+    Renderer::ReflectedVariable viewProjection = {};
+    strcpy(viewProjection.Name, "viewProjection");
+    viewProjection.Size = 64;
+    reflection.Variables.push_back(viewProjection);
+
+    std::vector<uint8_t> blob;
+    ShaderReflector::Serialize(reflection, &blob);
+    return blob;
+}
+
+}
+
+ESL_BENCHMARK(ShaderReflection_Load_PhongVS)
+{
+    const std::vector<uint8_t> blob = MakeBlob();
+    ShaderReflection reflection;
+    state.Run([&]()
+    {
+        Bench::DoNotOptimize(ShaderReflector::Deserialize(blob.data(), blob.size(), &reflection));
+    });
+}
+
+ESL_BENCHMARK(ShaderReflection_Build_PhongVS)
+{
+    ShaderReflection reflection;
+    state.Run([&]()
+    {
+        Bench::DoNotOptimize(ShaderReflector::BuildInputs(kPhongSignature, kParamCount, &reflection));
+    });
+}
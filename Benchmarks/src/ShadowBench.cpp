@@ -0,0 +1,106 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : The CPU side of the sun's cascaded shadows. Fit is the splits
+and four cascades fitted around a view, Casters is every cascade's casters
+culled out of a 100x100 grid of unit cubes like CullingBench's, reported
+per cube per cascade. Frame is both, what the shadow tasks add to a frame.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Renderer/CascadedShadows.h>
+
+#include <math.h>
+#include <vector>
+
+namespace {
+
+using Renderer::BoundingSphere;
+using Renderer::CascadedShadows;
+using Renderer::Culling;
+using Renderer::ShadowCascade;
+
+static const uint32_t kGridWidth = 100;
+static const uint32_t kCascadeCount = 4;
+static const uint32_t kResolution = 2048;
+
+struct Scene
+{
+    ShadowCascade               Cascades[kCascadeCount];
+    std::vector<BoundingSphere> Spheres;
+    std::vector<uint32_t>       Casters;
+    float                       InverseView[16];
+    float                       ProjX = 0.0f;
+    float                       ProjY = 0.0f;
+    float                       ToLight[3] = { 0.3f, 0.8f, -0.5f };
+    uint32_t                    Frame = 0;
+
+    Scene()
+    {
+        // Cubes laid out in the XZ plane, 2 apart, centred on the origin
+        for (uint32_t i = 0; i != kGridWidth * kGridWidth; ++i)
+            Spheres.push_back({ (float)(i % kGridWidth) * 2.0f - (float)kGridWidth, 0.0f, (float)(i / kGridWidth) * 2.0f - (float)kGridWidth, 0.8660254f });
+        Casters.resize(Spheres.size());
+
+        // A 60 degree 16:9 view
+        ProjY = 1.0f / tanf(0.5235988f);
+        ProjX = ProjY * 9.0f / 16.0f;
+    }
+
+    // Turning a little every frame, standing at (0, 2, 0), so the fit never sees the same view twice in a row
+    void Fit()
+    {
+        const float yaw = (float)(Frame++ % 360) * 0.0174533f;
+        const float s = sinf(yaw), c = cosf(yaw);
+        const float world[16] = { c, 0, -s, 0,   0, 1, 0, 0,   s, 0, c, 0,   0, 2, 0, 1 };
+        for (int i = 0; i != 16; ++i)
+            InverseView[i] = world[i];
+
+        float splits[kCascadeCount + 1];
+        CascadedShadows::ComputeSplits(0.1f, 60.0f, 0.75f, kCascadeCount, splits);
+        for (uint32_t i = 0; i != kCascadeCount; ++i)
+            CascadedShadows::FitCascade(InverseView, ProjX, ProjY, splits[i], splits[i + 1], ToLight, kResolution, &Cascades[i]);
+    }
+
+    uint32_t CullCasters()
+    {
+        uint32_t total = 0;
+        for (const ShadowCascade& cascade : Cascades)
+            total += Culling::CullSpheres(cascade.Casters, Spheres.data(), (uint32_t)Spheres.size(), Casters.data());
+        return total;
+    }
+};
+
+}
+
+ESL_BENCHMARK(Shadow_Fit_4Cascades)
+{
+    Scene scene;
+    state.Run([&]()
+    {
+        scene.Fit();
+        Bench::DoNotOptimize(scene.Cascades[kCascadeCount - 1].ViewProjection[0]);
+    });
+}
+
+ESL_BENCHMARK(Shadow_Casters_10k)
+{
+    Scene scene;
+    scene.Fit();
+    state.SetOpsPerBatch(kGridWidth * kGridWidth * kCascadeCount);
+    state.Run([&]()
+    {
+        Bench::DoNotOptimize(scene.CullCasters());
+    });
+}
+
+ESL_BENCHMARK(Shadow_Frame_10k)
+{
+    Scene scene;
+    state.SetOpsPerBatch(kGridWidth * kGridWidth * kCascadeCount);
+    state.Run([&]()
+    {
+        scene.Fit();
+        Bench::DoNotOptimize(scene.CullCasters());
+    });
+}
@@ -0,0 +1,80 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Core::TaskGraph, laid out like Game's frame graph: input, then
+lights and culling, with transforms free to overlap input. Empty is the
+scheduling overhead alone, one Run of four tasks that do nothing. Work gives
+each task a few microseconds, so Pool against Serial shows what overlapping
+buys back, which on a machine with fewer cores than threads may be nothing.
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <Easel/Core/TaskGraph.h>
+#include <Easel/Core/WorkerPool.h>
+
+namespace {
+
+using Core::TaskGraph;
+using Core::WorkerPool;
+
+static const uint32_t kFloatsPerTask = 4096;
+
+// Stands in for a task's work. Each task has its own array, so only the graph orders them.
+void Churn(float* pData, uint32_t count)
+{
+    for (uint32_t i = 0; i != count; ++i)
+        pData[i] = pData[i] * 0.999f + 1.0f;
+    Bench::DoNotOptimize(pData[count - 1]);
+}
+
+void BuildFrameShape(TaskGraph* graph, float (*data)[kFloatsPerTask], uint32_t floatsPerTask)
+{
+    const TaskGraph::ResourceMask camera = 1 << 0, transforms = 1 << 1, view = 1 << 2, lights = 1 << 3, instances = 1 << 4;
+    graph->AddTask("Input",      0,                  camera | view, [=]() { Churn(data[0], floatsPerTask); });
+    graph->AddTask("Lights",     camera,             lights,        [=]() { Churn(data[1], floatsPerTask); });
+    graph->AddTask("Transforms", 0,                  transforms,    [=]() { Churn(data[2], floatsPerTask); });
+    graph->AddTask("Culling",    view | transforms,  instances,     [=]() { Churn(data[3], floatsPerTask); });
+    graph->Compile();
+}
+
+void RunFrameShape(Bench::State& state, uint32_t floatsPerTask, bool pooled)
+{
+    static float data[4][kFloatsPerTask] = {};
+
+    // The simulation thread is the caller here, the render thread would keep one more core busy
+    WorkerPool pool;
+    if (pooled)
+        pool.Init(WorkerPool::GetDefaultWorkerCount(2));
+
+    TaskGraph graph;
+    BuildFrameShape(&graph, data, floatsPerTask);
+
+    state.Run([&]()
+    {
+        graph.Run(&pool);
+    });
+
+    pool.Shutdown();
+}
+
+}
+
+ESL_BENCHMARK(TaskGraph_FrameShape_Empty_Serial)
+{
+    RunFrameShape(state, 1, false);
+}
+
+ESL_BENCHMARK(TaskGraph_FrameShape_Empty_Pool)
+{
+    RunFrameShape(state, 1, true);
+}
+
+ESL_BENCHMARK(TaskGraph_FrameShape_Work_Serial)
+{
+    RunFrameShape(state, kFloatsPerTask, false);
+}
+
+ESL_BENCHMARK(TaskGraph_FrameShape_Work_Pool)
+{
+    RunFrameShape(state, kFloatsPerTask, true);
+}
@@ -0,0 +1,66 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Transform::Recompute and Transform::Interpolate over a
+scene's worth of entities, the first half of EntityRenderer::Update. Needs
+DirectXMath, which ships with the Windows SDK, so other platforms report it
+skipped. See premake5.lua.
+----------------------------------------------*/
+#include "Bench.h"
+
+#if defined(ESL_BENCH_TRANSFORM)
+#include <Easel/Core/Transform.h>
+
+#include <vector>
+
+namespace {
+
+void RunRecompute(Bench::State& state, uint32_t count)
+{
+    std::vector<Core::Transform> transforms(count);
+    for (uint32_t i = 0; i != count; ++i)
+    {
+        transforms[i].SetTranslation((float)(i % 64), 0.0f, (float)(i / 64));
+        transforms[i].SetRotation(0.1f * i, 0.2f * i, 0.3f * i);
+    }
+
+    std::vector<DirectX::XMFLOAT4X4> worlds(count);
+    state.SetOpsPerBatch(count);
+    state.Run([&]()
+    {
+        for (uint32_t i = 0; i != count; ++i)
+            worlds[i] = transforms[i].Recompute();
+        Bench::DoNotOptimize(worlds.front());
+    });
+}
+
+// What EntityRenderer::Update does every presented frame under a fixed timestep
+void RunInterpolate(Bench::State& state, uint32_t count)
+{
+    std::vector<Core::Transform> previous(count), current(count);
+    for (uint32_t i = 0; i != count; ++i)
+    {
+        previous[i].SetTranslation((float)(i % 64), 0.0f, (float)(i / 64));
+        current[i] = previous[i];
+        current[i].Rotate(0.0f, 0.02f, 0.0f);
+    }
+
+    std::vector<DirectX::XMFLOAT4X4> worlds(count);
+    state.SetOpsPerBatch(count);
+    state.Run([&]()
+    {
+        for (uint32_t i = 0; i != count; ++i)
+            worlds[i] = Core::Transform::Interpolate(previous[i], current[i], 0.5f);
+        Bench::DoNotOptimize(worlds.front());
+    });
+}
+
+}
+
+ESL_BENCHMARK(Transform_Recompute_400)      { RunRecompute(state, 400); }
+ESL_BENCHMARK(Transform_Recompute_16384)    { RunRecompute(state, 16384); }
+ESL_BENCHMARK(Transform_Interpolate_400)    { RunInterpolate(state, 400); }
+ESL_BENCHMARK(Transform_Interpolate_16384)  { RunInterpolate(state, 16384); }
+#else
+ESL_BENCHMARK(Transform_Recompute)          { state.Skip("built without DirectXMath (ESL_BENCH_TRANSFORM)"); }
+#endif
@@ -0,0 +1,189 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Runs every registered benchmark, or only those whose name
+contains one of the filters on the command line.
+    --warmup <seconds>       Untimed running before the first repetition
+    --min-time <seconds>     Minimum duration of each repetition
+    --repetitions <count>    Samples taken per case
+    --assets <path>          Where Assets/ is, for cases that load from it
+    --json <file>            Also write every sample and statistic as JSON
+----------------------------------------------*/
+#include "Bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace {
+
+struct Result
+{
+    const Bench::Benchmark* pBench;
+    Bench::State            State;
+};
+
+FILE* OpenFile(const char* path)
+{
+    FILE* pFile = nullptr;
+    #if defined(_MSC_VER)
+    fopen_s(&pFile, path, "w");
+    #else
+    pFile = fopen(path, "w");
+    #endif
+    return pFile;
+}
+
+// Names and reasons are plain ASCII, only quotes and backslashes need escaping
+void WriteJSONString(FILE* pFile, const std::string& str)
+{
+    fputc('"', pFile);
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            fputc('\\', pFile);
+        fputc(c, pFile);
+    }
+    fputc('"', pFile);
+}
+
+const char* GetConfigurationName()
+{
+    #if defined(ESL_DEBUG)
+    return "Debug";
+    #elif defined(ESL_RELEASE)
+    return "Release";
+    #else
+    return "Unknown";
+    #endif
+}
+
+bool WriteJSON(const char* path, const std::vector<Result>& results)
+{
+    FILE* pFile = OpenFile(path);
+    if (!pFile)
+        return false;
+
+    const Bench::Options& options = Bench::GetOptions();
+
+    char timestamp[32] = "";
+    const time_t now = time(nullptr);
+    struct tm utc;
+    #if defined(_MSC_VER)
+    gmtime_s(&utc, &now);
+    #else
+    gmtime_r(&now, &utc);
+    #endif
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    fprintf(pFile, "{\n  \"context\": { \"date\": \"%s\", \"configuration\": \"%s\", \"warmupSeconds\": %g, \"minSeconds\": %g, \"repetitions\": %u },\n",
+        timestamp, GetConfigurationName(), options.WarmupSeconds, options.MinSeconds, options.Repetitions);
+    fprintf(pFile, "  \"benchmarks\": [");
+
+    bool first = true;
+    for (const Result& result : results)
+    {
+        const Bench::State& state = result.State;
+        fprintf(pFile, "%s\n    { \"name\": ", first ? "" : ",");
+        WriteJSONString(pFile, result.pBench->Name);
+        first = false;
+
+        if (!state.GetSkipReason().empty())
+        {
+            fprintf(pFile, ", \"skipped\": ");
+            WriteJSONString(pFile, state.GetSkipReason());
+            fprintf(pFile, " }");
+            continue;
+        }
+
+        const Bench::Statistics& stats = state.GetStatistics();
+        fprintf(pFile, ", \"unit\": \"ns/op\", \"opsPerBatch\": %llu, \"warmupBatches\": %llu, \"batches\": %llu,\n",
+            (unsigned long long)state.GetOpsPerBatch(), (unsigned long long)state.GetWarmupBatches(), (unsigned long long)state.GetBatches());
+        fprintf(pFile, "      \"min\": %.4f, \"median\": %.4f, \"mean\": %.4f, \"stddev\": %.4f, \"max\": %.4f,\n      \"samples\": [",
+            stats.Min, stats.Median, stats.Mean, stats.StdDev, stats.Max);
+
+        const std::vector<double>& samples = state.GetSamples();
+        for (size_t i = 0; i != samples.size(); ++i)
+            fprintf(pFile, "%s%.4f", i ? ", " : "", samples[i]);
+        fprintf(pFile, "] }");
+    }
+
+    fprintf(pFile, "\n  ]\n}\n");
+    fclose(pFile);
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Bench::Options& options = Bench::GetOptions();
+    const char* jsonPath = nullptr;
+    std::vector<const char*> filters;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--warmup") && hasValue)
+            options.WarmupSeconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--min-time") && hasValue)
+            options.MinSeconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--repetitions") && hasValue)
+        {
+            const int repetitions = atoi(argv[++i]);
+            options.Repetitions = repetitions > 0 ? (uint32_t)repetitions : 1;
+        }
+        else if (!strcmp(argv[i], "--assets") && hasValue)
+            options.AssetPath = argv[++i];
+        else if (!strcmp(argv[i], "--json") && hasValue)
+            jsonPath = argv[++i];
+        else if (!strncmp(argv[i], "--", 2))
+        {
+            fprintf(stderr, "Unknown or incomplete option '%s'\n", argv[i]);
+            return 1;
+        }
+        else
+            filters.push_back(argv[i]);
+    }
+
+    if (!options.AssetPath.empty() && options.AssetPath.back() != '/' && options.AssetPath.back() != '\\')
+        options.AssetPath += '/';
+
+    for (Bench::GeneratorFunc generator : Bench::GetGenerators())
+        generator(options);
+
+    std::vector<Result> results;
+    for (const Bench::Benchmark& bench : Bench::GetRegistry())
+    {
+        bool selected = filters.empty();
+        for (size_t i = 0; i != filters.size() && !selected; ++i)
+            selected = strstr(bench.Name.c_str(), filters[i]) != nullptr;
+
+        if (!selected)
+            continue;
+
+        results.push_back({ &bench, Bench::State() });
+        Bench::State& state = results.back().State;
+        bench.Func(state);
+
+        if (!state.GetSkipReason().empty())
+        {
+            printf("%-48s skipped: %s\n", bench.Name.c_str(), state.GetSkipReason().c_str());
+            continue;
+        }
+
+        // Spread as a percentage of the median, anything past a few percent deserves a rerun
+        const Bench::Statistics& stats = state.GetStatistics();
+        printf("%-48s %12.2f ns/op  min %12.2f  +/- %5.1f%%\n", bench.Name.c_str(), stats.Median, stats.Min,
+            stats.Median > 0.0 ? 100.0 * stats.StdDev / stats.Median : 0.0);
+        fflush(stdout);
+    }
+
+    if (jsonPath && !WriteJSON(jsonPath, results))
+    {
+        fprintf(stderr, "Couldn't write '%s'\n", jsonPath);
+        return 1;
+    }
+    return 0;
+}
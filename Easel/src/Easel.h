@@ -9,6 +9,7 @@ Description : Easel main header
 #include <Easel/Core/AppWindow.h>
 #include <Easel/Core/Core.h>
 #include <Easel/Core/GameWindow.h>
+#include <Easel/Core/Headless.h>
 #include <Easel/Core/WinApp.h>
 
 
@@ -0,0 +1,305 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of AssetCache.h
+Writers always go through a uniquely named temp file followed by a rename,
+so readers either see a complete blob or nothing at all. Since blobs are
+content addressed, two writers racing on one key write identical bytes.
+----------------------------------------------*/
+#include "AssetCache.h"
+
+#include <Easel/Renderer/hash_util.h>
+#include <Easel/Core/MemoryTracker.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdio.h>
+#include <thread>
+
+namespace Assets {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint32_t kBlobMagic         = 0x42434145; // 'EACB'
+const uint32_t kManifestMagic     = 0x4D434145; // 'EACM'
+const uint32_t kCacheFormatVersion = 1;
+
+struct BlobHeader
+{
+    uint32_t Magic;
+    uint32_t FormatVersion;
+    AssetKey Key;
+    uint64_t PayloadSize;
+    uint64_t PayloadHash;
+};
+
+bool ReadWholeFile(const std::string& path, std::vector<uint8_t>* out_bytes)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    const std::streamoff size = file.tellg();
+    if (size < 0)
+        return false;
+
+    out_bytes->resize((size_t)size);
+    file.seekg(0);
+    return size == 0 || (bool)file.read((char*)out_bytes->data(), size);
+}
+
+// Writes to a temp file then renames over the destination. Returns false (and cleans up) on any failure.
+bool AtomicWrite(const std::string& tempPath, const std::string& finalPath, const std::vector<uint8_t>& bytes)
+{
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+
+        file.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+        if (!file)
+        {
+            file.close();
+            std::error_code ec;
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tempPath, finalPath, ec);
+    if (ec)
+    {
+        // Most likely someone else has the destination open. For blobs that's fine, theirs has the same contents.
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+}
+
+AssetCache::AssetCache() :
+    mManifestDirty(false),
+    mEnabled(false)
+{}
+
+void AssetCache::Init(const std::string& cacheDir)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mCacheDir = cacheDir;
+
+    std::error_code ec;
+    fs::create_directories(mCacheDir, ec);
+    mEnabled = fs::is_directory(mCacheDir, ec);
+
+    mManifest.clear();
+    if (mEnabled)
+        ReadManifest(&mManifest);
+
+    mManifestDirty = false;
+}
+
+void AssetCache::Shutdown()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (!mEnabled || !mManifestDirty)
+        return;
+
+    // Someone else may have validated other files since we started, keep their entries too
+    Manifest merged;
+    ReadManifest(&merged);
+    for (auto const& entry : mManifest)
+        merged[entry.first] = entry.second;
+
+    std::vector<uint8_t> bytes;
+    BlobWriter writer(&bytes);
+    writer.Write(kManifestMagic);
+    writer.Write(kCacheFormatVersion);
+    writer.Write((uint32_t)merged.size());
+    for (auto const& entry : merged)
+    {
+        writer.Write((uint32_t)entry.first.size());
+        writer.WriteBytes(entry.first.data(), entry.first.size());
+        writer.Write(entry.second);
+    }
+
+    const std::string manifestPath = (fs::path(mCacheDir) / "manifest.bin").string();
+    if (AtomicWrite(GetTempPath(manifestPath), manifestPath, bytes))
+        mManifestDirty = false;
+}
+
+void AssetCache::ReadManifest(Manifest* out_manifest) const
+{
+    std::vector<uint8_t> bytes;
+    if (!ReadWholeFile((fs::path(mCacheDir) / "manifest.bin").string(), &bytes))
+        return;
+
+    BlobReader reader(bytes.data(), bytes.size());
+    uint32_t magic, version, count;
+    if (!reader.Read(&magic) || !reader.Read(&version) || !reader.Read(&count))
+        return;
+
+    // A stale format is simply ignored, every source gets rehashed once
+    if (magic != kManifestMagic || version != kCacheFormatVersion)
+        return;
+
+    for (uint32_t i = 0; i != count; ++i)
+    {
+        uint32_t pathLen;
+        if (!reader.Read(&pathLen) || (size_t)(reader.End - reader.Cursor) < pathLen)
+            return;
+
+        std::string path((const char*)reader.Cursor, pathLen);
+        reader.Cursor += pathLen;
+
+        ManifestEntry entry;
+        if (!reader.Read(&entry))
+            return;
+
+        (*out_manifest)[path] = entry;
+    }
+}
+
+bool AssetCache::GetSourceHash(const std::string& path, uint64_t* out_hash)
+{
+    std::error_code ec;
+    const uint64_t fileSize = (uint64_t)fs::file_size(path, ec);
+    if (ec)
+        return false;
+
+    const int64_t writeTime = (int64_t)fs::last_write_time(path, ec).time_since_epoch().count();
+    if (ec)
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto itFind = mManifest.find(path);
+        if (itFind != mManifest.end() && itFind->second.FileSize == fileSize && itFind->second.WriteTime == writeTime)
+        {
+            *out_hash = itFind->second.SourceHash;
+            return true;
+        }
+    }
+
+    // Changed or never seen: pay for the full read outside the lock
+    std::vector<uint8_t> bytes;
+    if (!ReadWholeFile(path, &bytes))
+        return false;
+
+    ManifestEntry entry;
+    entry.FileSize = fileSize;
+    entry.WriteTime = writeTime;
+    entry.SourceHash = fnv1a_64(bytes.data(), bytes.size());
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mManifest[path] = entry;
+        mManifestDirty = true;
+    }
+
+    *out_hash = entry.SourceHash;
+    return true;
+}
+
+AssetKey AssetCache::MakeKey(uint64_t sourceHash, uint32_t importerVersion, const void* settings, size_t settingsSize)
+{
+    uint64_t key = fnv1a_64(&sourceHash, sizeof(sourceHash));
+    key = fnv1a_64(&importerVersion, sizeof(importerVersion), key);
+    key = fnv1a_64(&kCacheFormatVersion, sizeof(kCacheFormatVersion), key);
+    if (settings && settingsSize)
+        key = fnv1a_64(settings, settingsSize, key);
+    return key;
+}
+
+bool AssetCache::Load(AssetKey key, std::vector<uint8_t>* out_blob) const
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::ASSETS);
+
+    if (!mEnabled)
+        return false;
+
+    std::ifstream file(GetBlobPath(key), std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    const std::streamoff fileSize = file.tellg();
+    if (fileSize < (std::streamoff)sizeof(BlobHeader))
+        return false;
+
+    BlobHeader header;
+    file.seekg(0);
+    if (!file.read((char*)&header, sizeof(BlobHeader)))
+        return false;
+
+    if (header.Magic != kBlobMagic || header.FormatVersion != kCacheFormatVersion || header.Key != key)
+        return false;
+
+    // A truncated blob can't happen through Store, but a crashed foreign writer or a full disk could leave one
+    if (header.PayloadSize != (uint64_t)fileSize - sizeof(BlobHeader))
+        return false;
+
+    // Straight into the caller's buffer, no intermediate copy
+    out_blob->resize((size_t)header.PayloadSize);
+    if (header.PayloadSize && !file.read((char*)out_blob->data(), (std::streamsize)header.PayloadSize))
+        return false;
+
+    #if defined(ESL_DEBUG)
+    if (fnv1a_64(out_blob->data(), out_blob->size()) != header.PayloadHash)
+        return false;
+    #endif
+
+    return true;
+}
+
+bool AssetCache::Store(AssetKey key, const void* data, size_t size)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::ASSETS);
+
+    if (!mEnabled)
+        return false;
+
+    BlobHeader header;
+    header.Magic = kBlobMagic;
+    header.FormatVersion = kCacheFormatVersion;
+    header.Key = key;
+    header.PayloadSize = size;
+    header.PayloadHash = fnv1a_64(data, size);
+
+    std::vector<uint8_t> bytes;
+    bytes.reserve(sizeof(BlobHeader) + size);
+    BlobWriter writer(&bytes);
+    writer.Write(header);
+    writer.WriteBytes(data, size);
+
+    const std::string blobPath = GetBlobPath(key);
+    return AtomicWrite(GetTempPath(blobPath), blobPath, bytes);
+}
+
+std::string AssetCache::GetBlobPath(AssetKey key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.blob", (unsigned long long)key);
+    return (fs::path(mCacheDir) / name).string();
+}
+
+std::string AssetCache::GetTempPath(const std::string& finalPath) const
+{
+    // Unique per thread and per call, and per process thanks to the clock
+    static std::atomic<uint32_t> sCounter(0);
+    const uint64_t threadHash = (uint64_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+    const uint64_t now = (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%llx.%llx.%x.tmp", (unsigned long long)threadHash, (unsigned long long)now, sCounter.fetch_add(1));
+    return finalPath + suffix;
+}
+
+}
@@ -0,0 +1,110 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Content-addressed on-disk cache for cooked asset data.
+Blobs are keyed by source bytes + importer version + import settings.
+----------------------------------------------*/
+#ifndef EASEL_ASSETCACHE_H
+#define EASEL_ASSETCACHE_H
+
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Assets {
+
+typedef uint64_t AssetKey;
+
+// Appends POD values and raw bytes to a blob
+struct BlobWriter
+{
+    explicit BlobWriter(std::vector<uint8_t>* out) : Out(out) {}
+
+    void WriteBytes(const void* data, size_t size)
+    {
+        const uint8_t* bytes = (const uint8_t*)data;
+        Out->insert(Out->end(), bytes, bytes + size);
+    }
+
+    template<typename T>
+    void Write(const T& value) { WriteBytes(&value, sizeof(T)); }
+
+    std::vector<uint8_t>* Out;
+};
+
+// Bounds-checked reads back out of a blob
+struct BlobReader
+{
+    BlobReader(const uint8_t* data, size_t size) : Cursor(data), End(data + size) {}
+
+    bool ReadBytes(void* out_data, size_t size)
+    {
+        if ((size_t)(End - Cursor) < size)
+            return false;
+
+        memcpy(out_data, Cursor, size);
+        Cursor += size;
+        return true;
+    }
+
+    template<typename T>
+    bool Read(T* out_value) { return ReadBytes(out_value, sizeof(T)); }
+
+    const uint8_t* Cursor;
+    const uint8_t* End;
+};
+
+class AssetCache
+{
+public:
+    inline static AssetCache& GetSingleton() { static AssetCache cacheInstance; return cacheInstance; }
+
+    // Creates the cache folder if needed and reads the manifest
+    void Init(const std::string& cacheDir);
+
+    // Merges our manifest changes with whatever other processes wrote and saves it
+    void Shutdown();
+
+    bool IsEnabled() const { return mEnabled; }
+
+    // Hash of the file's bytes. Served from the manifest without touching the contents when size and write time match.
+    bool GetSourceHash(const std::string& path, uint64_t* out_hash);
+
+    // Combines everything a cooked result depends on. Bump importerVersion whenever an importer's output changes.
+    static AssetKey MakeKey(uint64_t sourceHash, uint32_t importerVersion, const void* settings, size_t settingsSize);
+
+    // Safe to call from any thread, and from several processes sharing the same folder
+    bool Load(AssetKey key, std::vector<uint8_t>* out_blob) const;
+    bool Store(AssetKey key, const void* data, size_t size);
+
+private:
+    AssetCache();
+
+    struct ManifestEntry
+    {
+        uint64_t FileSize;
+        int64_t  WriteTime;
+        uint64_t SourceHash;
+    };
+    typedef std::unordered_map<std::string, ManifestEntry> Manifest;
+
+    std::string GetBlobPath(AssetKey key) const;
+    std::string GetTempPath(const std::string& finalPath) const;
+    void ReadManifest(Manifest* out_manifest) const;
+
+    std::string        mCacheDir;
+    mutable std::mutex mMutex;
+    Manifest           mManifest;
+    bool               mManifestDirty;
+    bool               mEnabled;
+
+public:
+    AssetCache(AssetCache const&)            = delete;
+    AssetCache& operator=(AssetCache const&) = delete;
+};
+
+}
+#endif
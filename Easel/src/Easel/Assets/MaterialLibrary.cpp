@@ -0,0 +1,258 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of MaterialLibrary.h
+----------------------------------------------*/
+#include "MaterialLibrary.h"
+
+#include <Easel/Core/MemoryTracker.h>
+#include <Easel/Core/Profiler.h>
+
+#include <charconv>
+#include <filesystem>
+
+namespace Assets {
+
+namespace {
+
+bool ParseFloat(std::string_view text, float* out_value)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+        text.remove_prefix(1);
+
+    const std::from_chars_result res = std::from_chars(text.data(), text.data() + text.size(), *out_value);
+    return res.ec == std::errc();
+}
+
+// Comma separated list of up to maxCount floats
+uint32_t ParseFloats(std::string_view text, float* out_values, uint32_t maxCount)
+{
+    uint32_t count = 0;
+    while (count != maxCount && !text.empty())
+    {
+        const size_t comma = text.find(',');
+        if (!ParseFloat(text.substr(0, comma), &out_values[count]))
+            break;
+
+        ++count;
+        if (comma == std::string_view::npos)
+            break;
+        text.remove_prefix(comma + 1);
+    }
+    return count;
+}
+
+bool ParseBool(std::string_view text, bool fallback)
+{
+    if (text == "true" || text == "1")
+        return true;
+    if (text == "false" || text == "0")
+        return false;
+    return fallback;
+}
+
+template<typename TEnum, size_t N>
+bool ParseEnum(std::string_view text, const char* const (&names)[N], TEnum* out_value)
+{
+    for (size_t i = 0; i != N; ++i)
+    {
+        if (text == names[i])
+        {
+            *out_value = (TEnum)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* const kFillNames[]    = { "solid", "wireframe" };
+const char* const kCullNames[]    = { "none", "front", "back" };
+const char* const kCompareNames[] = { "never", "less", "equal", "less_equal", "greater", "not_equal", "greater_equal", "always" };
+const char* const kBlendNames[]   = { "none", "alpha", "additive" };
+
+}
+
+bool MaterialLibrary::Load(const std::string& path, std::string* out_error)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::ASSETS);
+    ESL_PROFILE_ZONE("MaterialLibrary::Load");
+
+    mMaterials.clear();
+    if (!mFile.Open(path))
+    {
+        if (out_error)
+            *out_error = "couldn't open " + path;
+        return false;
+    }
+
+    if (!mDocument.Parse(mFile.GetData(), mFile.GetSize(), out_error) || !ParseMaterials(out_error))
+    {
+        if (out_error)
+            *out_error = path + ": " + *out_error;
+        return false;
+    }
+    return true;
+}
+
+bool MaterialLibrary::LoadFromMemory(const char* data, size_t size, std::string* out_error)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::ASSETS);
+
+    mMaterials.clear();
+    mFile.Close();
+    return mDocument.Parse(data, size, out_error) && ParseMaterials(out_error);
+}
+
+bool MaterialLibrary::ParseMaterials(std::string* out_error)
+{
+    auto fail = [&](std::string_view material, const char* msg)
+    {
+        if (out_error)
+            *out_error = "material '" + std::string(material) + "': " + msg;
+        return false;
+    };
+
+    const XmlDocument& doc = mDocument;
+    const uint32_t root = doc.FirstChild(XmlDocument::kDocumentNode, "materials");
+    if (root == kInvalidXmlNode)
+    {
+        if (out_error)
+            *out_error = "missing <materials> root";
+        return false;
+    }
+
+    for (uint32_t matNode = doc.FirstChild(root, "material"); matNode != kInvalidXmlNode; matNode = doc.NextSibling(matNode, "material"))
+    {
+        MaterialDesc desc;
+        desc.Name = doc.GetAttribute(matNode, "name");
+        if (desc.Name.empty())
+            return fail(desc.Name, "has no name");
+
+        for (uint32_t child = doc.FirstChild(matNode); child != kInvalidXmlNode; child = doc.NextSibling(child))
+        {
+            const std::string_view tag = doc.GetNode(child).Name;
+            if (tag == "shader")
+            {
+                const std::string_view type = doc.GetAttribute(child, "type");
+                if (type == "VS")
+                    desc.VertexShader = doc.GetAttribute(child, "name");
+                else if (type == "PS")
+                {
+                    desc.PixelShader = doc.GetAttribute(child, "name");
+                    desc.PackedPixelShader = doc.GetAttribute(child, "packed");
+                }
+                else
+                    return fail(desc.Name, "unknown shader type");
+            }
+            else if (tag == "textures")
+            {
+                desc.Textures = doc.GetAttribute(child, "name");
+            }
+            else if (tag == "features")
+            {
+                using Renderer::ShaderFeature;
+                using Renderer::ShaderPermutations;
+
+                Renderer::PermutationKey features = 0;
+                if (ParseBool(doc.GetAttribute(child, "normalmap"), false))
+                    features |= (Renderer::PermutationKey)ShaderFeature::NORMAL_MAP;
+                if (ParseBool(doc.GetAttribute(child, "alphatest"), false))
+                    features |= (Renderer::PermutationKey)ShaderFeature::ALPHA_TEST;
+                if (ParseBool(doc.GetAttribute(child, "instanced"), false))
+                    features |= (Renderer::PermutationKey)ShaderFeature::INSTANCED;
+
+                Renderer::LightClass lights = Renderer::LightClass::AMBIENT;
+                const std::string_view lightName = doc.GetAttribute(child, "lights");
+                if (!lightName.empty() && !ShaderPermutations::ParseLightClass(lightName, &lights))
+                    return fail(desc.Name, "unknown light class");
+
+                desc.Features = ShaderPermutations::MakeKey(features, lights);
+            }
+            else if (tag == "params")
+            {
+                for (uint32_t param = doc.FirstChild(child); param != kInvalidXmlNode; param = doc.NextSibling(param))
+                {
+                    const XmlNode& p = doc.GetNode(param);
+                    if (p.Name == "tint")
+                    {
+                        if (ParseFloats(p.Text, desc.Tint, 4) < 3)
+                            return fail(desc.Name, "tint needs at least 3 components");
+                    }
+                    else if (p.Name == "specular")
+                    {
+                        if (!ParseFloat(p.Text, &desc.SpecularExp))
+                            return fail(desc.Name, "specular isn't a number");
+                    }
+                }
+            }
+            else if (tag == "raster")
+            {
+                desc.HasRasterState = true;
+                const std::string_view fill = doc.GetAttribute(child, "fill");
+                const std::string_view cull = doc.GetAttribute(child, "cull");
+                if (!fill.empty() && !ParseEnum(fill, kFillNames, &desc.Raster.Fill))
+                    return fail(desc.Name, "unknown fill mode");
+                if (!cull.empty() && !ParseEnum(cull, kCullNames, &desc.Raster.Cull))
+                    return fail(desc.Name, "unknown cull mode");
+                desc.Raster.DepthClip = ParseBool(doc.GetAttribute(child, "depthclip"), desc.Raster.DepthClip);
+            }
+            else if (tag == "depth")
+            {
+                desc.HasDepthState = true;
+                const std::string_view func = doc.GetAttribute(child, "func");
+                if (!func.empty() && !ParseEnum(func, kCompareNames, &desc.Depth.Func))
+                    return fail(desc.Name, "unknown depth func");
+                desc.Depth.DepthEnable = ParseBool(doc.GetAttribute(child, "enable"), desc.Depth.DepthEnable);
+                desc.Depth.DepthWrite = ParseBool(doc.GetAttribute(child, "write"), desc.Depth.DepthWrite);
+            }
+            else if (tag == "blend")
+            {
+                desc.HasBlendState = true;
+                const std::string_view mode = doc.GetAttribute(child, "mode");
+                if (!mode.empty() && !ParseEnum(mode, kBlendNames, &desc.Blend.Mode))
+                    return fail(desc.Name, "unknown blend mode");
+            }
+        }
+
+        if (desc.VertexShader.empty() || desc.PixelShader.empty())
+            return fail(desc.Name, "needs both a VS and a PS");
+
+        mMaterials.push_back(desc);
+    }
+
+    return true;
+}
+
+bool MaterialLibrary::ReadManifest(const std::string& codexPath, std::vector<std::string>* out_libraries, std::string* out_error)
+{
+    Core::MappedFile file;
+    if (!file.Open(codexPath))
+    {
+        if (out_error)
+            *out_error = "couldn't open " + codexPath;
+        return false;
+    }
+
+    XmlDocument doc;
+    if (!doc.Parse(file.GetData(), file.GetSize(), out_error))
+        return false;
+
+    const uint32_t root = doc.FirstChild(XmlDocument::kDocumentNode, "codex");
+    if (root == kInvalidXmlNode)
+    {
+        if (out_error)
+            *out_error = "missing <codex> root";
+        return false;
+    }
+
+    const std::filesystem::path folder = std::filesystem::path(codexPath).parent_path();
+    for (uint32_t lib = doc.FirstChild(root, "materials"); lib != kInvalidXmlNode; lib = doc.NextSibling(lib, "materials"))
+    {
+        const std::string_view libPath = doc.GetAttribute(lib, "path");
+        if (!libPath.empty())
+            out_libraries->push_back((folder / std::string(libPath)).string());
+    }
+    return true;
+}
+
+}
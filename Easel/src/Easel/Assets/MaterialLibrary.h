@@ -0,0 +1,121 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Material definitions read from XML (Assets/materials.xml).
+Only describes materials, the renderer turns them into D3D objects.
+All strings are views into the mapped file, so keep the library
+alive for as long as its descs are used.
+----------------------------------------------*/
+#ifndef EASEL_MATERIALLIBRARY_H
+#define EASEL_MATERIALLIBRARY_H
+
+#include "XmlDocument.h"
+
+#include <Easel/Core/MappedFile.h>
+#include <Easel/Renderer/ShaderPermutations.h>
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Assets {
+
+enum class FillMode : uint8_t
+{
+    SOLID,
+    WIREFRAME
+};
+
+enum class CullMode : uint8_t
+{
+    NONE,
+    FRONT,
+    BACK
+};
+
+enum class CompareFunc : uint8_t
+{
+    NEVER,
+    LESS,
+    EQUAL,
+    LESS_EQUAL,
+    GREATER,
+    NOT_EQUAL,
+    GREATER_EQUAL,
+    ALWAYS
+};
+
+enum class BlendMode : uint8_t
+{
+    NONE,
+    ALPHA,
+    ADDITIVE
+};
+
+struct RasterStateDesc
+{
+    FillMode Fill      = FillMode::SOLID;
+    CullMode Cull      = CullMode::BACK;
+    bool     DepthClip = true;
+};
+
+struct DepthStateDesc
+{
+    bool        DepthEnable = true;
+    bool        DepthWrite  = true;
+    CompareFunc Func        = CompareFunc::LESS;
+};
+
+struct BlendStateDesc
+{
+    BlendMode Mode = BlendMode::NONE;
+};
+
+struct MaterialDesc
+{
+    std::string_view Name;
+    std::string_view VertexShader;
+    std::string_view PixelShader;
+    std::string_view PackedPixelShader; // Replaces PixelShader when the texture set was packed into a bank
+    std::string_view Textures;          // Texture set name: "Lunar" covers Lunar_T, Lunar_N...
+
+    // From <features>. Picks the variant when a shader names a permutation family rather than a file.
+    // TEXTURE_ARRAY is never read from the file, it's set when the texture set turns out to be packed.
+    Renderer::PermutationKey Features = 0;
+
+    float            Tint[4]     = { 0.0f, 0.0f, 0.0f, 1.0f };
+    float            SpecularExp = 0.0f;
+
+    bool             HasRasterState = false;
+    RasterStateDesc  Raster;
+    bool             HasDepthState = false;
+    DepthStateDesc   Depth;
+    bool             HasBlendState = false;
+    BlendStateDesc   Blend;
+};
+
+class MaterialLibrary
+{
+public:
+    // Maps the file and parses every <material> in it
+    bool Load(const std::string& path, std::string* out_error = nullptr);
+
+    // Same, from a buffer the caller keeps alive
+    bool LoadFromMemory(const char* data, size_t size, std::string* out_error = nullptr);
+
+    const std::vector<MaterialDesc>& GetMaterials() const { return mMaterials; }
+
+    // codex.xml lists which material libraries make up the game. Paths come back relative to the codex's folder.
+    static bool ReadManifest(const std::string& codexPath, std::vector<std::string>* out_libraries, std::string* out_error = nullptr);
+
+private:
+    bool ParseMaterials(std::string* out_error);
+
+    Core::MappedFile          mFile;
+    XmlDocument               mDocument;
+    std::vector<MaterialDesc> mMaterials;
+};
+
+}
+#endif
@@ -0,0 +1,242 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of MeshImporter.h
+----------------------------------------------*/
+#include "MeshImporter.h"
+
+#include <Easel/Core/MemoryTracker.h>
+#include <Easel/Core/Profiler.h>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+namespace Assets {
+
+const uint32_t MeshImporter::kPostProcessFlags =
+    aiProcess_Triangulate           |
+    aiProcess_JoinIdenticalVertices |   // Remove unnecessary duplicate information
+    aiProcess_GenNormals            |   // Ensure normals are generated
+    aiProcess_CalcTangentSpace;         // Needed for normal mapping
+
+// Centered on the box around every position, so it's only a little looser than the tightest sphere
+static Renderer::BoundingSphere ComputeBounds(const aiScene* pScene)
+{
+    Renderer::BoundingSphere bounds;
+
+    aiVector3D minimum(FLT_MAX, FLT_MAX, FLT_MAX);
+    aiVector3D maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (unsigned int i = 0; i != pScene->mNumMeshes; ++i)
+    {
+        const aiMesh* pMesh = pScene->mMeshes[i];
+        for (unsigned int j = 0; j != pMesh->mNumVertices; ++j)
+        {
+            const aiVector3D& p = pMesh->mVertices[j];
+            minimum.x = p.x < minimum.x ? p.x : minimum.x;
+            minimum.y = p.y < minimum.y ? p.y : minimum.y;
+            minimum.z = p.z < minimum.z ? p.z : minimum.z;
+            maximum.x = p.x > maximum.x ? p.x : maximum.x;
+            maximum.y = p.y > maximum.y ? p.y : maximum.y;
+            maximum.z = p.z > maximum.z ? p.z : maximum.z;
+        }
+    }
+
+    if (minimum.x > maximum.x)
+        return bounds; // No vertices
+
+    const aiVector3D center = (minimum + maximum) * 0.5f;
+    float radiusSq = 0.0f;
+    for (unsigned int i = 0; i != pScene->mNumMeshes; ++i)
+    {
+        const aiMesh* pMesh = pScene->mMeshes[i];
+        for (unsigned int j = 0; j != pMesh->mNumVertices; ++j)
+        {
+            const float distSq = (pMesh->mVertices[j] - center).SquareLength();
+            radiusSq = distSq > radiusSq ? distSq : radiusSq;
+        }
+    }
+
+    bounds.X = center.x;
+    bounds.Y = center.y;
+    bounds.Z = center.z;
+    bounds.Radius = sqrtf(radiusSq);
+    return bounds;
+}
+
+bool MeshImporter::Import(const std::string& path, const Renderer::VertexBufferDescription& layout, CookedMesh* out_mesh, std::string* out_error)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::ASSETS);
+    ESL_PROFILE_ZONE("MeshImporter::Import");
+
+    using Renderer::Semantics;
+
+    Assimp::Importer Importer;
+
+    // Load assimpScene with proper flags
+    const aiScene* pScene = Importer.ReadFile(path, kPostProcessFlags);
+    if (!pScene)
+    {
+        if (out_error)
+            *out_error = Importer.GetErrorString();
+        return false;
+    }
+
+    const uint32_t stride = layout.ByteSize;
+
+    // aiScenes may be composed of multiple submeshes,
+    // we want to coagulate this into a single vertex/index buffer
+    size_t totalVertices = 0, totalIndices = 0;
+    for (unsigned int i = 0; i != pScene->mNumMeshes; ++i)
+    {
+        totalVertices += pScene->mMeshes[i]->mNumVertices;
+        totalIndices += (size_t)pScene->mMeshes[i]->mNumFaces * 3;
+    }
+
+    out_mesh->Stride = stride;
+    out_mesh->Vertices.assign(totalVertices * stride, 0);
+    out_mesh->Indices.resize(totalIndices);
+
+    uint8_t* vertices = out_mesh->Vertices.data();
+    uint32_t* indices = out_mesh->Indices.data();
+    uint32_t baseVertex = 0;
+
+    for (unsigned int i = 0; i != pScene->mNumMeshes; ++i)
+    {
+        const aiMesh* pMesh = pScene->mMeshes[i];
+
+        // Process Vertices for this mesh
+        for (unsigned int j = 0; j != pMesh->mNumVertices; ++j)
+        {
+            // Assign needed vertex attributes
+            for (unsigned int k = 0; k != layout.AttrCount; ++k)
+            {
+                const unsigned int currByteOffset = layout.ByteOffsets[k];
+                const unsigned int nextByteOffset = (k+1) != layout.AttrCount ? layout.ByteOffsets[k+1] : layout.ByteSize;
+                const unsigned int numComponents = (nextByteOffset - currByteOffset) / sizeof(float);
+                uint8_t* copyLocation = (vertices + (size_t)(baseVertex + j) * stride) + currByteOffset;
+
+                switch (layout.SemanticsArr[k])
+                {
+                    case Semantics::POSITION:
+                        assert(pMesh->HasPositions());
+                        memcpy(copyLocation, &(pMesh->mVertices[j]), sizeof(float) * numComponents);
+                        break;
+                    case Semantics::NORMAL:
+                        assert(pMesh->HasNormals());
+                        memcpy(copyLocation, &(pMesh->mNormals[j]), sizeof(float) * numComponents);
+                        break;
+                    case Semantics::TEXCOORD:
+                        assert(pMesh->HasTextureCoords(0));
+                        memcpy(copyLocation, &(pMesh->mTextureCoords[0][j]), sizeof(float) * numComponents);
+                        break;
+                    case Semantics::TANGENT:
+                        assert(pMesh->HasTangentsAndBitangents());
+                        memcpy(copyLocation, &(pMesh->mTangents[j]), sizeof(float) * numComponents);
+                        break;
+                    case Semantics::BINORMAL:
+                        assert(pMesh->HasTangentsAndBitangents());
+                        memcpy(copyLocation, &(pMesh->mBitangents[j]), sizeof(float) * numComponents);
+                        break;
+                    case Semantics::COLOR: // Lacks testing
+                        assert(pMesh->HasVertexColors(0));
+                        memcpy(copyLocation, &(pMesh->mColors[0][j]), sizeof(float) * numComponents);
+                        break;
+                    default: // Unhandled semantic, left zeroed
+                        break;
+                }
+            }
+        }
+
+        // Process Indices next, rebased onto this submesh's first vertex
+        for (unsigned int j = 0; j < pMesh->mNumFaces; ++j)
+        {
+            const aiFace& face = pMesh->mFaces[j];
+            assert(face.mNumIndices == 3); // Sanity check
+
+            *indices++ = baseVertex + face.mIndices[0];
+            *indices++ = baseVertex + face.mIndices[1];
+            *indices++ = baseVertex + face.mIndices[2];
+        }
+
+        baseVertex += pMesh->mNumVertices;
+    }
+
+    out_mesh->Bounds = ComputeBounds(pScene);
+    return true;
+}
+
+bool MeshImporter::ImportCached(const std::string& path, const Renderer::VertexBufferDescription& layout, CookedMesh* out_mesh, std::string* out_error)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::ASSETS);
+    ESL_PROFILE_ZONE("MeshImporter::ImportCached");
+
+    AssetCache& cache = AssetCache::GetSingleton();
+
+    uint64_t sourceHash = 0;
+    const bool canCache = cache.IsEnabled() && cache.GetSourceHash(path, &sourceHash);
+    const AssetKey key = canCache ? MakeCacheKey(sourceHash, layout) : 0;
+
+    std::vector<uint8_t> blob;
+    if (canCache && cache.Load(key, &blob) && Deserialize(blob.data(), blob.size(), out_mesh))
+        return true;
+
+    if (!Import(path, layout, out_mesh, out_error))
+        return false;
+
+    if (canCache)
+    {
+        blob.clear();
+        Serialize(*out_mesh, &blob);
+        cache.Store(key, blob.data(), blob.size());
+    }
+    return true;
+}
+
+AssetKey MeshImporter::MakeCacheKey(uint64_t sourceHash, const Renderer::VertexBufferDescription& layout)
+{
+    // The vertex layout decides which attributes get copied where, so it's part of the import settings
+    std::vector<uint8_t> settings;
+    BlobWriter writer(&settings);
+    writer.Write(kPostProcessFlags);
+    writer.Write(layout.AttrCount);
+    writer.Write(layout.ByteSize);
+    writer.WriteBytes(layout.SemanticsArr, sizeof(Renderer::Semantics) * layout.AttrCount);
+    writer.WriteBytes(layout.ByteOffsets, sizeof(uint16_t) * layout.AttrCount);
+
+    return AssetCache::MakeKey(sourceHash, kVersion, settings.data(), settings.size());
+}
+
+void MeshImporter::Serialize(const CookedMesh& mesh, std::vector<uint8_t>* out_blob)
+{
+    BlobWriter writer(out_blob);
+    writer.Write(mesh.Stride);
+    writer.Write(mesh.Bounds);
+    writer.Write((uint64_t)mesh.Vertices.size());
+    writer.Write((uint64_t)mesh.Indices.size());
+    writer.WriteBytes(mesh.Vertices.data(), mesh.Vertices.size());
+    writer.WriteBytes(mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+}
+
+bool MeshImporter::Deserialize(const uint8_t* blob, size_t size, CookedMesh* out_mesh)
+{
+    BlobReader reader(blob, size);
+
+    uint64_t vertexBytes, indexCount;
+    if (!reader.Read(&out_mesh->Stride) || !reader.Read(&out_mesh->Bounds) || !reader.Read(&vertexBytes) || !reader.Read(&indexCount))
+        return false;
+
+    if ((uint64_t)(reader.End - reader.Cursor) != vertexBytes + indexCount * sizeof(uint32_t))
+        return false;
+
+    out_mesh->Vertices.resize((size_t)vertexBytes);
+    out_mesh->Indices.resize((size_t)indexCount);
+    return reader.ReadBytes(out_mesh->Vertices.data(), (size_t)vertexBytes) &&
+           reader.ReadBytes(out_mesh->Indices.data(), (size_t)indexCount * sizeof(uint32_t));
+}
+
+}
@@ -0,0 +1,51 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Device independent mesh import through Assimp.
+Produces vertex/index data laid out for a given vertex shader.
+----------------------------------------------*/
+#ifndef EASEL_MESHIMPORTER_H
+#define EASEL_MESHIMPORTER_H
+
+#include <Easel/Renderer/Culling.h>
+#include <Easel/Renderer/VertexFormat.h>
+
+#include "AssetCache.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Assets {
+
+// Vertices laid out exactly as the vertex shader expects, ready for upload
+struct CookedMesh
+{
+    std::vector<uint8_t>     Vertices;
+    std::vector<uint32_t>    Indices;
+    uint32_t                 Stride = 0;
+    Renderer::BoundingSphere Bounds;    // Model space, encloses every vertex
+};
+
+struct MeshImporter final
+{
+    // Bump whenever the cooked output changes for the same inputs
+    static constexpr uint32_t kVersion = 2;
+
+    // Assimp post-process steps applied to every import (part of the cache key)
+    static const uint32_t kPostProcessFlags;
+
+    // Runs Assimp and packs every submesh into a single vertex/index buffer
+    static bool Import(const std::string& path, const Renderer::VertexBufferDescription& layout, CookedMesh* out_mesh, std::string* out_error = nullptr);
+
+    // Same as Import, but served from the AssetCache when the source, importer and layout haven't changed
+    static bool ImportCached(const std::string& path, const Renderer::VertexBufferDescription& layout, CookedMesh* out_mesh, std::string* out_error = nullptr);
+
+    static AssetKey MakeCacheKey(uint64_t sourceHash, const Renderer::VertexBufferDescription& layout);
+
+    static void Serialize(const CookedMesh& mesh, std::vector<uint8_t>* out_blob);
+    static bool Deserialize(const uint8_t* blob, size_t size, CookedMesh* out_mesh);
+};
+
+}
+#endif
@@ -0,0 +1,503 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of MipGenerator.h
+Each level is produced from the previous one with a separable
+polyphase filter in float precision. One RGBA texel maps to one
+SSE register, and both passes are split across a WorkerPool in row blocks.
+----------------------------------------------*/
+#include "MipGenerator.h"
+
+#include <Easel/Core/MemoryTracker.h>
+#include <Easel/Core/Profiler.h>
+#include <Easel/Core/WorkerPool.h>
+
+#include "AssetCache.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+    #define ESL_MIP_SSE 1
+    #include <emmintrin.h>
+#else
+    #define ESL_MIP_SSE 0
+#endif
+
+namespace Assets {
+
+namespace {
+
+const float kPi = 3.14159265358979f;
+
+// Rows per dispatched item: small enough to balance the lower mips, large enough to amortize the claim
+const uint32_t kRowGrain = 16;
+
+// A full chain for the largest possible dimensions, a cached blob claiming more is corrupt
+const uint32_t kMaxLevels = 32;
+
+// Calls func(y) for every row in [0, rows), kRowGrain rows per item on the pool
+template<typename TFunc>
+void ForEachRow(Core::WorkerPool* pPool, uint32_t rows, const TFunc& func)
+{
+    const uint32_t blocks = (rows + kRowGrain - 1) / kRowGrain;
+    if (!pPool || blocks <= 1)
+    {
+        for (uint32_t y = 0; y != rows; ++y)
+            func(y);
+        return;
+    }
+
+    struct Context
+    {
+        const TFunc* pFunc;
+        uint32_t     Rows;
+    };
+    Context context = { &func, rows };
+
+    pPool->Dispatch(blocks, [](void* pContext, uint32_t block)
+    {
+        const Context& ctx = *static_cast<const Context*>(pContext);
+        const uint32_t end = std::min(ctx.Rows, (block + 1) * kRowGrain);
+        for (uint32_t y = block * kRowGrain; y != end; ++y)
+            (*ctx.pFunc)(y);
+    }, &context);
+}
+
+// Support radius of each filter, in destination texels
+const float kFilterRadius[(uint8_t)MipFilter::COUNT] =
+{
+    0.5f,   // BOX
+    3.0f,   // KAISER
+    3.0f    // LANCZOS
+};
+
+const float kKaiserAlpha = 4.0f;
+
+float Sinc(float x)
+{
+    if (fabsf(x) < 1e-5f)
+        return 1.0f;
+
+    x *= kPi;
+    return sinf(x) / x;
+}
+
+// Zeroth order modified Bessel function of the first kind, power series
+float BesselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    const float halfSq = 0.25f * x * x;
+    for (int k = 1; k != 32; ++k)
+    {
+        term *= halfSq / (float)(k * k);
+        sum += term;
+        if (term < sum * 1e-7f)
+            break;
+    }
+    return sum;
+}
+
+float EvaluateKernel(MipFilter filter, float x)
+{
+    const float radius = kFilterRadius[(uint8_t)filter];
+    const float ax = fabsf(x);
+
+    switch (filter)
+    {
+        case MipFilter::BOX:
+            return ax < radius ? 1.0f : 0.0f;
+        case MipFilter::KAISER:
+        {
+            if (ax >= radius)
+                return 0.0f;
+
+            const float t = ax / radius;
+            return Sinc(x) * BesselI0(kKaiserAlpha * sqrtf(1.0f - t * t)) / BesselI0(kKaiserAlpha);
+        }
+        case MipFilter::LANCZOS:
+            return ax < radius ? Sinc(x) * Sinc(x / radius) : 0.0f;
+        default:
+            assert(false);
+            return 0.0f;
+    }
+}
+
+// Precomputed taps for resampling one axis from srcSize to dstSize
+struct FilterTaps
+{
+    std::vector<uint32_t> Indices; // dstSize * MaxTaps source texel indices (already wrapped/clamped)
+    std::vector<float>    Weights; // dstSize * MaxTaps normalized weights, zero padded
+    uint32_t              MaxTaps;
+};
+
+void BuildTaps(MipFilter filter, uint32_t srcSize, uint32_t dstSize, bool wrap, FilterTaps* out_taps)
+{
+    const float scale = (float)srcSize / (float)dstSize;
+    const float filterScale = std::max(1.0f, scale);
+    const float support = kFilterRadius[(uint8_t)filter] * filterScale;
+
+    const uint32_t maxTaps = (uint32_t)ceilf(support * 2.0f) + 1;
+    out_taps->MaxTaps = maxTaps;
+    out_taps->Indices.assign(dstSize * maxTaps, 0);
+    out_taps->Weights.assign(dstSize * maxTaps, 0.0f);
+
+    for (uint32_t d = 0; d != dstSize; ++d)
+    {
+        const float center = ((float)d + 0.5f) * scale;
+        const int32_t first = (int32_t)floorf(center - support);
+        const int32_t last = (int32_t)ceilf(center + support);
+
+        uint32_t* indices = &out_taps->Indices[d * maxTaps];
+        float* weights = &out_taps->Weights[d * maxTaps];
+
+        uint32_t numTaps = 0;
+        float totalWeight = 0.0f;
+        for (int32_t s = first; s <= last && numTaps != maxTaps; ++s)
+        {
+            const float w = EvaluateKernel(filter, ((float)s + 0.5f - center) / filterScale);
+            if (w == 0.0f)
+                continue;
+
+            int32_t src = s;
+            if (wrap)
+                src = ((src % (int32_t)srcSize) + (int32_t)srcSize) % (int32_t)srcSize;
+            else
+                src = std::min(std::max(src, 0), (int32_t)srcSize - 1);
+
+            indices[numTaps] = (uint32_t)src;
+            weights[numTaps] = w;
+            totalWeight += w;
+            ++numTaps;
+        }
+
+        // 1:1 or degenerate case, just point sample
+        if (numTaps == 0 || totalWeight == 0.0f)
+        {
+            indices[0] = std::min((uint32_t)center, srcSize - 1);
+            weights[0] = 1.0f;
+            continue;
+        }
+
+        const float invTotal = 1.0f / totalWeight;
+        for (uint32_t k = 0; k != numTaps; ++k)
+            weights[k] *= invTotal;
+    }
+}
+
+// sRGB transfer functions, as LUTs since they are called per channel per texel
+struct SrgbTables
+{
+    float   ToLinear[256];
+    uint8_t FromLinear[65536];
+
+    SrgbTables()
+    {
+        for (uint32_t i = 0; i != 256; ++i)
+        {
+            const float c = (float)i / 255.0f;
+            ToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        for (uint32_t i = 0; i != 65536; ++i)
+        {
+            const float l = (float)i / 65535.0f;
+            const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+            FromLinear[i] = (uint8_t)(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+};
+
+const SrgbTables& GetSrgbTables()
+{
+    static const SrgbTables sTables;
+    return sTables;
+}
+
+inline uint8_t QuantizeUnorm(float v)
+{
+    return (uint8_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// out[x] = sum_k w[k] * src[idx[k]] for every destination texel of one row
+void FilterRowHorizontal(const float* srcRow, const FilterTaps& taps, uint32_t dstWidth, float* out_row)
+{
+    const uint32_t maxTaps = taps.MaxTaps;
+    for (uint32_t x = 0; x != dstWidth; ++x)
+    {
+        const uint32_t* indices = &taps.Indices[x * maxTaps];
+        const float* weights = &taps.Weights[x * maxTaps];
+
+    #if ESL_MIP_SSE
+        __m128 acc = _mm_setzero_ps();
+        for (uint32_t k = 0; k != maxTaps; ++k)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(srcRow + indices[k] * 4)));
+        _mm_storeu_ps(out_row + x * 4, acc);
+    #else
+        float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (uint32_t k = 0; k != maxTaps; ++k)
+            for (uint32_t c = 0; c != 4; ++c)
+                acc[c] += weights[k] * srcRow[indices[k] * 4 + c];
+        memcpy(out_row + x * 4, acc, sizeof(acc));
+    #endif
+    }
+}
+
+// out_row += w * srcRow, streaming over a whole row
+void AccumulateRow(const float* srcRow, float w, uint32_t width, float* out_row)
+{
+    const uint32_t numFloats = width * 4;
+
+#if ESL_MIP_SSE
+    const __m128 vw = _mm_set1_ps(w);
+    for (uint32_t i = 0; i != numFloats; i += 4)
+        _mm_storeu_ps(out_row + i, _mm_add_ps(_mm_loadu_ps(out_row + i), _mm_mul_ps(vw, _mm_loadu_ps(srcRow + i))));
+#else
+    for (uint32_t i = 0; i != numFloats; ++i)
+        out_row[i] += w * srcRow[i];
+#endif
+}
+
+// Decodes [0,1] encoded normals, normalizes xyz, and re-encodes. Alpha is untouched.
+void RenormalizeRow(float* row, uint32_t width)
+{
+#if ESL_MIP_SSE
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+    for (uint32_t x = 0; x != width; ++x)
+    {
+        float* texel = row + x * 4;
+        const __m128 c = _mm_loadu_ps(texel);
+        const __m128 n = _mm_and_ps(_mm_sub_ps(_mm_mul_ps(c, two), one), xyzMask);
+
+        // Horizontal sum of squares without SSE4
+        __m128 sq = _mm_mul_ps(n, n);
+        sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+        sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 0, 3, 2)));
+
+        if (_mm_cvtss_f32(sq) < 1e-12f)
+        {
+            // Fully cancelled out, fall back to straight up
+            texel[0] = 0.5f; texel[1] = 0.5f; texel[2] = 1.0f;
+            continue;
+        }
+
+        const __m128 encoded = _mm_add_ps(_mm_mul_ps(_mm_div_ps(n, _mm_sqrt_ps(sq)), half), half);
+        const float alpha = texel[3];
+        _mm_storeu_ps(texel, encoded);
+        texel[3] = alpha;
+    }
+#else
+    for (uint32_t x = 0; x != width; ++x)
+    {
+        float* texel = row + x * 4;
+        float n[3] = { texel[0] * 2.0f - 1.0f, texel[1] * 2.0f - 1.0f, texel[2] * 2.0f - 1.0f };
+        const float lenSq = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+        if (lenSq < 1e-12f)
+        {
+            texel[0] = 0.5f; texel[1] = 0.5f; texel[2] = 1.0f;
+            continue;
+        }
+
+        const float invLen = 1.0f / sqrtf(lenSq);
+        for (uint32_t c = 0; c != 3; ++c)
+            texel[c] = n[c] * invLen * 0.5f + 0.5f;
+    }
+#endif
+}
+
+void QuantizeRow(const float* row, uint32_t width, bool srgb, uint8_t* out_row)
+{
+    const SrgbTables& tables = GetSrgbTables();
+    for (uint32_t x = 0; x != width; ++x)
+    {
+        const float* texel = row + x * 4;
+        uint8_t* dst = out_row + x * 4;
+
+        if (srgb)
+        {
+            for (uint32_t c = 0; c != 3; ++c)
+            {
+                const float l = std::min(std::max(texel[c], 0.0f), 1.0f);
+                dst[c] = tables.FromLinear[(uint32_t)(l * 65535.0f + 0.5f)];
+            }
+        }
+        else
+        {
+            for (uint32_t c = 0; c != 3; ++c)
+                dst[c] = QuantizeUnorm(texel[c]);
+        }
+
+        dst[3] = QuantizeUnorm(texel[3]);
+    }
+}
+
+}
+
+uint32_t MipGenerator::CountMips(uint32_t width, uint32_t height)
+{
+    uint32_t count = 1;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        ++count;
+    }
+    return count;
+}
+
+bool MipGenerator::GenerateChain(const uint8_t* rgba, uint32_t width, uint32_t height, const MipGenDesc& desc, MipChain* out_chain, Core::WorkerPool* pPool)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::ASSETS);
+    ESL_PROFILE_ZONE("MipGenerator::GenerateChain");
+
+    if (!rgba || !out_chain || width == 0 || height == 0 || desc.Filter >= MipFilter::COUNT)
+        return false;
+
+    const bool normalMap = (desc.Flags & MF_NORMAL_MAP) != 0;
+    const bool srgb = !normalMap && (desc.Flags & MF_SRGB) != 0; // Normal maps are never gamma encoded
+    const bool wrap = (desc.Flags & MF_WRAP) != 0;
+
+    uint32_t numLevels = CountMips(width, height);
+    if (desc.MaxLevels)
+        numLevels = std::min(numLevels, desc.MaxLevels);
+
+    // Lay out every level in one allocation
+    out_chain->Levels.resize(numLevels);
+    size_t totalBytes = 0;
+    {
+        uint32_t w = width, h = height;
+        for (uint32_t i = 0; i != numLevels; ++i)
+        {
+            MipLevel& level = out_chain->Levels[i];
+            level.Width = w;
+            level.Height = h;
+            level.RowPitch = w * 4;
+            level.Offset = totalBytes;
+            totalBytes += (size_t)level.RowPitch * h;
+
+            w = std::max(1u, w / 2);
+            h = std::max(1u, h / 2);
+        }
+    }
+    out_chain->Pixels.resize(totalBytes);
+
+    // Level 0 is the source untouched
+    memcpy(out_chain->Pixels.data(), rgba, (size_t)width * height * 4);
+    if (numLevels == 1)
+        return true;
+
+    // Promote the source to linear float once. Each level is filtered from the float version of the
+    // previous one so quantization error doesn't accumulate down the chain.
+    std::vector<float> current((size_t)width * height * 4);
+    {
+        const SrgbTables& tables = GetSrgbTables();
+        ForEachRow(pPool, height, [&](uint32_t y)
+        {
+            const uint8_t* srcRow = rgba + (size_t)y * width * 4;
+            float* dstRow = &current[(size_t)y * width * 4];
+            for (uint32_t i = 0; i != width * 4; ++i)
+            {
+                const bool isColor = (i & 3) != 3;
+                dstRow[i] = (srgb && isColor) ? tables.ToLinear[srcRow[i]] : (float)srcRow[i] / 255.0f;
+            }
+        });
+    }
+
+    std::vector<float> horizontal;
+    std::vector<float> next;
+    FilterTaps tapsX, tapsY;
+
+    for (uint32_t level = 1; level != numLevels; ++level)
+    {
+        const MipLevel& srcLevel = out_chain->Levels[level - 1];
+        const MipLevel& dstLevel = out_chain->Levels[level];
+        const uint32_t sw = srcLevel.Width, sh = srcLevel.Height;
+        const uint32_t dw = dstLevel.Width, dh = dstLevel.Height;
+
+        BuildTaps(desc.Filter, sw, dw, wrap, &tapsX);
+        BuildTaps(desc.Filter, sh, dh, wrap, &tapsY);
+
+        // Horizontal pass: sw x sh -> dw x sh
+        horizontal.resize((size_t)dw * sh * 4);
+        ForEachRow(pPool, sh, [&](uint32_t y)
+        {
+            FilterRowHorizontal(&current[(size_t)y * sw * 4], tapsX, dw, &horizontal[(size_t)y * dw * 4]);
+        });
+
+        // Vertical pass: dw x sh -> dw x dh, then fix up and quantize the finished row while it's hot
+        next.assign((size_t)dw * dh * 4, 0.0f);
+        uint8_t* dstPixels = out_chain->Pixels.data() + dstLevel.Offset;
+        ForEachRow(pPool, dh, [&](uint32_t y)
+        {
+            float* dstRow = &next[(size_t)y * dw * 4];
+            const uint32_t* indices = &tapsY.Indices[y * tapsY.MaxTaps];
+            const float* weights = &tapsY.Weights[y * tapsY.MaxTaps];
+
+            for (uint32_t k = 0; k != tapsY.MaxTaps; ++k)
+            {
+                if (weights[k] != 0.0f)
+                    AccumulateRow(&horizontal[(size_t)indices[k] * dw * 4], weights[k], dw, dstRow);
+            }
+
+            if (normalMap)
+                RenormalizeRow(dstRow, dw);
+
+            QuantizeRow(dstRow, dw, srgb, dstPixels + (size_t)y * dstLevel.RowPitch);
+        });
+
+        current.swap(next);
+    }
+
+    return true;
+}
+
+void MipGenerator::Serialize(const MipChain& chain, std::vector<uint8_t>* out_blob)
+{
+    BlobWriter writer(out_blob);
+    writer.Write((uint32_t)chain.Levels.size());
+    writer.WriteBytes(chain.Levels.data(), chain.Levels.size() * sizeof(MipLevel));
+    writer.Write((uint64_t)chain.Pixels.size());
+    writer.WriteBytes(chain.Pixels.data(), chain.Pixels.size());
+}
+
+bool MipGenerator::Deserialize(const uint8_t* blob, size_t size, MipChain* out_chain)
+{
+    BlobReader reader(blob, size);
+
+    uint32_t numLevels;
+    if (!reader.Read(&numLevels) || numLevels == 0 || numLevels > kMaxLevels)
+        return false;
+
+    if ((size_t)(reader.End - reader.Cursor) < numLevels * sizeof(MipLevel))
+        return false;
+
+    out_chain->Levels.resize(numLevels);
+    if (!reader.ReadBytes(out_chain->Levels.data(), numLevels * sizeof(MipLevel)))
+        return false;
+
+    uint64_t numBytes;
+    if (!reader.Read(&numBytes) || (uint64_t)(reader.End - reader.Cursor) != numBytes)
+        return false;
+
+    // Every level must land inside the pixel data, so the sampler and uploads can't read past it
+    for (const MipLevel& level : out_chain->Levels)
+    {
+        if (level.Width == 0 || level.Height == 0 || level.RowPitch < (uint64_t)level.Width * 4)
+            return false;
+
+        if (level.Offset > numBytes || (uint64_t)level.RowPitch * level.Height > numBytes - level.Offset)
+            return false;
+    }
+
+    out_chain->Pixels.resize((size_t)numBytes);
+    return reader.ReadBytes(out_chain->Pixels.data(), (size_t)numBytes);
+}
+
+}
@@ -0,0 +1,79 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : CPU mip-chain generation for RGBA8 images.
+Device independent, so it can feed both the runtime
+texture loader and offline cooking.
+----------------------------------------------*/
+#ifndef EASEL_MIPGENERATOR_H
+#define EASEL_MIPGENERATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace Core {
+class WorkerPool;
+}
+
+namespace Assets {
+
+enum class MipFilter : uint8_t
+{
+    BOX,        // 2x2 average, cheapest
+    KAISER,     // Kaiser-windowed sinc, good default
+    LANCZOS,    // Lanczos3, sharpest
+    COUNT
+};
+
+enum MipFlags : uint8_t
+{
+    MF_NONE       = 0,
+    MF_SRGB       = 1 << 0, // Source is gamma encoded (albedo): filter in linear space
+    MF_NORMAL_MAP = 1 << 1, // Source is a tangent-space normal map: renormalize every texel of every mip
+    MF_WRAP       = 1 << 2, // Filter taps wrap around the edges instead of clamping (tiling textures)
+};
+
+struct MipGenDesc
+{
+    MipFilter Filter    = MipFilter::KAISER;
+    uint8_t   Flags     = MF_NONE;
+    uint32_t  MaxLevels = 0; // 0 means generate the full chain down to 1x1
+};
+
+struct MipLevel
+{
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t RowPitch;
+    size_t   Offset;    // Byte offset of this level inside MipChain::Pixels
+};
+
+// All levels of a texture, tightly packed RGBA8 in a single allocation
+struct MipChain
+{
+    std::vector<uint8_t>  Pixels;
+    std::vector<MipLevel> Levels;
+
+    const uint8_t* GetLevelData(uint32_t level) const { return Pixels.data() + Levels[level].Offset; }
+};
+
+struct MipGenerator final
+{
+    // Bump whenever the generated chain changes for the same inputs
+    static constexpr uint32_t kVersion = 1;
+
+    // Number of levels in a full chain for the given dimensions
+    static uint32_t CountMips(uint32_t width, uint32_t height);
+
+    // Builds the full chain (level 0 is a copy of the source) from tightly packed RGBA8 pixels.
+    // Rows are filtered in blocks across the pool, or all on the calling thread without one.
+    static bool GenerateChain(const uint8_t* rgba, uint32_t width, uint32_t height, const MipGenDesc& desc, MipChain* out_chain, Core::WorkerPool* pPool);
+
+    // Flat blob form of a chain, for the AssetCache
+    static void Serialize(const MipChain& chain, std::vector<uint8_t>* out_blob);
+    static bool Deserialize(const uint8_t* blob, size_t size, MipChain* out_chain);
+};
+
+}
+#endif
@@ -0,0 +1,87 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of TexturePacker.h
+----------------------------------------------*/
+#include "TexturePacker.h"
+
+#include <Easel/Core/MemoryTracker.h>
+
+#include <algorithm>
+#include <string.h>
+
+namespace Assets {
+
+namespace {
+
+bool SameSignature(const TextureSetDesc& set, const TextureBank& bank)
+{
+    if (set.SlotMask != bank.SlotMask)
+        return false;
+
+    for (uint32_t s = 0; s != kMaxPackSlots; ++s)
+    {
+        if ((set.SlotMask & (1u << s)) && !(set.Slots[s] == bank.Slots[s]))
+            return false;
+    }
+    return true;
+}
+
+}
+
+void TexturePacker::PackArrays(const std::vector<TextureSetDesc>& sets, uint32_t maxSlices, PackResult* out_result)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::ASSETS);
+
+    out_result->Banks.clear();
+    out_result->Placements.assign(sets.size(), SetPlacement{ kInvalidBank, 0 });
+
+    // Sort by ID so slice order (and therefore material params) is stable across runs
+    std::vector<uint32_t> order(sets.size());
+    for (uint32_t i = 0; i != (uint32_t)sets.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sets[a].ID < sets[b].ID; });
+
+    std::vector<TextureBank> candidates;
+    for (uint32_t setIdx : order)
+    {
+        const TextureSetDesc& set = sets[setIdx];
+        if (!set.SlotMask)
+            continue;
+
+        TextureBank* pBank = nullptr;
+        for (TextureBank& bank : candidates)
+        {
+            if (bank.Members.size() < maxSlices && SameSignature(set, bank))
+            {
+                pBank = &bank;
+                break;
+            }
+        }
+
+        if (!pBank)
+        {
+            candidates.emplace_back();
+            pBank = &candidates.back();
+            pBank->SlotMask = set.SlotMask;
+            memcpy(pBank->Slots, set.Slots, sizeof(pBank->Slots));
+        }
+
+        pBank->Members.push_back(setIdx);
+    }
+
+    // A bank of one saves nothing, leave those sets standalone
+    for (TextureBank& bank : candidates)
+    {
+        if (bank.Members.size() < 2)
+            continue;
+
+        const uint32_t bankIdx = (uint32_t)out_result->Banks.size();
+        for (uint32_t slice = 0; slice != (uint32_t)bank.Members.size(); ++slice)
+            out_result->Placements[bank.Members[slice]] = SetPlacement{ bankIdx, slice };
+
+        out_result->Banks.push_back(std::move(bank));
+    }
+}
+
+}
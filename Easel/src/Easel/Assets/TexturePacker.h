@@ -0,0 +1,69 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Import-time grouping of textures into Texture2DArray banks
+so many materials can share a single set of bound SRVs
+----------------------------------------------*/
+#ifndef EASEL_TEXTUREPACKER_H
+#define EASEL_TEXTUREPACKER_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace Assets {
+
+// Upper bound on texture slots per set, independent of the renderer's TextureSlots enum
+static const uint32_t kMaxPackSlots = 8;
+static const uint32_t kInvalidBank  = UINT32_MAX;
+
+// Everything that must match for two textures to live in the same Texture2DArray
+struct TextureSignature
+{
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t Format;    // DXGI_FORMAT, kept opaque here
+    uint32_t MipLevels;
+
+    bool operator==(const TextureSignature& o) const
+    {
+        return Width == o.Width && Height == o.Height && Format == o.Format && MipLevels == o.MipLevels;
+    }
+};
+
+// A named set of textures that a material binds together (e.g. Lunar_T + Lunar_N)
+struct TextureSetDesc
+{
+    uint32_t         ID;        // TextureID of the set
+    uint32_t         SlotMask;  // Bit i set if Slots[i] is used
+    TextureSignature Slots[kMaxPackSlots];
+};
+
+// Sets with identical signatures in every slot. Each occupied slot becomes one array,
+// and every member set lives at the same slice in all of them.
+struct TextureBank
+{
+    uint32_t              SlotMask;
+    TextureSignature      Slots[kMaxPackSlots];
+    std::vector<uint32_t> Members; // Indices into the input set list, in slice order
+};
+
+struct SetPlacement
+{
+    uint32_t Bank;  // kInvalidBank if the set was left standalone
+    uint32_t Slice;
+};
+
+struct PackResult
+{
+    std::vector<TextureBank>  Banks;
+    std::vector<SetPlacement> Placements; // One per input set
+};
+
+struct TexturePacker final
+{
+    // Groups sets into banks. Sets that would end up alone in a bank stay standalone.
+    static void PackArrays(const std::vector<TextureSetDesc>& sets, uint32_t maxSlices, PackResult* out_result);
+};
+
+}
+#endif
@@ -0,0 +1,312 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of XmlDocument.h
+----------------------------------------------*/
+#include "XmlDocument.h"
+
+#include <string.h>
+
+namespace Assets {
+
+namespace {
+
+inline bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline bool IsNameEnd(char c)
+{
+    return IsSpace(c) || c == '/' || c == '>' || c == '=';
+}
+
+std::string_view Trim(const char* begin, const char* end)
+{
+    while (begin != end && IsSpace(*begin))
+        ++begin;
+    while (end != begin && IsSpace(end[-1]))
+        --end;
+    return std::string_view(begin, (size_t)(end - begin));
+}
+
+// Position just past the terminator, or nullptr if it never shows up
+const char* SkipPast(const char* cursor, const char* end, const char* terminator)
+{
+    const size_t termLen = strlen(terminator);
+    for (; cursor + termLen <= end; ++cursor)
+    {
+        if (*cursor == terminator[0] && memcmp(cursor, terminator, termLen) == 0)
+            return cursor + termLen;
+    }
+    return nullptr;
+}
+
+bool StartsWith(const char* cursor, const char* end, const char* prefix)
+{
+    const size_t len = strlen(prefix);
+    return (size_t)(end - cursor) >= len && memcmp(cursor, prefix, len) == 0;
+}
+
+}
+
+bool XmlDocument::Parse(const char* data, size_t size, std::string* out_error)
+{
+    const char* const begin = data;
+    const char* const end = data + size;
+    const char* cursor = begin;
+
+    const char* errorAt = nullptr;
+    const char* errorMsg = nullptr;
+    auto fail = [&](const char* at, const char* msg)
+    {
+        errorAt = at;
+        errorMsg = msg;
+        return false;
+    };
+
+    // Every element starts with '<', so this is an upper bound on the node count.
+    // One pass of memchr beats regrowing, and keeps references into mNodes stable while parsing.
+    size_t tagEstimate = 1;
+    for (const char* p = begin; (p = (const char*)memchr(p, '<', (size_t)(end - p))) != nullptr; ++p)
+        ++tagEstimate;
+
+    mNodes.clear();
+    mAttributes.clear();
+    mStack.clear();
+    mNodes.reserve(tagEstimate);
+    mAttributes.reserve(tagEstimate * 2);
+
+    mNodes.emplace_back();
+    mStack.push_back(kDocumentNode);
+
+    // UTF-8 BOM
+    if (StartsWith(cursor, end, "\xEF\xBB\xBF"))
+        cursor += 3;
+
+    bool ok = true;
+    while (ok && cursor != end)
+    {
+        // Character data up to the next tag
+        const char* tagStart = (const char*)memchr(cursor, '<', (size_t)(end - cursor));
+        if (!tagStart)
+            tagStart = end;
+
+        if (tagStart != cursor)
+        {
+            const std::string_view text = Trim(cursor, tagStart);
+            XmlNode& top = mNodes[mStack.back()];
+            if (!text.empty() && top.Text.empty())
+                top.Text = text;
+            cursor = tagStart;
+            if (cursor == end)
+                break;
+        }
+
+        if (StartsWith(cursor, end, "<?"))
+        {
+            cursor = SkipPast(cursor, end, "?>");
+            ok = cursor || fail(tagStart, "unterminated processing instruction");
+        }
+        else if (StartsWith(cursor, end, "<!--"))
+        {
+            cursor = SkipPast(cursor, end, "-->");
+            ok = cursor || fail(tagStart, "unterminated comment");
+        }
+        else if (StartsWith(cursor, end, "<![CDATA["))
+        {
+            const char* textStart = cursor + 9;
+            cursor = SkipPast(textStart, end, "]]>");
+            if (cursor)
+            {
+                XmlNode& top = mNodes[mStack.back()];
+                if (top.Text.empty())
+                    top.Text = std::string_view(textStart, (size_t)(cursor - 3 - textStart));
+            }
+            ok = cursor || fail(tagStart, "unterminated CDATA section");
+        }
+        else if (StartsWith(cursor, end, "<!"))
+        {
+            // DOCTYPE and friends carry nothing we need
+            cursor = SkipPast(cursor, end, ">");
+            ok = cursor || fail(tagStart, "unterminated declaration");
+        }
+        else if (StartsWith(cursor, end, "</"))
+        {
+            const char* nameStart = cursor + 2;
+            const char* nameEnd = nameStart;
+            while (nameEnd != end && !IsNameEnd(*nameEnd))
+                ++nameEnd;
+
+            const std::string_view name(nameStart, (size_t)(nameEnd - nameStart));
+            cursor = nameEnd;
+            while (cursor != end && IsSpace(*cursor))
+                ++cursor;
+
+            if (cursor == end || *cursor != '>')
+                ok = fail(tagStart, "malformed closing tag");
+            else if (mStack.size() == 1 || mNodes[mStack.back()].Name != name)
+                ok = fail(tagStart, "closing tag doesn't match the open element");
+            else
+            {
+                mStack.pop_back();
+                ++cursor;
+            }
+        }
+        else
+        {
+            const char* nameStart = cursor + 1;
+            const char* nameEnd = nameStart;
+            while (nameEnd != end && !IsNameEnd(*nameEnd))
+                ++nameEnd;
+
+            if (nameEnd == nameStart)
+            {
+                ok = fail(tagStart, "element without a name");
+                break;
+            }
+
+            const uint32_t nodeIdx = (uint32_t)mNodes.size();
+            mNodes.emplace_back();
+            XmlNode& node = mNodes.back();
+            node.Name = std::string_view(nameStart, (size_t)(nameEnd - nameStart));
+            node.FirstAttribute = (uint32_t)mAttributes.size();
+
+            // Link as the last child of whatever is open
+            XmlNode& parent = mNodes[mStack.back()];
+            if (parent.LastChild == kInvalidXmlNode)
+                parent.FirstChild = nodeIdx;
+            else
+                mNodes[parent.LastChild].NextSibling = nodeIdx;
+            parent.LastChild = nodeIdx;
+
+            // Attributes until '>' or '/>'
+            cursor = nameEnd;
+            bool selfClosing = false;
+            for (;;)
+            {
+                while (cursor != end && IsSpace(*cursor))
+                    ++cursor;
+
+                if (cursor == end)
+                {
+                    ok = fail(tagStart, "unterminated element");
+                    break;
+                }
+
+                if (*cursor == '>')
+                {
+                    ++cursor;
+                    break;
+                }
+
+                if (*cursor == '/')
+                {
+                    if (cursor + 1 == end || cursor[1] != '>')
+                    {
+                        ok = fail(cursor, "expected '>' after '/'");
+                        break;
+                    }
+                    cursor += 2;
+                    selfClosing = true;
+                    break;
+                }
+
+                const char* attrNameStart = cursor;
+                while (cursor != end && !IsNameEnd(*cursor))
+                    ++cursor;
+                const std::string_view attrName(attrNameStart, (size_t)(cursor - attrNameStart));
+
+                while (cursor != end && IsSpace(*cursor))
+                    ++cursor;
+                if (attrName.empty() || cursor == end || *cursor != '=')
+                {
+                    ok = fail(attrNameStart, "expected attribute=\"value\"");
+                    break;
+                }
+                ++cursor;
+
+                while (cursor != end && IsSpace(*cursor))
+                    ++cursor;
+                if (cursor == end || (*cursor != '"' && *cursor != '\''))
+                {
+                    ok = fail(attrNameStart, "attribute value must be quoted");
+                    break;
+                }
+
+                const char quote = *cursor++;
+                const char* valueEnd = (const char*)memchr(cursor, quote, (size_t)(end - cursor));
+                if (!valueEnd)
+                {
+                    ok = fail(attrNameStart, "unterminated attribute value");
+                    break;
+                }
+
+                XmlAttribute attr;
+                attr.Name = attrName;
+                attr.Value = std::string_view(cursor, (size_t)(valueEnd - cursor));
+                mAttributes.push_back(attr);
+                cursor = valueEnd + 1;
+            }
+
+            node.AttributeCount = (uint32_t)mAttributes.size() - node.FirstAttribute;
+
+            if (ok && !selfClosing)
+                mStack.push_back(nodeIdx);
+        }
+    }
+
+    if (ok && mStack.size() != 1)
+        ok = fail(end, "unclosed element at end of file");
+
+    if (!ok && out_error)
+    {
+        uint32_t line = 1;
+        for (const char* p = begin; p < errorAt && p < end; ++p)
+            line += *p == '\n';
+
+        *out_error = "line " + std::to_string(line) + ": " + errorMsg;
+    }
+
+    return ok;
+}
+
+uint32_t XmlDocument::FirstChild(uint32_t node, std::string_view name) const
+{
+    uint32_t child = mNodes[node].FirstChild;
+    while (child != kInvalidXmlNode && !name.empty() && mNodes[child].Name != name)
+        child = mNodes[child].NextSibling;
+    return child;
+}
+
+uint32_t XmlDocument::NextSibling(uint32_t node, std::string_view name) const
+{
+    uint32_t sibling = mNodes[node].NextSibling;
+    while (sibling != kInvalidXmlNode && !name.empty() && mNodes[sibling].Name != name)
+        sibling = mNodes[sibling].NextSibling;
+    return sibling;
+}
+
+std::string_view XmlDocument::GetAttribute(uint32_t node, std::string_view name) const
+{
+    const XmlNode& n = mNodes[node];
+    for (uint32_t i = n.FirstAttribute; i != n.FirstAttribute + n.AttributeCount; ++i)
+    {
+        if (mAttributes[i].Name == name)
+            return mAttributes[i].Value;
+    }
+    return std::string_view();
+}
+
+bool XmlDocument::HasAttribute(uint32_t node, std::string_view name) const
+{
+    const XmlNode& n = mNodes[node];
+    for (uint32_t i = n.FirstAttribute; i != n.FirstAttribute + n.AttributeCount; ++i)
+    {
+        if (mAttributes[i].Name == name)
+            return true;
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,66 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Small in-situ XML parser for asset description files.
+Names, values and text are views into the source buffer, which must
+outlive the document. Nodes and attributes live in two flat arrays and
+link to each other by index, so parsing never allocates per node.
+Entities (&amp; etc) are left encoded, the asset files don't use them.
+----------------------------------------------*/
+#ifndef EASEL_XMLDOCUMENT_H
+#define EASEL_XMLDOCUMENT_H
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Assets {
+
+static const uint32_t kInvalidXmlNode = ~0u;
+
+struct XmlAttribute
+{
+    std::string_view Name;
+    std::string_view Value;
+};
+
+struct XmlNode
+{
+    std::string_view Name;
+    std::string_view Text;            // Trimmed character data directly inside this element, if any
+    uint32_t         FirstChild     = kInvalidXmlNode;
+    uint32_t         LastChild      = kInvalidXmlNode;
+    uint32_t         NextSibling    = kInvalidXmlNode;
+    uint32_t         FirstAttribute = 0;
+    uint32_t         AttributeCount = 0;
+};
+
+class XmlDocument
+{
+public:
+    // Node 0 is the document itself, top-level elements are its children
+    static constexpr uint32_t kDocumentNode = 0;
+
+    // Parses a whole buffer. On failure, out_error (if given) gets a message with the line number.
+    bool Parse(const char* data, size_t size, std::string* out_error = nullptr);
+
+    const XmlNode& GetNode(uint32_t node) const { return mNodes[node]; }
+    uint32_t GetNodeCount() const { return (uint32_t)mNodes.size(); }
+
+    // Walk children, optionally only those with a given name. Return kInvalidXmlNode at the end.
+    uint32_t FirstChild(uint32_t node, std::string_view name = std::string_view()) const;
+    uint32_t NextSibling(uint32_t node, std::string_view name = std::string_view()) const;
+
+    // Empty view when the attribute doesn't exist
+    std::string_view GetAttribute(uint32_t node, std::string_view name) const;
+    bool HasAttribute(uint32_t node, std::string_view name) const;
+
+private:
+    std::vector<XmlNode>      mNodes;
+    std::vector<XmlAttribute> mAttributes;
+    std::vector<uint32_t>     mStack;
+};
+
+}
+#endif
@@ -0,0 +1,250 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of Allocators.h
+----------------------------------------------*/
+#include "Allocators.h"
+
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+namespace Core {
+
+static uint8_t* AlignUp(uint8_t* p, size_t alignment)
+{
+    const uintptr_t mask = (uintptr_t)alignment - 1;
+    return (uint8_t*)(((uintptr_t)p + mask) & ~mask);
+}
+
+LinearArena::~LinearArena()
+{
+    Destroy();
+}
+
+LinearArena::LinearArena(LinearArena&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+LinearArena& LinearArena::operator=(LinearArena&& other) noexcept
+{
+    if (this != &other)
+    {
+        Destroy();
+        mBase      = other.mBase;
+        mCapacity  = other.mCapacity;
+        mUsed      = other.mUsed;
+        mHighWater = other.mHighWater;
+
+        other.mBase = nullptr;
+        other.mCapacity = other.mUsed = other.mHighWater = 0;
+    }
+    return *this;
+}
+
+void LinearArena::Init(size_t capacity)
+{
+    Destroy();
+    mBase = (uint8_t*)TrackedMalloc(capacity);
+    mCapacity = mBase ? capacity : 0;
+}
+
+void LinearArena::Destroy()
+{
+    TrackedFree(mBase);
+    mBase = nullptr;
+    mCapacity = mUsed = mHighWater = 0;
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+    void* p = TryAllocate(size, alignment);
+    assert(p && "LinearArena out of memory, raise its capacity");
+    return p;
+}
+
+void* LinearArena::TryAllocate(size_t size, size_t alignment)
+{
+    assert(alignment && !(alignment & (alignment - 1)) && "Alignment must be a power of two");
+
+    uint8_t* p = AlignUp(mBase + mUsed, alignment);
+    const size_t end = (size_t)(p - mBase) + size;
+    if (!mBase || end > mCapacity)
+        return nullptr;
+
+    mUsed = end;
+    mHighWater = std::max(mHighWater, mUsed);
+    return p;
+}
+
+void FrameArena::Init(size_t capacityPerFrame)
+{
+    mArenas[0].Init(capacityPerFrame);
+    mArenas[1].Init(capacityPerFrame);
+    mCurrent = 0;
+}
+
+void FrameArena::Destroy()
+{
+    mArenas[0].Destroy();
+    mArenas[1].Destroy();
+}
+
+void FrameArena::BeginFrame()
+{
+    // The other arena was filled two frames ago, nothing reads it anymore
+    mCurrent ^= 1;
+    mArenas[mCurrent].Reset();
+}
+
+FrameArena& GetFrameArena()
+{
+    static FrameArena sFrameArena;
+    return sFrameArena;
+}
+
+LinearArena& GetThreadScratchArena()
+{
+    thread_local LinearArena tScratch;
+    if (!tScratch.IsInitialized())
+        tScratch.Init(kScratchArenaCapacity);
+    return tScratch;
+}
+
+PoolAllocator::~PoolAllocator()
+{
+    Destroy();
+}
+
+void PoolAllocator::Init(size_t blockSize, size_t blockAlignment, uint32_t blockCount)
+{
+    Destroy();
+
+    // Free blocks hold the next pointer, so every block must fit and align one
+    blockAlignment = std::max(blockAlignment, alignof(void*));
+    mBlockSize = (std::max(blockSize, sizeof(void*)) + blockAlignment - 1) & ~(blockAlignment - 1);
+    mBlockCount = blockCount;
+
+    // The heap only guarantees fundamental alignment, so over-allocate and align the first block
+    mBase = (uint8_t*)TrackedMalloc(mBlockSize * blockCount + blockAlignment);
+    if (!mBase)
+    {
+        mBlockCount = 0;
+        return;
+    }
+
+    uint8_t* first = AlignUp(mBase, blockAlignment);
+    mFirst = first;
+    for (uint32_t i = 0; i != blockCount; ++i)
+    {
+        void** pBlock = (void**)(first + i * mBlockSize);
+        *pBlock = i + 1 != blockCount ? first + (i + 1) * mBlockSize : nullptr;
+    }
+    mFreeHead = blockCount ? first : nullptr;
+}
+
+void PoolAllocator::Destroy()
+{
+    assert(mLiveCount == 0 && "PoolAllocator destroyed with blocks still in use");
+    TrackedFree(mBase);
+    mBase = nullptr;
+    mFirst = nullptr;
+    mFreeHead = nullptr;
+    mBlockSize = 0;
+    mBlockCount = 0;
+    mLiveCount = 0;
+}
+
+void* PoolAllocator::Allocate()
+{
+    if (!mFreeHead)
+        return nullptr;
+
+    void* pBlock = mFreeHead;
+    mFreeHead = *(void**)pBlock;
+    ++mLiveCount;
+    return pBlock;
+}
+
+void PoolAllocator::Free(void* pBlock)
+{
+    if (!pBlock)
+        return;
+
+    assert(Owns(pBlock) && "Block doesn't belong to this pool");
+    *(void**)pBlock = mFreeHead;
+    mFreeHead = pBlock;
+    --mLiveCount;
+}
+
+bool PoolAllocator::Owns(const void* p) const
+{
+    return mFirst && p >= mFirst && p < mFirst + mBlockSize * mBlockCount && ((const uint8_t*)p - mFirst) % mBlockSize == 0;
+}
+
+#if defined(ESL_COUNT_ALLOCATIONS)
+// Plain thread_local integer, no constructor, so it's safe to touch from inside operator new
+static thread_local uint64_t tHeapAllocationCount = 0;
+
+uint64_t GetThreadHeapAllocationCount()
+{
+    return tHeapAllocationCount;
+}
+
+void AdjustThreadHeapAllocationCount(int64_t count)
+{
+    tHeapAllocationCount += (uint64_t)count;
+}
+#else
+uint64_t GetThreadHeapAllocationCount()
+{
+    return 0;
+}
+
+void AdjustThreadHeapAllocationCount(int64_t)
+{
+}
+#endif
+
+}
+
+#if defined(ESL_COUNT_ALLOCATIONS) || defined(ESL_TRACK_MEMORY)
+// Replacing the global operator new only affects the module it's linked into, which is exactly the engine.
+// The nothrow forms forward to these by default. Over-aligned new is neither counted nor tracked.
+void* operator new(size_t size)
+{
+    #if defined(ESL_COUNT_ALLOCATIONS)
+    ++Core::tHeapAllocationCount;
+    #endif
+    if (void* p = Core::TrackedMalloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    Core::TrackedFree(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    Core::TrackedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    Core::TrackedFree(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    Core::TrackedFree(p);
+}
+#endif
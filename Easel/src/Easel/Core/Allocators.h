@@ -0,0 +1,233 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Allocators for memory that doesn't need the general heap.
+LinearArena    : bump pointer over one fixed block, freed all at once.
+FrameArena     : two arenas flipped every frame, for per-frame transient data.
+ScopedScratch  : rewinds the calling thread's scratch arena when it goes out of scope, for load-time temporaries.
+PoolAllocator  : fixed-size blocks from one fixed block, for objects that come and go.
+In builds with ESL_COUNT_ALLOCATIONS, operator new also counts heap allocations
+per thread, so the frame loop can check it stays off the heap. Work a thread
+runs for another, like WorkerPool items and TaskGraph tasks, hands its count
+back to the thread that asked for it. With ESL_TRACK_MEMORY, operator new goes
+through TrackedMalloc (see MemoryTracker.h), and the arenas and pools take
+their blocks from there too.
+----------------------------------------------*/
+#ifndef EASEL_ALLOCATORS_H
+#define EASEL_ALLOCATORS_H
+
+#include <assert.h>
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+namespace Core {
+
+static const size_t kDefaultAlignment = 16; // Enough for any XMFLOAT4X4 or XMVECTOR
+
+class LinearArena
+{
+public:
+    LinearArena() = default;
+    explicit LinearArena(size_t capacity) { Init(capacity); }
+    ~LinearArena();
+
+    LinearArena(LinearArena&& other) noexcept;
+    LinearArena& operator=(LinearArena&& other) noexcept;
+
+    // The one heap allocation this arena makes
+    void Init(size_t capacity);
+    void Destroy();
+
+    // Never freed individually. Running out is a bug, it asserts and returns nullptr.
+    void* Allocate(size_t size, size_t alignment = kDefaultAlignment);
+
+    // nullptr when the arena is full, for callers that can fall back to something else
+    void* TryAllocate(size_t size, size_t alignment = kDefaultAlignment);
+
+    // Uninitialized storage, callers construct into it if T isn't trivial
+    template<typename T>
+    T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T) > kDefaultAlignment ? alignof(T) : kDefaultAlignment)); }
+
+    // Everything allocated after GetMarker() is dropped by Rewind(marker)
+    size_t GetMarker() const    { return mUsed; }
+    void   Rewind(size_t marker) { assert(marker <= mUsed); mUsed = marker; }
+    void   Reset()               { mUsed = 0; }
+
+    bool   IsInitialized() const { return mBase != nullptr; }
+    size_t GetUsed() const      { return mUsed; }
+    size_t GetCapacity() const  { return mCapacity; }
+    size_t GetHighWater() const { return mHighWater; }
+
+private:
+    uint8_t* mBase = nullptr;
+    size_t   mCapacity = 0;
+    size_t   mUsed = 0;
+    size_t   mHighWater = 0;
+
+public:
+    LinearArena(LinearArena const&)            = delete;
+    LinearArena& operator=(LinearArena const&) = delete;
+};
+
+// Memory from Allocate() stays valid for the frame it was made in and the one after,
+// so data built while simulating frame N can still be read while frame N is drawn.
+class FrameArena
+{
+public:
+    void Init(size_t capacityPerFrame);
+    void Destroy();
+
+    // Called once per frame, before anything allocates from it
+    void BeginFrame();
+
+    void* Allocate(size_t size, size_t alignment = kDefaultAlignment) { return mArenas[mCurrent].Allocate(size, alignment); }
+
+    template<typename T>
+    T* AllocateArray(size_t count) { return mArenas[mCurrent].AllocateArray<T>(count); }
+
+    const LinearArena& GetCurrent() const { return mArenas[mCurrent]; }
+
+private:
+    LinearArena mArenas[2];
+    uint32_t    mCurrent = 0;
+};
+
+// Render thread only. Game owns its lifetime and flips it at the top of every rendered frame.
+FrameArena& GetFrameArena();
+
+// Each thread gets its own scratch arena, made on first use.
+// Only ever touched through ScopedScratch, so it unwinds like a stack.
+static const size_t kScratchArenaCapacity = 4 * 1024 * 1024;
+LinearArena& GetThreadScratchArena();
+
+class ScopedScratch
+{
+public:
+    ScopedScratch() : mArena(GetThreadScratchArena()), mMarker(mArena.GetMarker()) {}
+    ~ScopedScratch() { mArena.Rewind(mMarker); }
+
+    void* Allocate(size_t size, size_t alignment = kDefaultAlignment) { return mArena.Allocate(size, alignment); }
+
+    template<typename T>
+    T* AllocateArray(size_t count) { return mArena.AllocateArray<T>(count); }
+
+private:
+    LinearArena& mArena;
+    size_t       mMarker;
+
+public:
+    ScopedScratch(ScopedScratch const&)            = delete;
+    ScopedScratch& operator=(ScopedScratch const&) = delete;
+};
+
+// Fixed-size blocks threaded on an intrusive free list. Allocate and Free are O(1) and never touch the heap after Init.
+class PoolAllocator
+{
+public:
+    PoolAllocator() = default;
+    ~PoolAllocator();
+
+    void Init(size_t blockSize, size_t blockAlignment, uint32_t blockCount);
+    void Destroy();
+
+    // nullptr when every block is in use
+    void* Allocate();
+    void  Free(void* pBlock);
+
+    bool     Owns(const void* p) const;
+    uint32_t GetLiveCount() const { return mLiveCount; }
+    uint32_t GetCapacity() const  { return mBlockCount; }
+
+private:
+    uint8_t* mBase = nullptr;  // What malloc returned
+    uint8_t* mFirst = nullptr; // First aligned block
+    void*    mFreeHead = nullptr;
+    size_t   mBlockSize = 0;
+    uint32_t mBlockCount = 0;
+    uint32_t mLiveCount = 0;
+
+public:
+    PoolAllocator(PoolAllocator const&)            = delete;
+    PoolAllocator& operator=(PoolAllocator const&) = delete;
+};
+
+template<typename T>
+class ObjectPool
+{
+public:
+    void Init(uint32_t capacity)
+    {
+        mPool.Init(sizeof(T) < sizeof(void*) ? sizeof(void*) : sizeof(T), alignof(T), capacity);
+    }
+
+    template<typename... TArgs>
+    T* Create(TArgs&&... args)
+    {
+        void* pBlock = mPool.Allocate();
+        return pBlock ? new (pBlock) T(std::forward<TArgs>(args)...) : nullptr;
+    }
+
+    void Destroy(T* pObject)
+    {
+        if (!pObject)
+            return;
+        pObject->~T();
+        mPool.Free(pObject);
+    }
+
+    uint32_t GetLiveCount() const { return mPool.GetLiveCount(); }
+    uint32_t GetCapacity() const  { return mPool.GetCapacity(); }
+
+private:
+    PoolAllocator mPool;
+};
+
+// Heap allocations made by operator new on the calling thread so far.
+// Always zero unless the build defines ESL_COUNT_ALLOCATIONS.
+uint64_t GetThreadHeapAllocationCount();
+
+// Adds to the calling thread's count, or takes away with a negative count. Only for handing counts between threads.
+void AdjustThreadHeapAllocationCount(int64_t count);
+
+// Counts what the current thread allocates between construction and GetCount(),
+// including whatever work it handed to other threads allocated on its behalf
+class HeapAllocationScope
+{
+public:
+    HeapAllocationScope() : mStart(GetThreadHeapAllocationCount()) {}
+    uint64_t GetCount() const { return GetThreadHeapAllocationCount() - mStart; }
+
+private:
+    uint64_t mStart;
+};
+
+// Moves what the current thread allocates during its lifetime off the thread's count and onto *pTotal.
+// Whoever asked for the work adds *pTotal to its own count once the work is done.
+class HeapAllocationHandoff
+{
+public:
+    explicit HeapAllocationHandoff(std::atomic<uint64_t>* pTotal) : mpTotal(pTotal), mStart(GetThreadHeapAllocationCount()) {}
+    ~HeapAllocationHandoff()
+    {
+        const uint64_t count = GetThreadHeapAllocationCount() - mStart;
+        if (count)
+        {
+            AdjustThreadHeapAllocationCount(-(int64_t)count);
+            mpTotal->fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::atomic<uint64_t>* mpTotal;
+    uint64_t               mStart;
+
+public:
+    HeapAllocationHandoff(HeapAllocationHandoff const&)            = delete;
+    HeapAllocationHandoff& operator=(HeapAllocationHandoff const&) = delete;
+};
+
+}
+#endif
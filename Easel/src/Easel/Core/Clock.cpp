@@ -0,0 +1,62 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of Clock.h
+----------------------------------------------*/
+#include "Clock.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+namespace Core {
+
+#if defined(_WIN32)
+static uint64_t QueryFrequency()
+{
+    // Can't fail on anything since Windows XP
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)frequency.QuadPart;
+}
+
+uint64_t Clock::Now()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)counter.QuadPart;
+}
+
+uint64_t Clock::GetFrequency()
+{
+    static const uint64_t sFrequency = QueryFrequency();
+    return sFrequency;
+}
+#else
+uint64_t Clock::Now()
+{
+    timespec now;
+    #if defined(CLOCK_MONOTONIC_RAW)
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    #else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    #endif
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+uint64_t Clock::GetFrequency()
+{
+    return 1000000000ull;
+}
+#endif
+
+uint64_t Clock::TicksToMicroseconds(uint64_t ticks)
+{
+    // Split so ticks * 1000000 can't overflow for any realistic frequency
+    const uint64_t frequency = GetFrequency();
+    return (ticks / frequency) * 1000000ull + (ticks % frequency) * 1000000ull / frequency;
+}
+
+}
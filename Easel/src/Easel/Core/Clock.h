@@ -0,0 +1,28 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Monotonic high resolution clock. QueryPerformanceCounter on
+Windows, CLOCK_MONOTONIC_RAW elsewhere, which unlike CLOCK_MONOTONIC
+isn't slewed by NTP while the game is running.
+----------------------------------------------*/
+#ifndef EASEL_CLOCK_H
+#define EASEL_CLOCK_H
+
+#include <stdint.h>
+
+namespace Core {
+
+struct Clock final
+{
+    // In GetFrequency() units since some unspecified point. Only differences mean anything.
+    static uint64_t Now();
+
+    // Ticks per second, fixed for the life of the process
+    static uint64_t GetFrequency();
+
+    static double TicksToSeconds(uint64_t ticks) { return (double)ticks / (double)GetFrequency(); }
+    static uint64_t TicksToMicroseconds(uint64_t ticks);
+};
+
+}
+#endif
@@ -0,0 +1,252 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of FileWatcher.h
+----------------------------------------------*/
+#include "FileWatcher.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace Core {
+
+namespace fs = std::filesystem;
+
+FileWatcher::FileWatcher() :
+    mRunning(false),
+    mDebounce(0),
+    mStopEvent(nullptr)
+{}
+
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+bool FileWatcher::Start(const std::vector<fs::path>& folders, uint32_t debounceMs)
+{
+    if (mRunning.load())
+        return false;
+
+    mDebounce = std::chrono::milliseconds(debounceMs);
+
+    #if defined(_WIN32)
+    mStopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!mStopEvent)
+        return false;
+    #endif
+
+    mRunning.store(true);
+
+    for (const fs::path& folder : folders)
+    {
+        std::error_code ec;
+        if (fs::is_directory(folder, ec))
+            mThreads.emplace_back(&FileWatcher::WatchThread, this, folder);
+    }
+
+    if (mThreads.empty())
+    {
+        mRunning.store(false);
+        #if defined(_WIN32)
+        CloseHandle((HANDLE)mStopEvent);
+        mStopEvent = nullptr;
+        #endif
+        return false;
+    }
+    return true;
+}
+
+void FileWatcher::Stop()
+{
+    if (!mRunning.exchange(false))
+        return;
+
+    // Stays set, so a thread that hasn't started waiting yet still sees it when it does.
+    // Linux threads poll with a timeout and notice mRunning on their own.
+    #if defined(_WIN32)
+    SetEvent((HANDLE)mStopEvent);
+    #endif
+
+    for (std::thread& t : mThreads)
+        t.join();
+    mThreads.clear();
+
+    #if defined(_WIN32)
+    CloseHandle((HANDLE)mStopEvent);
+    mStopEvent = nullptr;
+    #elif defined(__linux__)
+    for (int fd : mLinuxFds)
+        close(fd);
+    #endif
+    mLinuxFds.clear();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPending.clear();
+}
+
+void FileWatcher::Poll(std::vector<fs::path>* out_changed)
+{
+    const Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mPending.begin(); it != mPending.end();)
+    {
+        if (now - it->second >= mDebounce)
+        {
+            out_changed->push_back(fs::path(it->first));
+            it = mPending.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+void FileWatcher::OnRawChange(const fs::path& file)
+{
+    // Every write restarts the quiet period for that file
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPending[file.wstring()] = Clock::now();
+}
+
+#if defined(_WIN32)
+void FileWatcher::WatchThread(fs::path folder)
+{
+    // Overlapped, so the thread can wait on the read and the stop event at once
+    HANDLE hDir = CreateFileW(folder.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (hDir == INVALID_HANDLE_VALUE)
+        return;
+
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!overlapped.hEvent)
+    {
+        CloseHandle(hDir);
+        return;
+    }
+
+    const HANDLE waitHandles[2] = { overlapped.hEvent, (HANDLE)mStopEvent };
+
+    // DWORD aligned, as required by ReadDirectoryChangesW
+    alignas(DWORD) uint8_t buffer[16 * 1024];
+    for (;;)
+    {
+        ResetEvent(overlapped.hEvent);
+        if (!ReadDirectoryChangesW(hDir, buffer, sizeof(buffer), TRUE,
+            FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, &overlapped, nullptr))
+            break;
+
+        if (WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE) != WAIT_OBJECT_0)
+        {
+            // Stopped. The read still owns the buffer until the cancel has gone through.
+            DWORD ignored;
+            CancelIoEx(hDir, &overlapped);
+            GetOverlappedResult(hDir, &overlapped, &ignored, TRUE);
+            break;
+        }
+
+        // The folder went away
+        DWORD bytesReturned = 0;
+        if (!GetOverlappedResult(hDir, &overlapped, &bytesReturned, FALSE))
+            break;
+
+        // Zero bytes means the buffer overflowed. Nothing to do but wait for the next write.
+        if (bytesReturned == 0)
+            continue;
+
+        const uint8_t* cursor = buffer;
+        for (;;)
+        {
+            const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)cursor;
+            if (info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+                OnRawChange(folder / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+
+            if (!info->NextEntryOffset)
+                break;
+            cursor += info->NextEntryOffset;
+        }
+    }
+
+    CloseHandle(overlapped.hEvent);
+    CloseHandle(hDir);
+}
+#elif defined(__linux__)
+void FileWatcher::WatchThread(fs::path folder)
+{
+    const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mHandleMutex);
+        mLinuxFds.push_back(fd);
+    }
+
+    // inotify isn't recursive, so every sub folder gets its own watch
+    const uint32_t kMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+    std::unordered_map<int, fs::path> watches;
+    auto addWatch = [&](const fs::path& dir)
+    {
+        const int wd = inotify_add_watch(fd, dir.c_str(), kMask);
+        if (wd >= 0)
+            watches[wd] = dir;
+    };
+
+    addWatch(folder);
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(folder, ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (it->is_directory(ec))
+            addWatch(it->path());
+    }
+
+    alignas(inotify_event) char buffer[16 * 1024];
+    while (mRunning.load())
+    {
+        // Short timeout so Stop() never waits long
+        pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+
+        const ssize_t len = read(fd, buffer, sizeof(buffer));
+        if (len <= 0)
+            continue;
+
+        for (const char* cursor = buffer; cursor < buffer + len;)
+        {
+            const inotify_event* ev = (const inotify_event*)cursor;
+            cursor += sizeof(inotify_event) + ev->len;
+
+            auto itDir = watches.find(ev->wd);
+            if (itDir == watches.end() || ev->len == 0)
+                continue;
+
+            const fs::path path = itDir->second / ev->name;
+            if (ev->mask & IN_ISDIR)
+            {
+                if (ev->mask & IN_CREATE)
+                    addWatch(path);
+                continue;
+            }
+
+            // A plain IN_CREATE is followed by IN_CLOSE_WRITE once the contents are there
+            if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                OnRawChange(path);
+        }
+    }
+}
+#else
+void FileWatcher::WatchThread(fs::path folder)
+{
+    // No native watcher on this platform, hot reload simply never fires
+    (void)folder;
+}
+#endif
+
+}
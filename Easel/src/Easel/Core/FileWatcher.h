@@ -0,0 +1,62 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Watches folders for modified files on a background thread.
+ReadDirectoryChangesW on Windows, inotify on Linux. Editors tend to write
+a file several times in a row, so changes are debounced before being reported.
+----------------------------------------------*/
+#ifndef EASEL_FILEWATCHER_H
+#define EASEL_FILEWATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Core {
+
+class FileWatcher
+{
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    // Starts watching every folder (recursively). A file is reported once it has been quiet for debounceMs.
+    bool Start(const std::vector<std::filesystem::path>& folders, uint32_t debounceMs);
+    void Stop();
+
+    bool IsRunning() const { return mRunning.load(); }
+
+    // Appends files whose last change is older than the debounce window. Call from the main thread.
+    void Poll(std::vector<std::filesystem::path>* out_changed);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void WatchThread(std::filesystem::path folder);
+    void OnRawChange(const std::filesystem::path& file);
+
+    std::vector<std::thread> mThreads;
+    std::atomic<bool>        mRunning;
+    std::chrono::milliseconds mDebounce;
+
+    std::mutex mMutex;
+    std::unordered_map<std::wstring, Clock::time_point> mPending; // Keyed by native path, wide so it hashes on every platform
+
+    // Windows threads wait on their read and this manual reset event together, so a Stop() is never missed
+    void*              mStopEvent;
+
+    // Linux threads poll with a timeout, these are only closed once they're done
+    std::mutex         mHandleMutex;
+    std::vector<int>   mLinuxFds;
+
+public:
+    FileWatcher(FileWatcher const&)            = delete;
+    FileWatcher& operator=(FileWatcher const&) = delete;
+};
+
+}
+#endif
@@ -0,0 +1,200 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of FrameStats.h
+----------------------------------------------*/
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+namespace Core {
+
+static uint32_t FindHighestBit(uint64_t value)
+{
+    uint32_t bit = 0;
+    while (value >>= 1)
+        ++bit;
+    return bit;
+}
+
+uint32_t FrameTimeHistogram::GetBucketIndex(uint64_t microseconds)
+{
+    if (microseconds < kLinearBuckets)
+        return (uint32_t)microseconds;
+
+    const uint32_t exponent = FindHighestBit(microseconds);
+    if (exponent > kMaxExponent)
+        return kBucketCount - 1;
+
+    // The bits right below the leading one pick the sub-bucket
+    const uint32_t shift = exponent - kSubBucketBits;
+    const uint32_t subBucket = (uint32_t)(microseconds >> shift) & ((1u << kSubBucketBits) - 1);
+    return kLinearBuckets + (exponent - 7) * (1u << kSubBucketBits) + subBucket;
+}
+
+uint64_t FrameTimeHistogram::GetBucketLowerBound(uint32_t index)
+{
+    if (index < kLinearBuckets)
+        return index;
+
+    const uint32_t offset = index - kLinearBuckets;
+    const uint32_t exponent = 7 + (offset >> kSubBucketBits);
+    const uint64_t subBucket = offset & ((1u << kSubBucketBits) - 1);
+    return ((1ull << kSubBucketBits) + subBucket) << (exponent - kSubBucketBits);
+}
+
+uint64_t FrameTimeHistogram::GetBucketWidth(uint32_t index)
+{
+    if (index < kLinearBuckets)
+        return 1;
+
+    const uint32_t exponent = 7 + ((index - kLinearBuckets) >> kSubBucketBits);
+    return 1ull << (exponent - kSubBucketBits);
+}
+
+void FrameTimeHistogram::Record(uint64_t microseconds)
+{
+    ++mCounts[GetBucketIndex(microseconds)];
+    ++mCount;
+    mSum += microseconds;
+    mMin = microseconds < mMin ? microseconds : mMin;
+    mMax = microseconds > mMax ? microseconds : mMax;
+}
+
+void FrameTimeHistogram::Reset()
+{
+    *this = FrameTimeHistogram();
+}
+
+uint64_t FrameTimeHistogram::GetValueAtPercentile(double percentile) const
+{
+    if (!mCount)
+        return 0;
+
+    // Nearest rank, the same definition the exact window stats use
+    uint64_t rank = (uint64_t)ceil(percentile / 100.0 * (double)mCount);
+    rank = rank < 1 ? 1 : (rank > mCount ? mCount : rank);
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i != kBucketCount; ++i)
+    {
+        seen += mCounts[i];
+        if (seen >= rank)
+        {
+            // Middle of the bucket, but never outside what was actually recorded
+            const uint64_t value = GetBucketLowerBound(i) + GetBucketWidth(i) / 2;
+            return value < mMin ? mMin : (value > mMax ? mMax : value);
+        }
+    }
+    return mMax;
+}
+
+void FrameStats::Record(uint64_t microseconds)
+{
+    mWindow[mWindowNext] = microseconds < UINT32_MAX ? (uint32_t)microseconds : UINT32_MAX;
+    mWindowNext = (mWindowNext + 1) % kWindowCapacity;
+    mWindowCount = mWindowCount < kWindowCapacity ? mWindowCount + 1 : kWindowCapacity;
+
+    mSession.Record(microseconds);
+    mSessionSpikes += microseconds > mSpikeThreshold ? 1 : 0;
+}
+
+void FrameStats::Reset()
+{
+    mWindowNext = 0;
+    mWindowCount = 0;
+    mSession.Reset();
+    mSessionSpikes = 0;
+}
+
+// Nearest rank over samples already sorted ascending
+static uint32_t GetSortedPercentile(const uint32_t* sorted, uint32_t count, double percentile)
+{
+    uint32_t rank = (uint32_t)ceil(percentile / 100.0 * (double)count);
+    rank = rank < 1 ? 1 : (rank > count ? count : rank);
+    return sorted[rank - 1];
+}
+
+FrameTimeStats FrameStats::GetWindowStats(uint32_t frames) const
+{
+    FrameTimeStats stats;
+    const uint32_t count = frames < mWindowCount ? frames : mWindowCount;
+    if (!count)
+        return stats;
+
+    // Newest 'count' samples, walking back from the write position
+    uint64_t sum = 0;
+    uint64_t spikes = 0;
+    for (uint32_t i = 0; i != count; ++i)
+    {
+        const uint32_t sample = mWindow[(mWindowNext + kWindowCapacity - 1 - i) % kWindowCapacity];
+        mSortScratch[i] = sample;
+        sum += sample;
+        spikes += sample > mSpikeThreshold ? 1 : 0;
+    }
+    std::sort(mSortScratch, mSortScratch + count);
+
+    stats.Frames = count;
+    stats.Spikes = spikes;
+    stats.MinMs  = mSortScratch[0] / 1000.0;
+    stats.MeanMs = (double)sum / (double)count / 1000.0;
+    stats.P50Ms  = GetSortedPercentile(mSortScratch, count, 50.0) / 1000.0;
+    stats.P95Ms  = GetSortedPercentile(mSortScratch, count, 95.0) / 1000.0;
+    stats.P99Ms  = GetSortedPercentile(mSortScratch, count, 99.0) / 1000.0;
+    stats.MaxMs  = mSortScratch[count - 1] / 1000.0;
+    return stats;
+}
+
+FrameTimeStats FrameStats::GetSessionStats() const
+{
+    FrameTimeStats stats;
+    stats.Frames = mSession.GetCount();
+    stats.Spikes = mSessionSpikes;
+    stats.MinMs  = mSession.GetMin() / 1000.0;
+    stats.MeanMs = mSession.GetMean() / 1000.0;
+    stats.P50Ms  = mSession.GetValueAtPercentile(50.0) / 1000.0;
+    stats.P95Ms  = mSession.GetValueAtPercentile(95.0) / 1000.0;
+    stats.P99Ms  = mSession.GetValueAtPercentile(99.0) / 1000.0;
+    stats.MaxMs  = mSession.GetMax() / 1000.0;
+    return stats;
+}
+
+static void WriteStats(FILE* pFile, const FrameTimeStats& stats)
+{
+    fprintf(pFile, "\"frames\": %llu, \"spikes\": %llu, \"minMs\": %.3f, \"meanMs\": %.3f, \"p50Ms\": %.3f, \"p95Ms\": %.3f, \"p99Ms\": %.3f, \"maxMs\": %.3f",
+        (unsigned long long)stats.Frames, (unsigned long long)stats.Spikes,
+        stats.MinMs, stats.MeanMs, stats.P50Ms, stats.P95Ms, stats.P99Ms, stats.MaxMs);
+}
+
+bool FrameStats::DumpJSON(const char* path) const
+{
+    FILE* pFile = nullptr;
+    #if defined(_MSC_VER)
+    fopen_s(&pFile, path, "w");
+    #else
+    pFile = fopen(path, "w");
+    #endif
+    if (!pFile)
+        return false;
+
+    fprintf(pFile, "{\n  \"spikeThresholdMs\": %.3f,\n  \"session\": { ", mSpikeThreshold / 1000.0);
+    WriteStats(pFile, GetSessionStats());
+    fprintf(pFile, " },\n  \"windows\": [");
+
+    // Roughly two seconds, twenty seconds and everything kept, at 60Hz
+    static const uint32_t kWindows[] = { 120, 1200, kWindowCapacity };
+    for (uint32_t i = 0; i != sizeof(kWindows) / sizeof(kWindows[0]); ++i)
+    {
+        fprintf(pFile, "%s\n    { \"window\": %u, ", i ? "," : "", kWindows[i]);
+        WriteStats(pFile, GetWindowStats(kWindows[i]));
+        fprintf(pFile, " }");
+    }
+    fprintf(pFile, "\n  ]\n}\n");
+
+    fclose(pFile);
+    return true;
+}
+
+}
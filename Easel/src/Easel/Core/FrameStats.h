@@ -0,0 +1,98 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Frame time statistics. Average FPS hides stutter, so frames
+are kept individually: the last kWindowCapacity in a ring, from which any
+trailing window gives exact percentiles, and every frame of the session in
+a log-linear histogram that stays a fixed size however long the game runs.
+Both report min/mean/p50/p95/p99/max and how many frames were spikes.
+Recording is O(1) and never allocates.
+----------------------------------------------*/
+#ifndef EASEL_FRAMESTATS_H
+#define EASEL_FRAMESTATS_H
+
+#include <stdint.h>
+
+namespace Core {
+
+struct FrameTimeStats
+{
+    uint64_t Frames = 0;
+    uint64_t Spikes = 0;    // Frames longer than the spike threshold
+    double   MinMs = 0.0;
+    double   MeanMs = 0.0;
+    double   P50Ms = 0.0;
+    double   P95Ms = 0.0;
+    double   P99Ms = 0.0;
+    double   MaxMs = 0.0;
+};
+
+// HDR style histogram over microseconds. Exact below 128us, then 64 buckets per
+// power of two, so any value it reports is within 1/64 (1.6%) of the real one.
+class FrameTimeHistogram
+{
+public:
+    static constexpr uint32_t kLinearBuckets = 128;
+    static constexpr uint32_t kSubBucketBits = 6;
+    static constexpr uint32_t kMaxExponent = 25;    // Up to 2^26us, about a minute. Longer frames are clamped.
+    static constexpr uint32_t kBucketCount = kLinearBuckets + (kMaxExponent - 6) * (1u << kSubBucketBits);
+
+    void Record(uint64_t microseconds);
+    void Reset();
+
+    uint64_t GetCount() const { return mCount; }
+    uint64_t GetMin() const   { return mCount ? mMin : 0; }
+    uint64_t GetMax() const   { return mMax; }
+    double   GetMean() const  { return mCount ? (double)mSum / (double)mCount : 0.0; }
+
+    // Smallest recorded value that percentile% of the samples are at or below, e.g. 99.0 for p99
+    uint64_t GetValueAtPercentile(double percentile) const;
+
+    static uint32_t GetBucketIndex(uint64_t microseconds);
+    static uint64_t GetBucketLowerBound(uint32_t index);
+    static uint64_t GetBucketWidth(uint32_t index);
+
+private:
+    uint32_t mCounts[kBucketCount] = {};
+    uint64_t mCount = 0;
+    uint64_t mSum = 0;
+    uint64_t mMin = UINT64_MAX;
+    uint64_t mMax = 0;
+};
+
+class FrameStats
+{
+public:
+    static constexpr uint32_t kWindowCapacity = 4096;       // A bit over a minute at 60Hz
+    static constexpr uint64_t kDefaultSpikeThreshold = 25000; // 1.5x a 60Hz frame, in microseconds
+
+    void Record(uint64_t microseconds);
+    void Reset();
+
+    // Only affects frames recorded from now on
+    void     SetSpikeThreshold(uint64_t microseconds) { mSpikeThreshold = microseconds; }
+    uint64_t GetSpikeThreshold() const                { return mSpikeThreshold; }
+
+    // The last 'frames' frames, or as many as have been kept. Exact.
+    FrameTimeStats GetWindowStats(uint32_t frames) const;
+
+    // Every frame since the last Reset(), percentiles to histogram precision
+    FrameTimeStats GetSessionStats() const;
+    const FrameTimeHistogram& GetSessionHistogram() const { return mSession; }
+
+    // Session plus a few trailing windows as JSON. False if the file couldn't be opened.
+    bool DumpJSON(const char* path) const;
+
+private:
+    uint32_t           mWindow[kWindowCapacity];            // Microseconds, oldest overwritten first
+    uint32_t           mWindowNext = 0;
+    uint32_t           mWindowCount = 0;
+    mutable uint32_t   mSortScratch[kWindowCapacity];       // So window queries don't allocate
+
+    FrameTimeHistogram mSession;
+    uint64_t           mSessionSpikes = 0;
+    uint64_t           mSpikeThreshold = kDefaultSpikeThreshold;
+};
+
+}
+#endif
@@ -5,25 +5,63 @@ Description : Implementation of Game.h
 ----------------------------------------------*/
 #include "Game.h"
 
+#include "Allocators.h"
+#include "Clock.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+
 #include <Easel/Input/GameInput.h>
 
 #include <Easel/Renderer/Camera.h>
 #include <Easel/Renderer/COMException.h>
 #include <Easel/Renderer/LightingManager.h>
 #include <Easel/Renderer/ResourceCodex.h>
+#include <Easel/Renderer/SoftwareRasterizer.h>
+
+#include <assert.h>
+#include <stdio.h>
 
 
 namespace Core
 {
 
+// What the frame graph's tasks touch. A task waits on every earlier one that writes what it reads or writes,
+// or reads what it writes. The packet's parts are separate so the tasks filling them in don't serialize.
+static const TaskGraph::ResourceMask kCamera           = 1ull << 0;
+static const TaskGraph::ResourceMask kLights           = 1ull << 1;
+static const TaskGraph::ResourceMask kEntityTransforms = 1ull << 2;
+static const TaskGraph::ResourceMask kPacketView       = 1ull << 3;
+static const TaskGraph::ResourceMask kPacketLights     = 1ull << 4;
+static const TaskGraph::ResourceMask kPacketInstances  = 1ull << 5;
+static const TaskGraph::ResourceMask kPacketCasters    = 1ull << 6;
+
 // Initialize device resources, and link up this game to be notified of device updates
 Game::Game() :
     mpInput(new Input::GameInput()),
     mpCamera(nullptr),
-    mpLightingManager(nullptr)
+    mpLightingManager(nullptr),
+    mRunning(false),
+    mPacketsBuilt(0),
+    mRequestedOutputSize(0),
+    mOutputSizeRequests(0),
+    mSimulatedOutputSizeRequests(0),
+    mRenderedOutputSizeRequests(0),
+    mResumeRequested(false),
+    mHeadless(false),
+    mpSoftwareRasterizer(nullptr),
+    mSoftwareGeometryMs(0.0),
+    mSoftwareRasterMs(0.0),
+    mLastPresentTime(0),
+    mPresentCount(0),
+    mAllocatingFrames(0)
 {
     mDeviceResources.RegisterDeviceNotify(this);
-    mTimer.SetFixedTimeStep(false);
+    // Simulation runs at a fixed rate whatever the frame rate, rendering interpolates between steps
+    mTimer.SetFixedTimeStep(true);
+    mTimer.SetTargetElapsedSeconds(1.0 / kSimulationHz);
+    mTimer.SetMaxUpdatesPerTick(kMaxSimulationStepsPerFrame);
+
+    GetFrameArena().Init(kFrameArenaBytes);
 }
 
 // Initialize device resource holder by creating all necessary resources
@@ -31,6 +69,8 @@ bool Game::Init(HWND window, int width, int height)
 {
     using namespace Renderer;
 
+    Profiler::SetThreadName("Window");
+
     // Grab Window handle, creates device and context
     mDeviceResources.SetWindow(window, width, height);
     mDeviceResources.CreateDeviceResources();
@@ -39,15 +79,18 @@ bool Game::Init(HWND window, int width, int height)
     auto device = mDeviceResources.GetDevice();
     auto context = mDeviceResources.GetContext();
 
+    // The workers start first, texture loading spreads its mip generation over them
+    mWorkerPool.Init(WorkerPool::GetDefaultWorkerCount(2));
+
     // Init all game resources
-    ResourceCodex::Init(device, context);
+    ResourceCodex::Init(device, context, &mWorkerPool);
     
     // Initialize game camera
     mpCamera = new Camera(-5.0f, 5.0f, -5.0f, width / (float)height, 0.1f, 100.0f, 1.5f, device, context);
 
     // Create Devices dependent on window size
     mDeviceResources.CreateWindowSizeDependentResources();
-    CreateWindowSizeDependentResources(width, height);
+    mRequestedOutputSize.store(PackOutputSize(width, height));
 
     // Create Materials, Meshes, Entities
     mEntityRenderer.Init(mDeviceResources);
@@ -57,82 +100,483 @@ bool Game::Init(HWND window, int width, int height)
     DirectX::XMFLOAT3A camPos;
     mpCamera->GetPosition3A(&camPos);
     mpLightingManager = new LightingManager(mDeviceResources.GetDevice(), context, camPos);
+    mShadowRenderer.Init(device, LightingManager::kShadowResolution, LightingManager::kCascadeCount);
+
+    // From here on the context belongs to the render thread
+    StartLoops();
 
     return true;
 }
 
-// On Timer tick, run Update() on the game, then Render()
-void Game::Frame()
+bool Game::RunHeadless(HeadlessSettings const& settings)
 {
-    mTimer.Tick([&]()
+    using namespace Renderer;
+
+    assert(settings.Frames != 0 && settings.Width > 0 && settings.Height > 0);
+
+    Profiler::SetThreadName("Main");
+    mHeadless = true;
+    mHeadlessSettings = settings;
+
+    mWorkerPool.Init(WorkerPool::GetDefaultWorkerCount(2));
+
+    // Meshes only, for their bounds
+    ResourceCodex::InitHeadless();
+
+    // The same camera and lights as a windowed run, minus their constant buffers
+    mpCamera = new Camera(-5.0f, 5.0f, -5.0f, settings.Width / (float)settings.Height, 0.1f, 100.0f, 1.5f, nullptr, nullptr);
+    mRequestedOutputSize.store(PackOutputSize(settings.Width, settings.Height));
+
+    mEntityRenderer.InitHeadless();
+
+    DirectX::XMFLOAT3A camPos;
+    mpCamera->GetPosition3A(&camPos);
+    mpLightingManager = new LightingManager(nullptr, nullptr, camPos);
+    if (settings.StressLights)
+        mpLightingManager->AddStressLights(settings.StressLights);
+
+    // WIC decodes the textures, and there was no window to initialize COM
+    const HRESULT hrCom = settings.ImagePath[0] ? CoInitializeEx(nullptr, COINIT_MULTITHREADED) : E_FAIL;
+    if (settings.ImagePath[0])
     {
-        Update(mTimer);
-    });
+        mpSoftwareRasterizer = new SoftwareRasterizer();
+        mpSoftwareRasterizer->Init((uint32_t)settings.Width, (uint32_t)settings.Height, &mWorkerPool);
+        if (!mEntityRenderer.InitSoftware(mpSoftwareRasterizer, &mWorkerPool))
+        {
+            OutputDebugStringA("ERROR: Headless image output couldn't load its meshes or textures\n");
+            delete mpSoftwareRasterizer;
+            mpSoftwareRasterizer = nullptr;
+        }
+    }
+
+    const uint64_t start = Clock::Now();
+    StartLoops();
+
+    // The render thread ends the run once it has drawn the last frame
+    mRenderThread.join();
+    Stop();
 
-    Render();
+    if (SUCCEEDED(hrCom))
+        CoUninitialize();
 
-    mDeviceResources.UpdateTitleBar(mTimer.GetFramesPerSecond(), mTimer.GetFrameCount());
+    const double wallSeconds = Clock::TicksToSeconds(Clock::Now() - start);
+    FILE* pFile = nullptr;
+    #if defined(_MSC_VER)
+    fopen_s(&pFile, "Headless.json", "w");
+    #else
+    pFile = fopen("Headless.json", "w");
+    #endif
+    if (!pFile)
+        return false;
+
+    #if defined(ESL_COUNT_ALLOCATIONS)
+    const bool allocationsCounted = true;
+    #else
+    const bool allocationsCounted = false;
+    #endif
+
+    fprintf(pFile, "{\n  \"frames\": %u,\n  \"unthrottled\": %s,\n  \"stressLights\": %u,\n  \"simulationSteps\": %u,\n  \"simulatedSeconds\": %.4f,\n  \"wallSeconds\": %.4f,\n"
+        "  \"drawCalls\": %llu,\n  \"instances\": %llu,\n  \"instanceBytes\": %llu,\n"
+        "  \"software\": %s,\n  \"softwareGeometryMs\": %.4f,\n  \"softwareRasterMs\": %.4f,\n"
+        "  \"allocationsCounted\": %s,\n  \"allocatingFrames\": %u\n}\n",
+        mPresentCount, settings.Unthrottled ? "true" : "false", settings.StressLights, mTimer.GetFrameCount(), mTimer.GetTotalSeconds(), wallSeconds,
+        (unsigned long long)mNullDrawStats.DrawCalls, (unsigned long long)mNullDrawStats.Instances, (unsigned long long)mNullDrawStats.InstanceBytes,
+        mpSoftwareRasterizer ? "true" : "false", mPresentCount ? mSoftwareGeometryMs / mPresentCount : 0.0, mPresentCount ? mSoftwareRasterMs / mPresentCount : 0.0,
+        allocationsCounted ? "true" : "false", mAllocatingFrames.load());
+    fclose(pFile);
+
+    // Every frame that allocated was already reported as it happened
+    if (settings.CheckAllocations)
+    {
+        if (!allocationsCounted)
+        {
+            OutputDebugStringA("ERROR: -check-allocations needs a build with ESL_COUNT_ALLOCATIONS\n");
+            return false;
+        }
+        if (mAllocatingFrames.load())
+            return false;
+    }
+    return true;
 }
 
-void Game::Update(StepTimer const& timer)
+void Game::StartLoops()
 {
-    float elapsedTime = float(timer.GetElapsedSeconds());
+    using Renderer::FramePacket;
 
-    // Update the input, passing in the camera so it will update its internal information
-    mpInput->Frame(elapsedTime, mpCamera);
+    // Every packet gets its own instance and light list storage up front, so building one never allocates
+    for (uint32_t i = 0; i != Mailbox<FramePacket>::kSlotCount; ++i)
+    {
+        mEntityRenderer.InitFramePacket(&mFramePackets.GetSlot(i));
+        mpLightingManager->InitFramePacket(&mFramePackets.GetSlot(i));
+    }
 
-    auto context = mDeviceResources.GetContext();
+    InitFrameGraph();
 
-    // Update the camera's view matrix
-    mpCamera->UpdateView(context);
+    mLastPresentTime = Clock::Now();
+    mRunning.store(true);
+    mSimulationThread = std::thread(&Game::ThreadMain, this, "Simulation", &Game::SimulationLoop);
+    mRenderThread = std::thread(&Game::ThreadMain, this, "Render", &Game::RenderLoop);
+}
 
-    // Update the lights (if needed)
-    DirectX::XMFLOAT3A camPos;
-    mpCamera->GetPosition3A(&camPos);
-    mpLightingManager->Update(context, timer.GetTotalSeconds(), camPos);
-    
-    // Update the renderer's view matrices, lighting information.
-    mEntityRenderer.Update(context, elapsedTime);
+void Game::Stop()
+{
+    mRunning.store(false);
+    mFramePackets.Close();
+
+    if (mSimulationThread.joinable())
+        mSimulationThread.join();
+    if (mRenderThread.joinable())
+        mRenderThread.join();
+
+    // Only the simulation thread ran the graph, so nothing is queued any more
+    mWorkerPool.Shutdown();
 }
 
-void Game::Render()
+void Game::ThreadMain(const char* name, void (Game::*loop)())
 {
-    // Don't try to render anything before the first Update.
-    if (mTimer.GetFrameCount() == 0)
+    Profiler::SetThreadName(name);
+
+    #if defined(ESL_DEBUG)
+        try
+        {
+            (this->*loop)();
+        }
+        catch (std::exception const& e)
+        {
+            // Take the other loop down too, then have the window thread close as it would have before the loops moved off it
+            mRunning.store(false);
+            mFramePackets.Close();
+
+            // Nobody is there to click a message box on a headless run
+            if (mHeadless)
+            {
+                OutputDebugStringA(e.what());
+                return;
+            }
+
+            MessageBoxA(nullptr, e.what(), "Fatal Exception!", MB_OK | MB_ICONERROR | MB_SETFOREGROUND);
+            PostMessage(mDeviceResources.GetWindow(), WM_CLOSE, 0, 0);
+        }
+    #else
+        (this->*loop)();
+    #endif
+}
+
+void Game::SimulationLoop()
+{
+    while (mRunning.load(std::memory_order_relaxed))
     {
-        return;
+        SimulationFrame();
+
+        // Every packet gets drawn, and the renderer is all that sets the pace
+        if (mHeadlessSettings.Unthrottled)
+        {
+            while (!mFramePackets.WaitForAcquire(kIdleWaitMicroseconds))
+            {
+                if (mFramePackets.IsClosed())
+                    break;
+            }
+            continue;
+        }
+
+        // Don't run ahead of the renderer: wait for it to pick this packet up, unless a step falls due first.
+        // If it's still busy then, the next packet simply replaces this one.
+        const double secondsToNextStep = (1.0 - mTimer.GetInterpolationAlpha()) / kSimulationHz;
+        mFramePackets.WaitForAcquire((uint64_t)(secondsToNextStep * 1000000.0));
+    }
+}
+
+void Game::RenderLoop()
+{
+    while (mRunning.load(std::memory_order_relaxed))
+    {
+        // Nothing new to draw means nothing new to show, so wait rather than present the same packet twice
+        if (!mFramePackets.Acquire())
+        {
+            mFramePackets.WaitForPublish(kIdleWaitMicroseconds);
+            continue;
+        }
+
+        if (mHeadless)
+            RenderHeadless(mFramePackets.GetReadSlot());
+        else
+            Render(mFramePackets.GetReadSlot());
+    }
+}
+
+void Game::SimulationFrame()
+{
+    // This thread drives the profiler, so a profiler frame is one packet. Closes out the previous one's zones, see Profiler::GetLastFrame.
+    Profiler::NewFrame();
+    ESL_PROFILE_ZONE("Game::SimulationFrame");
+
+    // Also sees what the frame graph's tasks allocate on the workers
+    HeapAllocationScope frameAllocations;
+
+    if (mResumeRequested.exchange(false))
+        mTimer.ResetElapsedTime();
+
+    const uint32_t outputSizeRequests = mOutputSizeRequests.load(std::memory_order_acquire);
+    if (outputSizeRequests != mSimulatedOutputSizeRequests)
+    {
+        mSimulatedOutputSizeRequests = outputSizeRequests;
+        const uint64_t size = mRequestedOutputSize.load(std::memory_order_relaxed);
+        mpCamera->UpdateProjection((float)GetPackedWidth(size) / (float)GetPackedHeight(size));
     }
+
+    uint32_t steps = 0;
+    auto step = [&]()
+    {
+        Simulate(mTimer);
+        ++steps;
+    };
+
+    if (mHeadlessSettings.Unthrottled)
+        mTimer.StepOnce(step);
+    else
+        mTimer.Tick(step);
+
+    Renderer::FramePacket& packet = mFramePackets.GetWriteSlot();
+    packet.Index = ++mPacketsBuilt;
+    packet.SimulationSteps = steps;
+    BuildFramePacket(mTimer, &packet);
+    mFramePackets.Publish();
+
+    // Quit comes in through input, which no longer runs where the message loop is
+    if (!mHeadless && mpInput->TakeQuitRequest())
+        PostMessage(mDeviceResources.GetWindow(), WM_CLOSE, 0, 0);
+
+    CheckFrameAllocations("Simulation", mTimer.GetTickCount(), frameAllocations.GetCount());
+}
+
+void Game::Simulate(StepTimer const& timer)
+{
+    ESL_PROFILE_ZONE("Game::Simulate");
+
+    mEntityRenderer.Simulate(float(timer.GetElapsedSeconds()));
+}
+
+void Game::BuildFramePacket(StepTimer const& timer, Renderer::FramePacket* packet)
+{
+    ESL_PROFILE_ZONE("Game::BuildFramePacket");
+
+    // Input and the camera respond every packet, not just on simulation steps
+    mFrameInputs.pPacket = packet;
+    mFrameInputs.FrameSeconds = float(timer.GetFrameElapsedSeconds());
+    mFrameInputs.TotalSeconds = float(timer.GetInterpolatedTotalSeconds());
+    mFrameInputs.Alpha = float(timer.GetInterpolationAlpha());
+
+    mFrameGraph.Run(&mWorkerPool);
+}
+
+void Game::InitFrameGraph()
+{
+    // Transforms don't depend on the camera, so they overlap with input, and then lights overlap with culling.
+    // Shadow casters need both the cascades from the lights and the transforms.
+    mFrameGraph.AddTask("Input", 0, kCamera | kPacketView, [this]()
+    {
+        // Update the input, passing in the camera so it will update its internal information. Headless, nothing moves it.
+        if (!mHeadless)
+            mpInput->Frame(mFrameInputs.FrameSeconds, mpCamera);
+
+        // Update the camera's view matrix
+        mpCamera->UpdateView();
+        mpCamera->GetViewProjection(&mFrameInputs.pPacket->ViewProjection);
+        mpCamera->GetSkyViewProjection(&mFrameInputs.pPacket->SkyViewProjection);
+    });
+
+    mFrameGraph.AddTask("Lights", kCamera, kLights | kPacketLights, [this]()
+    {
+        // Update the lights (if needed)
+        DirectX::XMFLOAT3A camPos;
+        mpCamera->GetPosition3A(&camPos);
+        mpLightingManager->Update(mFrameInputs.TotalSeconds, camPos);
+        mFrameInputs.pPacket->Lighting = mpLightingManager->GetLightData();
+
+        // Point and spot lights into the view's clusters, one z slice per job
+        mpLightingManager->Cluster(*mpCamera, mFrameInputs.pPacket, &mWorkerPool);
+
+        // The sun's cascades around the view
+        mpLightingManager->FitShadowCascades(*mpCamera, mFrameInputs.pPacket);
+    });
+
+    mFrameGraph.AddTask("Transforms", 0, kEntityTransforms, [this]()
+    {
+        mEntityRenderer.UpdateTransforms(mFrameInputs.Alpha);
+    });
+
+    mFrameGraph.AddTask("Culling", kPacketView | kEntityTransforms, kPacketInstances, [this]()
+    {
+        // Interpolated world matrices of whatever is in view. The occlusion pass fans out over the pool too.
+        mEntityRenderer.Cull(mFrameInputs.pPacket, &mWorkerPool);
+    });
+
+    mFrameGraph.AddTask("ShadowCasters", kPacketLights | kEntityTransforms, kPacketCasters, [this]()
+    {
+        // Every cascade's casters out of the same bounds culling uses
+        mEntityRenderer.CullShadowCasters(mFrameInputs.pPacket);
+    });
+
+    mFrameGraph.Compile();
+}
+
+void Game::Render(Renderer::FramePacket const& packet)
+{
+    ESL_PROFILE_ZONE("Game::Render");
+
+    // What was allocated from it two frames ago is dropped here
+    GetFrameArena().BeginFrame();
+
+    HeapAllocationScope frameAllocations;
+
+    const uint32_t outputSizeRequests = mOutputSizeRequests.load(std::memory_order_acquire);
+    if (outputSizeRequests != mRenderedOutputSizeRequests)
+    {
+        mRenderedOutputSizeRequests = outputSizeRequests;
+        const uint64_t size = mRequestedOutputSize.load(std::memory_order_relaxed);
+        mDeviceResources.WindowSizeChanged(GetPackedWidth(size), GetPackedHeight(size));
+    }
+
     auto context = mDeviceResources.GetContext();
 
+    // Swap in re-imported assets while nothing is in flight on the CPU side
+    Renderer::ResourceCodex::ProcessHotReload(context);
+
+    // Shadow maps first, they bind their own targets and the frame's are bound by the clear
+    mShadowRenderer.Draw(context, packet, mEntityRenderer, *mpCamera);
+
+    mpCamera->BindViewProjection(packet.ViewProjection, context);
+    const RECT outputSize = mDeviceResources.GetOutputSize();
+    mpLightingManager->Bind(packet, (float)(outputSize.right - outputSize.left), (float)(outputSize.bottom - outputSize.top), context);
+
     // Clear the necessary backbuffer
     mDeviceResources.Clear(DirectX::Colors::Black);
 
     // Draw all geometries
-    mEntityRenderer.Draw(context);
+    mEntityRenderer.Draw(context, packet);
 
     // Remove Translation component from VP matrix
-    mpCamera->PrepareForSkyRender(context);
+    mpCamera->BindViewProjection(packet.SkyViewProjection, context);
 
     // Draw the sky, binding the appropriate rasterizer/depth states
     mSkyRenderer.Draw(context);
 
     // Show the new frame
     mDeviceResources.Present();
+
+    // Resources released a few frames ago are no longer in flight
+    Renderer::ResourceCodex::EndFrame();
+
+    // Meshes hot reloaded or brought back this frame get culled with their new bounds
+    mEntityRenderer.PublishMeshBounds();
+
+    MemoryTracker::EndFrame();
+
+    RecordPresent();
+
+    CheckFrameAllocations("Render", mPresentCount, frameAllocations.GetCount());
 }
 
-void Game::CreateDeviceDependentResources()
+void Game::RenderHeadless(Renderer::FramePacket const& packet)
+{
+    ESL_PROFILE_ZONE("Game::RenderHeadless");
+
+    GetFrameArena().BeginFrame();
+
+    HeapAllocationScope frameAllocations;
+
+    mEntityRenderer.DrawNull(packet, &mNullDrawStats);
+
+    if (mpSoftwareRasterizer)
+    {
+        mEntityRenderer.DrawSoftware(packet, mpSoftwareRasterizer);
+        mSoftwareGeometryMs += mpSoftwareRasterizer->GetStats().GeometryMs;
+        mSoftwareRasterMs += mpSoftwareRasterizer->GetStats().RasterMs;
+    }
+
+    Renderer::ResourceCodex::EndFrame();
+
+    mEntityRenderer.PublishMeshBounds();
+
+    MemoryTracker::EndFrame();
+
+    RecordPresent();
+
+    CheckFrameAllocations("Render", mPresentCount, frameAllocations.GetCount());
+
+    // That was the last one. Closing also wakes the simulation thread if it's waiting on this one.
+    if (mPresentCount == mHeadlessSettings.Frames)
+    {
+        if (mpSoftwareRasterizer && !mpSoftwareRasterizer->WriteTGA(mHeadlessSettings.ImagePath))
+            OutputDebugStringA("ERROR: Couldn't write the headless image\n");
+
+        mRunning.store(false);
+        mFramePackets.Close();
+    }
+}
+
+void Game::RecordPresent()
 {
+    const uint64_t presentTime = Clock::Now();
+    mPresentStats.Record(Clock::TicksToMicroseconds(presentTime - mLastPresentTime));
+    mLastPresentTime = presentTime;
+    ++mPresentCount;
+
+    // Posted, never sent: the window thread may be waiting in Stop() for this one to finish
+    if (!mHeadless && mPresentCount % kTitleBarIntervalFrames == 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mTitleBarMutex);
+            mTitleBarStats = mPresentStats.GetWindowStats(kTitleBarWindowFrames);
+        }
+        PostMessage(mDeviceResources.GetWindow(), kTitleBarMessage, 0, 0);
+    }
+}
+
+void Game::UpdateTitleBar()
+{
+    FrameTimeStats frameTimes;
+    {
+        std::lock_guard<std::mutex> lock(mTitleBarMutex);
+        frameTimes = mTitleBarStats;
+    }
+
+    const uint32_t fps = frameTimes.MeanMs > 0.0 ? (uint32_t)(1000.0 / frameTimes.MeanMs + 0.5) : 0;
+    const uint64_t size = mRequestedOutputSize.load(std::memory_order_relaxed);
+    mDeviceResources.UpdateTitleBar(fps, frameTimes, GetPackedWidth(size), GetPackedHeight(size));
+}
+
+void Game::CheckFrameAllocations(const char* loop, uint32_t frame, uint64_t allocations)
+{
+    #if defined(ESL_COUNT_ALLOCATIONS)
+    // Once warmed up, the loops themselves should stay off the heap. Loads, reloads and evictions coming back are expected to allocate.
+    if (frame > kAllocationWarmupFrames && allocations != 0)
+    {
+        mAllocatingFrames.fetch_add(1, std::memory_order_relaxed);
+
+        char message[128];
+        sprintf_s(message, "WARNING: %s frame %u made %llu heap allocations\n", loop, frame, allocations);
+        OutputDebugStringA(message);
+    }
+    #else
+    (void)loop;
+    (void)frame;
+    (void)allocations;
+    #endif
 }
 
-void Game::CreateWindowSizeDependentResources(int newWidth, int newHeight)
+void Game::CreateDeviceDependentResources()
 {
-    mDeviceResources.WindowSizeChanged(newWidth, newHeight);
-    float aspectRatio = (float)newWidth / (float)newHeight;
-    mpCamera->UpdateProjection(aspectRatio, mDeviceResources.GetContext());
 }
 
 Game::~Game()
 {
+    // Nothing below may run while either loop still could
+    Stop();
+
+    delete mpSoftwareRasterizer;
+    mpSoftwareRasterizer = nullptr;
+
     delete mpLightingManager;
     mpLightingManager = nullptr;
     
@@ -142,7 +586,26 @@ Game::~Game()
     delete mpInput;
     mpInput = nullptr;
 
-    
+    GetFrameArena().Destroy();
+
+    // Frame time percentiles for the whole run, what a perf pass is judged on
+    mPresentStats.DumpJSON("FrameTimes.json");
+
+    // Mean time per task and the chain that bounds how fast a packet can be built
+    mFrameGraph.DumpJSON("FrameGraph.json");
+
+    #if defined(ESL_DEBUG)
+    const FrameTimeStats session = mPresentStats.GetSessionStats();
+    char message[160];
+    sprintf_s(message, "Frame times over %llu frames: p50 %.2fms, p95 %.2fms, p99 %.2fms, max %.2fms, %llu spikes\n",
+        (unsigned long long)session.Frames, session.P50Ms, session.P95Ms, session.P99Ms, session.MaxMs, (unsigned long long)session.Spikes);
+    OutputDebugStringA(message);
+    #endif
+
+    #if defined(ESL_TRACK_MEMORY)
+    // Whatever is still live here is either owned by members about to be destroyed, or a leak
+    MemoryTracker::DumpJSON("MemoryReport.json");
+    #endif
 }
 
 #pragma region Game State Callbacks
@@ -168,35 +631,26 @@ void Game::OnSuspending()
 
 void Game::OnResuming()
 {
-    mTimer.ResetElapsedTime();
+    // The simulation thread owns the timer
+    mResumeRequested.store(true);
 }
 
-// Recreates Window size dependent resources if needed
+// Same size again, but the render thread re-checks the color space, which can change with the monitor
 void Game::OnMove()
 {
-    auto r = mDeviceResources.GetOutputSize();
-    mDeviceResources.WindowSizeChanged(r.right, r.bottom);
+    RECT rc;
+    GetClientRect(mDeviceResources.GetWindow(), &rc);
+    OnResize(rc.right - rc.left, rc.bottom - rc.top);
 }
 
-// Recreates Window size dependent resources if needed
+// The render thread resizes the swap chain and the simulation thread the projection, each on its next frame
 void Game::OnResize(int newWidth, int newHeight)
 {
-    if (!mDeviceResources.WindowSizeChanged(newWidth, newHeight))
+    if (newWidth <= 0 || newHeight <= 0)
         return;
 
-    #if defined(ESL_DEBUG)
-        try
-        {
-            CreateWindowSizeDependentResources(newWidth, newHeight);
-        }
-        catch (std::exception const& e)
-        {
-            MessageBoxA(mDeviceResources.GetWindow(), e.what(), "Fatal Exception!", MB_OK | MB_ICONERROR | MB_SETFOREGROUND);
-            DestroyWindow(mDeviceResources.GetWindow());
-        }
-    #else
-        CreateWindowSizeDependentResources(newWidth, newHeight);
-    #endif
+    mRequestedOutputSize.store(PackOutputSize(newWidth, newHeight), std::memory_order_relaxed);
+    mOutputSizeRequests.fetch_add(1, std::memory_order_release);
 }
 
 void Game::OnMouseMove(short newX, short newY)
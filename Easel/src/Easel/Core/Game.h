@@ -7,16 +7,26 @@ This class encapsulates all app functionality
 #ifndef GAME_H
 #define GAME_H
 
+#include "Mailbox.h"
 #include "StepTimer.h"
+#include "TaskGraph.h"
+#include "WorkerPool.h"
 
 #include <Easel/Renderer/DeviceResources.h>
 #include <Easel/Renderer/EntityRenderer.h>
+#include <Easel/Renderer/FramePacket.h>
+#include <Easel/Renderer/ShadowRenderer.h>
 #include <Easel/Renderer/SkyRenderer.h>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 namespace Renderer
 {
 class Camera;
 class LightingManager;
+class SoftwareRasterizer;
 }
 
 namespace Input
@@ -25,15 +35,48 @@ class GameInput;
 }
 
 namespace Core {
+
+// A run without a window or a device, see Game::RunHeadless
+struct HeadlessSettings
+{
+    uint32_t Frames = 600;          // Packets drawn before the run ends
+    bool     Unthrottled = false;   // One fixed step per packet as fast as the machine goes, instead of in real time
+    int      Width = 1280;          // Culling sees what a window this size would, and images come out this size
+    int      Height = 800;
+    char     ImagePath[260] = {};   // When set, every frame is also drawn by the software rasterizer and the last one saved here as TGA
+
+    // Fails the run if a frame past warmup touches the heap. Needs a build with ESL_COUNT_ALLOCATIONS.
+    bool     CheckAllocations = false;
+
+    // Point and spot lights added in a grid over the scene, to load the clustered lighting. The game itself has none.
+    uint32_t StressLights = 0;
+};
+
+// The window thread only pumps messages. The simulation thread runs input, fixed steps and culling, and publishes
+// one FramePacket per loop, building it through a task graph that spreads the independent parts over a worker pool.
+// The render thread draws the latest packet while the next one is being built, and owns the immediate context, the
+// codex and the frame arena. Window callbacks reach the other two through atomics.
 class Game final : public Renderer::IDeviceNotify
 {
 public:
+    // Posted to the window by the render thread whenever the title bar has new frame times
+    static constexpr UINT kTitleBarMessage = WM_APP + 1;
+
     Game();
     ~Game();
+
+    // Creates everything on the window thread, then starts the simulation and render threads
     bool Init(HWND window, int width, int height);
 
-    // Main Game Loop
-    void Frame();
+    // Instead of Init: no window and no device. The same two loops run, but the render thread draws through
+    // EntityRenderer::DrawNull and presents nothing. Returns once settings.Frames packets have been drawn.
+    bool RunHeadless(HeadlessSettings const& settings);
+
+    // Joins both threads. Window thread, before the window is destroyed. Safe to call more than once.
+    void Stop();
+
+    // Window thread, on kTitleBarMessage
+    void UpdateTitleBar();
 
     // Implementation of IDeviceNotify
     // Handles sudden loss of device
@@ -52,11 +95,58 @@ public:
     void OnMouseMove(short newX, short newY);
 
 private:
-    void Update(StepTimer const& timer);
-    void Render();
+    static constexpr size_t kFrameArenaBytes = 1024 * 1024;
+    static constexpr uint32_t kAllocationWarmupFrames = 8;
+
+    // Fixed simulation rate, and how many steps one frame may run to catch up before time is dropped
+    static constexpr double kSimulationHz = 60.0;
+    static constexpr uint32_t kMaxSimulationStepsPerFrame = 4;
+
+    // The title bar shows frame times over the trailing window, refreshed every interval
+    static constexpr uint32_t kTitleBarIntervalFrames = 60;
+    static constexpr uint32_t kTitleBarWindowFrames = 120;
+
+    // Longest either loop waits on the other before checking whether it should stop
+    static constexpr uint64_t kIdleWaitMicroseconds = 100000;
+
+    // Packet storage and the frame graph, then both loops. Once the scene exists, headless or not.
+    // The workers are already running by then, loading the scene uses them.
+    void StartLoops();
+
+    // Sets the thread's name, then runs the loop. In debug, an exception shuts the game down with a message box.
+    void ThreadMain(const char* name, void (Game::*loop)());
+    void SimulationLoop();
+    void RenderLoop();
+
+    // Simulation thread, once per packet: whatever fixed steps are due, then the packet itself
+    void SimulationFrame();
+
+    // Advances the world by one fixed step
+    void Simulate(StepTimer const& timer);
+
+    // Input, camera, lights and visible instances, interpolated to the present
+    void BuildFramePacket(StepTimer const& timer, Renderer::FramePacket* packet);
+
+    // The tasks BuildFramePacket runs, and what each of them reads and writes. Once, at Init.
+    void InitFrameGraph();
+
+    // Render thread: draws a packet and presents
+    void Render(Renderer::FramePacket const& packet);
+
+    // Render thread, headless: culled instances are uploaded to memory, nothing is presented
+    void RenderHeadless(Renderer::FramePacket const& packet);
+
+    // Render thread, after a packet is done with. Present to present time, and the title bar with a window.
+    void RecordPresent();
+
+    // Once past warmup, a loop that touched the heap gets reported and counted
+    void CheckFrameAllocations(const char* loop, uint32_t frame, uint64_t allocations);
 
     void CreateDeviceDependentResources();
-    void CreateWindowSizeDependentResources(int newWidth, int newHeight);
+
+    static uint64_t PackOutputSize(int width, int height) { return (uint64_t)(uint32_t)width | ((uint64_t)(uint32_t)height << 32); }
+    static int GetPackedWidth(uint64_t size) { return (int)(uint32_t)size; }
+    static int GetPackedHeight(uint64_t size) { return (int)(uint32_t)(size >> 32); }
 
     // Application's Device Resources, such as the necessary buffers/views in video memory
     Renderer::DeviceResources mDeviceResources;
@@ -67,6 +157,9 @@ private:
     // Handles the drawing of the skybox
     Renderer::SkyRenderer mSkyRenderer;
 
+    // Draws the sun's shadow cascades ahead of the frame
+    Renderer::ShadowRenderer mShadowRenderer;
+
     // Lights Manager
     Renderer::LightingManager* mpLightingManager;
 
@@ -76,8 +169,61 @@ private:
     // Main Camera
     Renderer::Camera* mpCamera;
     
-    // Timer for the main game loop
+    // Timer for the simulation loop, simulation thread only
     StepTimer mTimer;
+
+    std::thread       mSimulationThread;
+    std::thread       mRenderThread;
+    std::atomic<bool> mRunning;
+
+    // Threads for the frame graph, less the two the simulation and render loops keep busy
+    WorkerPool mWorkerPool;
+
+    // Builds the packet, simulation thread only. The tasks work from mFrameInputs, which is set before every run.
+    TaskGraph  mFrameGraph;
+    struct FrameInputs
+    {
+        Renderer::FramePacket* pPacket = nullptr;
+        float                  FrameSeconds = 0.0f;    // Real time since the last packet
+        float                  TotalSeconds = 0.0f;    // Simulation time, interpolated to the present
+        float                  Alpha = 0.0f;           // How far from the previous step to the latest
+    } mFrameInputs;
+
+    // Simulation to render handoff, three packets so neither side waits on the other
+    Core::Mailbox<Renderer::FramePacket> mFramePackets;
+    uint64_t                             mPacketsBuilt;
+
+    // Size requests from the window thread. Each loop applies its half when the count moves past what it has seen.
+    std::atomic<uint64_t> mRequestedOutputSize;
+    std::atomic<uint32_t> mOutputSizeRequests;
+    uint32_t              mSimulatedOutputSizeRequests;
+    uint32_t              mRenderedOutputSizeRequests;
+
+    std::atomic<bool>     mResumeRequested;
+
+    // Set before the threads start and never changed
+    bool                  mHeadless;
+    HeadlessSettings      mHeadlessSettings;
+
+    // What the null path drew, render thread only
+    Renderer::NullDrawStats mNullDrawStats;
+
+    // Headless image output, only with HeadlessSettings::ImagePath. Draws on the render thread and the frame graph's workers.
+    Renderer::SoftwareRasterizer* mpSoftwareRasterizer;
+    double                        mSoftwareGeometryMs;  // Summed over every frame, render thread only
+    double                        mSoftwareRasterMs;
+
+    // Present to present, what the player actually sees. Render thread only.
+    FrameStats            mPresentStats;
+    uint64_t              mLastPresentTime;
+    uint32_t              mPresentCount;
+
+    // Warmed up frames that allocated, from either loop
+    std::atomic<uint32_t> mAllocatingFrames;
+
+    // Handed to the window thread for the title bar
+    std::mutex            mTitleBarMutex;
+    FrameTimeStats        mTitleBarStats;
 };
 }
 #endif
\ No newline at end of file
@@ -29,6 +29,16 @@ namespace Core
             m_pGame->OnMouseMove(pt.x, pt.y);
             return 0;
 
+        case WM_CLOSE:
+            // The game's threads draw into this window, they have to be gone before it is
+            m_pGame->Stop();
+            DestroyWindow(m_hwnd);
+            return 0;
+
+        case Core::Game::kTitleBarMessage:
+            m_pGame->UpdateTitleBar();
+            return 0;
+
         case WM_DESTROY:
             PostQuitMessage(0);
             return 0;
@@ -131,22 +141,19 @@ namespace Core
 #endif
     }
 
-    // Here we invoke the window procedure to handle windows messages
-    // if no message is received, we process a frame
+    // Here we invoke the window procedure to handle windows messages.
+    // The game simulates and renders on its own threads, so this one can block until there's a message.
     void GameWindow::RunGame()
     {
         MSG msg = {};
-        while (msg.message != WM_QUIT)
+        while (GetMessage(&msg, nullptr, 0, 0) > 0)
         {
-            if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
-            {
-                TranslateMessage(&msg);
-                DispatchMessage(&msg);
-            }
-
-            // Process one gameplay frame
-            m_pGame->Frame();
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
         }
+
+        // Already stopped if the window was closed, but not if the loop ended some other way
+        m_pGame->Stop();
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,73 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of Headless.h
+----------------------------------------------*/
+#include <Easel/Core/Game.h>
+
+#include "Headless.h"
+
+#include <string>
+#include <wchar.h>
+
+namespace Core
+{
+    bool Headless::ParseCommandLine(const wchar_t* commandLine, HeadlessSettings* out_settings)
+    {
+        if (!commandLine)
+            return false;
+
+        HeadlessSettings settings;
+        bool headless = false;
+
+        std::wstring args(commandLine);
+        wchar_t* context = nullptr;
+        for (wchar_t* token = wcstok_s(&args[0], L" \t", &context); token; token = wcstok_s(nullptr, L" \t", &context))
+        {
+            if (!wcscmp(token, L"-headless"))
+            {
+                headless = true;
+            }
+            else if (!wcscmp(token, L"-unthrottled"))
+            {
+                settings.Unthrottled = true;
+            }
+            else if (!wcscmp(token, L"-check-allocations"))
+            {
+                settings.CheckAllocations = true;
+            }
+            else if (!wcscmp(token, L"-image"))
+            {
+                const wchar_t* value = wcstok_s(nullptr, L" \t", &context);
+                size_t converted = 0;
+                if (value)
+                    wcstombs_s(&converted, settings.ImagePath, value, _TRUNCATE);
+            }
+            else if (!wcscmp(token, L"-stress-lights"))
+            {
+                const wchar_t* value = wcstok_s(nullptr, L" \t", &context);
+                settings.StressLights = value ? (uint32_t)wcstoul(value, nullptr, 10) : 0;
+            }
+            else if (!wcscmp(token, L"-frames"))
+            {
+                const wchar_t* value = wcstok_s(nullptr, L" \t", &context);
+                const unsigned long frames = value ? wcstoul(value, nullptr, 10) : 0;
+                if (frames)
+                    settings.Frames = (uint32_t)frames;
+            }
+        }
+
+        if (headless)
+            *out_settings = settings;
+        return headless;
+    }
+
+    bool Headless::Run(HeadlessSettings const& settings)
+    {
+        // Heap allocated, same as GameWindow does
+        Core::Game* pGame = new Core::Game();
+        const bool succeeded = pGame->RunHeadless(settings);
+        delete pGame;
+        return succeeded;
+    }
+}
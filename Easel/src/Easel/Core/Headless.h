@@ -0,0 +1,26 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Entry point for runs without a window or GPU, such as batch
+simulation and nightly perf runs. The app decides from its command line,
+before it creates a window, whether this is one of those.
+----------------------------------------------*/
+#ifndef EASEL_HEADLESS_H
+#define EASEL_HEADLESS_H
+
+#include <Easel.h>
+
+namespace Core
+{
+    struct EASEL_API Headless final
+    {
+        // Picks -headless, -unthrottled, -check-allocations, -frames N, -stress-lights N and -image <file.tga> out of the command line.
+        // False without -headless.
+        static bool ParseCommandLine(const wchar_t* commandLine, HeadlessSettings* out_settings);
+
+        // Runs a Game headless to the end. It leaves Headless.json next to the usual frame time and graph dumps.
+        // With -check-allocations it fails if any frame past warmup allocated, e.g. as a nightly gate.
+        static bool Run(HeadlessSettings const& settings);
+    };
+}
+#endif
@@ -0,0 +1,118 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Triple-buffered mailbox between one producer thread and one
+consumer thread. The producer fills its slot and publishes it; the consumer
+swaps in whatever was published last. Neither side ever waits for the other
+to finish with a slot, and a value the consumer was too slow to see is
+overwritten rather than queued, so the consumer is always at most one
+publish behind. The optional waits are only for pacing, e.g. so a producer
+doesn't build values nobody will look at.
+----------------------------------------------*/
+#ifndef EASEL_MAILBOX_H
+#define EASEL_MAILBOX_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+
+namespace Core {
+
+template<typename T>
+class Mailbox
+{
+public:
+    Mailbox() = default;
+
+    // Before either thread starts, e.g. to point every slot at its own storage
+    T& GetSlot(uint32_t index) { return mSlots[index]; }
+    static constexpr uint32_t kSlotCount = 3;
+
+    // Producer: the slot it owns until the next Publish. Whatever it held last time is still there.
+    T& GetWriteSlot() { return mSlots[mWrite]; }
+
+    // Producer: hands the write slot over and takes back whichever slot is free
+    void Publish()
+    {
+        mWrite = mPending.exchange(mWrite | kFreshBit, std::memory_order_acq_rel) & kIndexMask;
+        Notify();
+    }
+
+    // Consumer: swaps in the latest published value. False if nothing was published since the last Acquire.
+    bool Acquire()
+    {
+        if (!(mPending.load(std::memory_order_relaxed) & kFreshBit))
+            return false;
+
+        mRead = mPending.exchange(mRead, std::memory_order_acq_rel) & kIndexMask;
+        Notify();
+        return true;
+    }
+
+    // Consumer: what the last successful Acquire got
+    const T& GetReadSlot() const { return mSlots[mRead]; }
+
+    // Consumer: blocks until something is published, the timeout passes or the mailbox is closed
+    bool WaitForPublish(uint64_t timeoutMicroseconds)
+    {
+        return Wait(timeoutMicroseconds, [this]() { return (mPending.load(std::memory_order_relaxed) & kFreshBit) != 0; });
+    }
+
+    // Producer: blocks until the last Publish has been acquired, the timeout passes or the mailbox is closed
+    bool WaitForAcquire(uint64_t timeoutMicroseconds)
+    {
+        return Wait(timeoutMicroseconds, [this]() { return (mPending.load(std::memory_order_relaxed) & kFreshBit) == 0; });
+    }
+
+    // Wakes both sides and makes every later wait return immediately, for shutdown
+    void Close()
+    {
+        mClosed.store(true, std::memory_order_relaxed);
+        Notify();
+    }
+
+    bool IsClosed() const { return mClosed.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t kFreshBit = 4;
+    static constexpr uint32_t kIndexMask = 3;
+
+    void Notify()
+    {
+        // Taking the lock orders this against a waiter between checking its predicate and sleeping
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+        }
+        mCondition.notify_all();
+    }
+
+    template<typename TPredicate>
+    bool Wait(uint64_t timeoutMicroseconds, const TPredicate& predicate)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mCondition.wait_for(lock, std::chrono::microseconds(timeoutMicroseconds), [&]()
+        {
+            return predicate() || mClosed.load(std::memory_order_relaxed);
+        }) && !mClosed.load(std::memory_order_relaxed);
+    }
+
+    T mSlots[kSlotCount];
+
+    // Slot index of the pending value, plus kFreshBit if it hasn't been acquired yet
+    std::atomic<uint32_t> mPending{2};
+    uint32_t mWrite = 0;    // Producer only
+    uint32_t mRead = 1;     // Consumer only
+
+    std::atomic<bool>       mClosed{false};
+    std::mutex              mMutex;
+    std::condition_variable mCondition;
+
+public:
+    Mailbox(Mailbox const&)            = delete;
+    Mailbox& operator=(Mailbox const&) = delete;
+};
+
+}
+#endif
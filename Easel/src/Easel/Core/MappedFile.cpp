@@ -0,0 +1,159 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of MappedFile.h
+----------------------------------------------*/
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <utility>
+
+namespace Core {
+
+MappedFile::MappedFile() :
+    mData(nullptr),
+    mSize(0),
+    mIsEmpty(false),
+    mFileHandle(nullptr),
+    mMappingHandle(nullptr)
+{}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+    MappedFile()
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        std::swap(mData, other.mData);
+        std::swap(mSize, other.mSize);
+        std::swap(mIsEmpty, other.mIsEmpty);
+        std::swap(mFileHandle, other.mFileHandle);
+        std::swap(mMappingHandle, other.mMappingHandle);
+    }
+    return *this;
+}
+
+#if defined(_WIN32)
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+    HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size))
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    if (size.QuadPart == 0)
+    {
+        CloseHandle(hFile);
+        mIsEmpty = true;
+        return true;
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!hMapping)
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    const void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!pView)
+    {
+        CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return false;
+    }
+
+    mData = (const char*)pView;
+    mSize = (size_t)size.QuadPart;
+    mFileHandle = hFile;
+    mMappingHandle = hMapping;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData)
+        UnmapViewOfFile(mData);
+    if (mMappingHandle)
+        CloseHandle((HANDLE)mMappingHandle);
+    if (mFileHandle)
+        CloseHandle((HANDLE)mFileHandle);
+
+    mData = nullptr;
+    mSize = 0;
+    mIsEmpty = false;
+    mFileHandle = nullptr;
+    mMappingHandle = nullptr;
+}
+#else
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    if (st.st_size == 0)
+    {
+        close(fd);
+        mIsEmpty = true;
+        return true;
+    }
+
+    // The mapping keeps its own reference to the file
+    void* pView = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pView == MAP_FAILED)
+        return false;
+
+    mData = (const char*)pView;
+    mSize = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData)
+        munmap((void*)mData, mSize);
+
+    mData = nullptr;
+    mSize = 0;
+    mIsEmpty = false;
+}
+#endif
+
+}
@@ -0,0 +1,46 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Read-only memory mapped view of a whole file.
+Lets parsers hand out views straight into the file instead of copying.
+----------------------------------------------*/
+#ifndef EASEL_MAPPEDFILE_H
+#define EASEL_MAPPEDFILE_H
+
+#include <stddef.h>
+#include <string>
+
+namespace Core {
+
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool        IsOpen() const { return mData != nullptr || mIsEmpty; }
+    const char* GetData() const { return mData; }
+    size_t      GetSize() const { return mSize; }
+
+private:
+    const char* mData;
+    size_t      mSize;
+    bool        mIsEmpty; // Zero byte files can't be mapped, but are still valid
+
+    // Platform handles. On Windows both the file and the mapping must stay open, on POSIX only the view does.
+    void*       mFileHandle;
+    void*       mMappingHandle;
+
+public:
+    MappedFile(MappedFile const&)            = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+};
+
+}
+#endif
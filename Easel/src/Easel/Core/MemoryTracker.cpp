@@ -0,0 +1,243 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of MemoryTracker.h
+----------------------------------------------*/
+#include "MemoryTracker.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace Core {
+
+static const char* kMemoryTagNames[(uint32_t)MemoryTag::COUNT] =
+{
+    "General",
+    "Renderer",
+    "ResourceCodex",
+    "Input",
+    "Assets"
+};
+
+const char* GetMemoryTagName(MemoryTag tag)
+{
+    return (uint32_t)tag < (uint32_t)MemoryTag::COUNT ? kMemoryTagNames[(uint32_t)tag] : "Unknown";
+}
+
+#if defined(ESL_TRACK_MEMORY)
+namespace {
+
+// Everything here is touched from inside operator new, so nothing may allocate or need a constructor at runtime
+struct TagCounters
+{
+    std::atomic<int64_t>  LiveBytes{0};
+    std::atomic<int64_t>  PeakBytes{0};
+    std::atomic<uint64_t> TotalAllocations{0};
+    std::atomic<uint64_t> FrameAllocations{0};
+    std::atomic<uint64_t> FrameBytes{0};
+
+    // Only written by EndFrame
+    uint64_t LastFrameAllocations = 0;
+    uint64_t LastFrameBytes = 0;
+    uint64_t PeakFrameAllocations = 0;
+};
+
+TagCounters sTagCounters[(uint32_t)MemoryTag::COUNT];
+
+// Where allocations outside of any scope are charged
+MemorySite sUntaggedSite("Untagged", "", 0, MemoryTag::GENERAL);
+
+std::atomic<MemorySite*> sFirstSite{nullptr};
+
+thread_local MemorySite* tpCurrentSite = nullptr;
+
+// Sits in front of every tracked block. 16 bytes so the block keeps malloc's alignment.
+struct AllocationHeader
+{
+    uint64_t    Size;
+    MemorySite* pSite;
+};
+static_assert(sizeof(AllocationHeader) == 16, "Header must preserve 16 byte alignment");
+
+}
+
+ScopedMemorySite::ScopedMemorySite(MemorySite* pSite) :
+    mpPrevious(tpCurrentSite)
+{
+    if (!pSite->Registered.load(std::memory_order_acquire))
+        MemoryTracker::RegisterSite(pSite);
+    tpCurrentSite = pSite;
+}
+
+ScopedMemorySite::~ScopedMemorySite()
+{
+    tpCurrentSite = mpPrevious;
+}
+
+void MemoryTracker::RegisterSite(MemorySite* pSite)
+{
+    if (pSite->Registered.exchange(true))
+        return; // Another thread got there first
+
+    MemorySite* pHead = sFirstSite.load(std::memory_order_relaxed);
+    do
+    {
+        pSite->pNext = pHead;
+    } while (!sFirstSite.compare_exchange_weak(pHead, pSite, std::memory_order_release, std::memory_order_relaxed));
+}
+
+const MemorySite* MemoryTracker::GetFirstSite()
+{
+    if (!sUntaggedSite.Registered.load(std::memory_order_acquire))
+        RegisterSite(&sUntaggedSite);
+    return sFirstSite.load(std::memory_order_acquire);
+}
+
+bool MemoryTracker::IsEnabled()
+{
+    return true;
+}
+
+void* TrackedMalloc(size_t size)
+{
+    AllocationHeader* pHeader = (AllocationHeader*)malloc(sizeof(AllocationHeader) + size);
+    if (!pHeader)
+        return nullptr;
+
+    MemorySite* pSite = tpCurrentSite ? tpCurrentSite : &sUntaggedSite;
+    pHeader->Size = size;
+    pHeader->pSite = pSite;
+
+    pSite->Allocations.fetch_add(1, std::memory_order_relaxed);
+    pSite->Bytes.fetch_add(size, std::memory_order_relaxed);
+    pSite->LiveBytes.fetch_add((int64_t)size, std::memory_order_relaxed);
+
+    TagCounters& tag = sTagCounters[(uint32_t)pSite->Tag];
+    tag.TotalAllocations.fetch_add(1, std::memory_order_relaxed);
+    tag.FrameAllocations.fetch_add(1, std::memory_order_relaxed);
+    tag.FrameBytes.fetch_add(size, std::memory_order_relaxed);
+
+    const int64_t live = tag.LiveBytes.fetch_add((int64_t)size, std::memory_order_relaxed) + (int64_t)size;
+    int64_t peak = tag.PeakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !tag.PeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {}
+
+    return pHeader + 1;
+}
+
+void TrackedFree(void* p)
+{
+    if (!p)
+        return;
+
+    // Charged back to whoever allocated it, whichever thread or scope frees it
+    AllocationHeader* pHeader = (AllocationHeader*)p - 1;
+    MemorySite* pSite = pHeader->pSite;
+    pSite->LiveBytes.fetch_sub((int64_t)pHeader->Size, std::memory_order_relaxed);
+    sTagCounters[(uint32_t)pSite->Tag].LiveBytes.fetch_sub((int64_t)pHeader->Size, std::memory_order_relaxed);
+
+    free(pHeader);
+}
+
+MemoryTagStats MemoryTracker::GetTagStats(MemoryTag tag)
+{
+    const TagCounters& counters = sTagCounters[(uint32_t)tag];
+
+    MemoryTagStats stats;
+    stats.LiveBytes            = counters.LiveBytes.load(std::memory_order_relaxed);
+    stats.PeakBytes            = counters.PeakBytes.load(std::memory_order_relaxed);
+    stats.TotalAllocations     = counters.TotalAllocations.load(std::memory_order_relaxed);
+    stats.LastFrameAllocations = counters.LastFrameAllocations;
+    stats.LastFrameBytes       = counters.LastFrameBytes;
+    stats.PeakFrameAllocations = counters.PeakFrameAllocations;
+    return stats;
+}
+
+void MemoryTracker::EndFrame()
+{
+    for (TagCounters& counters : sTagCounters)
+    {
+        counters.LastFrameAllocations = counters.FrameAllocations.exchange(0, std::memory_order_relaxed);
+        counters.LastFrameBytes = counters.FrameBytes.exchange(0, std::memory_order_relaxed);
+        if (counters.LastFrameAllocations > counters.PeakFrameAllocations)
+            counters.PeakFrameAllocations = counters.LastFrameAllocations;
+    }
+}
+#else
+ScopedMemorySite::ScopedMemorySite(MemorySite*) : mpPrevious(nullptr) {}
+ScopedMemorySite::~ScopedMemorySite() {}
+
+void MemoryTracker::RegisterSite(MemorySite*) {}
+const MemorySite* MemoryTracker::GetFirstSite() { return nullptr; }
+bool MemoryTracker::IsEnabled() { return false; }
+
+void* TrackedMalloc(size_t size) { return malloc(size); }
+void  TrackedFree(void* p)       { free(p); }
+
+MemoryTagStats MemoryTracker::GetTagStats(MemoryTag)
+{
+    return MemoryTagStats();
+}
+
+void MemoryTracker::EndFrame() {}
+#endif
+
+// JSON strings only need quotes and backslashes escaped here, names and paths are plain ASCII
+static void WriteJSONString(FILE* pFile, const char* str)
+{
+    fputc('"', pFile);
+    for (const char* c = str; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', pFile);
+        fputc(*c, pFile);
+    }
+    fputc('"', pFile);
+}
+
+bool MemoryTracker::DumpJSON(const char* path)
+{
+    FILE* pFile = nullptr;
+    #if defined(_MSC_VER)
+    fopen_s(&pFile, path, "w");
+    #else
+    pFile = fopen(path, "w");
+    #endif
+    if (!pFile)
+        return false;
+
+    fprintf(pFile, "{\n  \"enabled\": %s,\n  \"tags\": [\n", IsEnabled() ? "true" : "false");
+    for (uint32_t i = 0; i != (uint32_t)MemoryTag::COUNT; ++i)
+    {
+        const MemoryTagStats stats = GetTagStats((MemoryTag)i);
+        fprintf(pFile, "    { \"name\": ");
+        WriteJSONString(pFile, GetMemoryTagName((MemoryTag)i));
+        fprintf(pFile, ", \"liveBytes\": %lld, \"peakBytes\": %lld, \"totalAllocations\": %llu, \"lastFrameAllocations\": %llu, \"lastFrameBytes\": %llu, \"peakFrameAllocations\": %llu }%s\n",
+            (long long)stats.LiveBytes, (long long)stats.PeakBytes, (unsigned long long)stats.TotalAllocations,
+            (unsigned long long)stats.LastFrameAllocations, (unsigned long long)stats.LastFrameBytes, (unsigned long long)stats.PeakFrameAllocations,
+            i + 1 != (uint32_t)MemoryTag::COUNT ? "," : "");
+    }
+
+    fprintf(pFile, "  ],\n  \"sites\": [");
+    bool first = true;
+    ForEachSite([&](const MemorySite& site)
+    {
+        fprintf(pFile, "%s\n    { \"name\": ", first ? "" : ",");
+        WriteJSONString(pFile, site.Name);
+        fprintf(pFile, ", \"file\": ");
+        WriteJSONString(pFile, site.File);
+        fprintf(pFile, ", \"line\": %u, \"tag\": ", site.Line);
+        WriteJSONString(pFile, GetMemoryTagName(site.Tag));
+        fprintf(pFile, ", \"allocations\": %llu, \"bytes\": %llu, \"liveBytes\": %lld }",
+            (unsigned long long)site.Allocations.load(std::memory_order_relaxed),
+            (unsigned long long)site.Bytes.load(std::memory_order_relaxed),
+            (long long)site.LiveBytes.load(std::memory_order_relaxed));
+        first = false;
+    });
+    fprintf(pFile, "\n  ]\n}\n");
+
+    fclose(pFile);
+    return true;
+}
+
+}
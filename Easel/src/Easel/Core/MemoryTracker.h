@@ -0,0 +1,120 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Attributes heap memory to the subsystem that asked for it.
+Code opens an ESL_MEMORY_SCOPE(tag), and every allocation made on that thread
+until the scope closes is charged to the tag and to the scope's call site.
+Per tag: live and peak bytes, total allocations, and allocations per frame,
+which is what shows churn behind frame spikes. Per site: a histogram of
+counts and bytes. All of it can be queried at runtime or dumped to JSON.
+Only active in builds with ESL_TRACK_MEMORY, otherwise the scopes compile away
+and TrackedMalloc is plain malloc.
+----------------------------------------------*/
+#ifndef EASEL_MEMORYTRACKER_H
+#define EASEL_MEMORYTRACKER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Core {
+
+enum class MemoryTag : uint8_t
+{
+    GENERAL,        // Anything outside a scope
+    RENDERER,
+    RESOURCE_CODEX,
+    INPUT,
+    ASSETS,
+    COUNT
+};
+
+const char* GetMemoryTagName(MemoryTag tag);
+
+// One per ESL_MEMORY_SCOPE. Constant initialized, so declaring one never allocates or locks.
+struct MemorySite
+{
+    constexpr MemorySite(const char* name, const char* file, uint32_t line, MemoryTag tag) :
+        Name(name), File(file), Line(line), Tag(tag)
+    {}
+
+    const char* Name;
+    const char* File;
+    uint32_t    Line;
+    MemoryTag   Tag;
+
+    std::atomic<uint64_t> Allocations{0};
+    std::atomic<uint64_t> Bytes{0};
+    std::atomic<int64_t>  LiveBytes{0};
+
+    // Intrusive list of every site that has been entered, see MemoryTracker::ForEachSite
+    std::atomic<bool> Registered{false};
+    MemorySite*       pNext = nullptr;
+};
+
+struct MemoryTagStats
+{
+    int64_t  LiveBytes;
+    int64_t  PeakBytes;
+    uint64_t TotalAllocations;
+    uint64_t LastFrameAllocations;
+    uint64_t LastFrameBytes;
+    uint64_t PeakFrameAllocations; // Worst single frame so far
+};
+
+// Makes its site current for this thread, restores the previous one on exit
+class ScopedMemorySite
+{
+public:
+    explicit ScopedMemorySite(MemorySite* pSite);
+    ~ScopedMemorySite();
+
+private:
+    MemorySite* mpPrevious;
+
+public:
+    ScopedMemorySite(ScopedMemorySite const&)            = delete;
+    ScopedMemorySite& operator=(ScopedMemorySite const&) = delete;
+};
+
+struct MemoryTracker final
+{
+    static bool IsEnabled();
+
+    static MemoryTagStats GetTagStats(MemoryTag tag);
+
+    // Rolls the per-frame counters over. Called once per frame by the main loop.
+    static void EndFrame();
+
+    // Visits every site entered so far as func(const MemorySite&). Sites are never removed.
+    template<typename TFunc>
+    static void ForEachSite(const TFunc& func)
+    {
+        for (const MemorySite* pSite = GetFirstSite(); pSite; pSite = pSite->pNext)
+            func(*pSite);
+    }
+
+    // Writes tags and sites as JSON. False if the file couldn't be opened.
+    static bool DumpJSON(const char* path);
+
+    static const MemorySite* GetFirstSite();
+    static void RegisterSite(MemorySite* pSite);
+};
+
+// Heap memory charged to the current scope. Blocks from TrackedMalloc must go back through TrackedFree.
+void* TrackedMalloc(size_t size);
+void  TrackedFree(void* p);
+
+}
+
+#if defined(ESL_TRACK_MEMORY)
+    #define ESL_MEMORY_CONCAT_INNER(a, b) a##b
+    #define ESL_MEMORY_CONCAT(a, b) ESL_MEMORY_CONCAT_INNER(a, b)
+    #define ESL_MEMORY_SCOPE(tag) \
+        static Core::MemorySite ESL_MEMORY_CONCAT(sMemorySite, __LINE__)(__FUNCTION__, __FILE__, __LINE__, tag); \
+        Core::ScopedMemorySite ESL_MEMORY_CONCAT(memoryScope, __LINE__)(&ESL_MEMORY_CONCAT(sMemorySite, __LINE__))
+#else
+    #define ESL_MEMORY_SCOPE(tag) do {} while (0)
+#endif
+
+#endif
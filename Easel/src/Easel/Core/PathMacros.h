@@ -23,6 +23,7 @@ helper macros for reaching certain paths
 #define TEXTUREPATH ASSETPATH ## "Textures\\"
 #define SHADERPATH "..\\_bin\\Shaders\\"
 #define SHADERPATHW WIDEN(SHADERPATH)
+#define CACHEPATH "..\\_cache\\"
 
 namespace Core
 {
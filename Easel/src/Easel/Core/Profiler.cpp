@@ -0,0 +1,373 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of Profiler.h
+----------------------------------------------*/
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+namespace Core {
+
+namespace {
+
+static const uint32_t kRingCapacity = 8192; // Power of two
+static const uint32_t kRingMask = kRingCapacity - 1;
+
+struct ProfileEvent
+{
+    uint64_t           Start;
+    uint64_t           End;
+    const ProfileZone* Zone;
+    uint32_t           Depth;
+};
+
+// Written only by its owning thread, read only by the thread calling NewFrame
+struct ThreadRing
+{
+    ProfileEvent          Events[kRingCapacity];
+    std::atomic<uint64_t> WriteIndex{0};
+    std::atomic<uint64_t> ReadIndex{0};
+    std::atomic<const char*> Name{nullptr};
+
+    // Rings outlive their threads. Once a retired ring is fully drained, the next new thread takes it over.
+    std::atomic<bool>     Retired{false};
+    uint32_t              Index = 0;
+    ThreadRing*           pNext = nullptr;
+};
+
+struct RingRegistry
+{
+    std::atomic<ThreadRing*> Head{nullptr};
+    std::atomic<uint32_t>    Count{0};
+
+    ~RingRegistry()
+    {
+        ThreadRing* pRing = Head.load();
+        while (pRing)
+        {
+            ThreadRing* pNext = pRing->pNext;
+            delete pRing;
+            pRing = pNext;
+        }
+    }
+};
+RingRegistry sRings;
+
+ThreadRing* AcquireRing()
+{
+    for (ThreadRing* pRing = sRings.Head.load(std::memory_order_acquire); pRing; pRing = pRing->pNext)
+    {
+        bool retired = true;
+        if (pRing->ReadIndex.load(std::memory_order_acquire) == pRing->WriteIndex.load(std::memory_order_relaxed) &&
+            pRing->Retired.compare_exchange_strong(retired, false))
+        {
+            pRing->Name.store(nullptr, std::memory_order_relaxed);
+            return pRing;
+        }
+    }
+
+    // Short lived threads mostly end up above, so this is rare after startup
+    ThreadRing* pRing = new ThreadRing();
+    pRing->Index = sRings.Count.fetch_add(1);
+    ThreadRing* pHead = sRings.Head.load(std::memory_order_relaxed);
+    do
+    {
+        pRing->pNext = pHead;
+    } while (!sRings.Head.compare_exchange_weak(pHead, pRing, std::memory_order_release, std::memory_order_relaxed));
+    return pRing;
+}
+
+// Hands the ring back when its thread exits
+struct ThreadRingOwner
+{
+    ThreadRing* pRing = nullptr;
+
+    ThreadRing* Get()
+    {
+        if (!pRing)
+            pRing = AcquireRing();
+        return pRing;
+    }
+
+    ~ThreadRingOwner()
+    {
+        if (pRing)
+            pRing->Retired.store(true, std::memory_order_release);
+    }
+};
+thread_local ThreadRingOwner tRingOwner;
+thread_local uint32_t tDepth = 0;
+
+// Taken when the module loads, GetTicksPerSecond compares against it
+struct Calibration
+{
+    uint64_t                              Ticks = Profiler::ReadTimestamp();
+    std::chrono::steady_clock::time_point Time = std::chrono::steady_clock::now();
+};
+const Calibration sCalibration;
+
+struct CapturedEvent
+{
+    ProfileEvent Event;
+    uint32_t     ThreadIndex;
+};
+
+// Only touched by the thread calling NewFrame
+struct ProfilerState
+{
+    ProfileFrame               LastFrame;
+    std::vector<CapturedEvent> FrameEvents;     // Reused every frame
+    std::vector<uint32_t>      OpenNodes;       // Node index per depth while building the tree
+    std::vector<CapturedEvent> Capture;
+    std::vector<std::pair<uint32_t, const char*>> CaptureThreads;
+    bool                       Capturing = false;
+    uint64_t                   FrameIndex = 0;
+    uint64_t                   FrameStart = 0;
+};
+ProfilerState sState;
+
+void DrainRing(ThreadRing& ring, std::vector<CapturedEvent>* out_events, uint32_t* out_dropped)
+{
+    uint64_t read = ring.ReadIndex.load(std::memory_order_relaxed);
+    const uint64_t write = ring.WriteIndex.load(std::memory_order_acquire);
+    if (write - read > kRingCapacity)
+    {
+        *out_dropped += (uint32_t)(write - read - kRingCapacity);
+        read = write - kRingCapacity;
+    }
+
+    const size_t first = out_events->size();
+    for (uint64_t i = read; i != write; ++i)
+        out_events->push_back({ ring.Events[i & kRingMask], ring.Index });
+
+    // The writer may have lapped us while copying, anything it could have touched is unreliable
+    const uint64_t writeAfter = ring.WriteIndex.load(std::memory_order_acquire);
+    if (writeAfter - read > kRingCapacity)
+    {
+        const uint64_t torn = std::min<uint64_t>(writeAfter - read - kRingCapacity, write - read);
+        out_events->erase(out_events->begin() + first, out_events->begin() + first + (size_t)torn);
+        *out_dropped += (uint32_t)torn;
+    }
+
+    ring.ReadIndex.store(write, std::memory_order_release);
+}
+
+}
+
+double Profiler::GetTicksPerSecond()
+{
+    using namespace std::chrono;
+
+    // A second in, the ratio is as good as it gets and is kept
+    static std::atomic<double> sSettled{0.0};
+    const double settled = sSettled.load(std::memory_order_relaxed);
+    if (settled != 0.0)
+        return settled;
+
+    // Too short a window makes for a noisy ratio
+    steady_clock::time_point now = steady_clock::now();
+    while (now - sCalibration.Time < milliseconds(10))
+    {
+        std::this_thread::yield();
+        now = steady_clock::now();
+    }
+
+    const uint64_t ticks = ReadTimestamp();
+    const double seconds = duration<double>(now - sCalibration.Time).count();
+    const double ticksPerSecond = (ticks - sCalibration.Ticks) / seconds;
+    if (seconds >= 1.0)
+        sSettled.store(ticksPerSecond, std::memory_order_relaxed);
+    return ticksPerSecond;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    tRingOwner.Get()->Name.store(name, std::memory_order_relaxed);
+}
+
+uint32_t& Profiler::GetThreadDepth()
+{
+    return tDepth;
+}
+
+void Profiler::Record(const ProfileZone* pZone, uint64_t start, uint64_t end, uint32_t depth)
+{
+    ThreadRing* pRing = tRingOwner.Get();
+    const uint64_t write = pRing->WriteIndex.load(std::memory_order_relaxed);
+
+    ProfileEvent& event = pRing->Events[write & kRingMask];
+    event.Start = start;
+    event.End = end;
+    event.Zone = pZone;
+    event.Depth = depth;
+
+    pRing->WriteIndex.store(write + 1, std::memory_order_release);
+}
+
+void Profiler::NewFrame()
+{
+    ProfilerState& state = sState;
+    const uint64_t now = ReadTimestamp();
+
+    state.FrameEvents.clear();
+    uint32_t dropped = 0;
+    for (ThreadRing* pRing = sRings.Head.load(std::memory_order_acquire); pRing; pRing = pRing->pNext)
+        DrainRing(*pRing, &state.FrameEvents, &dropped);
+
+    // Parents close after their children, so sort back into call order per thread
+    std::sort(state.FrameEvents.begin(), state.FrameEvents.end(), [](const CapturedEvent& a, const CapturedEvent& b)
+    {
+        if (a.ThreadIndex != b.ThreadIndex)
+            return a.ThreadIndex < b.ThreadIndex;
+        return a.Event.Start != b.Event.Start ? a.Event.Start < b.Event.Start : a.Event.Depth < b.Event.Depth;
+    });
+
+    ProfileFrame& frame = state.LastFrame;
+    frame.FrameIndex = state.FrameIndex++;
+    frame.BeginTicks = state.FrameStart;
+    frame.EndTicks = now;
+    frame.DroppedEvents = dropped;
+    frame.Nodes.clear();
+
+    uint32_t thread = UINT32_MAX;
+    for (const CapturedEvent& captured : state.FrameEvents)
+    {
+        const ProfileEvent& event = captured.Event;
+        if (captured.ThreadIndex != thread)
+        {
+            thread = captured.ThreadIndex;
+            state.OpenNodes.clear();
+        }
+
+        // A parent that opened in an earlier frame hasn't been drained yet, treat the zone as a root then
+        const uint32_t depth = std::min<uint32_t>(event.Depth, (uint32_t)state.OpenNodes.size());
+        state.OpenNodes.resize(depth);
+        const uint32_t parent = depth ? state.OpenNodes[depth - 1] : ProfileNode::kNoParent;
+
+        // Fold repeated calls from the same parent into one node
+        uint32_t nodeIndex = ProfileNode::kNoParent;
+        for (uint32_t i = parent == ProfileNode::kNoParent ? 0 : parent + 1; i != (uint32_t)frame.Nodes.size(); ++i)
+        {
+            const ProfileNode& node = frame.Nodes[i];
+            if (node.Parent == parent && node.Zone == event.Zone && node.ThreadIndex == thread)
+            {
+                nodeIndex = i;
+                break;
+            }
+        }
+
+        if (nodeIndex == ProfileNode::kNoParent)
+        {
+            nodeIndex = (uint32_t)frame.Nodes.size();
+            frame.Nodes.push_back({ event.Zone, parent, depth, thread, 0, 0 });
+        }
+
+        ProfileNode& node = frame.Nodes[nodeIndex];
+        ++node.Calls;
+        node.Ticks += event.End - event.Start;
+        state.OpenNodes.push_back(nodeIndex);
+    }
+
+    if (state.Capturing)
+    {
+        state.Capture.insert(state.Capture.end(), state.FrameEvents.begin(), state.FrameEvents.end());
+        for (ThreadRing* pRing = sRings.Head.load(std::memory_order_acquire); pRing; pRing = pRing->pNext)
+        {
+            const char* name = pRing->Name.load(std::memory_order_relaxed);
+            auto itFind = std::find_if(state.CaptureThreads.begin(), state.CaptureThreads.end(), [&](const std::pair<uint32_t, const char*>& t) { return t.first == pRing->Index; });
+            if (itFind == state.CaptureThreads.end())
+                state.CaptureThreads.push_back({ pRing->Index, name });
+            else if (name)
+                itFind->second = name;
+        }
+    }
+
+    state.FrameStart = now;
+}
+
+const ProfileFrame& Profiler::GetLastFrame()
+{
+    return sState.LastFrame;
+}
+
+void Profiler::BeginCapture()
+{
+    sState.Capture.clear();
+    sState.CaptureThreads.clear();
+    sState.Capturing = true;
+}
+
+void Profiler::EndCapture()
+{
+    sState.Capturing = false;
+}
+
+bool Profiler::IsCapturing()
+{
+    return sState.Capturing;
+}
+
+// Zone names are literals, file paths can have backslashes
+static void WriteJSONString(FILE* pFile, const char* str)
+{
+    fputc('"', pFile);
+    for (const char* c = str ? str : ""; *c; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', pFile);
+        fputc(*c, pFile);
+    }
+    fputc('"', pFile);
+}
+
+bool Profiler::ExportChromeTrace(const char* path)
+{
+    FILE* pFile = nullptr;
+    #if defined(_MSC_VER)
+    fopen_s(&pFile, path, "w");
+    #else
+    pFile = fopen(path, "w");
+    #endif
+    if (!pFile)
+        return false;
+
+    const ProfilerState& state = sState;
+    const double usPerTick = 1000000.0 / GetTicksPerSecond();
+    const uint64_t origin = state.Capture.empty() ? 0 : std::min_element(state.Capture.begin(), state.Capture.end(),
+        [](const CapturedEvent& a, const CapturedEvent& b) { return a.Event.Start < b.Event.Start; })->Event.Start;
+
+    fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    bool first = true;
+    for (const std::pair<uint32_t, const char*>& thread : state.CaptureThreads)
+    {
+        fprintf(pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", thread.first);
+        WriteJSONString(pFile, thread.second ? thread.second : "Worker");
+        fprintf(pFile, "}}");
+        first = false;
+    }
+
+    // Complete events, Perfetto nests them by time so depth doesn't need to be written out
+    for (const CapturedEvent& captured : state.Capture)
+    {
+        const ProfileEvent& event = captured.Event;
+        fprintf(pFile, "%s{\"name\":", first ? "" : ",\n");
+        WriteJSONString(pFile, event.Zone->Name);
+        fprintf(pFile, ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"file\":",
+            captured.ThreadIndex, (event.Start - origin) * usPerTick, (event.End - event.Start) * usPerTick);
+        WriteJSONString(pFile, event.Zone->File);
+        fprintf(pFile, ",\"line\":%u}}", event.Zone->Line);
+        first = false;
+    }
+
+    fprintf(pFile, "\n]}\n");
+    fclose(pFile);
+    return true;
+}
+
+}
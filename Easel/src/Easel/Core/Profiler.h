@@ -0,0 +1,135 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Hierarchical CPU profiler.
+ESL_PROFILE_ZONE("Name") times the enclosing scope with the timestamp counter
+and pushes one event into the calling thread's ring buffer when it closes.
+Rings have a single writer and are drained lock-free in NewFrame(), which
+folds the frame's events into a call tree (GetLastFrame). NewFrame and the
+capture calls all belong to one thread, Game's simulation thread.
+Between BeginCapture() and EndCapture() events are also kept so they can be
+exported as a Chrome trace, which chrome://tracing and Perfetto both open.
+A zone costs two timestamp reads and a ring store, so it stays on in Release.
+Define ESL_DISABLE_PROFILER to compile zones out entirely.
+----------------------------------------------*/
+#ifndef EASEL_PROFILER_H
+#define EASEL_PROFILER_H
+
+#include <stdint.h>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+    #define ESL_PROFILER_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define ESL_PROFILER_TSC 1
+#else
+    #include <chrono>
+#endif
+
+namespace Core {
+
+// One per ESL_PROFILE_ZONE, identifies it in every event
+struct ProfileZone
+{
+    const char* Name;
+    const char* File;
+    uint32_t    Line;
+};
+
+// A zone and every call of it from the same parent, folded together
+struct ProfileNode
+{
+    static constexpr uint32_t kNoParent = UINT32_MAX;
+
+    const ProfileZone* Zone;
+    uint32_t           Parent;      // Index into ProfileFrame::Nodes, parents come before their children
+    uint32_t           Depth;
+    uint32_t           ThreadIndex;
+    uint32_t           Calls;
+    uint64_t           Ticks;       // Inclusive
+};
+
+struct ProfileFrame
+{
+    uint64_t                 FrameIndex = 0;
+    uint64_t                 BeginTicks = 0;
+    uint64_t                 EndTicks = 0;
+    uint32_t                 DroppedEvents = 0; // Overwritten before they were drained
+    std::vector<ProfileNode> Nodes;
+};
+
+struct Profiler final
+{
+    static uint64_t ReadTimestamp()
+    {
+        #if defined(ESL_PROFILER_TSC)
+        return __rdtsc();
+        #else
+        return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+        #endif
+    }
+
+    // Measured against the OS clock, so only meaningful some milliseconds after startup
+    static double GetTicksPerSecond();
+    static double TicksToMilliseconds(uint64_t ticks) { return ticks * 1000.0 / GetTicksPerSecond(); }
+
+    // Shows up in captures. The string must outlive the thread.
+    static void SetThreadName(const char* name);
+
+    // Once per frame: drains every ring and builds the previous frame's tree
+    static void NewFrame();
+    static const ProfileFrame& GetLastFrame();
+
+    static void BeginCapture();
+    static void EndCapture();
+    static bool IsCapturing();
+
+    // Writes what the last capture recorded. False if the file couldn't be opened.
+    static bool ExportChromeTrace(const char* path);
+
+    // Called by ProfileScope, see Profiler.cpp
+    static void Record(const ProfileZone* pZone, uint64_t start, uint64_t end, uint32_t depth);
+    static uint32_t& GetThreadDepth();
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const ProfileZone* pZone) :
+        mpZone(pZone),
+        mDepth(Profiler::GetThreadDepth()++),
+        mStart(Profiler::ReadTimestamp())
+    {}
+
+    ~ProfileScope()
+    {
+        const uint64_t end = Profiler::ReadTimestamp();
+        --Profiler::GetThreadDepth();
+        Profiler::Record(mpZone, mStart, end, mDepth);
+    }
+
+private:
+    const ProfileZone* mpZone;
+    uint32_t           mDepth;
+    uint64_t           mStart;
+
+public:
+    ProfileScope(ProfileScope const&)            = delete;
+    ProfileScope& operator=(ProfileScope const&) = delete;
+};
+
+}
+
+#if !defined(ESL_DISABLE_PROFILER)
+    #define ESL_PROFILE_CONCAT_INNER(a, b) a##b
+    #define ESL_PROFILE_CONCAT(a, b) ESL_PROFILE_CONCAT_INNER(a, b)
+    #define ESL_PROFILE_ZONE(name) \
+        static const Core::ProfileZone ESL_PROFILE_CONCAT(sProfileZone, __LINE__) = { name, __FILE__, __LINE__ }; \
+        Core::ProfileScope ESL_PROFILE_CONCAT(profileScope, __LINE__)(&ESL_PROFILE_CONCAT(sProfileZone, __LINE__))
+#else
+    #define ESL_PROFILE_ZONE(name) do {} while (0)
+#endif
+
+#endif
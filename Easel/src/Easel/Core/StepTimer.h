@@ -1,14 +1,17 @@
 /*----------------------------------------------
 Chuck Walbourn
 Date : 2019/12
-Description : StepTimer Interface, taken from the DirectX Visual Studio Template
+Description : StepTimer Interface, taken from the DirectX Visual Studio Template.
+Reads Core::Clock instead of QueryPerformanceCounter so it builds anywhere,
+and records every frame's real duration into a FrameStats.
 ----------------------------------------------*/
 #ifndef STEPTIMER_H
 #define STEPTIMER_H
 
-#include <Easel/Core/WinApp.h>
+#include "Clock.h"
+#include "FrameStats.h"
+
 #include <cmath>
-#include <exception>
 #include <stdint.h>
 
 namespace Core {
@@ -17,35 +20,25 @@ namespace Core {
 class StepTimer
 {
 public:
-    StepTimer() noexcept(false) :
+    StepTimer() :
+        m_clockFrequency(Clock::GetFrequency()),
+        m_clockLastTime(Clock::Now()),
         m_elapsedTicks(0),
+        m_frameElapsedTicks(0),
         m_totalTicks(0),
         m_leftOverTicks(0),
         m_frameCount(0),
+        m_tickCount(0),
         m_framesPerSecond(0),
         m_framesThisSecond(0),
-        m_qpcSecondCounter(0),
+        m_clockSecondCounter(0),
         m_isFixedTimeStep(false),
-        m_targetElapsedTicks(TicksPerSecond / 60)
+        m_targetElapsedTicks(TicksPerSecond / 60),
+        m_maxUpdatesPerTick(kDefaultMaxUpdatesPerTick),
+        m_droppedTicks(0)
     {
-
-        #if defined(ESL_DEBUG)
-            if (!QueryPerformanceFrequency(&m_qpcFrequency))
-            {
-                throw std::exception("QueryPerformanceFrequency");
-            }
-
-            if (!QueryPerformanceCounter(&m_qpcLastTime))
-            {
-                throw std::exception("QueryPerformanceCounter");
-            }
-        #else
-            QueryPerformanceFrequency(&m_qpcFrequency);
-            QueryPerformanceCounter(&m_qpcLastTime);
-        #endif
-
         // Initialize max delta to 1/10 of a second.
-        m_qpcMaxDelta = static_cast<uint64_t>(m_qpcFrequency.QuadPart / 10);
+        m_clockMaxDelta = m_clockFrequency / 10;
     }
 
     // Get elapsed time since the previous Update call.
@@ -59,9 +52,35 @@ public:
     // Get total number of updates since start of the program.
     uint32_t GetFrameCount() const { return m_frameCount; }
 
+    // Get total number of Tick calls, i.e. frames presented. Differs from GetFrameCount in fixed timestep mode.
+    uint32_t GetTickCount() const { return m_tickCount; }
+
+    // Real time covered by the last Tick, after the max delta clamp. For work that runs once per presented frame.
+    uint64_t GetFrameElapsedTicks() const { return m_frameElapsedTicks; }
+    double GetFrameElapsedSeconds() const { return TicksToSeconds(m_frameElapsedTicks); }
+
+    // How far the present is between the last fixed update and the next one, in [0, 1).
+    // Render state interpolates from the previous update's to the latest by this much. Always 1 in variable mode.
+    double GetInterpolationAlpha() const
+    {
+        return m_isFixedTimeStep ? static_cast<double>(m_leftOverTicks) / static_cast<double>(m_targetElapsedTicks) : 1.0;
+    }
+
+    // Simulation time of what's presented with GetInterpolationAlpha, which trails the latest update by up to one step.
+    double GetInterpolatedTotalSeconds() const
+    {
+        if (!m_isFixedTimeStep || m_totalTicks < m_targetElapsedTicks)
+            return GetTotalSeconds();
+        return TicksToSeconds(m_totalTicks - m_targetElapsedTicks + m_leftOverTicks);
+    }
+
     // Get the current framerate.
     uint32_t GetFramesPerSecond() const { return m_framesPerSecond; }
 
+    // Wall clock duration of every Tick, unclamped, so stutter shows up in the percentiles.
+    FrameStats const& GetFrameStats() const { return m_frameStats; }
+    FrameStats& GetFrameStats() { return m_frameStats; }
+
     // Set whether to use fixed or variable timestep mode.
     void SetFixedTimeStep(bool isFixedTimestep) { m_isFixedTimeStep = isFixedTimestep; }
 
@@ -69,6 +88,15 @@ public:
     void SetTargetElapsedTicks(uint64_t targetElapsed) { m_targetElapsedTicks = targetElapsed; }
     void SetTargetElapsedSeconds(double targetElapsed) { m_targetElapsedTicks = SecondsToTicks(targetElapsed); }
 
+    // Caps the fixed updates one Tick may run to catch up. When updates cost more than the time they
+    // cover, an uncapped loop runs more of them every frame until it never returns (the spiral of death).
+    // Past the cap, whole steps are dropped and the simulation runs slow instead.
+    static constexpr uint32_t kDefaultMaxUpdatesPerTick = 4;
+    void SetMaxUpdatesPerTick(uint32_t maxUpdates) { m_maxUpdatesPerTick = maxUpdates ? maxUpdates : 1; }
+
+    // Total time the simulation has given up to the cap, in ticks
+    uint64_t GetDroppedTicks() const { return m_droppedTicks; }
+
     // Integer format represents time using 10,000,000 ticks per second.
     static const uint64_t TicksPerSecond = 10000000;
 
@@ -81,17 +109,12 @@ public:
 
     void ResetElapsedTime()
     {
-        #if defined(ESL_DEBUG)
-        if (!QueryPerformanceCounter(&m_qpcLastTime))
-        {
-            throw std::exception("QueryPerformanceCounter");
-        }
-        #endif
+        m_clockLastTime = Clock::Now();
 
         m_leftOverTicks = 0;
         m_framesPerSecond = 0;
         m_framesThisSecond = 0;
-        m_qpcSecondCounter = 0;
+        m_clockSecondCounter = 0;
     }
 
     // Update timer state, calling the specified Update function the appropriate number of times.
@@ -99,33 +122,28 @@ public:
     void Tick(const TUpdate& update)
     {
         // Query the current time.
-        LARGE_INTEGER currentTime;
-        
-        #if defined(ESL_DEBUG)
-            if (!QueryPerformanceCounter(&currentTime))
-            {
-                throw std::exception("QueryPerformanceCounter");
-            }
-        #else
-            QueryPerformanceCounter(&currentTime);
-        #endif
+        const uint64_t currentTime = Clock::Now();
 
-        uint64_t timeDelta = static_cast<uint64_t>(currentTime.QuadPart - m_qpcLastTime.QuadPart);
+        uint64_t timeDelta = currentTime - m_clockLastTime;
 
-        m_qpcLastTime = currentTime;
-        m_qpcSecondCounter += timeDelta;
+        m_clockLastTime = currentTime;
+        m_clockSecondCounter += timeDelta;
+
+        // Before clamping, a long frame is exactly what the statistics are there to catch.
+        m_frameStats.Record(Clock::TicksToMicroseconds(timeDelta));
 
         // Clamp excessively large time deltas (e.g. after paused in the debugger).
-        if (timeDelta > m_qpcMaxDelta)
+        if (timeDelta > m_clockMaxDelta)
         {
-            timeDelta = m_qpcMaxDelta;
+            timeDelta = m_clockMaxDelta;
         }
 
-        // Convert QPC units into a canonical tick format. This cannot overflow due to the previous clamp.
+        // Convert clock units into a canonical tick format. This cannot overflow due to the previous clamp.
         timeDelta *= TicksPerSecond;
-        timeDelta /= static_cast<uint64_t>(m_qpcFrequency.QuadPart);
+        timeDelta /= m_clockFrequency;
 
-        uint32_t lastFrameCount = m_frameCount;
+        m_frameElapsedTicks = timeDelta;
+        m_tickCount++;
 
         if (m_isFixedTimeStep)
         {
@@ -145,12 +163,23 @@ public:
 
             m_leftOverTicks += timeDelta;
 
+            uint32_t updates = 0;
             while (m_leftOverTicks >= m_targetElapsedTicks)
             {
+                if (updates == m_maxUpdatesPerTick)
+                {
+                    // Drop the whole steps that are left but keep the fraction, so interpolation doesn't jump
+                    const uint64_t dropped = m_leftOverTicks - m_leftOverTicks % m_targetElapsedTicks;
+                    m_droppedTicks += dropped;
+                    m_leftOverTicks -= dropped;
+                    break;
+                }
+
                 m_elapsedTicks = m_targetElapsedTicks;
                 m_totalTicks += m_targetElapsedTicks;
                 m_leftOverTicks -= m_targetElapsedTicks;
                 m_frameCount++;
+                updates++;
 
                 update();
             }
@@ -166,40 +195,64 @@ public:
             update();
         }
 
-        // Track the current framerate.
-        if (m_frameCount != lastFrameCount)
-        {
-            m_framesThisSecond++;
-        }
+        // Track the current framerate. Every Tick presents a frame, interpolated if nothing was updated.
+        m_framesThisSecond++;
 
-        if (m_qpcSecondCounter >= static_cast<uint64_t>(m_qpcFrequency.QuadPart))
+        if (m_clockSecondCounter >= m_clockFrequency)
         {
             m_framesPerSecond = m_framesThisSecond;
             m_framesThisSecond = 0;
-            m_qpcSecondCounter %= static_cast<uint64_t>(m_qpcFrequency.QuadPart);
+            m_clockSecondCounter %= m_clockFrequency;
         }
     }
 
+    // Runs exactly one fixed length update, however much real time has passed. For runs that go as fast as
+    // they can, where simulated time mustn't depend on the machine. Nothing is left over, so alpha is 0.
+    template<typename TUpdate>
+    void StepOnce(const TUpdate& update)
+    {
+        const uint64_t currentTime = Clock::Now();
+        const uint64_t timeDelta = currentTime - m_clockLastTime;
+
+        m_clockLastTime = currentTime;
+        m_frameStats.Record(Clock::TicksToMicroseconds(timeDelta));
+
+        m_elapsedTicks = m_targetElapsedTicks;
+        m_frameElapsedTicks = m_targetElapsedTicks;
+        m_totalTicks += m_targetElapsedTicks;
+        m_leftOverTicks = 0;
+        m_frameCount++;
+        m_tickCount++;
+
+        update();
+    }
+
 private:
-    // Source timing data uses QPC units.
-    LARGE_INTEGER m_qpcFrequency;
-    LARGE_INTEGER m_qpcLastTime;
-    uint64_t m_qpcMaxDelta;
+    // Source timing data uses Clock units.
+    uint64_t m_clockFrequency;
+    uint64_t m_clockLastTime;
+    uint64_t m_clockMaxDelta;
 
     // Derived timing data uses a canonical tick format.
     uint64_t m_elapsedTicks;
+    uint64_t m_frameElapsedTicks;
     uint64_t m_totalTicks;
     uint64_t m_leftOverTicks;
 
     // Members for tracking the framerate.
     uint32_t m_frameCount;
+    uint32_t m_tickCount;
     uint32_t m_framesPerSecond;
     uint32_t m_framesThisSecond;
-    uint64_t m_qpcSecondCounter;
+    uint64_t m_clockSecondCounter;
 
     // Members for configuring fixed timestep mode.
     bool m_isFixedTimeStep;
     uint64_t m_targetElapsedTicks;
+    uint32_t m_maxUpdatesPerTick;
+    uint64_t m_droppedTicks;
+
+    FrameStats m_frameStats;
 };
 }
 #endif
\ No newline at end of file
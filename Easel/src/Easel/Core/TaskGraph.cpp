@@ -0,0 +1,231 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of TaskGraph.h
+----------------------------------------------*/
+#include "TaskGraph.h"
+
+#include "Allocators.h"
+#include "Clock.h"
+#include "WorkerPool.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <thread>
+
+namespace Core {
+
+uint32_t TaskGraph::AddTask(const char* name, ResourceMask reads, ResourceMask writes, TaskFunc func)
+{
+    assert(!mCompiled && "Tasks can't be added to a compiled graph");
+    assert(mTasks.size() < kMaxTasks);
+
+    Task task;
+    task.Name = name;
+    task.Reads = reads;
+    task.Writes = writes;
+    task.Func = std::move(func);
+    task.Zone = { name, __FILE__, __LINE__ };
+    mTasks.push_back(std::move(task));
+    return (uint32_t)mTasks.size() - 1;
+}
+
+void TaskGraph::Compile()
+{
+    assert(!mCompiled);
+
+    // Read after write, write after write and write after read all have to keep their order.
+    // Reads of the same thing don't, so those are free to overlap.
+    for (uint32_t later = 0; later != (uint32_t)mTasks.size(); ++later)
+    {
+        Task& task = mTasks[later];
+        for (uint32_t earlier = 0; earlier != later; ++earlier)
+        {
+            Task& before = mTasks[earlier];
+            if ((before.Writes & (task.Reads | task.Writes)) || (before.Reads & task.Writes))
+            {
+                task.Predecessors.push_back(earlier);
+                before.Successors.push_back(later);
+            }
+        }
+
+        if (task.Predecessors.empty())
+            mRoots.push_back(later);
+    }
+
+    mPending.reset(new std::atomic<uint32_t>[mTasks.size()]);
+    mCompiled = true;
+}
+
+void TaskGraph::Run(WorkerPool* pPool)
+{
+    assert(mCompiled && "Compile the graph before running it");
+
+    const uint64_t start = Clock::Now();
+    if (!pPool || !pPool->GetWorkerCount())
+    {
+        // Added order is always a valid order
+        for (uint32_t i = 0; i != (uint32_t)mTasks.size(); ++i)
+        {
+            Task& task = mTasks[i];
+            ProfileScope scope(&task.Zone);
+            const uint64_t taskStart = Clock::Now();
+            task.Func();
+            task.TotalTicks += Clock::Now() - taskStart;
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i != (uint32_t)mTasks.size(); ++i)
+            mPending[i].store((uint32_t)mTasks[i].Predecessors.size(), std::memory_order_relaxed);
+        mRemaining.store((uint32_t)mTasks.size(), std::memory_order_relaxed);
+        mpPool = pPool;
+
+        // Every root but the first goes to the workers, this thread starts on that one
+        for (size_t i = 1; i < mRoots.size(); ++i)
+            pPool->Push({ &TaskGraph::RunJob, this, mRoots[i] });
+        if (!mRoots.empty())
+            Execute(mRoots[0]);
+
+        // Help until the last task is done. Tasks are short, so yield rather than sleep.
+        while (mRemaining.load(std::memory_order_acquire) != 0)
+        {
+            if (!pPool->TryRunOne())
+                std::this_thread::yield();
+        }
+        mpPool = nullptr;
+
+        // Whichever thread ran them, the tasks were this thread's work
+        AdjustThreadHeapAllocationCount((int64_t)mTaskAllocations.exchange(0, std::memory_order_relaxed));
+    }
+
+    mTotalRunTicks += Clock::Now() - start;
+    ++mRuns;
+}
+
+void TaskGraph::RunJob(void* pContext, uint32_t task)
+{
+    static_cast<TaskGraph*>(pContext)->Execute(task);
+}
+
+void TaskGraph::Execute(uint32_t index)
+{
+    while (index != UINT32_MAX)
+    {
+        Task& task = mTasks[index];
+        {
+            ProfileScope scope(&task.Zone);
+            HeapAllocationHandoff allocations(&mTaskAllocations);
+            const uint64_t taskStart = Clock::Now();
+            task.Func();
+            task.TotalTicks += Clock::Now() - taskStart;
+        }
+
+        // Keep one ready successor for this thread, saves a trip through the queue on a chain
+        uint32_t next = UINT32_MAX;
+        for (uint32_t successor : task.Successors)
+        {
+            if (mPending[successor].fetch_sub(1, std::memory_order_acq_rel) != 1)
+                continue;
+
+            if (next == UINT32_MAX)
+                next = successor;
+            else
+                mpPool->Push({ &TaskGraph::RunJob, this, successor });
+        }
+
+        // Release so Run sees everything the task wrote once it reads zero
+        mRemaining.fetch_sub(1, std::memory_order_release);
+        index = next;
+    }
+}
+
+void TaskGraph::ResetTimings()
+{
+    for (Task& task : mTasks)
+        task.TotalTicks = 0;
+    mRuns = 0;
+    mTotalRunTicks = 0;
+}
+
+double TaskGraph::GetMeanTaskMs(uint32_t task) const
+{
+    return mRuns ? Clock::TicksToSeconds(mTasks[task].TotalTicks) * 1000.0 / (double)mRuns : 0.0;
+}
+
+double TaskGraph::GetMeanRunMs() const
+{
+    return mRuns ? Clock::TicksToSeconds(mTotalRunTicks) * 1000.0 / (double)mRuns : 0.0;
+}
+
+double TaskGraph::GetCriticalPath(std::vector<uint32_t>* out_tasks) const
+{
+    out_tasks->clear();
+    if (mTasks.empty())
+        return 0.0;
+
+    // Added order is topological, so one pass finds the longest chain ending at every task
+    double longest[kMaxTasks];
+    uint32_t via[kMaxTasks];
+    uint32_t last = 0;
+    for (uint32_t i = 0; i != (uint32_t)mTasks.size(); ++i)
+    {
+        double before = 0.0;
+        via[i] = UINT32_MAX;
+        for (uint32_t predecessor : mTasks[i].Predecessors)
+        {
+            if (longest[predecessor] > before)
+            {
+                before = longest[predecessor];
+                via[i] = predecessor;
+            }
+        }
+        longest[i] = before + GetMeanTaskMs(i);
+        last = longest[i] > longest[last] ? i : last;
+    }
+
+    for (uint32_t i = last; i != UINT32_MAX; i = via[i])
+        out_tasks->insert(out_tasks->begin(), i);
+    return longest[last];
+}
+
+bool TaskGraph::DumpJSON(const char* path) const
+{
+    FILE* pFile = nullptr;
+    #if defined(_MSC_VER)
+    fopen_s(&pFile, path, "w");
+    #else
+    pFile = fopen(path, "w");
+    #endif
+    if (!pFile)
+        return false;
+
+    std::vector<uint32_t> criticalPath;
+    const double criticalMs = GetCriticalPath(&criticalPath);
+
+    fprintf(pFile, "{\n  \"runs\": %llu,\n  \"meanRunMs\": %.4f,\n  \"criticalPathMs\": %.4f,\n  \"criticalPath\": [",
+        (unsigned long long)mRuns, GetMeanRunMs(), criticalMs);
+    for (size_t i = 0; i != criticalPath.size(); ++i)
+        fprintf(pFile, "%s\"%s\"", i ? ", " : "", mTasks[criticalPath[i]].Name);
+    fprintf(pFile, "],\n  \"tasks\": [");
+
+    for (uint32_t i = 0; i != (uint32_t)mTasks.size(); ++i)
+    {
+        const Task& task = mTasks[i];
+        bool critical = false;
+        for (uint32_t c : criticalPath)
+            critical |= c == i;
+
+        fprintf(pFile, "%s\n    { \"name\": \"%s\", \"meanMs\": %.4f, \"critical\": %s, \"dependsOn\": [",
+            i ? "," : "", task.Name, GetMeanTaskMs(i), critical ? "true" : "false");
+        for (size_t p = 0; p != task.Predecessors.size(); ++p)
+            fprintf(pFile, "%s\"%s\"", p ? ", " : "", mTasks[task.Predecessors[p]].Name);
+        fprintf(pFile, "] }");
+    }
+    fprintf(pFile, "\n  ]\n}\n");
+
+    fclose(pFile);
+    return true;
+}
+
+}
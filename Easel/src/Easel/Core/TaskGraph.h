@@ -0,0 +1,100 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Declarative task graph. Each task names the resources it
+reads and writes as bits in a mask, and the graph is compiled once: a task
+depends on every earlier task that writes something it touches, or reads
+something it writes. Run() then gives the same result as running the tasks
+one after another in the order they were added, but tasks with no path
+between them overlap on a WorkerPool, and the calling thread helps out.
+Every task is timed, which is what the critical path is computed from:
+the longest chain of dependent tasks, i.e. the floor on how long a Run can
+take however many workers there are.
+----------------------------------------------*/
+#ifndef EASEL_TASKGRAPH_H
+#define EASEL_TASKGRAPH_H
+
+#include "Profiler.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace Core {
+
+class WorkerPool;
+
+class TaskGraph
+{
+public:
+    typedef uint64_t ResourceMask;
+    typedef std::function<void()> TaskFunc;
+
+    static constexpr uint32_t kMaxTasks = 64;
+
+    TaskGraph() = default;
+
+    // Before Compile. The name must outlive the graph, it's what the profiler and the dumps show.
+    uint32_t AddTask(const char* name, ResourceMask reads, ResourceMask writes, TaskFunc func);
+
+    // Works out every task's dependencies. Nothing can be added afterwards.
+    void Compile();
+    bool IsCompiled() const { return mCompiled; }
+
+    // Runs every task once and returns when they are all done. Without a pool, or
+    // with one that has no workers, the tasks just run in order on the calling thread.
+    void Run(WorkerPool* pPool);
+
+    uint32_t    GetTaskCount() const                     { return (uint32_t)mTasks.size(); }
+    const char* GetTaskName(uint32_t task) const         { return mTasks[task].Name; }
+    const std::vector<uint32_t>& GetDependencies(uint32_t task) const { return mTasks[task].Predecessors; }
+
+    // Means over every Run since the last ResetTimings
+    void   ResetTimings();
+    double GetMeanTaskMs(uint32_t task) const;
+    double GetMeanRunMs() const;
+
+    // Longest chain of dependent tasks by mean time, first to last. Returns its length in ms.
+    double GetCriticalPath(std::vector<uint32_t>* out_tasks) const;
+
+    // Tasks, dependencies, mean times and the critical path as JSON. False if the file couldn't be opened.
+    bool DumpJSON(const char* path) const;
+
+private:
+    struct Task
+    {
+        const char*           Name = nullptr;
+        ResourceMask          Reads = 0;
+        ResourceMask          Writes = 0;
+        TaskFunc              Func;
+        ProfileZone           Zone;
+        std::vector<uint32_t> Predecessors;
+        std::vector<uint32_t> Successors;
+        uint64_t              TotalTicks = 0;   // Only written by whoever runs the task, read once Run has returned
+    };
+
+    static void RunJob(void* pContext, uint32_t task);
+
+    // Runs the task, then any successor it made ready: one on this thread, the rest pushed
+    void Execute(uint32_t task);
+
+    std::vector<Task>                      mTasks;
+    std::vector<uint32_t>                  mRoots;
+    std::unique_ptr<std::atomic<uint32_t>[]> mPending;  // Unfinished predecessors per task, reset every Run
+    std::atomic<uint32_t>                  mRemaining{0};
+    std::atomic<uint64_t>                  mTaskAllocations{0}; // Heap allocations of this Run's tasks, see HeapAllocationHandoff
+    WorkerPool*                            mpPool = nullptr;
+    bool                                   mCompiled = false;
+
+    uint64_t                               mRuns = 0;
+    uint64_t                               mTotalRunTicks = 0;
+
+public:
+    TaskGraph(TaskGraph const&)            = delete;
+    TaskGraph& operator=(TaskGraph const&) = delete;
+};
+
+}
+#endif
@@ -36,6 +36,17 @@ DirectX::XMFLOAT4X4 Transform::Recompute()
     return mWorld;
 }
 
+DirectX::XMFLOAT4X4 Transform::Interpolate(Transform const& from, Transform const& to, float alpha)
+{
+    const XMVECTOR position = XMVectorLerp(from.mPosition, to.mPosition, alpha);
+    const XMVECTOR scale = XMVectorLerp(from.mScale, to.mScale, alpha);
+    const XMVECTOR rotation = XMQuaternionSlerp(from.mQuatRotation, to.mQuatRotation, alpha);
+
+    XMFLOAT4X4 world;
+    XMStoreFloat4x4(&world, XMMatrixAffineTransformation(scale, XMVectorZero(), rotation, position));
+    return world;
+}
+
 
 void Transform::Translate(float x, float y, float z)
 {
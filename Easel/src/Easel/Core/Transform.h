@@ -6,7 +6,7 @@ Description : Transform class for game objects
 #ifndef TRANSFORM_H
 #define TRANSFORM_H
 
-#include <Easel/Renderer/DXCore.h>
+#include <DirectXMath.h>
 
 namespace Core {
 
@@ -18,6 +18,9 @@ struct Transform
     // Returns World matrix from internal pos, scale, rot and stores it in mWorld
     DirectX::XMFLOAT4X4 Recompute();
 
+    // World matrix part way from 'from' to 'to', position and scale lerped, rotation slerped. Neither is modified.
+    static DirectX::XMFLOAT4X4 Interpolate(Transform const& from, Transform const& to, float alpha);
+
     // Relative Transformers
     void Translate(float x, float y, float z);
     void Translate(DirectX::XMVECTOR translation);
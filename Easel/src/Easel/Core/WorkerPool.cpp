@@ -0,0 +1,169 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of WorkerPool.h
+----------------------------------------------*/
+#include "WorkerPool.h"
+
+#include "Allocators.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <assert.h>
+
+namespace Core {
+
+WorkerPool::~WorkerPool()
+{
+    Shutdown();
+}
+
+void WorkerPool::Init(uint32_t workerCount, uint32_t queueCapacity)
+{
+    assert(mWorkers.empty() && "WorkerPool initialized twice");
+    assert(queueCapacity != 0);
+
+    mQueue.resize(queueCapacity);
+    mHead = 0;
+    mCount = 0;
+    mQuit = false;
+
+    // Reserved up front, a reallocation would move names the profiler already points at
+    mNames.reserve(workerCount);
+    mWorkers.reserve(workerCount);
+    for (uint32_t i = 0; i != workerCount; ++i)
+    {
+        mNames.push_back("Worker " + std::to_string(i));
+        mWorkers.emplace_back(&WorkerPool::WorkerMain, this, i);
+    }
+}
+
+void WorkerPool::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mCondition.notify_all();
+
+    for (std::thread& worker : mWorkers)
+        worker.join();
+    mWorkers.clear();
+    mNames.clear();
+    mCount = 0;
+}
+
+void WorkerPool::Push(const WorkerJob& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mCount != (uint32_t)mQueue.size())
+        {
+            mQueue[(mHead + mCount) % mQueue.size()] = job;
+            ++mCount;
+            mCondition.notify_one();
+            return;
+        }
+    }
+
+    job.Func(job.pContext, job.Index);
+}
+
+bool WorkerPool::TryRunOne()
+{
+    WorkerJob job;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!Pop(&job))
+            return false;
+    }
+
+    job.Func(job.pContext, job.Index);
+    return true;
+}
+
+struct WorkerPool::DispatchState
+{
+    void                  (*Func)(void* pContext, uint32_t index);
+    void*                 pContext;
+    uint32_t              Count;
+    std::atomic<uint32_t> Next{0};
+    std::atomic<uint32_t> Exited{0};
+    std::atomic<uint64_t> Allocations{0};  // Made by the items, whichever thread ran them
+};
+
+void WorkerPool::Dispatch(uint32_t count, void (*func)(void* pContext, uint32_t index), void* pContext)
+{
+    DispatchState state;
+    state.Func = func;
+    state.pContext = pContext;
+    state.Count = count;
+
+    // The calling thread is one of the hands, so one item never goes through the queue
+    const uint32_t helpers = count ? std::min(GetWorkerCount(), count - 1) : 0;
+    for (uint32_t i = 0; i != helpers; ++i)
+        Push({ &WorkerPool::RunDispatch, &state, 0 });
+    RunDispatch(&state, 0);
+
+    // The state lives on this stack, so wait for every helper to let go of it, not just for the last item.
+    // A helper that never got picked up finds nothing left and leaves straight away.
+    while (state.Exited.load(std::memory_order_acquire) != helpers + 1)
+    {
+        if (!TryRunOne())
+            std::this_thread::yield();
+    }
+
+    // The items were this thread's work, so are their allocations
+    AdjustThreadHeapAllocationCount((int64_t)state.Allocations.load(std::memory_order_relaxed));
+}
+
+void WorkerPool::RunDispatch(void* pState, uint32_t)
+{
+    DispatchState* state = static_cast<DispatchState*>(pState);
+    {
+        HeapAllocationHandoff allocations(&state->Allocations);
+        for (uint32_t i = state->Next.fetch_add(1, std::memory_order_relaxed); i < state->Count; i = state->Next.fetch_add(1, std::memory_order_relaxed))
+            state->Func(state->pContext, i);
+    }
+
+    // Release so Dispatch sees everything the items wrote
+    state->Exited.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t WorkerPool::GetDefaultWorkerCount(uint32_t reservedThreads)
+{
+    const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > reservedThreads ? hardwareThreads - reservedThreads : 0;
+}
+
+void WorkerPool::WorkerMain(uint32_t index)
+{
+    Profiler::SetThreadName(mNames[index].c_str());
+
+    for (;;)
+    {
+        WorkerJob job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mQuit || mCount != 0; });
+            if (mQuit)
+                return;
+            Pop(&job);
+        }
+
+        job.Func(job.pContext, job.Index);
+    }
+}
+
+bool WorkerPool::Pop(WorkerJob* out_job)
+{
+    if (!mCount)
+        return false;
+
+    *out_job = mQueue[mHead];
+    mHead = (mHead + 1) % (uint32_t)mQueue.size();
+    --mCount;
+    return true;
+}
+
+}
@@ -0,0 +1,86 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Fixed set of worker threads pulling jobs off one shared
+queue. The threads live as long as the pool, so handing out work every
+frame costs a lock and a wake rather than a thread launch. Jobs are a function pointer and two words, queued in a ring sized
+at Init, so pushing never allocates. A thread waiting on jobs it pushed
+can help with TryRunOne instead of sleeping.
+----------------------------------------------*/
+#ifndef EASEL_WORKERPOOL_H
+#define EASEL_WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Core {
+
+struct WorkerJob
+{
+    void     (*Func)(void* pContext, uint32_t index) = nullptr;
+    void*    pContext = nullptr;
+    uint32_t Index = 0;
+};
+
+class WorkerPool
+{
+public:
+    static constexpr uint32_t kDefaultQueueCapacity = 1024;
+
+    WorkerPool() = default;
+    ~WorkerPool();
+
+    // Zero workers is fine, jobs then only run on threads calling TryRunOne
+    void Init(uint32_t workerCount, uint32_t queueCapacity = kDefaultQueueCapacity);
+
+    // Lets every worker finish its current job, drops whatever is still queued and joins them
+    void Shutdown();
+
+    uint32_t GetWorkerCount() const { return (uint32_t)mWorkers.size(); }
+
+    // Any thread. If the queue is full the job runs right here instead.
+    void Push(const WorkerJob& job);
+
+    // Runs one queued job on the calling thread. False if there was none.
+    bool TryRunOne();
+
+    // Calls func(pContext, i) for every i in [0, count) on the workers and the calling thread, and returns once
+    // they all have. Items are claimed one at a time, so uneven ones balance out. Without workers it's a plain loop.
+    void Dispatch(uint32_t count, void (*func)(void* pContext, uint32_t index), void* pContext);
+
+    // One worker per hardware thread, less the ones the caller keeps busy itself
+    static uint32_t GetDefaultWorkerCount(uint32_t reservedThreads);
+
+private:
+    struct DispatchState;
+
+    void WorkerMain(uint32_t index);
+
+    // Claims and runs items of a Dispatch until there are none left
+    static void RunDispatch(void* pState, uint32_t);
+
+    // With mMutex held
+    bool Pop(WorkerJob* out_job);
+
+    std::vector<std::thread> mWorkers;
+    std::vector<std::string> mNames;        // The profiler keeps the pointers, so these outlive the threads
+
+    std::vector<WorkerJob>   mQueue;        // Ring
+    uint32_t                 mHead = 0;
+    uint32_t                 mCount = 0;
+    bool                     mQuit = false;
+    std::mutex               mMutex;
+    std::condition_variable  mCondition;
+
+public:
+    WorkerPool(WorkerPool const&)            = delete;
+    WorkerPool& operator=(WorkerPool const&) = delete;
+};
+
+}
+#endif
@@ -8,10 +8,15 @@ Description : Implementation of GameInput method overrides
 #include "InputSystem.h"
 #include "GameInput.h"
 
+#include <Easel/Core/MemoryTracker.h>
+#include <Easel/Core/Profiler.h>
+
 namespace Input {
 
     GameInput::GameInput()
     {
+        ESL_MEMORY_SCOPE(Core::MemoryTag::INPUT);
+
         SetDefaultKeyMap();
     }
 
@@ -20,10 +25,15 @@ namespace Input {
 
     void GameInput::Frame(float dt, Renderer::Camera* pCamera)
     {
+        ESL_MEMORY_SCOPE(Core::MemoryTag::INPUT);
+        ESL_PROFILE_ZONE("GameInput::Frame");
+
         using namespace DirectX;
 
         static const float kSpeed = 5.0f;
 
+        LatchMousePosition();
+
         // Act on user input:
         // - Iterate through all active keys
         // - Check for commands corresponding to activated chords
@@ -33,7 +43,7 @@ namespace Input {
             switch (pair.first)
             {
             case GameCommands::Quit:
-                PostQuitMessage(0);
+                mQuitRequested = true;
                 break;
             case GameCommands::MoveForward:
                 pCamera->MoveForward(kSpeed * dt);
@@ -71,14 +81,35 @@ namespace Input {
                 pCamera->Rotate(XMQuaternionMultiply(horizontalQuat, verticalQuat));
                 break;
             }
+            case GameCommands::ToggleProfilerCapture:
+                // Second press writes out everything since the first, open it in chrome://tracing or Perfetto
+                if (Core::Profiler::IsCapturing())
+                {
+                    Core::Profiler::EndCapture();
+                    Core::Profiler::ExportChromeTrace("ProfileCapture.json");
+                }
+                else
+                {
+                    Core::Profiler::BeginCapture();
+                }
+                break;
             }
         }
         
         GetInput();
     }
 
+    bool GameInput::TakeQuitRequest()
+    {
+        const bool requested = mQuitRequested;
+        mQuitRequested = false;
+        return requested;
+    }
+
     void GameInput::SetDefaultKeyMap()
     {
+        ESL_MEMORY_SCOPE(Core::MemoryTag::INPUT);
+
         mKeyMap.clear();
         mKeyMap[GameCommands::Quit]         = new Chord(L"Quit", VK_ESCAPE, KeyState::JustReleased);
         mKeyMap[GameCommands::MoveForward]  = new Chord(L"Move Forward", 'W', KeyState::StillPressed);
@@ -90,5 +121,6 @@ namespace Input {
         mKeyMap[GameCommands::RollRight]    = new Chord(L"Roll Right", 'E', KeyState::StillPressed);
 
         mKeyMap[GameCommands::CameraRotation] = new Chord(L"Camera Rotation", VK_RBUTTON, KeyState::StillPressed);
+        mKeyMap[GameCommands::ToggleProfilerCapture] = new Chord(L"Toggle Profiler Capture", VK_F9, KeyState::JustReleased);
     }
 }
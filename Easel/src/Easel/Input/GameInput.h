@@ -20,10 +20,16 @@ namespace Input {
 
         // Actions run by the input system each frame
         void Frame(float dt, Renderer::Camera* pCamera);
+
+        // True once after Quit was pressed. Input runs off the window thread, so the game has to pass it on.
+        bool TakeQuitRequest();
     
     protected:
         // Override implementation for setting default key mappings
         virtual void SetDefaultKeyMap() override;
+
+    private:
+        bool mQuitRequested = false;
     };
 }
 #endif
\ No newline at end of file
@@ -45,4 +45,15 @@ namespace Input {
         mName(name),
         mChord(bindingList)
     {};
+
+    bool Chord::IsActive(const uint8_t* previousKeyboard, const uint8_t* currentKeyboard) const
+    {
+        for (const Binding& binding : mChord)
+        {
+            const unsigned int keyCode = binding.mKeyCode;
+            if (GetKeyState(previousKeyboard[keyCode] != 0, currentKeyboard[keyCode] != 0) != binding.mKeyState)
+                return false;
+        }
+        return true;
+    }
 }
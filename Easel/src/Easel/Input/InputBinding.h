@@ -7,10 +7,8 @@ to be used by the Inputhandling InputSystem class
 #ifndef INPUTBINDING_H
 #define INPUTBINDING_H
 
-// Preset our windows includes
-#include <Easel/Core/WinApp.h>
-
 // std inclusions
+#include <stdint.h>
 #include <string>
 #include <array>
 #include <vector>
@@ -28,7 +26,8 @@ namespace Input {
         MoveUp,
         RollLeft,
         RollRight,
-        CameraRotation
+        CameraRotation,
+        ToggleProfilerCapture
     };
 
     // Enum to emphasize the different states of a key
@@ -40,6 +39,15 @@ namespace Input {
         JustReleased
     };
 
+    // Deduces a key's state from whether it was down last frame and this frame
+    inline KeyState GetKeyState(bool wasDown, bool isDown)
+    {
+        if (wasDown)
+            return isDown ? KeyState::StillPressed : KeyState::JustReleased;
+        else
+            return isDown ? KeyState::JustPressed : KeyState::StillReleased;
+    }
+
     // Wrapping struct keycode and above enum
     struct Binding
     {
@@ -53,6 +61,7 @@ namespace Input {
         ~Binding() {};
 
         friend class InputSystem;
+        friend struct Chord;
     };
 
     // Maps a game command to a Binding
@@ -69,6 +78,9 @@ namespace Input {
         Chord(const std::wstring& name, const std::vector<Binding>& chords);
         ~Chord() {};
 
+        // True when every binding's key is in its state. Keyboards are indexed by keycode, nonzero when down.
+        bool IsActive(const uint8_t* previousKeyboard, const uint8_t* currentKeyboard) const;
+
         // Accessors for member variables
         std::vector<Binding>& GetChord() { return mChord; }
         std::wstring&         GetName()  { return mName;  }
@@ -5,17 +5,22 @@ Description : InputSystem method definitions
 ----------------------------------------------*/
 #include "InputSystem.h"
 
+#include <Easel/Core/MemoryTracker.h>
+
 namespace Input {
 
     // Init all keyboard states to 0
     InputSystem::InputSystem()
     {
+        ESL_MEMORY_SCOPE(Core::MemoryTag::INPUT);
+
         mKeyboardCurrent.fill(0);
         mKeyboardPrevious.fill(0);
         mMousePrevious.x = 0;
         mMousePrevious.y = 0;
         mMouseCurrent.x = 0;
         mMouseCurrent.y = 0;
+        mMousePosted.store(0, std::memory_order_relaxed);
     }
 
     // Release all dynamic memory
@@ -35,6 +40,8 @@ namespace Input {
     // Updates mouse mapping
     void InputSystem::GetInput()
     {
+        ESL_MEMORY_SCOPE(Core::MemoryTag::INPUT);
+
         // Get the keyboard state from windows
         GetKeyboardState();
 
@@ -47,7 +54,13 @@ namespace Input {
 
     void InputSystem::OnMouseMove(short newX, short newY)
     {
-        mMouseCurrent = { newX, newY };
+        mMousePosted.store((uint32_t)(uint16_t)newX | ((uint32_t)(uint16_t)newY << 16), std::memory_order_relaxed);
+    }
+
+    void InputSystem::LatchMousePosition()
+    {
+        const uint32_t posted = mMousePosted.load(std::memory_order_relaxed);
+        mMouseCurrent = { (short)(posted & 0xFFFF), (short)(posted >> 16) };
     }
 
     std::pair<float,float> InputSystem::GetMouseDelta() const
@@ -66,22 +79,10 @@ namespace Input {
         mActiveKeyMap.clear();
 
         // Map which keys are active into the active key map
-        for (auto key : mKeyMap)
+        for (const auto& key : mKeyMap)
         {
-            bool activeKey = true;
-
-            // Test Chord
-            for (Binding binding : key.second->GetChord())
-            {
-                if (GetKeyboardKeyState(binding.mKeyCode) != binding.mKeyState)
-                {
-                    activeKey = false;
-                    break;
-                }
-            }
-
             // Passed Chord Check : move key to active key map
-            if (activeKey)
+            if (key.second->IsActive(mKeyboardPrevious.data(), mKeyboardCurrent.data()))
                 mActiveKeyMap.insert(key);
         }
     }
@@ -99,15 +100,6 @@ namespace Input {
     // Use logic to deduce Keystate from current and previous keyboard states
     const KeyState InputSystem::GetKeyboardKeyState(const unsigned int keyCode) const
     {
-        if (mKeyboardPrevious[keyCode] == 1)
-            if (mKeyboardCurrent[keyCode] == 1)
-                return KeyState::StillPressed;  // true, true
-            else
-                return KeyState::JustReleased;  // true, false
-        else
-            if (mKeyboardCurrent[keyCode] == 1)
-                return KeyState::JustPressed;   // false, true
-            else
-                return KeyState::StillReleased; // false, false
+        return GetKeyState(mKeyboardPrevious[keyCode] == 1, mKeyboardCurrent[keyCode] == 1);
     }
 }
\ No newline at end of file
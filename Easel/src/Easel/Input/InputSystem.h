@@ -8,6 +8,7 @@ Description : Interface for the InputSystem class
 
 #include <Easel/Core/WinApp.h>
 #include <array>
+#include <atomic>
 #include <unordered_map>
 #include "InputBinding.h"
 
@@ -24,6 +25,9 @@ namespace Input {
         POINT mMouseCurrent;
         POINT mMousePrevious;
 
+        // Latest WM_MOUSEMOVE position, x in the low 16 bits and y in the high. Written by the window thread.
+        std::atomic<uint32_t> mMousePosted;
+
         // Uses GetAsyncKeyState to read in 256 bytes
         void GetKeyboardState();
 
@@ -52,9 +56,12 @@ namespace Input {
         // Main "Update method" for input system
         void GetInput();
 
-        // On WM_MOUSEMOVE message, trigger this method
+        // On WM_MOUSEMOVE message, trigger this method. Safe from the window thread while input runs elsewhere.
         void OnMouseMove(short newX, short newY);
 
+        // Takes the last position OnMouseMove posted as current, once per frame before reading the delta
+        void LatchMousePosition();
+
         // Returns the current mouse position as a POINT
         POINT GetMousePosition() const { return mMouseCurrent; }
 
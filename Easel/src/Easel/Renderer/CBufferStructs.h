@@ -9,6 +9,9 @@ Description : Declation of structs used as constant buffers by various shaders
 #include <DirectXMath.h>
 #include <DirectXColors.h>
 #include "LightStructs.h"
+#include "ShaderReflection.h"
+
+#include <stddef.h>
 
 namespace Renderer
 {
@@ -28,13 +31,97 @@ struct alignas(16) cbLighting
     DirectX::XMFLOAT3A ambientColor;
     DirectionalLight   directionalLight;
     DirectX::XMFLOAT3A cameraWorldPos;
+    DirectX::XMFLOAT4  clusterParams;   // Slice scale and bias, then tiles per pixel in x and y
+    DirectX::XMUINT4   clusterDims;     // Clusters in x, y and z, then how many lights were binned
+};
+
+struct alignas(16) cbShadows
+{
+    DirectX::XMFLOAT4X4 cascadeViewProjection[4];
+    DirectX::XMFLOAT4   cascadeSplits;  // View space depth where each cascade ends
+    DirectX::XMFLOAT4   shadowParams;   // One shadow map texel in uv, then how many cascades there are
 };
 
 struct alignas(16) cbMaterialParams
 {
     DirectX::XMFLOAT4  colorTint = DirectX::XMFLOAT4(DirectX::Colors::Black);
     float              specularExp = 0.0f;
+    uint32_t           textureSlice = 0; // Slice into the bound Texture2DArrays, for materials that use a texture bank
+
+    // textureSlice stays per material while every instanced pass draws a single material. It moves into
+    // the instance stream once passes are grouped by pipeline and bank, so sets sharing a bank share a draw.
+};
+
+// Where each member lands in HLSL, under the names the shaders use. ShaderReflector checks every compiled shader's
+// cbuffers against these when the Shaders project builds, and fails the build if one has drifted.
+#define ESL_CBUFFER_FIELD(type, member, hlslName) { hlslName, (uint32_t)offsetof(type, member), (uint32_t)sizeof(type::member) }
+
+namespace CBufferFields
+{
+constexpr CBufferField kCamera[] =
+{
+    ESL_CBUFFER_FIELD(cbCamera, viewProjection, "viewProjection")
+};
+
+constexpr CBufferField kPerEntity[] =
+{
+    ESL_CBUFFER_FIELD(cbPerEntity, world, "world")
+};
+
+constexpr CBufferField kLighting[] =
+{
+    ESL_CBUFFER_FIELD(cbLighting, ambientColor, "ambientColor"),
+    ESL_CBUFFER_FIELD(cbLighting, directionalLight, "directionalLight"),
+    ESL_CBUFFER_FIELD(cbLighting, cameraWorldPos, "cameraWorldPos"),
+    ESL_CBUFFER_FIELD(cbLighting, clusterParams, "clusterParams"),
+    ESL_CBUFFER_FIELD(cbLighting, clusterDims, "clusterDims")
 };
 
+constexpr CBufferField kShadows[] =
+{
+    ESL_CBUFFER_FIELD(cbShadows, cascadeViewProjection, "cascadeViewProjection"),
+    ESL_CBUFFER_FIELD(cbShadows, cascadeSplits, "cascadeSplits"),
+    ESL_CBUFFER_FIELD(cbShadows, shadowParams, "shadowParams")
+};
+
+constexpr CBufferField kMaterialParams[] =
+{
+    ESL_CBUFFER_FIELD(cbMaterialParams, colorTint, "colorTint"),
+    ESL_CBUFFER_FIELD(cbMaterialParams, specularExp, "specularity"),
+    ESL_CBUFFER_FIELD(cbMaterialParams, textureSlice, "textureSlice")
+};
+
+// HLSL packs cbuffers in 16 byte rows: nothing that fits in a row straddles two, and anything bigger starts one
+template<size_t N>
+constexpr bool FollowsHLSLPacking(const CBufferField (&fields)[N])
+{
+    for (size_t i = 0; i != N; ++i)
+    {
+        const uint32_t offset = fields[i].Offset;
+        const uint32_t size = fields[i].Size;
+        if (size > 16 ? offset % 16 != 0 : offset / 16 != (offset + size - 1) / 16)
+            return false;
+    }
+    return true;
+}
+
+static_assert(FollowsHLSLPacking(kCamera) && FollowsHLSLPacking(kPerEntity) && FollowsHLSLPacking(kLighting) &&
+              FollowsHLSLPacking(kShadows) && FollowsHLSLPacking(kMaterialParams), "A cbuffer struct doesn't pack the way HLSL would");
+}
+
+#define ESL_CBUFFER_LAYOUT(hlslName, type, fields) { hlslName, (uint32_t)sizeof(type), fields, (uint32_t)(sizeof(fields) / sizeof(fields[0])) }
+
+constexpr CBufferLayout kCBufferLayouts[] =
+{
+    ESL_CBUFFER_LAYOUT("VSPerPass",         cbCamera,         CBufferFields::kCamera),
+    ESL_CBUFFER_LAYOUT("VSPerStaticEntity", cbPerEntity,      CBufferFields::kPerEntity),
+    ESL_CBUFFER_LAYOUT("PSPerFrame",        cbLighting,       CBufferFields::kLighting),
+    ESL_CBUFFER_LAYOUT("PSShadows",         cbShadows,        CBufferFields::kShadows),
+    ESL_CBUFFER_LAYOUT("PSPerMaterial",     cbMaterialParams, CBufferFields::kMaterialParams)
+};
+
+#undef ESL_CBUFFER_LAYOUT
+#undef ESL_CBUFFER_FIELD
+
 }
 #endif
\ No newline at end of file
@@ -38,13 +38,20 @@ Camera::Camera(float x, float y, float z, float aspectRatio, float nearPlane, fl
     mRight = XMVectorAdd(initialRight, verticalOffset);
     mUp = XMVectorAdd(initialUp, verticalOffset);
 
-    ConstantBufferUpdateManager::Populate(sizeof(cbCamera), 10, EASEL_SHADER_STAGE::ESS_VS, device, &mBindPacket);
-
     // Create initial matrices
-    UpdateView(context);
-    UpdateProjection(aspectRatio, context);
+    UpdateView();
+    UpdateProjection(aspectRatio);
+
+    // Headless there's no device, and the camera is only math
+    mBindPacket = {};
+    if (!device)
+        return;
 
     // Bind the camera buffer
+    ConstantBufferUpdateManager::Populate(sizeof(cbCamera), 10, EASEL_SHADER_STAGE::ESS_VS, device, &mBindPacket);
+    XMFLOAT4X4 viewProjection;
+    GetViewProjection(&viewProjection);
+    BindViewProjection(viewProjection, context);
     ConstantBufferUpdateManager::Bind(&mBindPacket, context);
 }
 
@@ -54,27 +61,31 @@ Camera::~Camera()
 }
 
 // Creates a new view matrix based on current position and orientation
-void Camera::UpdateView(ID3D11DeviceContext* context)
+void Camera::UpdateView()
 {
     // Create view matrix
     mView = XMMatrixLookToLH(
         mPosition,
         mForward,
         mUp);
+}
 
-    UpdateConstantBuffer(context);
+void Camera::GetViewProjection(XMFLOAT4X4* out_viewProjection) const
+{
+    XMStoreFloat4x4(out_viewProjection, XMMatrixMultiply(mView, mProjection));
 }
 
-void Camera::PrepareForSkyRender(ID3D11DeviceContext* context)
+void Camera::GetSkyViewProjection(XMFLOAT4X4* out_viewProjection) const
 {
-    // Remove translation from view matrix directly
-    mView.r[3] = XMVectorZero();
+    // Remove translation from a copy of the view matrix
+    XMMATRIX skyView = mView;
+    skyView.r[3] = XMVectorZero();
 
-    UpdateConstantBuffer(context);
+    XMStoreFloat4x4(out_viewProjection, XMMatrixMultiply(skyView, mProjection));
 }
 
 // Updates the projection matrix (like on screen resize)
-void Camera::UpdateProjection(float aspectRatio, ID3D11DeviceContext* context)
+void Camera::UpdateProjection(float aspectRatio)
 {
     switch (mCameraMode)
     {
@@ -105,8 +116,6 @@ void Camera::UpdateProjection(float aspectRatio, ID3D11DeviceContext* context)
             break;
         }
     }
-
-    UpdateConstantBuffer(context);
 }
 
 void Camera::GetPosition3A(XMFLOAT3A* out_pos) const
@@ -152,10 +161,10 @@ void Camera::Rotate(XMVECTOR quatRotation)
     mRight      = XMVector3Rotate(mRight, quatRotation);
 }
 
-void Camera::UpdateConstantBuffer(ID3D11DeviceContext* context)
+void Camera::BindViewProjection(XMFLOAT4X4 const& viewProjection, ID3D11DeviceContext* context)
 {
     cbCamera cb;
-    XMStoreFloat4x4(&cb.viewProjection, XMMatrixMultiply(mView, mProjection));
+    cb.viewProjection = viewProjection;
 
     ConstantBufferUpdateManager::MapUnmap(&mBindPacket, &cb, context);
 }
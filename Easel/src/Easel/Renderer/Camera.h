@@ -29,23 +29,31 @@ class Camera
 friend class Input::GameInput;
 
 public:
+    // A null device makes one for a headless run, which never binds
     Camera(float x, float y, float z, float aspectRatio, float nearPlane, float farPlane, float sensitivity, ID3D11Device* device, ID3D11DeviceContext* context);
     Camera() = delete;
     ~Camera();
 
 public:
     // Updates Camera's View Matrix
-    void UpdateView(ID3D11DeviceContext* context);
-
-    // Removes the translation from the view matrix, and then updates the view-projection constant buffer
-    void PrepareForSkyRender(ID3D11DeviceContext* context);
+    void UpdateView();
 
     // Updates Camera's Projection Matrix
-    void UpdateProjection(float aspectRatio, ID3D11DeviceContext* context);
+    void UpdateProjection(float aspectRatio);
+
+    // View-projection as of the last updates, and the same without the view's translation for the sky
+    void GetViewProjection(DirectX::XMFLOAT4X4* out_viewProjection) const;
+    void GetSkyViewProjection(DirectX::XMFLOAT4X4* out_viewProjection) const;
+
+    // Render thread only. Everything above is plain math the simulation thread owns,
+    // this is the one place the camera touches the context after construction.
+    void BindViewProjection(DirectX::XMFLOAT4X4 const& viewProjection, ID3D11DeviceContext* context);
 
     DirectX::XMMATRIX   GetView()           const  { return mView;         }
     DirectX::XMMATRIX   GetProjection()     const  { return mProjection;   }
     float               GetSensitivity()    const  { return mSensitivity;  }
+    float               GetNear()           const  { return mNear;         }
+    float               GetFar()            const  { return mFar;          }
     
     void GetPosition3A(DirectX::XMFLOAT3A* out_pos) const;
     DirectX::XMVECTOR   GetPosition() const;
@@ -56,7 +64,6 @@ private:
     // View and Projection Matrices
     DirectX::XMMATRIX   mView;
     DirectX::XMMATRIX   mProjection;
-    DirectX::XMFLOAT4X4 mViewProjection;
 
     // Camera's local axis and position
     DirectX::XMVECTOR   mForward;
@@ -83,8 +90,6 @@ private: // For GameInput only
     void MoveUp(float dist);
     void MoveAlongAxis(float dist, DirectX::XMVECTOR axis); // Assumes normalized axis
     void Rotate(DirectX::XMVECTOR quatRotation);
-    
-    void UpdateConstantBuffer(ID3D11DeviceContext* context);
 };
 }
 
@@ -0,0 +1,133 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of CascadedShadows.h
+----------------------------------------------*/
+#include "CascadedShadows.h"
+
+#include <assert.h>
+#include <math.h>
+
+namespace Renderer {
+
+namespace {
+
+void Normalize(float* v)
+{
+    const float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    v[0] /= length;
+    v[1] /= length;
+    v[2] /= length;
+}
+
+void Cross(const float* a, const float* b, float* out)
+{
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+void Multiply(const float* a, const float* b, float* out)
+{
+    for (int row = 0; row != 4; ++row)
+        for (int col = 0; col != 4; ++col)
+            out[row * 4 + col] = a[row * 4 + 0] * b[0 * 4 + col] + a[row * 4 + 1] * b[1 * 4 + col] +
+                                 a[row * 4 + 2] * b[2 * 4 + col] + a[row * 4 + 3] * b[3 * 4 + col];
+}
+
+}
+
+void CascadedShadows::ComputeSplits(float nearZ, float farZ, float lambda, uint32_t count, float* out_splits)
+{
+    assert(nearZ > 0.0f && farZ > nearZ && count && count <= kMaxCascades);
+
+    out_splits[0] = nearZ;
+    for (uint32_t i = 1; i != count; ++i)
+    {
+        const float t = (float)i / (float)count;
+        const float logarithmic = nearZ * powf(farZ / nearZ, t);
+        const float uniform = nearZ + (farZ - nearZ) * t;
+        out_splits[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+    }
+    out_splits[count] = farZ;
+}
+
+void CascadedShadows::FitCascade(const float* inverseView, float projX, float projY, float splitNear, float splitFar,
+                                 const float* toLight, uint32_t resolution, ShadowCascade* out_cascade)
+{
+    assert(splitFar > splitNear && resolution);
+
+    // The slice's corners in world space
+    float corners[8][3];
+    float center[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i != 8; ++i)
+    {
+        const float depth = i & 4 ? splitFar : splitNear;
+        const float x = (i & 1 ? 1.0f : -1.0f) * depth / projX;
+        const float y = (i & 2 ? 1.0f : -1.0f) * depth / projY;
+        for (int axis = 0; axis != 3; ++axis)
+        {
+            corners[i][axis] = x * inverseView[axis] + y * inverseView[4 + axis] + depth * inverseView[8 + axis] + inverseView[12 + axis];
+            center[axis] += corners[i][axis] * 0.125f;
+        }
+    }
+
+    // The corners are the same distance from the centre however the view turns, so only rounding changes the radius.
+    // Rounding it up to a sixteenth takes that out, and the box stays exactly the same size.
+    float radius = 0.0f;
+    for (const float* corner : corners)
+    {
+        const float dx = corner[0] - center[0], dy = corner[1] - center[1], dz = corner[2] - center[2];
+        radius = fmaxf(radius, sqrtf(dx * dx + dy * dy + dz * dz));
+    }
+    radius = ceilf(radius * 16.0f) / 16.0f;
+
+    // Looking down the light from the origin, so the light's view never moves, only turns with the sun
+    float forward[3] = { -toLight[0], -toLight[1], -toLight[2] };
+    Normalize(forward);
+    const float worldUp[3] = { 0.0f, 1.0f, 0.0f };
+    const float worldRight[3] = { 1.0f, 0.0f, 0.0f };
+    float right[3], up[3];
+    Cross(fabsf(forward[1]) > 0.99f ? worldRight : worldUp, forward, right);
+    Normalize(right);
+    Cross(forward, right, up);
+
+    const float lightView[16] =
+    {
+        right[0], up[0], forward[0], 0.0f,
+        right[1], up[1], forward[1], 0.0f,
+        right[2], up[2], forward[2], 0.0f,
+        0.0f,     0.0f,  0.0f,       1.0f
+    };
+
+    // Whole texels in light space
+    const float texelSize = 2.0f * radius / (float)resolution;
+    float lightCenter[3];
+    for (int axis = 0; axis != 3; ++axis)
+        lightCenter[axis] = center[0] * lightView[axis] + center[1] * lightView[4 + axis] + center[2] * lightView[8 + axis];
+    lightCenter[0] = floorf(lightCenter[0] / texelSize) * texelSize;
+    lightCenter[1] = floorf(lightCenter[1] / texelSize) * texelSize;
+
+    // XMMatrixOrthographicOffCenterLH around the sphere
+    const float left = lightCenter[0] - radius, rightEdge = lightCenter[0] + radius;
+    const float bottom = lightCenter[1] - radius, top = lightCenter[1] + radius;
+    const float nearZ = lightCenter[2] - radius, farZ = lightCenter[2] + radius;
+    const float projection[16] =
+    {
+        2.0f / (rightEdge - left),                  0.0f,                               0.0f,                       0.0f,
+        0.0f,                                       2.0f / (top - bottom),              0.0f,                       0.0f,
+        0.0f,                                       0.0f,                               1.0f / (farZ - nearZ),      0.0f,
+        (left + rightEdge) / (left - rightEdge),    (top + bottom) / (bottom - top),    nearZ / (nearZ - farZ),     1.0f
+    };
+
+    Multiply(lightView, projection, out_cascade->ViewProjection);
+    out_cascade->SplitNear = splitNear;
+    out_cascade->SplitFar = splitFar;
+    out_cascade->TexelSize = texelSize;
+
+    // No near plane: it's in front of everything
+    Culling::ExtractFrustum(out_cascade->ViewProjection, &out_cascade->Casters);
+    out_cascade->Casters.Planes[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+}
+
+}
@@ -0,0 +1,49 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Device independent setup for cascaded shadow maps from the
+directional light. The view is cut into depth ranges, each gets its own
+orthographic light projection fitted around it, and each only draws the
+casters that can throw a shadow into it.
+Cascades are fitted to a bounding sphere so their size doesn't change as
+the camera turns, and are moved in whole shadow map texels so shadow edges
+don't crawl as it moves.
+Like Culling.h, matrices are row-major float[16] in the DirectXMath convention.
+----------------------------------------------*/
+#ifndef EASEL_CASCADEDSHADOWS_H
+#define EASEL_CASCADEDSHADOWS_H
+
+#include "Culling.h"
+
+#include <stdint.h>
+
+namespace Renderer {
+
+struct ShadowCascade
+{
+    float   ViewProjection[16];     // World to the cascade's shadow map, D3D clip space
+    float   SplitNear;              // View space depths it covers
+    float   SplitFar;
+    float   TexelSize;              // Width of one shadow map texel in world units
+
+    // The box's sides and its far end. Open towards the light, since whatever is between it and the sun can shadow
+    // what's inside, so the casters have to be drawn with depth clamped rather than clipped.
+    Frustum Casters;
+};
+
+struct CascadedShadows final
+{
+    static constexpr uint32_t kMaxCascades = 4;
+
+    // The practical split scheme: lambda 0 spaces the splits evenly, 1 logarithmically, in between blends the two.
+    // out_splits gets count + 1 depths, nearZ first and farZ last.
+    static void ComputeSplits(float nearZ, float farZ, float lambda, uint32_t count, float* out_splits);
+
+    // Fits a cascade around the part of the view between splitNear and splitFar. inverseView is the camera's world
+    // matrix, projX and projY the _11 and _22 of its perspective projection. toLight points at the sun, any length.
+    static void FitCascade(const float* inverseView, float projX, float projY, float splitNear, float splitFar,
+                           const float* toLight, uint32_t resolution, ShadowCascade* out_cascade);
+};
+
+}
+#endif
@@ -0,0 +1,392 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of ClusteredLighting.h
+----------------------------------------------*/
+#include "ClusteredLighting.h"
+
+#include <Easel/Core/Clock.h>
+#include <Easel/Core/Profiler.h>
+#include <Easel/Core/WorkerPool.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <emmintrin.h>
+
+namespace Renderer {
+
+namespace {
+
+static const uint32_t kSliceClusters = LightBinner::kClustersX * LightBinner::kClustersY;
+static_assert(kSliceClusters <= 256, "A slice's clusters are packed into a byte");
+
+void ForEach(Core::WorkerPool* pPool, uint32_t count, void (*func)(void* pContext, uint32_t index), void* pContext)
+{
+    if (pPool)
+    {
+        pPool->Dispatch(count, func, pContext);
+        return;
+    }
+
+    for (uint32_t i = 0; i != count; ++i)
+        func(pContext, i);
+}
+
+uint32_t AddLight(LightSet* pSet, const float* position, float range, const float* color, const float* direction, float cosInner, float cosOuter)
+{
+    pSet->PositionX.push_back(position[0]);
+    pSet->PositionY.push_back(position[1]);
+    pSet->PositionZ.push_back(position[2]);
+    pSet->Range.push_back(range);
+    pSet->ColorR.push_back(color[0]);
+    pSet->ColorG.push_back(color[1]);
+    pSet->ColorB.push_back(color[2]);
+    pSet->DirectionX.push_back(direction[0]);
+    pSet->DirectionY.push_back(direction[1]);
+    pSet->DirectionZ.push_back(direction[2]);
+    pSet->CosOuter.push_back(cosOuter);
+    pSet->CosInner.push_back(cosInner);
+    return pSet->GetCount() - 1;
+}
+
+// Four lanes from first on, zero past the end
+__m128 LoadLanes(std::vector<float> const& values, uint32_t first, uint32_t count)
+{
+    if (count == 4)
+        return _mm_loadu_ps(values.data() + first);
+
+    float lanes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    memcpy(lanes, values.data() + first, count * sizeof(float));
+    return _mm_loadu_ps(lanes);
+}
+
+// Which of 'tiles' a coordinate in [-1, 1] falls in, clamped to the screen. Flip counts tiles from the top.
+__m128i TileOf(__m128 ndc, float tiles, bool flip)
+{
+    const __m128 half = _mm_set1_ps(0.5f * tiles);
+    const __m128 position = flip ? _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), ndc), half) : _mm_mul_ps(_mm_add_ps(ndc, _mm_set1_ps(1.0f)), half);
+    const __m128 clamped = _mm_min_ps(_mm_max_ps(position, _mm_setzero_ps()), _mm_set1_ps(tiles - 1.0f));
+    return _mm_cvttps_epi32(clamped);
+}
+
+uint32_t TileOf(float ndc, float tiles, bool flip)
+{
+    const float position = (flip ? 1.0f - ndc : ndc + 1.0f) * 0.5f * tiles;
+    return (uint32_t)std::min(std::max(position, 0.0f), tiles - 1.0f);
+}
+
+}
+
+uint32_t LightSet::AddPointLight(const float* position, float range, const float* color)
+{
+    // The cone test always passes
+    static const float kAnyDirection[3] = { 0.0f, 0.0f, 1.0f };
+    return AddLight(this, position, range, color, kAnyDirection, -1.0f, -2.0f);
+}
+
+uint32_t LightSet::AddSpotLight(const float* position, float range, const float* color, const float* direction, float innerAngle, float outerAngle)
+{
+    assert(innerAngle < outerAngle);
+    return AddLight(this, position, range, color, direction, cosf(innerAngle), cosf(outerAngle));
+}
+
+size_t LightBinner::GetOutputBytes()
+{
+    return sizeof(ClusterLight) * kMaxLights + sizeof(uint32_t) * 2 * kClusterCount + sizeof(uint32_t) * kMaxIndices;
+}
+
+void LightBinner::InitOutput(void* pMemory, ClusteredLights* out_lights)
+{
+    uint8_t* pBytes = static_cast<uint8_t*>(pMemory);
+    *out_lights = {};
+    out_lights->Lights = reinterpret_cast<ClusterLight*>(pBytes);
+    out_lights->Ranges = reinterpret_cast<uint32_t*>(pBytes + sizeof(ClusterLight) * kMaxLights);
+    out_lights->Indices = out_lights->Ranges + 2 * kClusterCount;
+}
+
+void LightBinner::Bin(LightSet const& lights, const float* view, float projX, float projY, float nearZ, float farZ, ClusteredLights* out_lights, Core::WorkerPool* pPool)
+{
+    ESL_PROFILE_ZONE("LightBinner::Bin");
+
+    assert(nearZ > 0.0f && farZ > nearZ);
+    const uint64_t start = Core::Clock::Now();
+
+    if (projX != mProjX || projY != mProjY || nearZ != mNear || farZ != mFar)
+        BuildClusterBounds(projX, projY, nearZ, farZ);
+
+    const float logRatio = logf(farZ / nearZ);
+    out_lights->SliceScale = (float)kClustersZ / logRatio;
+    out_lights->SliceBias = -(float)kClustersZ * logf(nearZ) / logRatio;
+
+    // Which lights reach into the view, and the slices and tiles they might touch
+    mCandidates.clear();
+    for (SliceJob& slice : mSlices)
+        slice.Candidates.clear();
+
+    out_lights->LightCount = 0;
+    const uint32_t lightCount = std::min(lights.GetCount(), kMaxLights);
+    for (uint32_t first = 0; first < lightCount; first += 4)
+        FindCandidates(lights, first, view, out_lights);
+
+    // Each slice against its clusters' boxes
+    ForEach(pPool, kClustersZ, &LightBinner::RunSliceJob, this);
+
+    // Slice after slice into the packet
+    uint32_t indexCount = 0;
+    uint32_t dropped = 0;
+    for (uint32_t z = 0; z != kClustersZ; ++z)
+    {
+        const SliceJob& slice = mSlices[z];
+        uint32_t* pRanges = out_lights->Ranges + 2 * z * kSliceClusters;
+        for (uint32_t cluster = 0; cluster != kSliceClusters; ++cluster)
+        {
+            const uint32_t count = slice.Offsets[cluster + 1] - slice.Offsets[cluster];
+            const uint32_t kept = std::min(count, kMaxIndices - indexCount);
+            if (kept)
+                memcpy(out_lights->Indices + indexCount, slice.Sorted.data() + slice.Offsets[cluster], kept * sizeof(uint32_t));
+
+            pRanges[2 * cluster + 0] = indexCount;
+            pRanges[2 * cluster + 1] = kept;
+            indexCount += kept;
+            dropped += count - kept;
+        }
+    }
+    out_lights->IndexCount = indexCount;
+
+    mStats.Lights = lights.GetCount();
+    mStats.Visible = out_lights->LightCount;
+    mStats.Indices = indexCount;
+    mStats.Dropped = dropped;
+    mStats.Ms = Core::Clock::TicksToSeconds(Core::Clock::Now() - start) * 1000.0;
+}
+
+void LightBinner::BuildClusterBounds(float projX, float projY, float nearZ, float farZ)
+{
+    mProjX = projX;
+    mProjY = projY;
+    mNear = nearZ;
+    mFar = farZ;
+
+    for (uint32_t z = 0; z <= kClustersZ; ++z)
+        mSliceDepths[z] = nearZ * powf(farZ / nearZ, (float)z / (float)kClustersZ);
+    mSliceDepths[kClustersZ] = farZ;
+
+    // A tile's edges are planes through the eye, so over a slice its box spans both of the slice's depths
+    for (uint32_t z = 0; z != kClustersZ; ++z)
+    {
+        const float nearDepth = mSliceDepths[z];
+        const float farDepth = mSliceDepths[z + 1];
+        for (uint32_t x = 0; x != kClustersX; ++x)
+        {
+            const float left = -1.0f + 2.0f * (float)x / (float)kClustersX;
+            const float right = -1.0f + 2.0f * (float)(x + 1) / (float)kClustersX;
+            mColumnMin[z][x] = std::min(left * nearDepth, left * farDepth) / projX;
+            mColumnMax[z][x] = std::max(right * nearDepth, right * farDepth) / projX;
+        }
+
+        for (uint32_t y = 0; y != kClustersY; ++y)
+        {
+            const float top = 1.0f - 2.0f * (float)y / (float)kClustersY;
+            const float bottom = 1.0f - 2.0f * (float)(y + 1) / (float)kClustersY;
+            mRowMin[z][y] = std::min(bottom * nearDepth, bottom * farDepth) / projY;
+            mRowMax[z][y] = std::max(top * nearDepth, top * farDepth) / projY;
+        }
+    }
+}
+
+void LightBinner::FindCandidates(LightSet const& lights, uint32_t first, const float* view, ClusteredLights* out_lights)
+{
+    const uint32_t count = std::min(4u, std::min(lights.GetCount(), kMaxLights) - first);
+
+    const __m128 x = LoadLanes(lights.PositionX, first, count);
+    const __m128 y = LoadLanes(lights.PositionY, first, count);
+    const __m128 z = LoadLanes(lights.PositionZ, first, count);
+    const __m128 range = LoadLanes(lights.Range, first, count);
+
+    // Into view space, row vectors
+    const __m128 viewX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(view[0])), _mm_mul_ps(y, _mm_set1_ps(view[4]))),
+                                    _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(view[8])), _mm_set1_ps(view[12])));
+    const __m128 viewY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(view[1])), _mm_mul_ps(y, _mm_set1_ps(view[5]))),
+                                    _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(view[9])), _mm_set1_ps(view[13])));
+    const __m128 viewZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(view[2])), _mm_mul_ps(y, _mm_set1_ps(view[6]))),
+                                    _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(view[10])), _mm_set1_ps(view[14])));
+
+    // Depth range, with the near end kept in front of the eye for the divides below
+    const __m128 minZ = _mm_sub_ps(viewZ, range);
+    const __m128 maxZ = _mm_add_ps(viewZ, range);
+    const __m128 frontZ = _mm_max_ps(minZ, _mm_set1_ps(mNear));
+    __m128 visible = _mm_and_ps(_mm_cmpgt_ps(maxZ, _mm_set1_ps(mNear)), _mm_cmplt_ps(minZ, _mm_set1_ps(mFar)));
+
+    // x / z over the sphere's box is at its extremes in the corners, at either end of the depth range
+    const __m128 lowX = _mm_sub_ps(viewX, range);
+    const __m128 highX = _mm_add_ps(viewX, range);
+    const __m128 lowY = _mm_sub_ps(viewY, range);
+    const __m128 highY = _mm_add_ps(viewY, range);
+    const __m128 minNdcX = _mm_mul_ps(_mm_set1_ps(mProjX), _mm_min_ps(_mm_div_ps(lowX, frontZ), _mm_div_ps(lowX, maxZ)));
+    const __m128 maxNdcX = _mm_mul_ps(_mm_set1_ps(mProjX), _mm_max_ps(_mm_div_ps(highX, frontZ), _mm_div_ps(highX, maxZ)));
+    const __m128 minNdcY = _mm_mul_ps(_mm_set1_ps(mProjY), _mm_min_ps(_mm_div_ps(lowY, frontZ), _mm_div_ps(lowY, maxZ)));
+    const __m128 maxNdcY = _mm_mul_ps(_mm_set1_ps(mProjY), _mm_max_ps(_mm_div_ps(highY, frontZ), _mm_div_ps(highY, maxZ)));
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    visible = _mm_and_ps(visible, _mm_and_ps(_mm_cmpge_ps(maxNdcX, minusOne), _mm_cmple_ps(minNdcX, one)));
+    visible = _mm_and_ps(visible, _mm_and_ps(_mm_cmpge_ps(maxNdcY, minusOne), _mm_cmple_ps(minNdcY, one)));
+
+    const int visibleMask = _mm_movemask_ps(visible) & ((1 << count) - 1);
+    if (!visibleMask)
+        return;
+
+    // A depth's slice is how many of the slices' far ends it's at or past
+    __m128i firstSlice = _mm_setzero_si128();
+    __m128i lastSlice = _mm_setzero_si128();
+    for (uint32_t slice = 1; slice != kClustersZ; ++slice)
+    {
+        const __m128 depth = _mm_set1_ps(mSliceDepths[slice]);
+        firstSlice = _mm_sub_epi32(firstSlice, _mm_castps_si128(_mm_cmpge_ps(minZ, depth)));
+        lastSlice = _mm_sub_epi32(lastSlice, _mm_castps_si128(_mm_cmpge_ps(maxZ, depth)));
+    }
+
+    alignas(16) float center[3][4];
+    alignas(16) int32_t tiles[4][4];
+    alignas(16) int32_t slices[2][4];
+    _mm_store_ps(center[0], viewX);
+    _mm_store_ps(center[1], viewY);
+    _mm_store_ps(center[2], viewZ);
+    _mm_store_si128((__m128i*)tiles[0], TileOf(minNdcX, (float)kClustersX, false));
+    _mm_store_si128((__m128i*)tiles[1], TileOf(maxNdcX, (float)kClustersX, false));
+    _mm_store_si128((__m128i*)tiles[2], TileOf(maxNdcY, (float)kClustersY, true));
+    _mm_store_si128((__m128i*)tiles[3], TileOf(minNdcY, (float)kClustersY, true));
+    _mm_store_si128((__m128i*)slices[0], firstSlice);
+    _mm_store_si128((__m128i*)slices[1], lastSlice);
+
+    for (uint32_t lane = 0; lane != count; ++lane)
+    {
+        if (!(visibleMask & (1 << lane)))
+            continue;
+
+        const uint32_t light = first + lane;
+        ClusterLight& out = out_lights->Lights[out_lights->LightCount];
+        out.Position[0] = lights.PositionX[light];
+        out.Position[1] = lights.PositionY[light];
+        out.Position[2] = lights.PositionZ[light];
+        out.Range = lights.Range[light];
+        out.Color[0] = lights.ColorR[light];
+        out.Color[1] = lights.ColorG[light];
+        out.Color[2] = lights.ColorB[light];
+        out.CosOuter = lights.CosOuter[light];
+        out.Direction[0] = lights.DirectionX[light];
+        out.Direction[1] = lights.DirectionY[light];
+        out.Direction[2] = lights.DirectionZ[light];
+        out.CosInner = lights.CosInner[light];
+
+        Candidate candidate;
+        candidate.Center[0] = center[0][lane];
+        candidate.Center[1] = center[1][lane];
+        candidate.Center[2] = center[2][lane];
+        candidate.Range = out.Range;
+        candidate.MinX = (uint8_t)tiles[0][lane];
+        candidate.MaxX = (uint8_t)tiles[1][lane];
+        candidate.MinY = (uint8_t)tiles[2][lane];
+        candidate.MaxY = (uint8_t)tiles[3][lane];
+        mCandidates.push_back(candidate);
+
+        for (int32_t slice = slices[0][lane]; slice <= slices[1][lane]; ++slice)
+            mSlices[slice].Candidates.push_back(out_lights->LightCount);
+
+        ++out_lights->LightCount;
+    }
+}
+
+void LightBinner::RunSliceJob(void* pContext, uint32_t slice)
+{
+    static_cast<LightBinner*>(pContext)->BinSlice(slice);
+}
+
+void LightBinner::BinSlice(uint32_t slice)
+{
+    SliceJob& job = mSlices[slice];
+    uint32_t entryCount = 0;
+
+    uint32_t counts[kSliceClusters] = {};
+
+    const float nearDepth = mSliceDepths[slice];
+    const float farDepth = mSliceDepths[slice + 1];
+    const float* pColumnMin = mColumnMin[slice];
+    const float* pColumnMax = mColumnMax[slice];
+    const float* pRowMin = mRowMin[slice];
+    const float* pRowMax = mRowMax[slice];
+
+    for (uint32_t light : job.Candidates)
+    {
+        const Candidate& candidate = mCandidates[light];
+
+        // Only the part of the sphere between the slice's depths matters, a disc no wider than where it's cut closest
+        // to the centre. The tiles its box covers are usually far fewer than the whole sphere's.
+        const float cutDistance = std::max(std::max(nearDepth - candidate.Center[2], candidate.Center[2] - farDepth), 0.0f);
+        const float cutRangeSq = candidate.Range * candidate.Range - cutDistance * cutDistance;
+        if (cutRangeSq < 0.0f)
+            continue;
+
+        const float cutRange = sqrtf(cutRangeSq);
+        const float frontZ = std::max(candidate.Center[2] - candidate.Range, nearDepth);
+        const float backZ = std::min(candidate.Center[2] + candidate.Range, farDepth);
+
+        const float lowX = candidate.Center[0] - cutRange;
+        const float highX = candidate.Center[0] + cutRange;
+        const float lowY = candidate.Center[1] - cutRange;
+        const float highY = candidate.Center[1] + cutRange;
+        const uint32_t minX = std::max<uint32_t>(TileOf(mProjX * std::min(lowX / frontZ, lowX / backZ), (float)kClustersX, false), candidate.MinX);
+        const uint32_t maxX = std::min<uint32_t>(TileOf(mProjX * std::max(highX / frontZ, highX / backZ), (float)kClustersX, false), candidate.MaxX);
+        const uint32_t minY = std::max<uint32_t>(TileOf(mProjY * std::max(highY / frontZ, highY / backZ), (float)kClustersY, true), candidate.MinY);
+        const uint32_t maxY = std::min<uint32_t>(TileOf(mProjY * std::min(lowY / frontZ, lowY / backZ), (float)kClustersY, true), candidate.MaxY);
+
+        // Sphere against box is the squared distance to the nearest point in it. Within a slice, x only depends on
+        // the column and y on the row, so the two are worked out once each and the clusters only add them up.
+        float columnDistanceSq[kClustersX];
+        for (uint32_t x = minX; x <= maxX; ++x)
+        {
+            const float outside = std::max(std::max(pColumnMin[x] - candidate.Center[0], candidate.Center[0] - pColumnMax[x]), 0.0f);
+            columnDistanceSq[x] = outside * outside;
+        }
+
+        // Room for every cluster in the rectangle, the buffer only ever grows
+        const size_t needed = entryCount + (size_t)(maxX - minX + 1) * (maxY - minY + 1);
+        if (job.Entries.size() < needed)
+            job.Entries.resize(std::max(needed, job.Entries.size() * 2));
+        uint32_t* pEntries = job.Entries.data();
+
+        for (uint32_t y = minY; y <= maxY; ++y)
+        {
+            const float outside = std::max(std::max(pRowMin[y] - candidate.Center[1], candidate.Center[1] - pRowMax[y]), 0.0f);
+            const float rowRangeSq = cutRangeSq - outside * outside;
+            if (rowRangeSq < 0.0f)
+                continue;
+
+            for (uint32_t x = minX; x <= maxX; ++x)
+            {
+                if (columnDistanceSq[x] <= rowRangeSq)
+                {
+                    const uint32_t cluster = y * kClustersX + x;
+                    pEntries[entryCount++] = light << 8 | cluster;
+                    ++counts[cluster];
+                }
+            }
+        }
+    }
+
+    // Counting sort by cluster, lights stay in order within each
+    job.Offsets[0] = 0;
+    for (uint32_t cluster = 0; cluster != kSliceClusters; ++cluster)
+        job.Offsets[cluster + 1] = job.Offsets[cluster] + counts[cluster];
+
+    job.Sorted.resize(entryCount);
+    uint32_t cursors[kSliceClusters];
+    memcpy(cursors, job.Offsets, sizeof(cursors));
+    for (uint32_t i = 0; i != entryCount; ++i)
+        job.Sorted[cursors[job.Entries[i] & 0xFF]++] = job.Entries[i] >> 8;
+}
+
+}
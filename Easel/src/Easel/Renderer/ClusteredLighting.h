@@ -0,0 +1,153 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Device independent light binning for clustered forward
+shading. The view frustum is cut into a grid of clusters: screen tiles in
+x and y, and slices in z spaced exponentially, so near slices are thin and
+far ones deep. Every frame each point and spot light is binned into the
+clusters its sphere touches, and the result is a compact list of light
+indices per cluster. A pixel finds its cluster from its screen position and
+depth, and shades only the lights in that cluster's list.
+Lights are kept one array per component so the first pass can take four at
+a time. The per-cluster tests then run one z slice per job over a WorkerPool.
+Like Culling.h, matrices are row-major float[16] in the DirectXMath convention.
+----------------------------------------------*/
+#ifndef EASEL_CLUSTEREDLIGHTING_H
+#define EASEL_CLUSTEREDLIGHTING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace Core
+{
+class WorkerPool;
+}
+
+namespace Renderer {
+
+// Point and spot lights. A point light is a spot light whose cone takes in everything.
+struct LightSet
+{
+    std::vector<float> PositionX, PositionY, PositionZ;
+    std::vector<float> Range;                               // Nothing is lit past it
+    std::vector<float> ColorR, ColorG, ColorB;
+    std::vector<float> DirectionX, DirectionY, DirectionZ;  // Where a spot light points, normalized
+    std::vector<float> CosOuter, CosInner;                  // Of the cone's half angles, fading in between
+
+    uint32_t GetCount() const { return (uint32_t)PositionX.size(); }
+
+    // Both return the new light's index. Angles are in radians, from the axis to the edge of the cone.
+    uint32_t AddPointLight(const float* position, float range, const float* color);
+    uint32_t AddSpotLight(const float* position, float range, const float* color, const float* direction, float innerAngle, float outerAngle);
+};
+
+// One light as the shaders read it, ClusterLight in PhongCommon.hlsli
+struct ClusterLight
+{
+    float Position[3];
+    float Range;
+    float Color[3];
+    float CosOuter;
+    float Direction[3];
+    float CosInner;
+};
+
+// One frame's lights binned, laid out the way the structured buffers take them
+struct ClusteredLights
+{
+    ClusterLight* Lights = nullptr;         // Only the ones that reach into the view
+    uint32_t      LightCount = 0;
+    uint32_t*     Ranges = nullptr;         // First index and count for every cluster, x fastest, then y from the top, then z
+    uint32_t*     Indices = nullptr;        // Into Lights
+    uint32_t      IndexCount = 0;
+
+    // A view space depth's slice is log(depth) * SliceScale + SliceBias
+    float         SliceScale = 0.0f;
+    float         SliceBias = 0.0f;
+};
+
+struct LightBinStats
+{
+    uint32_t Lights = 0;
+    uint32_t Visible = 0;       // Made it into at least one cluster's candidates
+    uint32_t Indices = 0;
+    uint32_t Dropped = 0;       // Indices past kMaxIndices, those lights go missing in some clusters
+    double   Ms = 0.0;
+};
+
+class LightBinner
+{
+public:
+    static constexpr uint32_t kClustersX = 16;
+    static constexpr uint32_t kClustersY = 8;
+    static constexpr uint32_t kClustersZ = 24;
+    static constexpr uint32_t kClusterCount = kClustersX * kClustersY * kClustersZ;
+
+    // What a ClusteredLights has room for. Lights past kMaxLights aren't binned at all.
+    static constexpr uint32_t kMaxLights = 4096;
+    static constexpr uint32_t kMaxIndices = 64 * 1024;
+
+    LightBinner() = default;
+
+    // Bytes a ClusteredLights needs, and pointing one at them. The memory has to outlive it.
+    static size_t GetOutputBytes();
+    static void InitOutput(void* pMemory, ClusteredLights* out_lights);
+
+    // view is the camera's, projX and projY the _11 and _22 of a perspective projection, nearZ and farZ its planes.
+    // pPool may be null or have no workers.
+    void Bin(LightSet const& lights, const float* view, float projX, float projY, float nearZ, float farZ, ClusteredLights* out_lights, Core::WorkerPool* pPool);
+
+    LightBinStats const& GetStats() const { return mStats; }
+
+private:
+    // Where a light landed in view space and the clusters its sphere might touch, inclusive
+    struct Candidate
+    {
+        float   Center[3];
+        float   Range;
+        uint8_t MinX, MaxX, MinY, MaxY;
+    };
+
+    // Binning of one z slice, sorted by cluster
+    struct SliceJob
+    {
+        std::vector<uint32_t> Candidates;   // Into mCandidates, in light order
+        std::vector<uint32_t> Entries;      // Cluster in the slice in the low byte, light above. Only grows, the count is BinSlice's.
+        std::vector<uint32_t> Sorted;       // Lights only
+        uint32_t              Offsets[kClustersX * kClustersY + 1];
+    };
+
+    static void RunSliceJob(void* pContext, uint32_t slice);
+
+    // Cluster bounds for a new projection
+    void BuildClusterBounds(float projX, float projY, float nearZ, float farZ);
+
+    // Four lights from first on, as many as there are, into mCandidates and the slices' lists
+    void FindCandidates(LightSet const& lights, uint32_t first, const float* view, ClusteredLights* out_lights);
+
+    void BinSlice(uint32_t slice);
+
+    // View space boxes around the clusters, the depths between slices and the x and y extents of every column and
+    // row in each slice. A cluster's box is its column's by its row's by its slice's.
+    float                 mProjX = 0.0f;
+    float                 mProjY = 0.0f;
+    float                 mNear = 0.0f;
+    float                 mFar = 0.0f;
+    float                 mSliceDepths[kClustersZ + 1];
+    float                 mColumnMin[kClustersZ][kClustersX];
+    float                 mColumnMax[kClustersZ][kClustersX];
+    float                 mRowMin[kClustersZ][kClustersY];
+    float                 mRowMax[kClustersZ][kClustersY];
+
+    std::vector<Candidate> mCandidates;     // Same order as the packet's Lights
+    SliceJob               mSlices[kClustersZ];
+    LightBinStats          mStats;
+
+public:
+    LightBinner(LightBinner const&)            = delete;
+    LightBinner& operator=(LightBinner const&) = delete;
+};
+
+}
+#endif
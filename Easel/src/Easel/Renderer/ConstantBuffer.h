@@ -64,9 +64,11 @@ struct ConstantBufferUpdateManager
         kBindFunctions[packet->ShaderStage](context, packet->BindSlot, &packet->Buffer);
     }
 
+    // Headless packets never had a buffer
     static void Cleanup(ConstantBufferBindPacket* packet)
     {
-        packet->Buffer->Release();
+        if (packet->Buffer)
+            packet->Buffer->Release();
     }
 };
 
@@ -0,0 +1,79 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of Culling.h
+----------------------------------------------*/
+#include "Culling.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace Renderer {
+
+static FrustumPlane MakePlane(float a, float b, float c, float d)
+{
+    const float length = sqrtf(a * a + b * b + c * c);
+    const float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+    return { a * invLength, b * invLength, c * invLength, d * invLength };
+}
+
+// Gribb/Hartmann: with row vectors, each clip plane is a sum or difference of the matrix's columns
+void Culling::ExtractFrustum(const float* m, Frustum* out_frustum)
+{
+    FrustumPlane* planes = out_frustum->Planes;
+    planes[0] = MakePlane(m[3] + m[0], m[7] + m[4], m[11] + m[8],  m[15] + m[12]); // w + x
+    planes[1] = MakePlane(m[3] - m[0], m[7] - m[4], m[11] - m[8],  m[15] - m[12]); // w - x
+    planes[2] = MakePlane(m[3] + m[1], m[7] + m[5], m[11] + m[9],  m[15] + m[13]); // w + y
+    planes[3] = MakePlane(m[3] - m[1], m[7] - m[5], m[11] - m[9],  m[15] - m[13]); // w - y
+    planes[4] = MakePlane(m[2],        m[6],        m[10],         m[14]);         // z, D3D clip space starts at 0 rather than -w
+    planes[5] = MakePlane(m[3] - m[2], m[7] - m[6], m[11] - m[10], m[15] - m[14]); // w - z
+}
+
+BoundingSphere Culling::TransformSphere(const BoundingSphere& local, const float* m)
+{
+    BoundingSphere world;
+    world.X = local.X * m[0] + local.Y * m[4] + local.Z * m[8]  + m[12];
+    world.Y = local.X * m[1] + local.Y * m[5] + local.Z * m[9]  + m[13];
+    world.Z = local.X * m[2] + local.Y * m[6] + local.Z * m[10] + m[14];
+
+    const float scaleX = m[0] * m[0] + m[1] * m[1] + m[2]  * m[2];
+    const float scaleY = m[4] * m[4] + m[5] * m[5] + m[6]  * m[6];
+    const float scaleZ = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+    float maxScale = scaleX > scaleY ? scaleX : scaleY;
+    maxScale = maxScale > scaleZ ? maxScale : scaleZ;
+
+    world.Radius = local.Radius * sqrtf(maxScale);
+    return world;
+}
+
+bool Culling::IsVisible(const Frustum& frustum, const BoundingSphere& sphere)
+{
+    for (const FrustumPlane& plane : frustum.Planes)
+    {
+        if (plane.Nx * sphere.X + plane.Ny * sphere.Y + plane.Nz * sphere.Z + plane.D < -sphere.Radius)
+            return false;
+    }
+    return true;
+}
+
+uint32_t Culling::CullSpheres(const Frustum& frustum, const BoundingSphere* spheres, uint32_t count, uint32_t* out_visible)
+{
+    // Branchless write: the index is always stored, the cursor only advances for visible spheres
+    uint32_t visibleCount = 0;
+    for (uint32_t i = 0; i != count; ++i)
+    {
+        out_visible[visibleCount] = i;
+        visibleCount += IsVisible(frustum, spheres[i]) ? 1 : 0;
+    }
+    return visibleCount;
+}
+
+void Culling::Gather(const void* src, size_t elementSize, const uint32_t* indices, uint32_t count, void* dst)
+{
+    const uint8_t* pSrc = static_cast<const uint8_t*>(src);
+    uint8_t* pDst = static_cast<uint8_t*>(dst);
+    for (uint32_t i = 0; i != count; ++i)
+        memcpy(pDst + i * elementSize, pSrc + indices[i] * elementSize, elementSize);
+}
+
+}
@@ -0,0 +1,53 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Device independent view frustum culling against bounding spheres.
+Matrices are plain row-major float[16] in the DirectXMath convention
+(row vectors, v * M), so an XMFLOAT4X4 can be passed straight in.
+----------------------------------------------*/
+#ifndef EASEL_CULLING_H
+#define EASEL_CULLING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Renderer {
+
+struct BoundingSphere
+{
+    float X = 0.0f;
+    float Y = 0.0f;
+    float Z = 0.0f;
+    float Radius = 0.0f;
+};
+
+// Normalized, with the normal pointing inside: dot(N, p) + D >= 0 for points in front
+struct FrustumPlane
+{
+    float Nx, Ny, Nz, D;
+};
+
+struct Frustum
+{
+    FrustumPlane Planes[6]; // Left, Right, Bottom, Top, Near, Far
+};
+
+struct Culling final
+{
+    // Planes of a D3D style clip space (0 <= z <= w) pulled back through viewProjection
+    static void ExtractFrustum(const float* viewProjection, Frustum* out_frustum);
+
+    // Local sphere moved into world space. Non-uniform scale grows the radius by the largest axis.
+    static BoundingSphere TransformSphere(const BoundingSphere& local, const float* world);
+
+    static bool IsVisible(const Frustum& frustum, const BoundingSphere& sphere);
+
+    // Writes the index of every sphere that touches the frustum, in order. Returns how many were written.
+    static uint32_t CullSpheres(const Frustum& frustum, const BoundingSphere* spheres, uint32_t count, uint32_t* out_visible);
+
+    // Copies the elements picked by indices into dst back to back, e.g. the world matrices of visible instances
+    static void Gather(const void* src, size_t elementSize, const uint32_t* indices, uint32_t count, void* dst);
+};
+
+}
+#endif
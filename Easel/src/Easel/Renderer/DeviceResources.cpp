@@ -703,18 +703,20 @@ void DeviceResources::UpdateColorSpace()
 }
 
 #if defined(ESL_DEBUG)
-void DeviceResources::UpdateTitleBar(uint32_t fps, uint32_t frameCount)
+void DeviceResources::UpdateTitleBar(uint32_t fps, Core::FrameTimeStats const& frameTimes, int width, int height)
 {
-    // Update title bar every 120 frames
-    if (frameCount % 120 == 0)
-        return;
-
     std::wstringstream wss;
+    wss.setf(std::ios::fixed);
+    wss.precision(2);
 
     // Window Information
-    wss <<  L"Width: "  << mViewportInfo.Width  <<
-        L"    Height: " << mViewportInfo.Height <<
-        L"    FPS: "    << fps;
+    wss <<  L"Width: "  << width  <<
+        L"    Height: " << height <<
+        L"    FPS: "    << fps <<
+        L"    p50: "    << frameTimes.P50Ms << L"ms" <<
+        L"    p99: "    << frameTimes.P99Ms << L"ms" <<
+        L"    max: "    << frameTimes.MaxMs << L"ms" <<
+        L"    spikes: " << frameTimes.Spikes;
 
     // Check and Print Feature Level
     switch (mFeatureLevel)
@@ -735,19 +737,15 @@ void DeviceResources::UpdateTitleBar(uint32_t fps, uint32_t frameCount)
     SetWindowText(GetWindow(), wss.str().c_str());
 }
 #else // This is temporary code for debugging
-void DeviceResources::UpdateTitleBar(uint32_t fps, uint32_t frameCount)
+void DeviceResources::UpdateTitleBar(uint32_t fps, Core::FrameTimeStats const& frameTimes, int width, int height)
 {
-    // Update title bar every 60 frames
-    if (frameCount % 60 == 0)
-        return;
-
-    // Small static buffer just for displaying the FPS
-    static char buf[16];
-    sprintf_s(buf, "FPS: %d", fps);
+    // Small static buffer just for displaying the FPS and frame times
+    static char buf[64];
+    sprintf_s(buf, "FPS: %u    p99: %.2fms    max: %.2fms", fps, frameTimes.P99Ms, frameTimes.MaxMs);
 
     SetWindowTextA(GetWindow(), buf);
     
-    SecureZeroMemory(buf, 16);
+    SecureZeroMemory(buf, 64);
 }
 #endif
 
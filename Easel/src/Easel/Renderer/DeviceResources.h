@@ -10,6 +10,8 @@ DeviceResources - Member of Game, encapsulates the creation and setup of device
 
 #include "DXCore.h"
 
+#include <Easel/Core/FrameStats.h>
+
 namespace Renderer {
 
 // Interface for any device that uses device resources.
@@ -75,7 +77,9 @@ public:
     RECT                     GetOutputSize()        const { return mOutputSize;          }
     HWND                     GetWindow()            const { return mWindow;              }
 
-    void UpdateTitleBar(uint32_t fps, uint32_t frameCount);
+    // Frame times are shown as well as FPS, p99 is what stutter shows up in.
+    // Window thread, so the size comes from the caller rather than the render thread's viewport.
+    void UpdateTitleBar(uint32_t fps, Core::FrameTimeStats const& frameTimes, int width, int height);
 
 private:
     void CreateFactory();
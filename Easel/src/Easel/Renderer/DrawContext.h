@@ -2,16 +2,27 @@
 #define DRAWCONTEXT_H
 
 #include "DXCore.h"
+#include "Material.h"
+#include "Mesh.h"
 
 namespace Renderer {
 
 struct InstancedDrawContext
 {
     DirectX::XMFLOAT4X4*    WorldMatrices = nullptr;
+    BoundingSphere*         WorldBounds = nullptr;      // MeshBounds under each of WorldMatrices
     ID3D11Buffer*           DynamicBuffer = nullptr;
-    MeshID                  InstancedMeshID = 0;
+    DirectX::XMFLOAT4X4*    NullInstances = nullptr;    // Headless stand-in for DynamicBuffer, the same size
+    MeshHandle              InstancedMesh;
     UINT                    InstanceCount = 0;
-    uint32_t                MaterialIndex = 0;
+    MaterialHandle          Material;
+
+    // A copy of the mesh's, the codex belongs to the render thread and culling runs on the simulation thread.
+    // After a reload, EntityRenderer::PublishMeshBounds hands the new ones over.
+    BoundingSphere          MeshBounds;
+
+    // In EntityRenderer's OcclusionCuller. When set, whatever of this pass is in view hides what's behind it.
+    uint32_t                OccluderHull = UINT32_MAX;
 };
 
 }
@@ -5,19 +5,27 @@ Description : Implementation of Renderer class
 ----------------------------------------------*/
 #include "EntityRenderer.h"
 
-#include "Camera.h"
 #include "CBufferStructs.h"
 #include "ConstantBuffer.h"
+#include "Culling.h"
 #include "DeviceResources.h"
 #include "DrawContext.h"
+#include "Factories.h"
 #include "hash_util.h"
 #include "Material.h"
 #include "Mesh.h"
 #include "ResourceCodex.h"
 #include "Shader.h"
+#include "ShaderPermutations.h"
 #include "SkyRenderer.h"
 #include "ThrowMacros.h"
 
+#include <Easel/Assets/MaterialLibrary.h>
+#include <Easel/Assets/MeshImporter.h>
+#include <Easel/Core/MemoryTracker.h>
+#include <Easel/Core/PathMacros.h>
+#include <Easel/Core/Profiler.h>
+
 #if defined(ESL_DEBUG)
 #include <typeinfo>
 #endif
@@ -27,15 +35,25 @@ Description : Implementation of Renderer class
 
 namespace Renderer {
 
-EntityRenderer::EntityRenderer()
+EntityRenderer::EntityRenderer() :
+    IsHeadless(false),
+    PublishedMeshVersion(0),
+    SoftwarePassMesh(0),
+    MaterialParamsCB(),
+    EntityCB()
 {}
 
 void EntityRenderer::Init(DeviceResources const& dr)
 {
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+
     // Grab reference to d3d11 device and context
     auto device = dr.GetDevice();
     auto context = dr.GetContext();
 
+    // Entities and draw passes live as long as the renderer, so they're carved out of one block
+    SceneMemory.Init(kSceneMemoryBytes);
+
     // Initialize meshes, materials, entities
     InitMeshes(dr);
     InitEntities();
@@ -51,6 +69,63 @@ void EntityRenderer::Init(DeviceResources const& dr)
     ConstantBufferUpdateManager::Bind(&EntityCB, context);
 }
 
+void EntityRenderer::InitHeadless()
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+
+    IsHeadless = true;
+    SceneMemory.Init(kSceneMemoryBytes);
+
+    // No shaders to reflect a layout from, and bounds only need positions. Kept static, the codex holds on to the layout.
+    static Semantics kPositionSemantics[] = { Semantics::POSITION };
+    static uint16_t  kPositionOffsets[] = { 0 };
+    static const VertexBufferDescription kPositionOnly = { kPositionSemantics, kPositionOffsets, 1, sizeof(float) * 3 };
+
+    const MeshID sphereID = ResourceCodex::AddMeshFromFile("sphere.obj", &kPositionOnly, nullptr);
+    const MeshID cubeID = ResourceCodex::AddMeshFromFile("cube.obj", &kPositionOnly, nullptr);
+    assert(sphereID == IDs::SphereMesh && cubeID == IDs::CubeMesh);
+
+    InitEntities();
+    InitDrawContexts(nullptr);
+}
+
+bool EntityRenderer::InitSoftware(SoftwareRasterizer* pRasterizer, Core::WorkerPool* pPool)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+    assert(IsHeadless && "With a device, the GPU draws");
+
+    // What PhongVS reads, in its order
+    static Semantics kPhongSemantics[] = { Semantics::POSITION, Semantics::NORMAL, Semantics::TEXCOORD, Semantics::TANGENT, Semantics::BINORMAL };
+    static uint16_t  kPhongOffsets[] = { 0, 12, 24, 32, 44 };
+    static const VertexBufferDescription kPhongLayout = { kPhongSemantics, kPhongOffsets, 5, sizeof(float) * 14 };
+
+    Assets::CookedMesh cube;
+    if (!Assets::MeshImporter::ImportCached(Core::GetModelPathFromFile("cube.obj"), kPhongLayout, &cube))
+        return false;
+    SoftwarePassMesh = pRasterizer->AddMesh(cube, kPhongLayout);
+
+    std::vector<Assets::MaterialLibrary> libraries;
+    MaterialFactory::LoadMaterialLibraries(&libraries);
+    for (const Assets::MaterialLibrary& library : libraries)
+    {
+        for (const Assets::MaterialDesc& desc : library.GetMaterials())
+        {
+            if (fnv1a(desc.Name) != IDs::LunarMaterial)
+                continue;
+
+            if (!TextureFactory::LoadTextureSetMipChains(fnv1a(desc.Textures), SoftwareTextures, pPool))
+                return false;
+
+            // PhongPS with or without NORMAL_MAP, depending on whether the set has a normal map
+            SoftwarePassMaterial.pDiffuse = &SoftwareTextures[(UINT)TextureSlots::DIFFUSE];
+            SoftwarePassMaterial.pNormal = SoftwareTextures[(UINT)TextureSlots::NORMAL].Levels.empty() ? nullptr : &SoftwareTextures[(UINT)TextureSlots::NORMAL];
+            SoftwarePassMaterial.Specularity = desc.SpecularExp;
+            return !SoftwarePassMaterial.pDiffuse->Levels.empty();
+        }
+    }
+    return false;
+}
+
 //TODO: Lots of hardcoded hashes here huh
 void EntityRenderer::InitMeshes(DeviceResources const& dr)
 {
@@ -58,16 +133,15 @@ void EntityRenderer::InitMeshes(DeviceResources const& dr)
 
     ResourceCodex const& sg_Codex = ResourceCodex::GetSingleton();
 
-    const ShaderID kInstancedPhongVSID = 0xc8a366aa; // FNV1A of L"InstancedPhongVS.cso"
-    const ShaderID kPhongPSID = 0x4dc6e249;          // FNV1A of L"PhongPS.cso"
-    const ShaderID kPhongPSNormalMapID = fnv1a(L"Phong_NormalMapPS.cso");
-
-    const VertexShader* instancedPhongVS = sg_Codex.GetVertexShader(kInstancedPhongVSID);
-    const PixelShader*  PhongPS = sg_Codex.GetPixelShader(kPhongPSID);
+    // Every PhongVS variant reads the same vertices, and every PhongPS variant samples the same way
+    const PermutationKey instanced = (PermutationKey)ShaderFeature::INSTANCED;
+    const VertexShader* instancedPhongVS = sg_Codex.GetVertexShader(sg_Codex.FindVertexShader(IDs::PhongVS, instanced));
+    const PixelShader*  PhongPS = sg_Codex.GetPixelShader(sg_Codex.FindPixelShader(IDs::PhongPS, 0));
 
     const VertexBufferDescription* phongVertDesc = &instancedPhongVS->VertexDesc;
     const MeshID sphereID = ResourceCodex::AddMeshFromFile("sphere.obj", phongVertDesc, device);
     const MeshID cubeID = ResourceCodex::AddMeshFromFile("cube.obj", phongVertDesc, device);
+    assert(sphereID == IDs::SphereMesh && cubeID == IDs::CubeMesh);
     
     dr.GetContext()->PSSetSamplers(0, 1, &PhongPS->SamplerState);
 }
@@ -80,8 +154,14 @@ void EntityRenderer::InitEntities()
     const UINT kNumEntities = width * height;
     EntityCount = kNumEntities;
 
-    Entities = (Entity*)malloc(sizeof(Entity) * kNumEntities);
-    MeshID cubeMeshId = fnv1a(L"cube.obj");
+    Entities = SceneMemory.AllocateArray<Entity>(kNumEntities);
+    const MeshID cubeMeshId = IDs::CubeMesh;
+
+    // Materials are created when materials.xml is loaded
+    ResourceCodex const& sg_Codex = ResourceCodex::GetSingleton();
+    const MaterialHandle lunarMaterial = sg_Codex.FindMaterial(IDs::LunarMaterial);
+    const MaterialHandle wireframeMaterial = sg_Codex.FindMaterial(IDs::WireframeMaterial);
+    assert(IsHeadless || (lunarMaterial.IsValid() && wireframeMaterial.IsValid()));
 
     UINT entityIdx = 0;
     for (UINT i = 0; i != width; ++i)
@@ -92,9 +172,10 @@ void EntityRenderer::InitEntities()
             tfm.SetTranslation((float)i, 0.0f, (float)j);
 
             Entity test;
-            test.MaterialIndex = i == 0 && j == 0 ? MI_WIREFRAME : MI_LUNAR; 
+            test.Material = i == 0 && j == 0 ? wireframeMaterial : lunarMaterial; 
             test.mMeshID = cubeMeshId;
             test.mTransform = tfm;
+            test.mPreviousTransform = tfm;
 
             Entities[entityIdx++] = test;
         }
@@ -104,20 +185,55 @@ void EntityRenderer::InitEntities()
 void EntityRenderer::InitDrawContexts(ID3D11Device* device)
 {
     const UINT kInstancingPassCount = 1;
+    ResourceCodex& sg_Codex = ResourceCodex::GetSingleton();
 
     InstancingPassCount = kInstancingPassCount;
-    InstancingPasses = new InstancedDrawContext[kInstancingPassCount];
+    InstancingPasses = SceneMemory.AllocateArray<InstancedDrawContext>(kInstancingPassCount);
+    for (UINT i = 0; i != kInstancingPassCount; ++i)
+        new (&InstancingPasses[i]) InstancedDrawContext();
 
     InstancedDrawContext& cubeDraw = InstancingPasses[0];
     cubeDraw.InstanceCount   = EntityCount;
-    cubeDraw.WorldMatrices   = (DirectX::XMFLOAT4X4*)malloc(sizeof(DirectX::XMFLOAT4X4) * cubeDraw.InstanceCount);
-    cubeDraw.InstancedMeshID = Entities[0].mMeshID;
-    cubeDraw.MaterialIndex   = MI_LUNAR;
+    cubeDraw.WorldMatrices   = SceneMemory.AllocateArray<DirectX::XMFLOAT4X4>(cubeDraw.InstanceCount);
+    cubeDraw.WorldBounds     = SceneMemory.AllocateArray<BoundingSphere>(cubeDraw.InstanceCount);
+    cubeDraw.InstancedMesh   = sg_Codex.FindMesh(Entities[0].mMeshID);
+    cubeDraw.Material        = Entities[0].Material;
+    cubeDraw.MeshBounds      = sg_Codex.GetMesh(cubeDraw.InstancedMesh)->Bounds;
 
     static const bool DRAW_WIREFRAME = true;
     if (DRAW_WIREFRAME)
     {
-        cubeDraw.MaterialIndex = MI_WIREFRAME;
+        cubeDraw.Material = sg_Codex.FindMaterial(IDs::WireframeMaterial);
+    }
+
+    // The cubes are solid, so each is its own occluder. The hull is the same unit cube the mesh is.
+    static const float kCubeHullPositions[] =
+    {
+        -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,  -0.5f, 0.5f, -0.5f,   0.5f, 0.5f, -0.5f,
+        -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,  -0.5f, 0.5f,  0.5f,   0.5f, 0.5f,  0.5f
+    };
+    static const uint32_t kCubeHullIndices[] =
+    {
+        1, 3, 7, 1, 7, 5,   4, 6, 2, 4, 2, 0,   6, 7, 3, 6, 3, 2,
+        0, 1, 5, 0, 5, 4,   5, 7, 6, 5, 6, 4,   0, 2, 3, 0, 3, 1
+    };
+    Occlusion.Init(kOcclusionWidth, kOcclusionHeight);
+    cubeDraw.OccluderHull = Occlusion.AddOccluderMesh(kCubeHullPositions, 8, kCubeHullIndices, 36);
+
+    // The pass keeps what it draws alive, whatever else gets unloaded
+    sg_Codex.AddRef(cubeDraw.InstancedMesh);
+    sg_Codex.AddRef(cubeDraw.Material);
+
+    // The passes start out with the current bounds, so only later reloads need publishing
+    for (uint32_t i = 0; i != Core::Mailbox<BoundingSphere*>::kSlotCount; ++i)
+        MeshBoundsMailbox.GetSlot(i) = SceneMemory.AllocateArray<BoundingSphere>(InstancingPassCount);
+    PublishedMeshVersion = sg_Codex.GetMeshVersion();
+
+    // Headless, instances go to memory the size the buffer would have been
+    if (!device)
+    {
+        cubeDraw.NullInstances = SceneMemory.AllocateArray<DirectX::XMFLOAT4X4>(cubeDraw.InstanceCount);
+        return;
     }
 
     // Create the dynamic vertex buffer
@@ -131,45 +247,249 @@ void EntityRenderer::InitDrawContexts(ID3D11Device* device)
     COM_EXCEPT(device->CreateBuffer(&dynamicDesc, nullptr, &cubeDraw.DynamicBuffer));
 }
 
-void EntityRenderer::Update(ID3D11DeviceContext* context, float dt)
+void EntityRenderer::Simulate(float dt)
 {
-    using namespace DirectX;
-    using Core::Transform;
+    ESL_PROFILE_ZONE("EntityRenderer::Simulate");
 
+    // Radians per second, alternating direction across the grid
     const float rotSpeed = 1.25f;
 
-    static const XMVECTOR rot1 = DirectX::XMQuaternionRotationRollPitchYaw(rotSpeed, -rotSpeed, rotSpeed);
-    static const XMVECTOR rot2 = -rot1;
+    for (UINT i = 0; i != EntityCount; ++i)
+    {
+        Entity& entity = Entities[i];
+        entity.mPreviousTransform = entity.mTransform;
+
+        const float direction = i & 1 ? -1.0f : 1.0f;
+        entity.mTransform.Rotate(0.0f, direction * rotSpeed * dt, 0.0f);
+    }
+}
+
+void EntityRenderer::InitFramePacket(FramePacket* packet)
+{
+    packet->BatchCount = InstancingPassCount;
+    packet->Batches = SceneMemory.AllocateArray<InstanceBatch>(InstancingPassCount);
+    for (UINT i = 0; i != InstancingPassCount; ++i)
+    {
+        InstanceBatch& batch = packet->Batches[i];
+        batch = InstanceBatch();
+        batch.Capacity = InstancingPasses[i].InstanceCount;
+        batch.WorldMatrices = SceneMemory.AllocateArray<DirectX::XMFLOAT4X4>(batch.Capacity);
+    }
+
+    const UINT shadowBatchCount = CascadedShadows::kMaxCascades * InstancingPassCount;
+    packet->ShadowBatches = SceneMemory.AllocateArray<InstanceBatch>(shadowBatchCount);
+    for (UINT i = 0; i != shadowBatchCount; ++i)
+    {
+        InstanceBatch& batch = packet->ShadowBatches[i];
+        batch = InstanceBatch();
+        batch.Capacity = InstancingPasses[i % InstancingPassCount].InstanceCount;
+        batch.WorldMatrices = SceneMemory.AllocateArray<DirectX::XMFLOAT4X4>(batch.Capacity);
+    }
+}
+
+void EntityRenderer::UpdateTransforms(float alpha)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+    ESL_PROFILE_ZONE("EntityRenderer::UpdateTransforms");
+
+    using Core::Transform;
+
+    // A mesh was loaded again on the render thread, and its bounds may have changed with it
+    if (MeshBoundsMailbox.Acquire())
+    {
+        const BoundingSphere* bounds = MeshBoundsMailbox.GetReadSlot();
+        for (UINT i = 0; i != InstancingPassCount; ++i)
+            InstancingPasses[i].MeshBounds = bounds[i];
+    }
 
     InstancedDrawContext& lunarDraw = InstancingPasses[0];
+    const BoundingSphere meshBounds = lunarDraw.MeshBounds;
 
     for (UINT i = 0; i != EntityCount; ++i)
     {
-        Transform* tfm = &Entities[i].mTransform;
-        lunarDraw.WorldMatrices[i] = tfm->Recompute();
+        const Entity& entity = Entities[i];
+        lunarDraw.WorldMatrices[i] = Transform::Interpolate(entity.mPreviousTransform, entity.mTransform, alpha);
+        lunarDraw.WorldBounds[i] = Culling::TransformSphere(meshBounds, &lunarDraw.WorldMatrices[i]._11);
     }
+}
+
+void EntityRenderer::Cull(FramePacket* out_packet, Core::WorkerPool* pPool)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+    ESL_PROFILE_ZONE("EntityRenderer::Cull");
+
+    InstancedDrawContext& lunarDraw = InstancingPasses[0];
+
+    // The visible list only lives for this call. The frame arena belongs to the render thread.
+    Core::ScopedScratch scratch;
+    uint32_t* visible = scratch.AllocateArray<uint32_t>(EntityCount);
+    assert(visible);
 
-    // Rewrite the dynamic vertex buffer
-    D3D11_MAPPED_SUBRESOURCE mappedBuffer;
-    COM_EXCEPT(context->Map(lunarDraw.DynamicBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer));
-    memcpy(mappedBuffer.pData, lunarDraw.WorldMatrices, sizeof(DirectX::XMFLOAT4X4) * InstancingPasses[0].InstanceCount);
-    context->Unmap(lunarDraw.DynamicBuffer, 0);
+    Frustum frustum;
+    Culling::ExtractFrustum(&out_packet->ViewProjection._11, &frustum);
+
+    uint32_t visibleCount = Culling::CullSpheres(frustum, lunarDraw.WorldBounds, EntityCount, visible);
+
+    // Whatever is in view and solid goes into the coarse depth, then everything in view is tested against it
+    Occlusion.BeginFrame(&out_packet->ViewProjection._11);
+    if (lunarDraw.OccluderHull != UINT32_MAX)
+        Occlusion.AddOccluders(lunarDraw.OccluderHull, &lunarDraw.WorldMatrices[0]._11, visible, visibleCount);
+    Occlusion.RasterizeOccluders(pPool);
+    visibleCount = Occlusion.CullSpheres(lunarDraw.WorldBounds, visible, visibleCount, pPool);
+
+    // The survivors go into the packet packed, the render thread copies them straight into the instance buffer
+    InstanceBatch& batch = out_packet->Batches[0];
+    batch.Count = visibleCount;
+    assert(batch.Count <= batch.Capacity);
+    Culling::Gather(lunarDraw.WorldMatrices, sizeof(DirectX::XMFLOAT4X4), visible, batch.Count, batch.WorldMatrices);
 }
 
-void EntityRenderer::Draw(ID3D11DeviceContext* context)
+void EntityRenderer::CullShadowCasters(FramePacket* out_packet)
 {
-    this->InstancedDraw(context);
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+    ESL_PROFILE_ZONE("EntityRenderer::CullShadowCasters");
+
+    Core::ScopedScratch scratch;
+    uint32_t* casters = scratch.AllocateArray<uint32_t>(EntityCount);
+    assert(casters);
+
+    // The same bounds the view is culled with, against each cascade's box stretched out to the sun
+    for (uint32_t cascade = 0; cascade != out_packet->CascadeCount; ++cascade)
+    {
+        const Frustum& frustum = out_packet->Cascades[cascade].Casters;
+        for (UINT i = 0; i != InstancingPassCount; ++i)
+        {
+            const InstancedDrawContext& pass = InstancingPasses[i];
+            InstanceBatch& batch = out_packet->ShadowBatches[cascade * InstancingPassCount + i];
+            batch.Count = Culling::CullSpheres(frustum, pass.WorldBounds, pass.InstanceCount, casters);
+            assert(batch.Count <= batch.Capacity);
+            Culling::Gather(pass.WorldMatrices, sizeof(DirectX::XMFLOAT4X4), casters, batch.Count, batch.WorldMatrices);
+        }
+    }
 }
 
-void EntityRenderer::InstancedDraw(ID3D11DeviceContext* context)
+void EntityRenderer::PublishMeshBounds()
 {
-    ResourceCodex const& sg_Codex = ResourceCodex::GetSingleton();
+    ResourceCodex& sg_Codex = ResourceCodex::GetSingleton();
+    if (sg_Codex.GetMeshVersion() == PublishedMeshVersion)
+        return;
+
+    PublishedMeshVersion = sg_Codex.GetMeshVersion();
+
+    // Written whole, so a set the simulation thread never picked up is simply replaced
+    BoundingSphere* bounds = MeshBoundsMailbox.GetWriteSlot();
+    for (UINT i = 0; i != InstancingPassCount; ++i)
+    {
+        // The pass holds a reference, so its mesh is always there, if not always resident
+        const Mesh* pMesh = sg_Codex.GetMesh(InstancingPasses[i].InstancedMesh);
+        assert(pMesh);
+        bounds[i] = pMesh->Bounds;
+    }
+    MeshBoundsMailbox.Publish();
+}
+
+void EntityRenderer::Draw(ID3D11DeviceContext* context, FramePacket const& packet)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+
+    this->InstancedDraw(context, packet);
+}
+
+void EntityRenderer::DrawNull(FramePacket const& packet, NullDrawStats* out_stats)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+    ESL_PROFILE_ZONE("EntityRenderer::DrawNull");
+
+    assert(packet.BatchCount == InstancingPassCount);
+    for (UINT i = 0; i != InstancingPassCount; ++i)
+    {
+        const InstanceBatch& batch = packet.Batches[i];
+        if (!batch.Count)
+            continue;
 
+        // The same copy InstancedDraw makes into the mapped buffer
+        const size_t bytes = sizeof(DirectX::XMFLOAT4X4) * batch.Count;
+        memcpy(InstancingPasses[i].NullInstances, batch.WorldMatrices, bytes);
+
+        ++out_stats->DrawCalls;
+        out_stats->Instances += batch.Count;
+        out_stats->InstanceBytes += bytes;
+    }
+
+    // And every cascade's casters, through the same buffers
+    for (UINT i = 0; i != packet.CascadeCount * InstancingPassCount; ++i)
+    {
+        const InstanceBatch& batch = packet.ShadowBatches[i];
+        if (!batch.Count)
+            continue;
+
+        const size_t bytes = sizeof(DirectX::XMFLOAT4X4) * batch.Count;
+        memcpy(InstancingPasses[i % InstancingPassCount].NullInstances, batch.WorldMatrices, bytes);
+
+        ++out_stats->DrawCalls;
+        out_stats->Instances += batch.Count;
+        out_stats->InstanceBytes += bytes;
+    }
+}
+
+void EntityRenderer::DrawSoftware(FramePacket const& packet, SoftwareRasterizer* pRasterizer)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+    ESL_PROFILE_ZONE("EntityRenderer::DrawSoftware");
+
+    const cbLighting& cb = packet.Lighting;
+    const SoftwareLighting lighting =
+    {
+        { cb.ambientColor.x, cb.ambientColor.y, cb.ambientColor.z },
+        { cb.directionalLight.diffuseColor.x, cb.directionalLight.diffuseColor.y, cb.directionalLight.diffuseColor.z },
+        { cb.directionalLight.toLight.x, cb.directionalLight.toLight.y, cb.directionalLight.toLight.z },
+        { cb.cameraWorldPos.x, cb.cameraWorldPos.y, cb.cameraWorldPos.z }
+    };
+
+    // Same clear as the windowed path
+    pRasterizer->BeginFrame(&packet.ViewProjection._11, lighting, DirectX::Colors::Black);
+
+    assert(packet.BatchCount == InstancingPassCount);
+    for (UINT i = 0; i != InstancingPassCount; ++i)
+    {
+        const InstanceBatch& batch = packet.Batches[i];
+        pRasterizer->DrawInstanced(SoftwarePassMesh, SoftwarePassMaterial, &batch.WorldMatrices[0]._11, batch.Count);
+    }
+
+    pRasterizer->EndFrame();
+}
+
+void EntityRenderer::InstancedDraw(ID3D11DeviceContext* context, FramePacket const& packet)
+{
+    ESL_PROFILE_ZONE("EntityRenderer::InstancedDraw");
+
+    ResourceCodex& sg_Codex = ResourceCodex::GetSingleton();
+
+    // Materials that share a texture bank bind the same chord, and materials that share a pipeline the same
+    // pipeline state, so consecutive passes can skip the rebind
+    TextureHandle boundResources;
+    PipelineStateHandle boundPipeline;
+
+    assert(packet.BatchCount == InstancingPassCount);
+    const InstanceBatch* batch = packet.Batches;
     InstancedDrawContext* drawCtx = InstancingPasses; 
     InstancedDrawContext* const drawCtxItEnd = InstancingPasses + InstancingPassCount;
-    for (; drawCtx != drawCtxItEnd; ++drawCtx)
+    for (; drawCtx != drawCtxItEnd; ++drawCtx, ++batch)
     {
-        const Mesh* const mesh = sg_Codex.GetMesh(drawCtx->InstancedMeshID);
+        // Everything in it was culled
+        if (!batch->Count)
+            continue;
+
+        // Couldn't be made resident, the pass sits this frame out
+        const Mesh* const mesh = sg_Codex.UseMesh(drawCtx->InstancedMesh);
+        if (!mesh)
+            continue;
+
+        // Rewrite the dynamic vertex buffer with this frame's instances
+        D3D11_MAPPED_SUBRESOURCE mappedBuffer;
+        COM_EXCEPT(context->Map(drawCtx->DynamicBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer));
+        memcpy(mappedBuffer.pData, batch->WorldMatrices, sizeof(DirectX::XMFLOAT4X4) * batch->Count);
+        context->Unmap(drawCtx->DynamicBuffer, 0);
 
         ID3D11Buffer* vertBuffers[2];
         vertBuffers[0] = mesh->VertexBuffer;        // Vertices
@@ -191,37 +511,71 @@ void EntityRenderer::InstancedDraw(ID3D11DeviceContext* context)
         context->IASetVertexBuffers(0, 2, &vertBuffers[0], &strides[0], &offsets[0]);
         context->IASetIndexBuffer(mesh->IndexBuffer, DXGI_FORMAT_R32_UINT, 0);
 
-        // Setup VS,PS
-        const Material mat = *sg_Codex.GetMaterial(drawCtx->MaterialIndex);
-        const VertexShader* VS = mat.VS;
-        const PixelShader*  PS = mat.PS;
+        // Shaders, input layout and fixed function state in one go
+        const Material* mat = sg_Codex.GetMaterial(drawCtx->Material);
+        if (!sg_Codex.BindPipelineState(context, mat->Pipeline, &boundPipeline))
+            continue;
+
+        // Update Material Param Data:
+        ConstantBufferUpdateManager::MapUnmap(&MaterialParamsCB, (void*)&mat->Description, context);
 
-        ID3D11RasterizerState* pCurrRasterState = nullptr;
-        ID3D11RasterizerState* pRasterStateOverride = mat.RasterStateOverride;
-        if (pRasterStateOverride)
+        // Bind Textures expected by the shader
+        if (mat->Resources.IsValid() && mat->Resources != boundResources)
         {
-            context->RSGetState(&pCurrRasterState);
-            context->RSSetState(pRasterStateOverride);
+            const ResourceBindChord* resources = sg_Codex.UseTexture(mat->Resources);
+            if (!resources)
+                continue;
+
+            context->PSSetShaderResources(0, (UINT)TextureSlots::COUNT, resources->SRVs);
+            boundResources = mat->Resources;
         }
 
-        context->IASetInputLayout(VS->InputLayout);
-        context->VSSetShader(VS->Shader, nullptr, 0);
-        context->PSSetShader(PS->Shader, nullptr, 0);
+        // Submit draw call to GPU
+        context->DrawIndexedInstanced(mesh->IndexCount, batch->Count, 0, 0, 0);
+    }
+}
+
+void EntityRenderer::DrawShadowCasters(ID3D11DeviceContext* context, FramePacket const& packet, uint32_t cascade)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+    ESL_PROFILE_ZONE("EntityRenderer::DrawShadowCasters");
 
-        // Update Material Param Data:
-        ConstantBufferUpdateManager::MapUnmap(&MaterialParamsCB, (void*)&mat.Description, context);
+    ResourceCodex& sg_Codex = ResourceCodex::GetSingleton();
 
-        // Bind Textures expected by the shader
-        if (mat.Resources)
-            context->PSSetShaderResources(0, (UINT)TextureSlots::COUNT, mat.Resources->SRVs);
+    // Depth only
+    context->PSSetShader(nullptr, nullptr, 0);
 
-        // Submit draw call to GPU
-        context->DrawIndexedInstanced(mesh->IndexCount, drawCtx->InstanceCount, 0, 0, 0);
+    assert(cascade < packet.CascadeCount);
+    const InstanceBatch* batch = packet.ShadowBatches + cascade * InstancingPassCount;
+    for (UINT i = 0; i != InstancingPassCount; ++i, ++batch)
+    {
+        if (!batch->Count)
+            continue;
+
+        InstancedDrawContext* drawCtx = &InstancingPasses[i];
+        const Mesh* const mesh = sg_Codex.UseMesh(drawCtx->InstancedMesh);
+        if (!mesh)
+            continue;
+
+        // Discarding again hands back fresh memory, the draws already made with this buffer keep what they saw
+        D3D11_MAPPED_SUBRESOURCE mappedBuffer;
+        COM_EXCEPT(context->Map(drawCtx->DynamicBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer));
+        memcpy(mappedBuffer.pData, batch->WorldMatrices, sizeof(DirectX::XMFLOAT4X4) * batch->Count);
+        context->Unmap(drawCtx->DynamicBuffer, 0);
+        ID3D11Buffer* vertBuffers[2] = { mesh->VertexBuffer, drawCtx->DynamicBuffer };
+        const UINT strides[2] = { mesh->Stride, sizeof(DirectX::XMFLOAT4X4) };
+        const UINT offsets[2] = { 0, 0 };
+        context->IASetVertexBuffers(0, 2, &vertBuffers[0], &strides[0], &offsets[0]);
+        context->IASetIndexBuffer(mesh->IndexBuffer, DXGI_FORMAT_R32_UINT, 0);
 
-        if (pRasterStateOverride)
-        {
-            context->RSSetState(pCurrRasterState); // Put things back how they were
-        }
+        // The material's vertex shader places the instances the same way the main pass does.
+        // Only that half of its pipeline state applies, the shadow renderer owns the rest.
+        const Material* mat = sg_Codex.GetMaterial(drawCtx->Material);
+        const PipelineState* pipeline = sg_Codex.GetPipelineState(mat->Pipeline);
+        context->IASetInputLayout(pipeline->InputLayout);
+        context->VSSetShader(pipeline->VertexShader, nullptr, 0);
+
+        context->DrawIndexedInstanced(mesh->IndexCount, batch->Count, 0, 0, 0);
     }
 }
 
@@ -231,15 +585,19 @@ EntityRenderer::~EntityRenderer()
     {
         InstancedDrawContext& drawCtx = InstancingPasses[i];
 
-        free(drawCtx.WorldMatrices);
         drawCtx.WorldMatrices = nullptr;
-        drawCtx.DynamicBuffer->Release();
+        drawCtx.WorldBounds = nullptr;
+        drawCtx.NullInstances = nullptr;
+        if (drawCtx.DynamicBuffer)
+            drawCtx.DynamicBuffer->Release();
+
+        ResourceCodex::GetSingleton().Release(drawCtx.InstancedMesh);
+        ResourceCodex::GetSingleton().Release(drawCtx.Material);
     }
     
-    delete[] InstancingPasses;
     InstancingPasses = nullptr;
-
-    free(Entities);
+    Entities = nullptr;
+    SceneMemory.Destroy();
 
     ConstantBufferUpdateManager::Cleanup(&MaterialParamsCB);
     ConstantBufferUpdateManager::Cleanup(&EntityCB);
@@ -6,28 +6,47 @@ Description : Manager-level class for intelligently binding and drawing objects
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <Easel/Assets/MipGenerator.h>
+#include <Easel/Core/Allocators.h>
+#include <Easel/Core/Mailbox.h>
 #include <Easel/Core/Transform.h>
 
 #include "CBufferStructs.h"
 #include "ConstantBuffer.h"
 #include "DXCore.h"
+#include "FramePacket.h"
+#include "OcclusionCulling.h"
 #include "ResourceCodex.h"
+#include "SoftwareRasterizer.h"
+
+namespace Core
+{
+    class WorkerPool;
+}
 
 namespace Renderer
 {
     class DeviceResources;
-    class Camera;
 
     struct InstancedDrawContext;
 }
 
 namespace Renderer {
 
+// What the headless path would have drawn, summed over every packet it was given
+struct NullDrawStats
+{
+    uint64_t DrawCalls = 0;
+    uint64_t Instances = 0;
+    uint64_t InstanceBytes = 0;
+};
+
 struct Entity
 {
-    Core::Transform mTransform;
+    Core::Transform mTransform;         // As of the latest simulation step
+    Core::Transform mPreviousTransform; // As of the step before, rendering blends between the two
     MeshID          mMeshID;
-    uint32_t        MaterialIndex;
+    MaterialHandle  Material;
 };
 
 class EntityRenderer
@@ -38,16 +57,58 @@ public:
 
     void Init(DeviceResources const& dr);
 
-    // For now, the renderer will handle updating the entities, 
+    // Without a device: the same entities and passes, but meshes are only imported for their bounds and
+    // instances go to plain memory instead of a vertex buffer. ResourceCodex::InitHeadless first.
+    void InitHeadless();
+
+    // After InitHeadless, for image output: adds the cube the pass draws to the rasterizer with the full Phong layout
+    // and decodes its material's textures. Headless has no materials in the codex, so the pass draws with Lunar from
+    // the material library, which is what the grid is given. False if any of it couldn't be loaded.
+    // The pool generates the texture mips, if they weren't cached.
+    bool InitSoftware(SoftwareRasterizer* pRasterizer, Core::WorkerPool* pPool);
+
+    // For now, the renderer will handle simulating the entities, 
     // In the future, perhaps a Physics Manager or AI Manager would be a good solution?
-    void Update(ID3D11DeviceContext* context, float dt);
+    // Called at the fixed simulation rate, dt is always one step.
+    void Simulate(float dt);
+
+    // Gives the packet one instance batch per pass, and one per pass for every shadow cascade, each sized for every
+    // entity in the pass. Once per packet, before the threads start.
+    void InitFramePacket(FramePacket* packet);
+
+    // Once per packet: world matrices and bounds 'alpha' of the way from the previous step to the latest.
+    // Doesn't touch the packet, so it can overlap with whatever fills in the view. Picks up bounds from PublishMeshBounds.
+    void UpdateTransforms(float alpha);
+
+    // Once per packet, after UpdateTransforms and once the packet's ViewProjection is set: packs the world matrices of
+    // whatever is inside its frustum and not hidden behind an occluder into the packet's batches. pPool may be null.
+    void Cull(FramePacket* out_packet, Core::WorkerPool* pPool);
 
-    // Binds the fields necessary in the material, then draws every entity in m_EntityMap
-    void Draw(ID3D11DeviceContext* context);
+    // Once per packet, after UpdateTransforms and once the packet's cascades are fitted: packs the world matrices of
+    // whatever could throw a shadow into each cascade into its batches. Occlusion doesn't apply, the sun sees around it.
+    void CullShadowCasters(FramePacket* out_packet);
+
+    // Render thread, once per frame: if the codex loaded a mesh again since the last call, sends every pass's mesh
+    // bounds to the simulation thread, so culling and occlusion fit the mesh that's actually drawn
+    void PublishMeshBounds();
+
+    // Render thread: uploads the packet's instances, binds the fields necessary in the material, then draws them
+    void Draw(ID3D11DeviceContext* context, FramePacket const& packet);
+
+    // Render thread: depth only, one cascade's casters through the same instance buffers and vertex shaders.
+    // The target, viewport, rasterizer state and view-projection are the caller's.
+    void DrawShadowCasters(ID3D11DeviceContext* context, FramePacket const& packet, uint32_t cascade);
+
+    // Headless stand-in for Draw: copies every batch out the way Draw fills its buffer, and counts the draws
+    // it would have made. What a frame costs the CPU stays measurable without a GPU.
+    void DrawNull(FramePacket const& packet, NullDrawStats* out_stats);
+
+    // Headless, after InitSoftware: the packet drawn on the CPU. The image is complete when this returns.
+    void DrawSoftware(FramePacket const& packet, SoftwareRasterizer* pRasterizer);
 
 private:
     // Performs all the instanced draw steps
-    void InstancedDraw(ID3D11DeviceContext* context);
+    void InstancedDraw(ID3D11DeviceContext* context, FramePacket const& packet);
     
     // Loads the necessary models into a collection
     void InitMeshes(DeviceResources const& dr);
@@ -55,19 +116,42 @@ private:
     // Populates the Entity List
     void InitEntities();
 
-    // Creates the necessary material keys within m_Map, 
+    // Creates the necessary material keys within m_Map. Headless when there's no device.
     void InitDrawContexts(ID3D11Device* device);
 
 private:
+    static constexpr size_t kSceneMemoryBytes = 1024 * 1024;
+
+    // Occluder depth resolution, whatever the window's
+    static constexpr uint32_t kOcclusionWidth = 256;
+    static constexpr uint32_t kOcclusionHeight = 128;
+
+    // Backs Entities, InstancingPasses and their world matrices
+    Core::LinearArena SceneMemory;
 
     // All the Entities
     Entity*  Entities;
     UINT     EntityCount;
 
+    // No device, so no materials and nothing bound
+    bool     IsHeadless;
+
     // Array of Instancing Information
     InstancedDrawContext* InstancingPasses;
     UINT                  InstancingPassCount;
 
+    // Coarse depth of the occluders in view, simulation thread only
+    OcclusionCuller Occlusion;
+
+    // Render to simulation thread: one bounds per pass, each slot backed by SceneMemory
+    Core::Mailbox<BoundingSphere*> MeshBoundsMailbox;
+    uint32_t                       PublishedMeshVersion;
+
+    // Software path, set up by InitSoftware
+    Assets::MipChain SoftwareTextures[(UINT)TextureSlots::COUNT];
+    SoftwareMaterial SoftwarePassMaterial;
+    uint32_t         SoftwarePassMesh;
+
     // Constant Buffer that holds material parameters
     ConstantBufferBindPacket MaterialParamsCB;
 
@@ -1,169 +1,72 @@
 #include "Factories.h"
 
 #include "hash_util.h"
+#include <Easel/Core/Allocators.h>
 
 // MeshFactory
 #include "Mesh.h"
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
-#include <assimp/scene.h>
+#include <Easel/Assets/AssetCache.h>
+#include <Easel/Assets/MeshImporter.h>
 
 // ShaderFactory
 #include "Shader.h"
+#include "ShaderPermutations.h"
+#include "ShaderReflection.h"
 
 // TextureFactory
 #include "Material.h"
+#include <Easel/Assets/MipGenerator.h>
+#include <Easel/Assets/TexturePacker.h>
 #include <filesystem>
 #include <DDSTextureLoader.h>
-#include <WICTextureLoader.h>
+#include <wincodec.h>
 
+#pragma comment(lib, "windowscodecs.lib")
+
+// MaterialFactory
+#include <Easel/Assets/MaterialLibrary.h>
+
+#include <array>
 #include <unordered_map>
 
 namespace Renderer {
 
+// Bump whenever WIC decoding or the texture cooking settings change
+static const uint32_t kTextureImporterVersion = 1;
+
 MeshID MeshFactory::CreateMesh(const char* fileName, const VertexBufferDescription* vertAttr, ID3D11Device* pDevice, Mesh* out_mesh)
 {
-    Assimp::Importer Importer;
     MeshID meshId = fnv1a(fileName);
 
-    // Load assimpScene with proper flags
-    const aiScene* pScene = Importer.ReadFile(
-        Core::GetModelPathFromFile(fileName),
-        aiProcess_Triangulate           |
-        aiProcess_JoinIdenticalVertices |   // Remove unnecessary duplicate information
-        aiProcess_GenNormals            |   // Ensure normals are generated
-        aiProcess_CalcTangentSpace          // Needed for normal mapping
-    );
-
-    const VertexBufferDescription vertDesc = *vertAttr;
-
-    if (pScene)
-    {
-        using namespace DirectX;
-
-        // aiScenes may be composed of multiple submeshes,
-        // we want to coagulate this into a single vertex/index buffer
-        for (unsigned int i = 0; i != pScene->mNumMeshes; ++i)
-        {
-            const aiMesh* pMesh = pScene->mMeshes[i];
-            const aiVector3D c_Zero(0.0f, 0.0f, 0.0f);
-
-            const UINT numVertices = pMesh->mNumVertices;
-            BYTE* vertices = (BYTE*)malloc(vertDesc.ByteSize * numVertices);
-
-            const unsigned int numIndices = pMesh->mNumFaces * 3;
-            uint32_t* indices  = (uint32_t*)malloc(sizeof(uint32_t) * numIndices);
-
-            // Process Vertices for this mesh
-            for (unsigned int j = 0; j != pMesh->mNumVertices; ++j)
-            {
-                // Assign needed vertex attributes
-                for (unsigned int k = 0; k != vertDesc.AttrCount; ++k)
-                {
-                    const unsigned int currByteOffset = vertDesc.ByteOffsets[k];
-                    const unsigned int nextByteOffset = (k+1) != vertDesc.AttrCount ? vertDesc.ByteOffsets[k+1] : vertDesc.ByteSize;
-                    const unsigned int numComponents = (nextByteOffset - currByteOffset) / sizeof(float);
-                    BYTE* copyLocation = (vertices + j*vertDesc.ByteSize) + currByteOffset;
-
-                    switch (vertDesc.SemanticsArr[k])
-                    {
-                        case Semantics::POSITION:
-                            assert(pMesh->HasPositions());
-                            memcpy(copyLocation, &(pMesh->mVertices[j]), sizeof(float) * numComponents);
-                            break;
-                        case Semantics::NORMAL:
-                            assert(pMesh->HasNormals());
-                            memcpy(copyLocation, &(pMesh->mNormals[j]), sizeof(float) * numComponents);
-                            break;
-                        case Semantics::TEXCOORD:
-                            assert(pMesh->HasTextureCoords(0));
-                            memcpy(copyLocation, &(pMesh->mTextureCoords[0][j]), sizeof(float) * numComponents);
-                            break;
-                        case Semantics::TANGENT:
-                            assert(pMesh->HasTangentsAndBitangents());
-                            memcpy(copyLocation, &(pMesh->mTangents[j]), sizeof(float) * numComponents);
-                            break;
-                        case Semantics::BINORMAL:
-                            assert(pMesh->HasTangentsAndBitangents());
-                            memcpy(copyLocation, &(pMesh->mBitangents[j]), sizeof(float) * numComponents);
-                            break;
-                        case Semantics::COLOR: // Lacks testing
-                            assert(pMesh->HasVertexColors(0));
-                            memcpy(copyLocation, &(pMesh->mColors[0][j]), sizeof(float) * numComponents);
-                            break;
-                        #if defined(ESL_DEBUG)
-                        default:
-                            OutputDebugStringA("INFO: Unhandled Vertex Shader Input Semantic when parsing Mesh vertices\n");
-                        #endif
-                    }
-                }
-            }
-
-            // Process Indices next
-            for (unsigned int j = 0, ind = 0; j < pMesh->mNumFaces; ++j)
-            {
-                const aiFace& face = pMesh->mFaces[j];
-
-                #if defined(ESL_DEBUG)
-                    assert(face.mNumIndices == 3); // Sanity check
-                #endif
-
-                // All the indices of this face are valid, add to list
-                indices[ind++] = face.mIndices[0];
-                indices[ind++] = face.mIndices[1];
-                indices[ind++] = face.mIndices[2];
-            }
-            
-            Mesh tempMesh;
-
-            // Populate Mesh's DX objects
-            D3D11_BUFFER_DESC vbd;
-            vbd.Usage = D3D11_USAGE_IMMUTABLE;
-            vbd.ByteWidth = vertDesc.ByteSize * numVertices; // Number of vertices
-            vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-            vbd.CPUAccessFlags = 0;
-            vbd.MiscFlags = 0;
-            vbd.StructureByteStride = 0;
-            D3D11_SUBRESOURCE_DATA initialVertexData;
-            initialVertexData.pSysMem = vertices;
-            HRESULT hr = pDevice->CreateBuffer(&vbd, &initialVertexData, &tempMesh.VertexBuffer);
-
-            #if defined(ESL_DEBUG)
-                COM_EXCEPT(hr);
-            #endif
-
-            D3D11_BUFFER_DESC ibd;
-            ibd.Usage = D3D11_USAGE_IMMUTABLE;
-            ibd.ByteWidth = sizeof(unsigned int) * numIndices; // Number of vertices
-            ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-            ibd.CPUAccessFlags = 0;
-            ibd.MiscFlags = 0;
-            ibd.StructureByteStride = 0;
-            D3D11_SUBRESOURCE_DATA initialIndexData;
-            initialIndexData.pSysMem = indices;
-            hr = pDevice->CreateBuffer(&ibd, &initialIndexData, &tempMesh.IndexBuffer);
-            tempMesh.IndexCount = numIndices;
-            tempMesh.Stride = vertAttr->ByteSize;
-
-            #if defined(ESL_DEBUG)
-                COM_EXCEPT(hr);
-            #endif
-
-            *out_mesh = tempMesh;
-
-            free(vertices);
-            free(indices);
-        }
-    }
-    #if defined(ESL_DEBUG)
-    else
+    // Either straight from the cooked blob, or through Assimp on a cold cache
+    Assets::CookedMesh cooked;
+    std::string importError;
+    if (!Assets::MeshImporter::ImportCached(Core::GetModelPathFromFile(fileName), *vertAttr, &cooked, &importError))
     {
+        #if defined(ESL_DEBUG)
         char buf[256];
-        sprintf_s(buf, "Error parsing '%s': '%s'\n", fileName, Importer.GetErrorString());
+        sprintf_s(buf, "Error parsing '%s': '%s'\n", fileName, importError.c_str());
         throw std::exception(buf);
+        #endif
         return 0;
     }
-    
+
+    // Headless, the bounds and counts are all anyone looks at
+    if (!pDevice)
+    {
+        Mesh headlessMesh = {};
+        headlessMesh.IndexCount = (UINT)cooked.Indices.size();
+        headlessMesh.VertexCount = (UINT)(cooked.Vertices.size() / cooked.Stride);
+        headlessMesh.Stride = cooked.Stride;
+        headlessMesh.Bounds = cooked.Bounds;
+        *out_mesh = headlessMesh;
+        return meshId;
+    }
+
+    HRESULT hr = UploadMesh(cooked, pDevice, out_mesh);
+    COM_EXCEPT(hr);
+
+    #if defined(ESL_DEBUG)
     const char vbDebug[] = "_VertexBuffer";
     const char ibDebug[] = "_IndexBuffer";
     char vbName[64];
@@ -177,7 +80,7 @@ MeshID MeshFactory::CreateMesh(const char* fileName, const VertexBufferDescripti
     strcat_s(vbName, "\0");
     strcat_s(ibName, "\0");
     
-    HRESULT hr = out_mesh->VertexBuffer->SetPrivateData(WKPDID_D3DDebugObjectName, strlen(vbName), vbName);
+    hr = out_mesh->VertexBuffer->SetPrivateData(WKPDID_D3DDebugObjectName, strlen(vbName), vbName);
     COM_EXCEPT(hr);
     hr = out_mesh->IndexBuffer->SetPrivateData(WKPDID_D3DDebugObjectName, strlen(ibName), ibName);
     COM_EXCEPT(hr);
@@ -185,6 +88,49 @@ MeshID MeshFactory::CreateMesh(const char* fileName, const VertexBufferDescripti
     return meshId;
 }
 
+HRESULT MeshFactory::UploadMesh(const Assets::CookedMesh& cooked, ID3D11Device* pDevice, Mesh* out_mesh)
+{
+    Mesh tempMesh = {};
+
+    // Populate Mesh's DX objects
+    D3D11_BUFFER_DESC vbd;
+    vbd.Usage = D3D11_USAGE_IMMUTABLE;
+    vbd.ByteWidth = (UINT)cooked.Vertices.size();
+    vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    vbd.CPUAccessFlags = 0;
+    vbd.MiscFlags = 0;
+    vbd.StructureByteStride = 0;
+    D3D11_SUBRESOURCE_DATA initialVertexData = {};
+    initialVertexData.pSysMem = cooked.Vertices.data();
+    HRESULT hr = pDevice->CreateBuffer(&vbd, &initialVertexData, &tempMesh.VertexBuffer);
+    if (FAILED(hr))
+        return hr;
+
+    D3D11_BUFFER_DESC ibd;
+    ibd.Usage = D3D11_USAGE_IMMUTABLE;
+    ibd.ByteWidth = (UINT)(sizeof(uint32_t) * cooked.Indices.size());
+    ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    ibd.CPUAccessFlags = 0;
+    ibd.MiscFlags = 0;
+    ibd.StructureByteStride = 0;
+    D3D11_SUBRESOURCE_DATA initialIndexData = {};
+    initialIndexData.pSysMem = cooked.Indices.data();
+    hr = pDevice->CreateBuffer(&ibd, &initialIndexData, &tempMesh.IndexBuffer);
+    if (FAILED(hr))
+    {
+        tempMesh.VertexBuffer->Release();
+        return hr;
+    }
+
+    tempMesh.IndexCount = (UINT)cooked.Indices.size();
+    tempMesh.VertexCount = (UINT)(cooked.Vertices.size() / cooked.Stride);
+    tempMesh.Stride = cooked.Stride;
+    tempMesh.Bounds = cooked.Bounds;
+
+    *out_mesh = tempMesh;
+    return S_OK;
+}
+
 void ShaderFactory::LoadAllShaders(ID3D11Device* device, ResourceCodex& codex)
 {
     namespace fs = std::filesystem;
@@ -198,19 +144,36 @@ void ShaderFactory::LoadAllShaders(ID3D11Device* device, ResourceCodex& codex)
     // Iterate through folder and load shaders
     for (const auto& entry : fs::directory_iterator(shaderPath))
     {
+        // The reflection cache sits next to the bytecode
+        if (entry.path().extension() != L".cso")
+            continue;
+
         std::wstring path = entry.path();
         std::wstring name = entry.path().filename();
 
         ShaderID hash = fnv1a(name.c_str());
 
+        #if defined(ESL_DEBUG)
+        RegisterResourceName(ResourceKind::SHADER, hash, entry.path().filename().u8string());
+        #endif
+
+        // Variants are loaded like any other shader, and also filed under their family and key
+        std::wstring_view family;
+        PermutationKey key = 0;
+        const bool isVariant = ShaderPermutations::ParseVariantName(name, &family, &key);
+
         // Parse file name to decide how to create this resource
         if (name.find(L"VS") != std::wstring::npos)
         {
-            codex.AddVertexShader(hash, path.c_str(), device);
+            const VertexShaderHandle handle = codex.AddVertexShader(hash, path.c_str(), device);
+            if (isVariant)
+                codex.mVertexShaderVariants.Insert(fnv1a(family), key, handle);
         }
         else if (name.find(L"PS") != std::wstring::npos)
         {
-            codex.AddPixelShader(hash, path.c_str(), device);
+            const PixelShaderHandle handle = codex.AddPixelShader(hash, path.c_str(), device);
+            if (isVariant)
+                codex.mPixelShaderVariants.Insert(fnv1a(family), key, handle);
         }
     }
 }
@@ -239,13 +202,24 @@ void ShaderFactory::CreateVertexShader(const wchar_t* path, VertexShader* out_sh
         COM_EXCEPT(hr);
     #endif
 
-    // Use the Blob to create a shader reflection
-    ID3D11ShaderReflection* pReflection = nullptr;
-    hr = D3DReflect(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), IID_ID3D11ShaderReflection, reinterpret_cast<void**>(&pReflection));
-    COM_EXCEPT(hr);
+    // The Shaders project writes the reflection next to the .cso. Without an up to date one, reflect now and save it for next time.
+    ShaderReflection reflection;
+    const std::string reflectionPath = ShaderReflector::GetReflectionPath(std::filesystem::path(path).string());
+    const uint64_t bytecodeHash = fnv1a_64(pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+    if (!ShaderReflector::Load(reflectionPath, bytecodeHash, &reflection))
+    {
+        #if defined(ESL_DEBUG)
+        OutputDebugStringA(("Reflecting " + reflectionPath + " at startup, it was missing or stale\n").c_str());
+        #endif
+
+        const bool reflected = ShaderReflector::Reflect(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), &reflection);
+        assert(reflected && "Vertex shader has an input semantic Easel doesn't know");
+        if (reflected)
+            ShaderReflector::Save(reflectionPath, reflection);
+    }
 
     // Use reflecion to build an input layout, finalizing vertex shader populate.
-    BuildInputLayout(pReflection, pBlob, out_shader, device);
+    BuildInputLayout(reflection, pBlob, out_shader, device);
 }
 
 void ShaderFactory::CreatePixelShader(const wchar_t* path, PixelShader* out_shader, ID3D11Device* device)
@@ -284,107 +258,65 @@ void ShaderFactory::CreatePixelShader(const wchar_t* path, PixelShader* out_shad
     COM_EXCEPT(hr);
 }
 
-const char* kSemanticNames[] = 
+// ShaderReflection.h spells these out without the D3D headers
+static_assert((UINT)InputFormat::R32G32B32A32_FLOAT == DXGI_FORMAT_R32G32B32A32_FLOAT && (UINT)InputFormat::R32G32B32A32_UINT == DXGI_FORMAT_R32G32B32A32_UINT &&
+              (UINT)InputFormat::R32G32B32A32_SINT == DXGI_FORMAT_R32G32B32A32_SINT && (UINT)InputFormat::R32G32B32_FLOAT == DXGI_FORMAT_R32G32B32_FLOAT &&
+              (UINT)InputFormat::R32G32B32_UINT == DXGI_FORMAT_R32G32B32_UINT && (UINT)InputFormat::R32G32B32_SINT == DXGI_FORMAT_R32G32B32_SINT &&
+              (UINT)InputFormat::R32G32_FLOAT == DXGI_FORMAT_R32G32_FLOAT && (UINT)InputFormat::R32G32_UINT == DXGI_FORMAT_R32G32_UINT &&
+              (UINT)InputFormat::R32G32_SINT == DXGI_FORMAT_R32G32_SINT && (UINT)InputFormat::R32_FLOAT == DXGI_FORMAT_R32_FLOAT &&
+              (UINT)InputFormat::R32_UINT == DXGI_FORMAT_R32_UINT && (UINT)InputFormat::R32_SINT == DXGI_FORMAT_R32_SINT,
+              "InputFormat no longer matches DXGI_FORMAT");
+static_assert((UINT)ComponentType::UINT32 == D3D_REGISTER_COMPONENT_UINT32 && (UINT)ComponentType::SINT32 == D3D_REGISTER_COMPONENT_SINT32 &&
+              (UINT)ComponentType::FLOAT32 == D3D_REGISTER_COMPONENT_FLOAT32, "ComponentType no longer matches D3D_REGISTER_COMPONENT_TYPE");
+
+void ShaderFactory::BuildInputLayout(const ShaderReflection& reflection, ID3D10Blob* pBlob, VertexShader* out_shader, ID3D11Device* device)
 {
-    "POSITION",
-    "NORMAL",
-    "TEXCOORD",
-    "TANGENT",
-    "BINORMAL",
-    "COLOR",
-    "BLENDINDICES",
-    "BLENDWEIGHTS",
-    "WORLDMATRIX"
-};
-
-const char* kInstancedSemanticNames[] = 
-{
-    "INSTANCE_POSITION",
-    "INSTANCE_NORMAL",
-    "INSTANCE_TEXCOORD,",
-    "INSTANCE_TANGENT",
-    "INSTANCE_BINORMAL",
-    "INSTANCE_COLOR",
-    "INSTANCE_BLENDINDICES",
-    "INSTANCE_BLENDWEIGHTS",
-    "INSTANCE_WORLDMATRIX"
-};
-
-void ShaderFactory::BuildInputLayout(ID3D11ShaderReflection* pReflection, ID3D10Blob* pBlob, VertexShader* out_shader, ID3D11Device* device)
-{
-    // Get a shader description
-    D3D11_SHADER_DESC shaderDesc;
-    pReflection->GetDesc(&shaderDesc);
-    const UINT numInputs = shaderDesc.InputParameters;
-
-    Semantics* tempSemanticsArr = (Semantics*)malloc(sizeof(semantic_t) * numInputs);
-    D3D11_SIGNATURE_PARAMETER_DESC* paramDescs = (D3D11_SIGNATURE_PARAMETER_DESC*)malloc(sizeof(D3D11_SIGNATURE_PARAMETER_DESC) * numInputs);
-
-    // Instance fields false by default
-    out_shader->Instanced = false;
-    ZeroMemory(&out_shader->InstanceDesc, sizeof(VertexBufferDescription));
+    const UINT numInputs = (UINT)reflection.Inputs.size();
+    const UINT numVertexInputs = reflection.InstanceStart;
 
-    uint8_t numInstanceInputs = 0;
-    uint8_t instanceStartIdx = UINT8_MAX;
+    // The semantics and byte offsets are kept by the shader and freed with it, the rest is scratch
+    Core::ScopedScratch scratch;
+    Semantics* semanticsArr = (Semantics*)malloc(sizeof(semantic_t) * numInputs);
+    uint16_t* byteOffsets = (uint16_t*)malloc(sizeof(uint16_t) * numInputs);
+    D3D11_INPUT_ELEMENT_DESC* allInputParams = scratch.AllocateArray<D3D11_INPUT_ELEMENT_DESC>(numInputs);
 
-    // Always start with regular vertex semantics
-    const char** comparisonArray = kSemanticNames;
-
-    // First, build semantics enum array from the strings gotten from the reflection
-    // If any of the strings are marked as being for instancing, then split off into initialization of two vertex buffers
-    for (uint8_t i = 0; i != numInputs; ++i)
+    // Formats and offsets were worked out when the shader was reflected, this only copies them over
+    for (UINT i = 0; i != numInputs; ++i)
     {
-        pReflection->GetInputParameterDesc(i, &paramDescs[i]);
+        const ReflectedInput& input = reflection.Inputs[i];
+        semanticsArr[i] = input.Semantic;
+        byteOffsets[i] = input.ByteOffset;
 
-        // determine semantic and assign easy enum ID
-        for (semantic_t s = 0; s != (semantic_t)Semantics::COUNT; ++s)
-        {
-            if (!strcmp(paramDescs[i].SemanticName, comparisonArray[s]))
-            {
-                tempSemanticsArr[i] = (Semantics)s;
-                break;
-            }
-            else if (numInstanceInputs == 0 && strstr(paramDescs[i].SemanticName, "INSTANCE_")) // Look for the instanced prefix set in HLSL
-            {
-                out_shader->Instanced = true; // Now we know this is an instanced shader
-                numInstanceInputs = numInputs - i;
-                instanceStartIdx = i--; // decrement i so we scan this semanticName again
-                comparisonArray = kInstancedSemanticNames; // By convention: we are done with regular vertex attributes, switch to comparing with the instanced versions
-                break;
-            }
-        }
+        D3D11_INPUT_ELEMENT_DESC inputParam = {};
+        inputParam.SemanticName = input.SemanticName;
+        inputParam.SemanticIndex = input.SemanticIndex;
+        inputParam.Format = (DXGI_FORMAT)input.Format;
+        inputParam.AlignedByteOffset = input.ByteOffset;
+        inputParam.InputSlotClass = input.PerInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+        inputParam.InputSlot = input.PerInstance ? 1 : 0;
+        inputParam.InstanceDataStepRate = input.PerInstance ? 1 : 0;
+        allInputParams[i] = inputParam;
     }
 
-    // Now the temp array has all the semantics properly labeled. Use it to create the vertex buffer and the instance buffer(if applicable)
+    // Both descriptions share the two allocations, the instance one starting where the vertex one ends
     VertexBufferDescription vbDesc;
+    vbDesc.SemanticsArr = semanticsArr;
+    vbDesc.ByteOffsets = byteOffsets;
+    vbDesc.AttrCount = (uint16_t)numVertexInputs;
+    vbDesc.ByteSize = reflection.VertexByteSize;
+    out_shader->VertexDesc = vbDesc;
 
-    D3D11_INPUT_ELEMENT_DESC* allInputParams = (D3D11_INPUT_ELEMENT_DESC*)malloc(sizeof(D3D11_INPUT_ELEMENT_DESC) * numInputs);
-    if (numInstanceInputs) // Also need to create an instance buffer layout
+    out_shader->Instanced = reflection.IsInstanced();
+    ZeroMemory(&out_shader->InstanceDesc, sizeof(VertexBufferDescription));
+    if (out_shader->Instanced)
     {
-        // Regular vertex buffer
-        UINT numVertexInputs = numInputs - numInstanceInputs;
-        vbDesc.ByteOffsets = (uint16_t*)malloc(sizeof(uint16_t) * numInputs);
-        AssignDXGIFormatsAndByteOffsets(D3D11_INPUT_PER_VERTEX_DATA, &paramDescs[0], numVertexInputs, &allInputParams[0], vbDesc.ByteOffsets, &vbDesc.ByteSize);
-        vbDesc.SemanticsArr = tempSemanticsArr;
-        vbDesc.AttrCount = numVertexInputs;
-        out_shader->VertexDesc = vbDesc;
-        
-        // Instance buffer
         VertexBufferDescription instDesc;
-        instDesc.ByteOffsets = &vbDesc.ByteOffsets[instanceStartIdx];
-        AssignDXGIFormatsAndByteOffsets(D3D11_INPUT_PER_INSTANCE_DATA, &paramDescs[instanceStartIdx], numInstanceInputs, &allInputParams[instanceStartIdx], instDesc.ByteOffsets, &instDesc.ByteSize);
-        instDesc.SemanticsArr = &tempSemanticsArr[instanceStartIdx];
-        instDesc.AttrCount = numInstanceInputs;
+        instDesc.SemanticsArr = &semanticsArr[numVertexInputs];
+        instDesc.ByteOffsets = &byteOffsets[numVertexInputs];
+        instDesc.AttrCount = (uint16_t)(numInputs - numVertexInputs);
+        instDesc.ByteSize = reflection.InstanceByteSize;
         out_shader->InstanceDesc = instDesc;
     }
-    else // Just regular vertex buffer
-    {
-        vbDesc.ByteOffsets = (uint16_t*)malloc(sizeof(uint16_t) * numInputs);
-        AssignDXGIFormatsAndByteOffsets(D3D11_INPUT_PER_VERTEX_DATA, paramDescs, numInputs, allInputParams, vbDesc.ByteOffsets, &vbDesc.ByteSize);
-        vbDesc.SemanticsArr = tempSemanticsArr;
-        vbDesc.AttrCount = numInputs;
-        out_shader->VertexDesc = vbDesc;
-    }
 
     // Finally, try to create the input layout
     HRESULT hr = device->CreateInputLayout(&allInputParams[0], numInputs, pBlob->GetBufferPointer(), pBlob->GetBufferSize(), &out_shader->InputLayout);
@@ -395,77 +327,10 @@ void ShaderFactory::BuildInputLayout(ID3D11ShaderReflection* pReflection, ID3D10
     hr = out_shader->InputLayout->SetPrivateData(WKPDID_D3DDebugObjectName, ARRAYSIZE(debugNameIL) - 1, debugNameIL);
     COM_EXCEPT(hr);
     #endif
-
-    // Cleanup mallocs
-    free(allInputParams);
-    free(paramDescs);
-}
-
-void ShaderFactory::AssignDXGIFormatsAndByteOffsets(D3D11_INPUT_CLASSIFICATION slotClass, D3D11_SIGNATURE_PARAMETER_DESC* paramDescs, UINT numInputs, D3D11_INPUT_ELEMENT_DESC* out_inputParams, uint16_t* out_byteOffsets, uint16_t* out_byteSize)
-{
-    uint16_t totalByteSize = 0;
-    for (uint8_t i = 0; i != numInputs; ++i)
-    {
-        D3D11_SIGNATURE_PARAMETER_DESC paramDesc = paramDescs[i];
-
-        D3D11_INPUT_ELEMENT_DESC inputParam = {};
-        inputParam.SemanticName = paramDesc.SemanticName;
-        inputParam.SemanticIndex = paramDesc.SemanticIndex;
-        inputParam.InputSlotClass = slotClass;
-
-        if(slotClass == D3D11_INPUT_PER_VERTEX_DATA)
-        {
-            inputParam.InputSlot = 0;
-            inputParam.InstanceDataStepRate = 0;
-        }
-        else // per instance data
-        {
-            inputParam.InputSlot = 1;
-            inputParam.InstanceDataStepRate = 1;
-        }
-
-        out_byteOffsets[i] = totalByteSize;
-        inputParam.AlignedByteOffset = totalByteSize;
-
-        // determine DXGI format ... Thanks MSDN!
-        if ( paramDesc.Mask == 1 ) // R
-        {
-            totalByteSize += 4;
-            if      ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_UINT32  )   inputParam.Format = DXGI_FORMAT_R32_UINT;
-            else if ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_SINT32  )   inputParam.Format = DXGI_FORMAT_R32_SINT;
-            else if ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32 )   inputParam.Format = DXGI_FORMAT_R32_FLOAT;
-        }
-        else if ( paramDesc.Mask <= 3 ) // RG
-        {
-            totalByteSize += 8;
-            if      ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_UINT32  )   inputParam.Format = DXGI_FORMAT_R32G32_UINT;
-            else if ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_SINT32  )   inputParam.Format = DXGI_FORMAT_R32G32_SINT;
-            else if ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32 )   inputParam.Format = DXGI_FORMAT_R32G32_FLOAT;
-        }
-        else if ( paramDesc.Mask <= 7 ) // RGB
-        {
-            totalByteSize += 12;
-            if      ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_UINT32  )   inputParam.Format = DXGI_FORMAT_R32G32B32_UINT;
-            else if ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_SINT32  )   inputParam.Format = DXGI_FORMAT_R32G32B32_SINT;
-            else if ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32 )   inputParam.Format = DXGI_FORMAT_R32G32B32_FLOAT;
-        }
-        else if ( paramDesc.Mask <= 15 ) // RGBA
-        {
-            totalByteSize += 16;
-            if      ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_UINT32  )   inputParam.Format = DXGI_FORMAT_R32G32B32A32_UINT;
-            else if ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_SINT32  )   inputParam.Format = DXGI_FORMAT_R32G32B32A32_SINT;
-            else if ( paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32 )   inputParam.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-        }
-
-
-        out_inputParams[i] = inputParam;
-    }
-
-    *out_byteSize = totalByteSize;
 }
 
 // Loads all the textures from the directory and returns them as out params to the ResourceCodex
-void TextureFactory::LoadAllTextures(ID3D11Device* device, ID3D11DeviceContext* context, ResourceCodex& codex)
+void TextureFactory::LoadAllTextures(ID3D11Device* device, ResourceCodex& codex, Core::WorkerPool* pPool)
 {
     namespace fs = std::filesystem;
     std::string texturePath = TEXTUREPATH;
@@ -474,8 +339,11 @@ void TextureFactory::LoadAllTextures(ID3D11Device* device, ID3D11DeviceContext*
     if(!fs::exists(texturePath))
         throw std::exception("Textures folder doesn't exist!");
     #endif
-    
-    std::unordered_map<TextureID, ResourceBindChord> tempTexMap;
+
+    std::vector<uint8_t> pixels;
+
+    // Decoded mip chains wait here until every file has been seen, so they can be packed into arrays
+    std::vector<PendingTexture> pending;
 
     // Iterate through folder and initialize materials
     for (const auto& entry : fs::directory_iterator(texturePath))
@@ -483,71 +351,55 @@ void TextureFactory::LoadAllTextures(ID3D11Device* device, ID3D11DeviceContext*
         std::wstring path = entry.path().c_str();
         std::wstring name = entry.path().filename().c_str();
 
-        ID3D11ShaderResourceView* pSRV;
+        ID3D11ShaderResourceView* pSRV = nullptr;
 
-        // Parse file name to decide how to create this resource
-        size_t pos = name.find(L'_');
-        const std::wstring TexName = name.substr(0, pos++);
-        const std::wstring TexType = name.substr(pos, 1);
-        
-        // Parse file extension
-        pos = name.find(L'.') + 1;
-        const std::wstring TexExt  = name.substr(pos);
+        // Classify before paying for the decode
+        TextureID tid;
+        UINT slot;
+        bool isDDS;
+        if (!ClassifyTextureFile(name, &tid, &slot, &isDDS))
+        {
+            #if defined(ESL_DEBUG)
+                std::wstring debugMsg = L"INFO: Skipped a texture with an unrecognized type: ";
+                debugMsg.append(name.c_str());
+                OutputDebugStringW(debugMsg.append(L"\n").c_str());
+            #endif
+            continue;
+        }
         
         HRESULT hr = E_FAIL;
 
-        ID3D11Resource* dummy = nullptr;
-
         // Special Case: DDS Files (Cube maps with no mipmaps)
-        if (TexExt == L"dds")
+        if (isDDS)
         {
+            ID3D11Resource* dummy = nullptr;
             hr = DirectX::CreateDDSTextureFromFile(
                 device,
                 path.c_str(),
                 &dummy,
                 &pSRV);
+
+            // Clean up Texture2D
+            if (dummy)
+                dummy->Release();
         } 
-        else // For most textures, use WIC with mipmaps
+        else // For most textures, decode with WIC and build the mip chain on the CPU
         {
-            hr = DirectX::CreateWICTextureFromFile(
-                device, context,    // Passing in the context auto generates mipmaps
-                path.c_str(),
-                &dummy,
-                &pSRV);
-            
+            PendingTexture pt;
+            pt.ID   = tid;
+            pt.Slot = slot;
+            pt.Name = name;
+            pt.Path = path;
+
+            hr = LoadMipChainCached(path, GetMipGenDesc(slot), &pixels, &pt.Chain, pPool);
+            if (SUCCEEDED(hr))
+                pending.push_back(std::move(pt));
+
+            assert(!FAILED(hr));
+            continue;
         }
-        // Clean up Texture2D
-        dummy->Release();
         assert(!FAILED(hr));
 
-        // Classify based on Letter following '_'
-        UINT slot;
-        switch (TexType[0]) // This is the character that precedes the underscore in the naming convention
-        {
-            case 'N': // This is a normal map
-                slot = (UINT)TextureSlots::NORMAL;
-                break;
-            case 'T': // This is a texture
-                slot = (UINT)TextureSlots::DIFFUSE;
-                break;
-            case 'R': // Roughness map
-                slot = (UINT)TextureSlots::ROUGHNESS;
-                break;
-            case 'C': // Cube map
-                slot = (UINT)TextureSlots::CUBE;
-                break;
-            default:
-                #if defined(ESL_DEBUG)
-                    std::wstring debugMsg = L"INFO: Attempted to load a texture with an unrecognized type: ";
-                    debugMsg.append(name.c_str());
-                    OutputDebugStringW(debugMsg.append(L"\n").c_str());
-                #endif
-
-                pSRV->Release(); // The SRV is still created, so it must be released
-                pSRV = nullptr;
-                continue;
-        }
-
         #if defined(ESL_DEBUG)
         if (pSRV)
         {
@@ -559,87 +411,602 @@ void TextureFactory::LoadAllTextures(ID3D11Device* device, ID3D11DeviceContext*
         }
         #endif
 
-        TextureID tid = fnv1a(TexName.c_str());
+        codex.SetTextureSource(tid, slot, path, isDDS);
         codex.InsertTexture(tid, slot, pSRV);
     }
+
+    CreatePackedTextures(device, pending, codex);
+}
+
+bool TextureFactory::ClassifyTextureFile(const std::wstring& fileName, TextureID* out_id, UINT* out_slot, bool* out_isDDS)
+{
+    // Naming convention is <Name>_<Type>.<ext>
+    size_t pos = fileName.find(L'_');
+    if (pos == std::wstring::npos || pos + 1 >= fileName.size())
+        return false;
+
+    const std::wstring TexName = fileName.substr(0, pos++);
+    const wchar_t TexType = fileName[pos];
+    
+    // Parse file extension
+    pos = fileName.find(L'.');
+    if (pos == std::wstring::npos)
+        return false;
+    const std::wstring TexExt = fileName.substr(pos + 1);
+
+    switch (TexType) // This is the character that follows the underscore in the naming convention
+    {
+        case 'N': // This is a normal map
+            *out_slot = (UINT)TextureSlots::NORMAL;
+            break;
+        case 'T': // This is a texture
+            *out_slot = (UINT)TextureSlots::DIFFUSE;
+            break;
+        case 'R': // Roughness map
+            *out_slot = (UINT)TextureSlots::ROUGHNESS;
+            break;
+        case 'C': // Cube map
+            *out_slot = (UINT)TextureSlots::CUBE;
+            break;
+        default:
+            return false;
+    }
+
+    *out_id = fnv1a(TexName.c_str());
+    *out_isDDS = TexExt == L"dds";
+
+    #if defined(ESL_DEBUG)
+    RegisterResourceName(ResourceKind::TEXTURE, *out_id, std::filesystem::path(TexName).u8string());
+    #endif
+    return true;
+}
+
+Assets::MipGenDesc TextureFactory::GetMipGenDesc(UINT slot)
+{
+    Assets::MipGenDesc mipDesc;
+    mipDesc.Filter = Assets::MipFilter::KAISER;
+    mipDesc.Flags  = Assets::MF_WRAP; // Everything is sampled with WRAP addressing
+
+    if (slot == (UINT)TextureSlots::NORMAL)
+        mipDesc.Flags |= Assets::MF_NORMAL_MAP;
+    else if (slot == (UINT)TextureSlots::DIFFUSE)
+        mipDesc.Flags |= Assets::MF_SRGB;
+
+    return mipDesc;
+}
+
+// Groups same-size textures into Texture2DArrays (one array per slot, same slice for every slot of a set).
+// Anything that doesn't share a signature with another set gets its own texture like before.
+void TextureFactory::CreatePackedTextures(ID3D11Device* device, const std::vector<PendingTexture>& pending, ResourceCodex& codex)
+{
+    using namespace Assets;
+
+    // Stored as UNORM like before: the chains are filtered in linear space but encoded the same way as the source
+    const DXGI_FORMAT kFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+
+    // Collapse the individual files into sets keyed by name
+    std::vector<TextureSetDesc> sets;
+    std::vector<std::array<const PendingTexture*, kMaxPackSlots>> setMembers;
+    for (const PendingTexture& pt : pending)
+    {
+        uint32_t setIdx = 0;
+        while (setIdx != sets.size() && sets[setIdx].ID != pt.ID)
+            ++setIdx;
+
+        if (setIdx == sets.size())
+        {
+            TextureSetDesc desc = {};
+            desc.ID = pt.ID;
+            sets.push_back(desc);
+            setMembers.emplace_back();
+            setMembers.back().fill(nullptr);
+        }
+
+        TextureSignature& sig = sets[setIdx].Slots[pt.Slot];
+        sig.Width     = pt.Chain.Levels[0].Width;
+        sig.Height    = pt.Chain.Levels[0].Height;
+        sig.Format    = (uint32_t)kFormat;
+        sig.MipLevels = (uint32_t)pt.Chain.Levels.size();
+        sets[setIdx].SlotMask |= 1u << pt.Slot;
+        setMembers[setIdx][pt.Slot] = &pt;
+    }
+
+    PackResult packing;
+    TexturePacker::PackArrays(sets, D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION, &packing);
+
+    // One array per occupied slot of every bank
+    for (uint32_t bankIdx = 0; bankIdx != packing.Banks.size(); ++bankIdx)
+    {
+        const TextureBank& bank = packing.Banks[bankIdx];
+        ResourceBindChord chord = {};
+
+        for (UINT slot = 0; slot != (UINT)TextureSlots::COUNT; ++slot)
+        {
+            if (!(bank.SlotMask & (1u << slot)))
+                continue;
+
+            std::vector<const MipChain*> slices;
+            for (uint32_t setIdx : bank.Members)
+                slices.push_back(&setMembers[setIdx][slot]->Chain);
+
+            HRESULT hr = CreateTextureArrayFromMipChains(device, slices, kFormat, &chord.SRVs[slot]);
+            COM_EXCEPT(hr);
+
+            #if defined(ESL_DEBUG)
+            char bankDebugName[32];
+            sprintf_s(bankDebugName, "TextureBank%u_Slot%u", bankIdx, slot);
+            hr = chord.SRVs[slot]->SetPrivateData(WKPDID_D3DDebugObjectName, (UINT)strlen(bankDebugName), bankDebugName);
+            COM_EXCEPT(hr);
+            #endif
+        }
+
+        const TextureHandle codexBank = codex.InsertTextureBank(chord);
+        for (uint32_t setIdx : bank.Members)
+            codex.InsertTextureSlice(sets[setIdx].ID, codexBank, packing.Placements[setIdx].Slice);
+    }
+
+    // Standalone leftovers
+    for (uint32_t setIdx = 0; setIdx != sets.size(); ++setIdx)
+    {
+        if (packing.Placements[setIdx].Bank != kInvalidBank)
+            continue;
+
+        for (const PendingTexture* pt : setMembers[setIdx])
+        {
+            if (!pt)
+                continue;
+
+            ID3D11ShaderResourceView* pSRV = nullptr;
+            HRESULT hr = CreateTextureFromMipChain(device, pt->Chain, kFormat, &pSRV);
+            COM_EXCEPT(hr);
+
+            #if defined(ESL_DEBUG)
+            size_t byteSize;
+            char texDebugName[64];
+            wcstombs_s(&byteSize, texDebugName, pt->Name.c_str(), pt->Name.size());
+            hr = pSRV->SetPrivateData(WKPDID_D3DDebugObjectName, (UINT)byteSize, texDebugName);
+            COM_EXCEPT(hr);
+            #endif
+
+            codex.SetTextureSource(pt->ID, pt->Slot, pt->Path, false);
+            codex.InsertTexture(pt->ID, pt->Slot, pSRV);
+        }
+    }
+}
+
+HRESULT TextureFactory::LoadMipChainCached(const std::wstring& path, const Assets::MipGenDesc& mipDesc, std::vector<uint8_t>* scratchPixels, Assets::MipChain* out_chain, Core::WorkerPool* pPool)
+{
+    Assets::AssetCache& cache = Assets::AssetCache::GetSingleton();
+
+    // Key covers the file bytes, the decoder + mip generator versions and the mip settings
+    uint64_t sourceHash = 0;
+    const bool canCache = cache.IsEnabled() && cache.GetSourceHash(std::filesystem::path(path).string(), &sourceHash);
+
+    std::vector<uint8_t> settings;
+    Assets::BlobWriter writer(&settings);
+    writer.Write(kTextureImporterVersion);
+    writer.Write(mipDesc.Filter);
+    writer.Write(mipDesc.Flags);
+    writer.Write(mipDesc.MaxLevels);
+    const Assets::AssetKey key = Assets::AssetCache::MakeKey(sourceHash, Assets::MipGenerator::kVersion, settings.data(), settings.size());
+
+    std::vector<uint8_t> blob;
+    if (canCache && cache.Load(key, &blob) && Assets::MipGenerator::Deserialize(blob.data(), blob.size(), out_chain))
+        return S_OK;
+
+    UINT width, height;
+    HRESULT hr = DecodeWICToRGBA(path.c_str(), scratchPixels, &width, &height);
+    if (FAILED(hr))
+        return hr;
+
+    if (!Assets::MipGenerator::GenerateChain(scratchPixels->data(), width, height, mipDesc, out_chain, pPool))
+        return E_FAIL;
+
+    if (canCache)
+    {
+        blob.clear();
+        Assets::MipGenerator::Serialize(*out_chain, &blob);
+        cache.Store(key, blob.data(), blob.size());
+    }
+
+    return S_OK;
+}
+
+bool TextureFactory::LoadTextureSetMipChains(TextureID textureSet, Assets::MipChain out_chains[(UINT)TextureSlots::COUNT], Core::WorkerPool* pPool)
+{
+    namespace fs = std::filesystem;
+
+    std::vector<uint8_t> pixels;
+    bool found = false;
+    for (const auto& entry : fs::directory_iterator(TEXTUREPATH))
+    {
+        TextureID tid;
+        UINT slot;
+        bool isDDS;
+        if (!ClassifyTextureFile(entry.path().filename().c_str(), &tid, &slot, &isDDS) || tid != textureSet || isDDS)
+            continue;
+
+        HRESULT hr = LoadMipChainCached(entry.path().c_str(), GetMipGenDesc(slot), &pixels, &out_chains[slot], pPool);
+        assert(!FAILED(hr));
+        found |= SUCCEEDED(hr);
+    }
+    return found;
+}
+
+HRESULT TextureFactory::DecodeWICToRGBA(const wchar_t* path, std::vector<uint8_t>* out_pixels, UINT* out_width, UINT* out_height)
+{
+    IWICImagingFactory*    pFactory   = nullptr;
+    IWICBitmapDecoder*     pDecoder   = nullptr;
+    IWICBitmapFrameDecode* pFrame     = nullptr;
+    IWICFormatConverter*   pConverter = nullptr;
+
+    HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pFactory));
+
+    if (SUCCEEDED(hr))
+        hr = pFactory->CreateDecoderFromFilename(path, nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &pDecoder);
+
+    if (SUCCEEDED(hr))
+        hr = pDecoder->GetFrame(0, &pFrame);
+
+    if (SUCCEEDED(hr))
+        hr = pFactory->CreateFormatConverter(&pConverter);
+
+    // Convert whatever the source is (RGB JPGs, paletted PNGs...) to plain RGBA8
+    if (SUCCEEDED(hr))
+        hr = pConverter->Initialize(pFrame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+
+    if (SUCCEEDED(hr))
+        hr = pConverter->GetSize(out_width, out_height);
+
+    if (SUCCEEDED(hr))
+    {
+        const UINT rowPitch = *out_width * 4;
+        out_pixels->resize((size_t)rowPitch * *out_height);
+        hr = pConverter->CopyPixels(nullptr, rowPitch, (UINT)out_pixels->size(), out_pixels->data());
+    }
+
+    if (pConverter) pConverter->Release();
+    if (pFrame)     pFrame->Release();
+    if (pDecoder)   pDecoder->Release();
+    if (pFactory)   pFactory->Release();
+
+    return hr;
+}
+
+HRESULT TextureFactory::CreateTextureFromFile(ID3D11Device* device, const std::wstring& path, UINT slot, bool isDDS, ID3D11ShaderResourceView** out_srv, Core::WorkerPool* pPool)
+{
+    if (isDDS)
+    {
+        ID3D11Resource* dummy = nullptr;
+        HRESULT hr = DirectX::CreateDDSTextureFromFile(device, path.c_str(), &dummy, out_srv);
+        if (dummy)
+            dummy->Release();
+        return hr;
+    }
+
+    std::vector<uint8_t> pixels;
+    Assets::MipChain chain;
+    HRESULT hr = LoadMipChainCached(path, GetMipGenDesc(slot), &pixels, &chain, pPool);
+    if (FAILED(hr))
+        return hr;
+
+    return CreateTextureFromMipChain(device, chain, DXGI_FORMAT_R8G8B8A8_UNORM, out_srv);
+}
+
+HRESULT TextureFactory::CreateTextureFromMipChain(ID3D11Device* device, const Assets::MipChain& chain, DXGI_FORMAT format, ID3D11ShaderResourceView** out_srv)
+{
+    const UINT numLevels = (UINT)chain.Levels.size();
+
+    D3D11_TEXTURE2D_DESC texDesc = {};
+    texDesc.Width            = chain.Levels[0].Width;
+    texDesc.Height           = chain.Levels[0].Height;
+    texDesc.MipLevels        = numLevels;
+    texDesc.ArraySize        = 1;
+    texDesc.Format           = format;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.Usage            = D3D11_USAGE_IMMUTABLE;
+    texDesc.BindFlags        = D3D11_BIND_SHADER_RESOURCE;
+
+    D3D11_SUBRESOURCE_DATA initData[D3D11_REQ_MIP_LEVELS];
+    for (UINT i = 0; i != numLevels; ++i)
+    {
+        initData[i].pSysMem          = chain.GetLevelData(i);
+        initData[i].SysMemPitch      = chain.Levels[i].RowPitch;
+        initData[i].SysMemSlicePitch = 0;
+    }
+
+    ID3D11Texture2D* pTexture = nullptr;
+    HRESULT hr = device->CreateTexture2D(&texDesc, initData, &pTexture);
+
+    // The SRV holds its own reference to the texture
+    if (SUCCEEDED(hr))
+    {
+        hr = device->CreateShaderResourceView(pTexture, nullptr, out_srv);
+        pTexture->Release();
+    }
+
+    return hr;
+}
+
+HRESULT TextureFactory::CreateTextureArrayFromMipChains(ID3D11Device* device, const std::vector<const Assets::MipChain*>& slices, DXGI_FORMAT format, ID3D11ShaderResourceView** out_srv)
+{
+    const Assets::MipChain& first = *slices[0];
+    const UINT numLevels = (UINT)first.Levels.size();
+    const UINT numSlices = (UINT)slices.size();
+
+    D3D11_TEXTURE2D_DESC texDesc = {};
+    texDesc.Width            = first.Levels[0].Width;
+    texDesc.Height           = first.Levels[0].Height;
+    texDesc.MipLevels        = numLevels;
+    texDesc.ArraySize        = numSlices;
+    texDesc.Format           = format;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.Usage            = D3D11_USAGE_IMMUTABLE;
+    texDesc.BindFlags        = D3D11_BIND_SHADER_RESOURCE;
+
+    // Subresources are ordered slice-major: (slice * numLevels + mip)
+    Core::ScopedScratch scratch;
+    D3D11_SUBRESOURCE_DATA* initData = scratch.AllocateArray<D3D11_SUBRESOURCE_DATA>(numLevels * numSlices);
+    for (UINT slice = 0; slice != numSlices; ++slice)
+    {
+        for (UINT mip = 0; mip != numLevels; ++mip)
+        {
+            D3D11_SUBRESOURCE_DATA& sub = initData[slice * numLevels + mip];
+            sub.pSysMem          = slices[slice]->GetLevelData(mip);
+            sub.SysMemPitch      = slices[slice]->Levels[mip].RowPitch;
+            sub.SysMemSlicePitch = 0;
+        }
+    }
+
+    ID3D11Texture2D* pTexture = nullptr;
+    HRESULT hr = device->CreateTexture2D(&texDesc, initData, &pTexture);
+
+    // A null view desc views the whole resource, which is a Texture2DArray here
+    if (SUCCEEDED(hr))
+    {
+        hr = device->CreateShaderResourceView(pTexture, nullptr, out_srv);
+        pTexture->Release();
+    }
+
+    return hr;
+}
+
+HRESULT TextureFactory::ReplaceArraySlice(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11ShaderResourceView* bankSRV, UINT slice, const Assets::MipChain& chain, ID3D11ShaderResourceView** out_srv)
+{
+    ID3D11Resource* pOldResource = nullptr;
+    bankSRV->GetResource(&pOldResource);
+
+    ID3D11Texture2D* pOldTexture = nullptr;
+    HRESULT hr = pOldResource->QueryInterface(IID_PPV_ARGS(&pOldTexture));
+    pOldResource->Release();
+    if (FAILED(hr))
+        return hr;
+
+    D3D11_TEXTURE2D_DESC texDesc;
+    pOldTexture->GetDesc(&texDesc);
+
+    // Only a same-size replacement fits in the existing slice
+    if (slice >= texDesc.ArraySize || texDesc.Width != chain.Levels[0].Width || texDesc.Height != chain.Levels[0].Height || texDesc.MipLevels != (UINT)chain.Levels.size())
+    {
+        pOldTexture->Release();
+        return E_INVALIDARG;
+    }
+
+    // Banks are immutable, so copy the whole array into a fresh one on the GPU and overwrite the one slice
+    texDesc.Usage = D3D11_USAGE_DEFAULT;
+    ID3D11Texture2D* pTexture = nullptr;
+    hr = device->CreateTexture2D(&texDesc, nullptr, &pTexture);
+    if (SUCCEEDED(hr))
+    {
+        context->CopyResource(pTexture, pOldTexture);
+        for (UINT mip = 0; mip != texDesc.MipLevels; ++mip)
+        {
+            const UINT subresource = D3D11CalcSubresource(mip, slice, texDesc.MipLevels);
+            context->UpdateSubresource(pTexture, subresource, nullptr, chain.GetLevelData(mip), chain.Levels[mip].RowPitch, 0);
+        }
+
+        hr = device->CreateShaderResourceView(pTexture, nullptr, out_srv);
+        pTexture->Release();
+    }
+
+    pOldTexture->Release();
+    return hr;
 }
 
 bool MaterialFactory::CreateAllMaterials(ID3D11Device* device, ResourceCodex& codex)
 {
-    const uint32_t kLunarId = fnv1a(L"Lunar");       // FNV1A of L"Lunar"
-
-    const ShaderID kInstancedPhongVSID = 0xc8a366aa; // FNV1A of L"InstancedPhongVS.cso"
-    const ShaderID kPhongPSID = 0x4dc6e249;          // FNV1A of L"PhongPS.cso"
-    const ShaderID kPhongPSNormalMapID = fnv1a(L"Phong_NormalMapPS.cso");
-    const ShaderID kWireFramePSID = fnv1a(L"WireframePS.cso");
-    const ShaderID kSkyVSID = 0xeb5accd4;         // fnv1a L"SkyVS.cso"
-    const ShaderID kSkyPSID = 0x6ec235e6;         // fnv1a L"SkyPS.cso"
-    const TextureID kSkyTextureID = 0x2fb626d6;   // fnv1a L"Sky"
-    const TextureID kSpaceTextureID = 0xc1c43225; // fnv1a L"Space"
-    const MeshID kSkyMeshID = 0x4a986f37; // cube
+    std::vector<Assets::MaterialLibrary> libraries;
+    const bool loaded = LoadMaterialLibraries(&libraries);
+
+    for (const Assets::MaterialLibrary& library : libraries)
+        ApplyMaterialLibrary(device, codex, library);
 
+    return loaded;
+}
+
+bool MaterialFactory::LoadMaterialLibraries(std::vector<Assets::MaterialLibrary>* out_libraries)
+{
+    std::string error;
+    std::vector<std::string> paths;
+    if (!Assets::MaterialLibrary::ReadManifest(ASSETPATH "codex.xml", &paths, &error))
     {
-        Material lunarMaterial;
-        lunarMaterial.VS = codex.GetVertexShader(kInstancedPhongVSID);
-        lunarMaterial.PS = codex.GetPixelShader(kPhongPSNormalMapID);
-        lunarMaterial.Description.colorTint = DirectX::XMFLOAT4(DirectX::Colors::White);
-        lunarMaterial.Description.specularExp = 128.0f;
-        lunarMaterial.Resources = codex.GetTexture(kLunarId);
-
-        MaterialIndex lunarMaterialIndex = codex.PushMaterial(lunarMaterial);
-        assert(MI_LUNAR == lunarMaterialIndex); // This is stupid
+        #if defined(ESL_DEBUG)
+        OutputDebugStringA(("ERROR: " + error + "\n").c_str());
+        #endif
+        return false;
     }
 
+    bool allLoaded = true;
+    out_libraries->reserve(paths.size());
+    for (const std::string& path : paths)
     {
-        Material skyMaterial;
-        skyMaterial.VS = codex.GetVertexShader(kSkyVSID);
-        skyMaterial.PS = codex.GetPixelShader(kSkyPSID);
-        skyMaterial.Resources = codex.GetTexture(kSpaceTextureID);
-
-        // Back-facing rasterizer state
-        D3D11_RASTERIZER_DESC rastDesc = {};
-        rastDesc.FillMode = D3D11_FILL_SOLID;
-        rastDesc.CullMode = D3D11_CULL_FRONT;
-        rastDesc.DepthClipEnable = true;
-        device->CreateRasterizerState(&rastDesc, &skyMaterial.RasterStateOverride);
-
-        // Depth stencil with "less equal"
-        D3D11_DEPTH_STENCIL_DESC dsDesc = {};
-        dsDesc.DepthEnable = true;
-        dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-        dsDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-        device->CreateDepthStencilState(&dsDesc, &skyMaterial.DepthStencilStateOverride);
-
-#if defined(ESL_DEBUG)
-        const char RSdebugName[] = "Sky_RS";
-        const char DSdebugName[] = "Sky_DS";
-        HRESULT hr = skyMaterial.RasterStateOverride->SetPrivateData(WKPDID_D3DDebugObjectName, ARRAYSIZE(RSdebugName) - 1, RSdebugName);
-        hr = skyMaterial.DepthStencilStateOverride->SetPrivateData(WKPDID_D3DDebugObjectName, ARRAYSIZE(DSdebugName) - 1, DSdebugName);
-        COM_EXCEPT(hr);
-#endif
+        Assets::MaterialLibrary library;
+        if (!library.Load(path, &error))
+        {
+            #if defined(ESL_DEBUG)
+            OutputDebugStringA(("ERROR: " + error + "\n").c_str());
+            #endif
+            allLoaded = false;
+            continue;
+        }
+        out_libraries->push_back(std::move(library));
+    }
+    return allLoaded;
+}
 
-        MaterialIndex skyMaterialIndex = codex.PushMaterial(skyMaterial);
-        assert(MI_SKY == skyMaterialIndex); // This is stupid    
+void MaterialFactory::ApplyMaterialLibrary(ID3D11Device* device, ResourceCodex& codex, const Assets::MaterialLibrary& library)
+{
+    for (const Assets::MaterialDesc& desc : library.GetMaterials())
+    {
+        Material material;
+        if (!CreateMaterial(device, codex, desc, &material))
+            continue;
+
+        // Known names are updated in place so handles held by the renderers stay valid
+        const MaterialID materialId = fnv1a(desc.Name);
+        #if defined(ESL_DEBUG)
+        RegisterResourceName(ResourceKind::MATERIAL, materialId, desc.Name);
+        #endif
+
+        const MaterialHandle existing = codex.FindMaterial(materialId);
+        if (existing.IsValid())
+            codex.ReplaceMaterial(existing, material);
+        else
+            codex.InsertMaterial(materialId, material);
+
+        // The material holds its own reference now
+        codex.Release(material.Pipeline);
     }
+}
 
+bool MaterialFactory::CreateMaterial(ID3D11Device* device, ResourceCodex& codex, const Assets::MaterialDesc& desc, Material* out_material)
+{
+    // The enums mirror D3D11's, offset by one
+    static const D3D11_FILL_MODE kFillModes[] = { D3D11_FILL_SOLID, D3D11_FILL_WIREFRAME };
+    static const D3D11_CULL_MODE kCullModes[] = { D3D11_CULL_NONE, D3D11_CULL_FRONT, D3D11_CULL_BACK };
+    static const PipelineBlend   kBlendModes[] = { PipelineBlend::NONE, PipelineBlend::ALPHA, PipelineBlend::ADDITIVE };
+
+    Material material;
+    PipelineStateDesc pipeline;
+
+    // Shader IDs are hashed from the wide file name, which always matches the UTF-8 name from the file.
+    // A name that isn't a file is a permutation family, and the material's features pick the variant.
+    const ShaderID vsId = fnv1a(desc.VertexShader);
+    const ShaderID psId = fnv1a(desc.PixelShader);
+    pipeline.VS = codex.FindVertexShader(vsId);
+    if (!pipeline.VS.IsValid())
+        pipeline.VS = codex.FindVertexShader(vsId, desc.Features);
+
+    pipeline.PS = codex.FindPixelShader(psId);
+    const bool permutedPS = !pipeline.PS.IsValid();
+    if (permutedPS)
+        pipeline.PS = codex.FindPixelShader(psId, desc.Features);
+
+    if (!pipeline.VS.IsValid() || !pipeline.PS.IsValid())
     {
-        Material wireframeMaterial;
-        wireframeMaterial.VS = codex.GetVertexShader(kInstancedPhongVSID);
-        wireframeMaterial.PS = codex.GetPixelShader(kWireFramePSID);
-        wireframeMaterial.Description.colorTint = DirectX::XMFLOAT4(DirectX::Colors::White);
-        wireframeMaterial.Description.specularExp = 0.0f;
-
-        // Wireframe no-cull raster state
-        D3D11_RASTERIZER_DESC rastDesc = {};
-        rastDesc.FillMode = D3D11_FILL_WIREFRAME;
-        rastDesc.CullMode = D3D11_CULL_NONE;
-        device->CreateRasterizerState(&rastDesc, &wireframeMaterial.RasterStateOverride);
-
-        MaterialIndex wireframeMaterialIndex = codex.PushMaterial(wireframeMaterial);
-        assert(MI_WIREFRAME == wireframeMaterialIndex); // This is stupid  
+        #if defined(ESL_DEBUG)
+        OutputDebugStringA(("ERROR: Material '" + std::string(desc.Name) + "' references a shader that wasn't loaded\n").c_str());
+        #endif
+        return false;
     }
 
+    material.Description.colorTint = DirectX::XMFLOAT4(desc.Tint);
+    material.Description.specularExp = desc.SpecularExp;
+
+    if (!desc.Textures.empty())
+    {
+        const TextureID textureId = fnv1a(desc.Textures);
+
+        // Prefer the packed arrays, so the material shares its bound SRVs with every other material in the bank
+        TextureHandle bank;
+        uint32_t slice = 0;
+        PixelShaderHandle packedPS = desc.PackedPixelShader.empty() ? PixelShaderHandle() : codex.FindPixelShader(fnv1a(desc.PackedPixelShader));
+        if (permutedPS)
+            packedPS = codex.FindPixelShader(psId, desc.Features | (PermutationKey)ShaderFeature::TEXTURE_ARRAY);
+        if (packedPS.IsValid() && codex.GetTextureSlice(textureId, &bank, &slice))
+        {
+            pipeline.PS = packedPS;
+            material.Resources = bank;
+            material.Description.textureSlice = slice;
+        }
+        else
+        {
+            material.Resources = codex.FindTexture(textureId);
+        }
+
+        #if defined(ESL_DEBUG)
+        if (!material.Resources.IsValid())
+            OutputDebugStringA(("ERROR: Material '" + std::string(desc.Name) + "' references textures that weren't loaded\n").c_str());
+        #endif
+    }
+
+    if (desc.HasRasterState)
+    {
+        pipeline.Fill = (uint8_t)kFillModes[(uint32_t)desc.Raster.Fill];
+        pipeline.Cull = (uint8_t)kCullModes[(uint32_t)desc.Raster.Cull];
+        pipeline.DepthClip = desc.Raster.DepthClip;
+    }
+
+    if (desc.HasDepthState)
+    {
+        pipeline.DepthEnable = desc.Depth.DepthEnable;
+        pipeline.DepthWrite = desc.Depth.DepthWrite;
+        pipeline.DepthFunc = (uint8_t)((uint32_t)desc.Depth.Func + D3D11_COMPARISON_NEVER);
+    }
+
+    if (desc.HasBlendState)
+        pipeline.Blend = kBlendModes[(uint32_t)desc.Blend.Mode];
+
+    // Materials that only differ by textures or params end up sharing one
+    material.Pipeline = codex.AcquirePipelineState(pipeline, device);
+
+    *out_material = material;
     return true;
 }
 
+HRESULT PipelineStateFactory::CreateRasterState(ID3D11Device* device, const PipelineStateDesc& desc, ID3D11RasterizerState** out_state)
+{
+    *out_state = nullptr;
+    if (!desc.GetRasterKey())
+        return S_OK;
+
+    D3D11_RASTERIZER_DESC rastDesc = {};
+    rastDesc.FillMode = (D3D11_FILL_MODE)desc.Fill;
+    rastDesc.CullMode = (D3D11_CULL_MODE)desc.Cull;
+    rastDesc.DepthClipEnable = desc.DepthClip;
+    return device->CreateRasterizerState(&rastDesc, out_state);
+}
+
+HRESULT PipelineStateFactory::CreateDepthStencilState(ID3D11Device* device, const PipelineStateDesc& desc, ID3D11DepthStencilState** out_state)
+{
+    *out_state = nullptr;
+    if (!desc.GetDepthStencilKey())
+        return S_OK;
+
+    D3D11_DEPTH_STENCIL_DESC dsDesc = {};
+    dsDesc.DepthEnable = desc.DepthEnable;
+    dsDesc.DepthWriteMask = desc.DepthWrite ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+    dsDesc.DepthFunc = (D3D11_COMPARISON_FUNC)desc.DepthFunc;
+    return device->CreateDepthStencilState(&dsDesc, out_state);
+}
+
+HRESULT PipelineStateFactory::CreateBlendState(ID3D11Device* device, const PipelineStateDesc& desc, ID3D11BlendState** out_state)
+{
+    *out_state = nullptr;
+    if (!desc.GetBlendKey())
+        return S_OK;
+
+    D3D11_BLEND_DESC blendDesc = {};
+    D3D11_RENDER_TARGET_BLEND_DESC& target = blendDesc.RenderTarget[0];
+    target.BlendEnable = TRUE;
+    target.SrcBlend = desc.Blend == PipelineBlend::ALPHA ? D3D11_BLEND_SRC_ALPHA : D3D11_BLEND_ONE;
+    target.DestBlend = desc.Blend == PipelineBlend::ALPHA ? D3D11_BLEND_INV_SRC_ALPHA : D3D11_BLEND_ONE;
+    target.BlendOp = D3D11_BLEND_OP_ADD;
+    target.SrcBlendAlpha = D3D11_BLEND_ONE;
+    target.DestBlendAlpha = D3D11_BLEND_ZERO;
+    target.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+    target.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+    return device->CreateBlendState(&blendDesc, out_state);
+}
+
 }
\ No newline at end of file
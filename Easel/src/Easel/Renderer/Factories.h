@@ -2,24 +2,36 @@
 #define FACTORIES_H
 
 #include "DXCore.h"
+#include "PipelineState.h"
 #include "ResourceCodex.h"
 #include "Shader.h"
+#include "ShaderReflection.h"
 
+#include <string>
 #include <utility>
+#include <vector>
+
+#include <Easel/Assets/MaterialLibrary.h>
+#include <Easel/Assets/MipGenerator.h>
+
+namespace Assets
+{
+struct CookedMesh;
+}
 
 namespace Renderer {
 
 struct ShaderFactory final
 {
     friend class ResourceCodex;
+    friend class HotReloader;
 
     // Main initialization function: Takes a codex, which then calls the static functions from ShaderFactory to populate its own hashtables
     static void LoadAllShaders(ID3D11Device* device, ResourceCodex& codex);
 
 private: // For VertexShader
     static void CreateVertexShader(const wchar_t* fileName, VertexShader* out_shader, ID3D11Device* device);
-    static void BuildInputLayout(ID3D11ShaderReflection* pReflection, ID3D10Blob* pBlob, VertexShader* out_shader, ID3D11Device* device);
-    static void AssignDXGIFormatsAndByteOffsets(D3D11_INPUT_CLASSIFICATION slotClass, D3D11_SIGNATURE_PARAMETER_DESC* paramDescs, UINT numInputs, D3D11_INPUT_ELEMENT_DESC* out_inputParams, uint16_t* out_byteOffsets, uint16_t* out_byteSize);
+    static void BuildInputLayout(const ShaderReflection& reflection, ID3D10Blob* pBlob, VertexShader* out_shader, ID3D11Device* device);
 
 private: // For PixelShader
     static void CreatePixelShader(const wchar_t* fileName, PixelShader* out_shader, ID3D11Device* device);
@@ -28,17 +40,80 @@ private: // For PixelShader
 struct TextureFactory final
 {
     typedef std::pair<TextureID, const ResourceBindChord> TexturePair;
-    static void LoadAllTextures(ID3D11Device* device, ID3D11DeviceContext* context, ResourceCodex& codex);
+    // Mip chains are generated across the pool when there is one, here and everywhere below
+    static void LoadAllTextures(ID3D11Device* device, ResourceCodex& codex, Core::WorkerPool* pPool);
+
+    // A decoded texture waiting to be packed
+    struct PendingTexture
+    {
+        TextureID        ID;
+        UINT             Slot;
+        std::wstring     Name;
+        std::wstring     Path;
+        Assets::MipChain Chain;
+    };
+
+    // Parses the <Name>_<Type>.<ext> naming convention. False for files that aren't textures.
+    static bool ClassifyTextureFile(const std::wstring& fileName, TextureID* out_id, UINT* out_slot, bool* out_isDDS);
+
+    // Mip settings for the texture type living in this slot
+    static Assets::MipGenDesc GetMipGenDesc(UINT slot);
+
+    // Decoded + mipped texture, served from the AssetCache when the source and settings haven't changed
+    static HRESULT LoadMipChainCached(const std::wstring& path, const Assets::MipGenDesc& mipDesc, std::vector<uint8_t>* scratchPixels, Assets::MipChain* out_chain, Core::WorkerPool* pPool);
+
+    // Every WIC-decoded slot of one texture set, e.g. all the Lunar_* files, built the way LoadAllTextures builds
+    // them but without a device. Slots without a file stay empty. False if the set has no textures at all.
+    static bool LoadTextureSetMipChains(TextureID textureSet, Assets::MipChain out_chains[(UINT)TextureSlots::COUNT], Core::WorkerPool* pPool);
+
+    // Decodes any WIC-supported image file into tightly packed RGBA8
+    static HRESULT DecodeWICToRGBA(const wchar_t* path, std::vector<uint8_t>* out_pixels, UINT* out_width, UINT* out_height);
+
+    // Standalone texture straight from a file, the same way LoadAllTextures would load it. Used to bring evicted textures back.
+    static HRESULT CreateTextureFromFile(ID3D11Device* device, const std::wstring& path, UINT slot, bool isDDS, ID3D11ShaderResourceView** out_srv, Core::WorkerPool* pPool);
+
+    // Creates an immutable texture with every level of the chain uploaded as initial data
+    static HRESULT CreateTextureFromMipChain(ID3D11Device* device, const Assets::MipChain& chain, DXGI_FORMAT format, ID3D11ShaderResourceView** out_srv);
+
+    // Same as above, but each chain becomes one slice of a Texture2DArray. All chains must share a signature.
+    static HRESULT CreateTextureArrayFromMipChains(ID3D11Device* device, const std::vector<const Assets::MipChain*>& slices, DXGI_FORMAT format, ID3D11ShaderResourceView** out_srv);
+
+    // New view of a bank with one slice overwritten. Used by hot reload, the chain must match the bank's size.
+    static HRESULT ReplaceArraySlice(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11ShaderResourceView* bankSRV, UINT slice, const Assets::MipChain& chain, ID3D11ShaderResourceView** out_srv);
+
+private:
+    static void CreatePackedTextures(ID3D11Device* device, const std::vector<PendingTexture>& pending, ResourceCodex& codex);
 };
 
 struct MeshFactory final
 {
     static MeshID CreateMesh(const char* fileName, const VertexBufferDescription* vertAttr, ID3D11Device* pDevice, Mesh* out_mesh);
+
+    // Creates the immutable vertex/index buffers for an already cooked mesh
+    static HRESULT UploadMesh(const Assets::CookedMesh& cooked, ID3D11Device* pDevice, Mesh* out_mesh);
 };
 
 struct MaterialFactory final
 {
+    // Loads every library listed in Assets/codex.xml into the codex
     static bool CreateAllMaterials(ID3D11Device* device, ResourceCodex& codex);
+
+    // Parsing half of the above, safe to run off the main thread
+    static bool LoadMaterialLibraries(std::vector<Assets::MaterialLibrary>* out_libraries);
+
+    // Adds new materials and updates existing ones (matched by name) in place
+    static void ApplyMaterialLibrary(ID3D11Device* device, ResourceCodex& codex, const Assets::MaterialLibrary& library);
+
+    // The material's pipeline state comes with a reference the caller owns, whether it was created or shared
+    static bool CreateMaterial(ID3D11Device* device, ResourceCodex& codex, const Assets::MaterialDesc& desc, Material* out_material);
+};
+
+struct PipelineStateFactory final
+{
+    // The state objects a desc asks for. Each is left null when the desc wants D3D11's defaults for it.
+    static HRESULT CreateRasterState(ID3D11Device* device, const PipelineStateDesc& desc, ID3D11RasterizerState** out_state);
+    static HRESULT CreateDepthStencilState(ID3D11Device* device, const PipelineStateDesc& desc, ID3D11DepthStencilState** out_state);
+    static HRESULT CreateBlendState(ID3D11Device* device, const PipelineStateDesc& desc, ID3D11BlendState** out_state);
 };
 
 }
@@ -0,0 +1,48 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Everything the render thread needs to draw one frame, built
+by the simulation thread and handed over through a Core::Mailbox. Once
+published a packet is never touched by the simulation again until the
+render thread has let go of it, so nothing in it needs a lock.
+Instance and light list storage is allocated once per packet at init, never per frame.
+----------------------------------------------*/
+#ifndef EASEL_FRAMEPACKET_H
+#define EASEL_FRAMEPACKET_H
+
+#include "CascadedShadows.h"
+#include "CBufferStructs.h"
+#include "ClusteredLighting.h"
+
+#include <stdint.h>
+
+namespace Renderer {
+
+// Visible instances of one EntityRenderer pass, packed in draw order
+struct InstanceBatch
+{
+    DirectX::XMFLOAT4X4* WorldMatrices = nullptr;
+    uint32_t             Count = 0;
+    uint32_t             Capacity = 0;
+};
+
+struct FramePacket
+{
+    uint64_t            Index = 0;              // Counts up from 1 with every packet built
+    uint32_t            SimulationSteps = 0;    // Fixed steps run since the previous packet
+
+    DirectX::XMFLOAT4X4 ViewProjection;
+    DirectX::XMFLOAT4X4 SkyViewProjection;      // Same camera with the translation taken out
+    cbLighting          Lighting;
+    ClusteredLights     Clusters;               // Point and spot lights binned for this packet's view
+
+    InstanceBatch*      Batches = nullptr;      // One per EntityRenderer instancing pass
+    uint32_t            BatchCount = 0;
+
+    ShadowCascade       Cascades[CascadedShadows::kMaxCascades];
+    uint32_t            CascadeCount = 0;
+    InstanceBatch*      ShadowBatches = nullptr;    // Casters for each cascade, BatchCount per cascade back to back
+};
+
+}
+#endif
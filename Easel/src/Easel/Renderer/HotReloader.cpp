@@ -0,0 +1,394 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of HotReloader.h
+The device is free threaded, so buffers, textures and shaders are created
+on the worker. Only the swap (and patching packed texture slices, which
+needs the immediate context) happens on the render thread.
+----------------------------------------------*/
+#include "HotReloader.h"
+
+#include "Factories.h"
+#include "hash_util.h"
+
+#include <Easel/Assets/MeshImporter.h>
+#include <Easel/Core/MemoryTracker.h>
+#include <Easel/Core/PathMacros.h>
+#include <Easel/Core/Profiler.h>
+
+#include <exception>
+
+namespace Renderer {
+
+namespace fs = std::filesystem;
+
+// Long enough to cover an editor's save (write, flush, rename), short enough to feel instant
+static const uint32_t kReloadDebounceMs = 250;
+
+// More than a branch switch touching every asset would be waiting on the worker at once
+static const uint32_t kMaxPendingReloads = 256;
+
+HotReloader::HotReloader(ID3D11Device* device) :
+    mpDevice(device),
+    mpJobHead(nullptr),
+    mpJobTail(nullptr),
+    mQuit(false)
+{
+    mJobPool.Init(kMaxPendingReloads);
+}
+
+HotReloader::~HotReloader()
+{
+    Stop();
+}
+
+bool HotReloader::Start()
+{
+    std::vector<fs::path> folders;
+    folders.push_back(ASSETPATH);
+    folders.push_back(SHADERPATH);
+
+    if (!mWatcher.Start(folders, kReloadDebounceMs))
+        return false;
+
+    mQuit = false;
+    mWorker = std::thread(&HotReloader::WorkerThread, this);
+    return true;
+}
+
+void HotReloader::Stop()
+{
+    mWatcher.Stop();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+        ClearJobs();
+    }
+    mCondition.notify_all();
+
+    if (mWorker.joinable())
+        mWorker.join();
+
+    // Anything finished but never swapped in
+    for (ReloadResult& result : mResults)
+        ReleaseResult(result);
+    mResults.clear();
+}
+
+void HotReloader::Update(ResourceCodex& codex, ID3D11DeviceContext* context)
+{
+    mChangedScratch.clear();
+    mWatcher.Poll(&mChangedScratch);
+
+    if (!mChangedScratch.empty())
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const fs::path& path : mChangedScratch)
+        {
+            // Already waiting for the worker, the newer contents will be picked up anyway
+            if (IsQueued(path))
+                continue;
+
+            ReloadJob* pJob = mJobPool.Create();
+            if (!pJob)
+            {
+                #if defined(ESL_DEBUG)
+                OutputDebugStringW((L"WARNING: Too many pending reloads, skipped " + path.filename().wstring() + L"\n").c_str());
+                #endif
+                continue;
+            }
+
+            if (!MakeJob(codex, path, pJob))
+            {
+                mJobPool.Destroy(pJob);
+                continue;
+            }
+
+            if (mpJobTail)
+                mpJobTail->pNext = pJob;
+            else
+                mpJobHead = pJob;
+            mpJobTail = pJob;
+        }
+    }
+    mCondition.notify_one();
+
+    std::vector<ReloadResult> finished;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        finished.swap(mResults);
+    }
+
+    for (ReloadResult& result : finished)
+        Apply(codex, context, result);
+}
+
+bool HotReloader::MakeJob(const ResourceCodex& codex, const fs::path& path, ReloadJob* out_job) const
+{
+    out_job->Path = path;
+
+    // Meshes are keyed by their UTF-8 file name, same as AddMeshFromFile
+    const std::string narrowName = path.filename().u8string();
+    const MeshID meshId = fnv1a(narrowName.c_str());
+    if (const ResourceCodex::MeshSource* pSource = codex.GetMeshSource(meshId))
+    {
+        out_job->Kind = ReloadKind::MESH;
+        out_job->ID = meshId;
+        out_job->Layout = pSource->Layout;
+        return true;
+    }
+
+    const std::wstring wideName = path.filename().wstring();
+    if (path.extension() == L".cso")
+    {
+        const ShaderID shaderId = fnv1a(wideName.c_str());
+        if (codex.FindPixelShader(shaderId).IsValid())
+        {
+            out_job->Kind = ReloadKind::PIXEL_SHADER;
+            out_job->ID = shaderId;
+            return true;
+        }
+
+        #if defined(ESL_DEBUG)
+        if (wideName.find(L"VS") != std::wstring::npos)
+            OutputDebugStringW((L"INFO: Vertex shader changes need a restart: " + wideName + L"\n").c_str());
+        #endif
+        return false;
+    }
+
+    // Any library (or codex.xml itself) changing rebuilds every material, it's only a few milliseconds
+    if (path.extension() == L".xml" && path.parent_path() == fs::path(ASSETPATH).parent_path())
+    {
+        out_job->Kind = ReloadKind::MATERIALS;
+        out_job->ID = 0;
+        return true;
+    }
+
+    // The asset folder also holds shader sources, whose names can look like textures
+    if (path.parent_path() != fs::path(TEXTUREPATH).parent_path())
+        return false;
+
+    TextureID textureId;
+    UINT slot;
+    bool isDDS;
+    if (TextureFactory::ClassifyTextureFile(wideName, &textureId, &slot, &isDDS))
+    {
+        TextureBankSlice location;
+        out_job->Kind = ReloadKind::TEXTURE;
+        out_job->ID = textureId;
+        out_job->Slot = slot;
+        out_job->IsDDS = isDDS;
+        out_job->Banked = !isDDS && codex.GetTextureBankIndex(textureId, &location);
+        return true;
+    }
+
+    return false;
+}
+
+bool HotReloader::IsQueued(const fs::path& path) const
+{
+    for (const ReloadJob* pJob = mpJobHead; pJob; pJob = pJob->pNext)
+    {
+        if (pJob->Path == path)
+            return true;
+    }
+    return false;
+}
+
+void HotReloader::ClearJobs()
+{
+    while (mpJobHead)
+    {
+        ReloadJob* pNext = mpJobHead->pNext;
+        mJobPool.Destroy(mpJobHead);
+        mpJobHead = pNext;
+    }
+    mpJobTail = nullptr;
+}
+
+void HotReloader::WorkerThread()
+{
+    Core::Profiler::SetThreadName("HotReload");
+
+    // WIC needs COM on this thread too
+    const HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    for (;;)
+    {
+        ReloadJob job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mQuit || mpJobHead; });
+            if (mQuit)
+                break;
+
+            ReloadJob* pJob = mpJobHead;
+            mpJobHead = pJob->pNext;
+            if (!mpJobHead)
+                mpJobTail = nullptr;
+
+            job = std::move(*pJob);
+            job.pNext = nullptr;
+            mJobPool.Destroy(pJob);
+        }
+
+        ReloadResult result;
+        result.Job = job;
+
+        // A half written file shouldn't take the whole app down, the next save will try again
+        try
+        {
+            Execute(job, &result);
+        }
+        catch (const std::exception& e)
+        {
+            #if defined(ESL_DEBUG)
+            OutputDebugStringA("ERROR: Hot reload failed: ");
+            OutputDebugStringA(e.what());
+            OutputDebugStringA("\n");
+            #endif
+            (void)e;
+            ReleaseResult(result);
+            result.Succeeded = false;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mQuit)
+        {
+            ReleaseResult(result);
+            break;
+        }
+        mResults.push_back(std::move(result));
+    }
+
+    if (SUCCEEDED(hrCom))
+        CoUninitialize();
+}
+
+void HotReloader::Execute(const ReloadJob& job, ReloadResult* out_result)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RESOURCE_CODEX);
+    ESL_PROFILE_ZONE("HotReloader::Execute");
+
+    switch (job.Kind)
+    {
+        case ReloadKind::MESH:
+        {
+            Assets::CookedMesh cooked;
+            std::string importError;
+            if (!Assets::MeshImporter::ImportCached(job.Path.string(), *job.Layout, &cooked, &importError))
+            {
+                #if defined(ESL_DEBUG)
+                OutputDebugStringA(("ERROR: Hot reload couldn't import mesh: " + importError + "\n").c_str());
+                #endif
+                return;
+            }
+
+            out_result->Succeeded = SUCCEEDED(MeshFactory::UploadMesh(cooked, mpDevice, &out_result->NewMesh));
+            break;
+        }
+        case ReloadKind::PIXEL_SHADER:
+        {
+            ShaderFactory::CreatePixelShader(job.Path.c_str(), &out_result->NewPixelShader, mpDevice);
+            out_result->Succeeded = out_result->NewPixelShader.Shader != nullptr;
+            break;
+        }
+        case ReloadKind::TEXTURE:
+        {
+            HRESULT hr = E_FAIL;
+            if (!job.Banked)
+            {
+                // No pool on this thread, the frame's workers may be shutting down under it
+                hr = TextureFactory::CreateTextureFromFile(mpDevice, job.Path.wstring(), job.Slot, job.IsDDS, &out_result->NewSRV, nullptr);
+            }
+            else
+            {
+                // Packed slices need the immediate context, so they're only decoded here
+                std::vector<uint8_t> pixels;
+                hr = TextureFactory::LoadMipChainCached(job.Path.wstring(), TextureFactory::GetMipGenDesc(job.Slot), &pixels, &out_result->Chain, nullptr);
+            }
+
+            out_result->Succeeded = SUCCEEDED(hr);
+            break;
+        }
+        case ReloadKind::MATERIALS:
+        {
+            out_result->Succeeded = MaterialFactory::LoadMaterialLibraries(&out_result->MaterialLibraries);
+            break;
+        }
+    }
+}
+
+void HotReloader::Apply(ResourceCodex& codex, ID3D11DeviceContext* context, ReloadResult& result)
+{
+    ESL_PROFILE_ZONE("HotReloader::Apply");
+
+    const ReloadJob& job = result.Job;
+    if (!result.Succeeded)
+    {
+        ReleaseResult(result);
+        return;
+    }
+
+    switch (job.Kind)
+    {
+        case ReloadKind::MESH:
+            codex.ReplaceMesh(job.ID, result.NewMesh);
+            break;
+
+        case ReloadKind::PIXEL_SHADER:
+            // Swapped in place and patched into every pipeline state using it, so materials pick it up next draw
+            codex.ReplacePixelShader(job.ID, result.NewPixelShader);
+            break;
+
+        case ReloadKind::TEXTURE:
+        {
+            TextureBankSlice location;
+            if (!job.Banked)
+            {
+                // Chords are updated in place, so every material referencing this texture follows along.
+                // If it was unloaded while the reload was in flight, it stays unloaded.
+                if (codex.FindTexture(job.ID).IsValid())
+                    codex.InsertTexture(job.ID, job.Slot, result.NewSRV);
+                else
+                    result.NewSRV->Release();
+            }
+            else if (codex.GetTextureBankIndex(job.ID, &location))
+            {
+                ID3D11ShaderResourceView* pNewBank = nullptr;
+                const HRESULT hr = TextureFactory::ReplaceArraySlice(mpDevice, context, codex.GetTexture(location.Bank)->SRVs[job.Slot], location.Slice, result.Chain, &pNewBank);
+                if (SUCCEEDED(hr))
+                    codex.ReplaceTextureBankSRV(location.Bank, job.Slot, pNewBank);
+
+                #if defined(ESL_DEBUG)
+                if (hr == E_INVALIDARG)
+                    OutputDebugStringA("INFO: A packed texture changed size, it will be repacked on the next restart\n");
+                #endif
+            }
+            break;
+        }
+
+        case ReloadKind::MATERIALS:
+            // Materials only resolve handles to codex shaders and chords, so creating them is cheap enough for the render thread
+            for (const Assets::MaterialLibrary& library : result.MaterialLibraries)
+                MaterialFactory::ApplyMaterialLibrary(mpDevice, codex, library);
+            break;
+    }
+
+    #if defined(ESL_DEBUG)
+    OutputDebugStringW((L"INFO: Hot reloaded " + job.Path.filename().wstring() + L"\n").c_str());
+    #endif
+}
+
+void HotReloader::ReleaseResult(ReloadResult& result)
+{
+    if (result.NewMesh.VertexBuffer) result.NewMesh.VertexBuffer->Release();
+    if (result.NewMesh.IndexBuffer) result.NewMesh.IndexBuffer->Release();
+    if (result.NewPixelShader.SamplerState) result.NewPixelShader.SamplerState->Release();
+    if (result.NewPixelShader.Shader) result.NewPixelShader.Shader->Release();
+    if (result.NewSRV) result.NewSRV->Release();
+    result = ReloadResult();
+}
+
+}
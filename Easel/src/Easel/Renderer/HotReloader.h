@@ -0,0 +1,104 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Re-imports changed meshes, textures, pixel shaders and
+material libraries on a background thread and swaps them into the
+ResourceCodex at the start of a frame.
+----------------------------------------------*/
+#ifndef EASEL_HOTRELOADER_H
+#define EASEL_HOTRELOADER_H
+
+#include "DXCore.h"
+#include "Mesh.h"
+#include "ResourceCodex.h"
+#include "Shader.h"
+
+#include <Easel/Assets/MaterialLibrary.h>
+#include <Easel/Assets/MipGenerator.h>
+#include <Easel/Core/Allocators.h>
+#include <Easel/Core/FileWatcher.h>
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Renderer {
+
+class HotReloader
+{
+public:
+    explicit HotReloader(ID3D11Device* device);
+    ~HotReloader();
+
+    // Starts watching the asset and compiled shader folders
+    bool Start();
+    void Stop();
+
+    // Render thread, once per frame: queues debounced file changes and swaps in everything that finished since last frame
+    void Update(ResourceCodex& codex, ID3D11DeviceContext* context);
+
+private:
+    enum class ReloadKind : uint8_t
+    {
+        MESH,
+        TEXTURE,
+        PIXEL_SHADER,
+        MATERIALS
+    };
+
+    // Everything the worker needs, resolved on the render thread so it never touches the codex
+    struct ReloadJob
+    {
+        ReloadKind                     Kind;
+        std::filesystem::path          Path;
+        id_type                        ID;
+        UINT                           Slot = 0;
+        bool                           IsDDS = false;
+        bool                           Banked = false; // Lives in a Texture2DArray: the slice is patched on the immediate context
+        const VertexBufferDescription* Layout = nullptr;
+        ReloadJob*                     pNext = nullptr; // Queue link while it waits for the worker
+    };
+
+    struct ReloadResult
+    {
+        ReloadJob                 Job;
+        bool                      Succeeded = false;
+        Mesh                      NewMesh = {};
+        PixelShader               NewPixelShader = {};
+        ID3D11ShaderResourceView* NewSRV = nullptr;
+        Assets::MipChain          Chain;
+        std::vector<Assets::MaterialLibrary> MaterialLibraries;
+    };
+
+    bool MakeJob(const ResourceCodex& codex, const std::filesystem::path& path, ReloadJob* out_job) const;
+    bool IsQueued(const std::filesystem::path& path) const;
+    void ClearJobs();
+    void WorkerThread();
+    void Execute(const ReloadJob& job, ReloadResult* out_result);
+    void Apply(ResourceCodex& codex, ID3D11DeviceContext* context, ReloadResult& result);
+    static void ReleaseResult(ReloadResult& result);
+
+    ID3D11Device*            mpDevice;
+    Core::FileWatcher        mWatcher;
+    std::thread              mWorker;
+
+    std::mutex               mMutex;
+    std::condition_variable  mCondition;
+    Core::ObjectPool<ReloadJob> mJobPool; // Jobs come and go with every save, so their slots are reused instead of allocated
+    ReloadJob*               mpJobHead;  // Oldest first, linked through pNext
+    ReloadJob*               mpJobTail;
+    std::vector<ReloadResult> mResults;
+    bool                     mQuit;
+
+    // Render thread only
+    std::vector<std::filesystem::path> mChangedScratch;
+
+public:
+    HotReloader(HotReloader const&)            = delete;
+    HotReloader& operator=(HotReloader const&) = delete;
+};
+
+}
+#endif
@@ -5,26 +5,114 @@ Description : Implementation of LightingManager.h
 ----------------------------------------------*/
 #include "LightingManager.h"
 
+#include "Camera.h"
+#include "FramePacket.h"
 #include "LightStructs.h"
 
+#include <Easel/Core/Mailbox.h>
+
+#include <algorithm>
+#include <math.h>
+
 namespace Renderer
 {
     LightingManager::LightingManager(ID3D11Device* device, ID3D11DeviceContext* context, DirectX::XMFLOAT3A cameraPos)
     {
+        mLightData = {};
         InitLights(cameraPos);
 
+        // Every packet that can be in flight gets its own lists
+        mPacketMemory.Init(Core::Mailbox<FramePacket>::kSlotCount * LightBinner::GetOutputBytes());
+
+        // Headless there's no device, the lights still update and get binned for the packet
+        mBindPacket = {};
+        mClusterLightsBuffer = {};
+        mClusterRangesBuffer = {};
+        mLightIndicesBuffer = {};
+        if (!device)
+            return;
+
         ConstantBufferUpdateManager::Populate(sizeof(cbLighting), 10, EASEL_SHADER_STAGE::ESS_PS, device, &mBindPacket);
         ConstantBufferUpdateManager::Bind(&mBindPacket, context);
+
+        StructuredBufferUpdateManager::Populate(sizeof(ClusterLight), LightBinner::kMaxLights, PS_RESOURCE_REGISTERS::CLUSTER_LIGHTS, device, &mClusterLightsBuffer);
+        StructuredBufferUpdateManager::Populate(2 * sizeof(uint32_t), LightBinner::kClusterCount, PS_RESOURCE_REGISTERS::CLUSTER_RANGES, device, &mClusterRangesBuffer);
+        StructuredBufferUpdateManager::Populate(sizeof(uint32_t), LightBinner::kMaxIndices, PS_RESOURCE_REGISTERS::LIGHT_INDICES, device, &mLightIndicesBuffer);
     }
 
     LightingManager::~LightingManager()
     {
         ConstantBufferUpdateManager::Cleanup(&mBindPacket);
+        StructuredBufferUpdateManager::Cleanup(&mClusterLightsBuffer);
+        StructuredBufferUpdateManager::Cleanup(&mClusterRangesBuffer);
+        StructuredBufferUpdateManager::Cleanup(&mLightIndicesBuffer);
+    }
+
+    void LightingManager::InitFramePacket(FramePacket* packet)
+    {
+        LightBinner::InitOutput(mPacketMemory.Allocate(LightBinner::GetOutputBytes()), &packet->Clusters);
+    }
+
+    void LightingManager::Update(float totalTime, DirectX::XMFLOAT3A cameraPos)
+    {
+        UpdateLights(totalTime, cameraPos);
+    }
+
+    void LightingManager::Cluster(Camera const& camera, FramePacket* out_packet, Core::WorkerPool* pPool)
+    {
+        DirectX::XMFLOAT4X4 view, projection;
+        DirectX::XMStoreFloat4x4(&view, camera.GetView());
+        DirectX::XMStoreFloat4x4(&projection, camera.GetProjection());
+
+        ClusteredLights& clusters = out_packet->Clusters;
+        mBinner.Bin(mLights, &view._11, projection._11, projection._22, camera.GetNear(), camera.GetFar(), &clusters, pPool);
+
+        // Tiles per pixel depend on the target, which only the render thread knows
+        cbLighting& lighting = out_packet->Lighting;
+        lighting.clusterParams = DirectX::XMFLOAT4(clusters.SliceScale, clusters.SliceBias, 0.0f, 0.0f);
+        lighting.clusterDims = DirectX::XMUINT4(LightBinner::kClustersX, LightBinner::kClustersY, LightBinner::kClustersZ, clusters.LightCount);
     }
 
-    void LightingManager::Update(ID3D11DeviceContext* context, float dt, DirectX::XMFLOAT3A cameraPos)
+    void LightingManager::FitShadowCascades(Camera const& camera, FramePacket* out_packet) const
     {
-        UpdateLights(dt, cameraPos, context);
+        static_assert(kCascadeCount <= CascadedShadows::kMaxCascades, "More cascades than a packet holds");
+
+        DirectX::XMFLOAT4X4 inverseView, projection;
+        DirectX::XMStoreFloat4x4(&inverseView, DirectX::XMMatrixInverse(nullptr, camera.GetView()));
+        DirectX::XMStoreFloat4x4(&projection, camera.GetProjection());
+
+        float splits[kCascadeCount + 1];
+        CascadedShadows::ComputeSplits(camera.GetNear(), std::min(camera.GetFar(), kShadowDistance), kSplitLambda, kCascadeCount, splits);
+
+        const DirectX::XMFLOAT3A& toLight = mLightData.directionalLight.toLight;
+        for (uint32_t i = 0; i != kCascadeCount; ++i)
+        {
+            CascadedShadows::FitCascade(&inverseView._11, projection._11, projection._22, splits[i], splits[i + 1],
+                                        &toLight.x, kShadowResolution, &out_packet->Cascades[i]);
+        }
+        out_packet->CascadeCount = kCascadeCount;
+    }
+
+    void LightingManager::Bind(FramePacket const& packet, float targetWidth, float targetHeight, ID3D11DeviceContext* context)
+    {
+        cbLighting lightData = packet.Lighting;
+        lightData.clusterParams.z = (float)LightBinner::kClustersX / targetWidth;
+        lightData.clusterParams.w = (float)LightBinner::kClustersY / targetHeight;
+
+        // Overwrite constant buffer
+        ConstantBufferUpdateManager::MapUnmap(&mBindPacket, (void*)&lightData, context);
+
+        // Only as much as was binned, the ranges never point past it
+        const ClusteredLights& clusters = packet.Clusters;
+        if (clusters.LightCount)
+            StructuredBufferUpdateManager::MapUnmap(&mClusterLightsBuffer, clusters.Lights, clusters.LightCount, context);
+        if (clusters.IndexCount)
+            StructuredBufferUpdateManager::MapUnmap(&mLightIndicesBuffer, clusters.Indices, clusters.IndexCount, context);
+        StructuredBufferUpdateManager::MapUnmap(&mClusterRangesBuffer, clusters.Ranges, LightBinner::kClusterCount, context);
+
+        StructuredBufferUpdateManager::Bind(&mClusterLightsBuffer, context);
+        StructuredBufferUpdateManager::Bind(&mClusterRangesBuffer, context);
+        StructuredBufferUpdateManager::Bind(&mLightIndicesBuffer, context);
     }
 
     // AAA Case: Bring in lights directly from a "world editor" of some sort, which exports light positions, colors, etc for environment artists
@@ -44,18 +132,53 @@ namespace Renderer
         mLightData.cameraWorldPos.z = cameraPos.z;
     }
 
-    void LightingManager::UpdateLights(float dt, DirectX::XMFLOAT3A cameraPos, ID3D11DeviceContext* context)
+    void LightingManager::AddStressLights(uint32_t count)
+    {
+        // A square grid of small lights over the cubes and a little past them, every fourth a spot pointing down
+        count = std::min(count, LightBinner::kMaxLights);
+        const uint32_t gridWidth = (uint32_t)ceilf(sqrtf((float)count));
+        const float kSpacing = 0.8f;
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            const uint32_t x = i % gridWidth;
+            const uint32_t z = i / gridWidth;
+            const float position[3] = { -3.0f + x * kSpacing, 1.0f + 0.25f * (float)((x + z) % 3), -3.0f + z * kSpacing };
+            const float color[3] = { 0.3f + 0.3f * (float)(x % 3), 0.3f + 0.3f * (float)(z % 3), 0.3f + 0.3f * (float)((x + 2 * z) % 3) };
+
+            if (i % 4 == 3)
+            {
+                const float down[3] = { 0.0f, -1.0f, 0.0f };
+                mLights.AddSpotLight(position, 3.0f, color, down, 0.35f, 0.6f);
+            }
+            else
+            {
+                mLights.AddPointLight(position, 1.5f, color);
+            }
+
+            mOriginsX.push_back(position[0]);
+            mOriginsZ.push_back(position[2]);
+        }
+    }
+
+    void LightingManager::UpdateLights(float totalTime, DirectX::XMFLOAT3A cameraPos)
     {
         // Logic to update the light's direction or something
         const float lightSpeed = 2.0f;
         DirectionalLight& light = mLightData.directionalLight;
-        light.toLight.x = cosf(lightSpeed * dt);
-        light.toLight.z = sinf(lightSpeed * dt);
+        light.toLight.x = cosf(lightSpeed * totalTime);
+        light.toLight.z = sinf(lightSpeed * totalTime);
 
         // Overwrite held camera position
         mLightData.cameraWorldPos = cameraPos;
 
-        // Overwrite constant buffer
-        ConstantBufferUpdateManager::MapUnmap(&mBindPacket, &mLightData, context);
+        // Small circles, each one a little out of phase with the last. Plain loops over the arrays, which vectorize.
+        const uint32_t lightCount = mLights.GetCount();
+        const float radius = 0.3f;
+        for (uint32_t i = 0; i != lightCount; ++i)
+        {
+            const float angle = totalTime + 0.37f * (float)i;
+            mLights.PositionX[i] = mOriginsX[i] + radius * cosf(angle);
+            mLights.PositionZ[i] = mOriginsZ[i] + radius * sinf(angle);
+        }
     }
 }
\ No newline at end of file
@@ -8,18 +8,55 @@ Description : Interface for management of lights in the scene
 
 #include "DXCore.h"
 #include "CBufferStructs.h"
+#include "ClusteredLighting.h"
 #include "ConstantBuffer.h"
+#include "StructuredBuffer.h"
+
+#include <Easel/Core/Allocators.h>
+
+namespace Core
+{
+    class WorkerPool;
+}
 
 namespace Renderer {
 
+class Camera;
+struct FramePacket;
+
 class LightingManager
 {
 public:
+    // Sun shadows: cascades over the first kShadowDistance of the view, each kShadowResolution squared
+    static constexpr uint32_t kCascadeCount = 4;
+    static constexpr uint32_t kShadowResolution = 2048;
+    static constexpr float kShadowDistance = 60.0f;
+    static constexpr float kSplitLambda = 0.75f;
+
+    // A null device makes one for a headless run, which never binds
     LightingManager(ID3D11Device* device, ID3D11DeviceContext* context, DirectX::XMFLOAT3A cameraPos);
     LightingManager()  = delete;
     ~LightingManager();
 
-    void Update(ID3D11DeviceContext* context, float dt, DirectX::XMFLOAT3A cameraPos);
+    // Lays out up to count point and spot lights in a grid over the scene, for perf runs. Before the threads start.
+    void AddStressLights(uint32_t count);
+
+    // Gives the packet room for its light lists. Once per packet, before the threads start.
+    void InitFramePacket(FramePacket* packet);
+
+    // Simulation thread: moves the lights, totalTime being what's on screen
+    void Update(float totalTime, DirectX::XMFLOAT3A cameraPos);
+    cbLighting const& GetLightData() const { return mLightData; }
+
+    // Simulation thread, after Update and once the camera is: bins the point and spot lights into the packet's
+    // clusters, and fills in its cbuffer copy. pPool may be null.
+    void Cluster(Camera const& camera, FramePacket* out_packet, Core::WorkerPool* pPool);
+
+    // Simulation thread, after Update and once the camera is: fits the sun's shadow cascades around the view
+    void FitShadowCascades(Camera const& camera, FramePacket* out_packet) const;
+
+    // Render thread: writes the light cbuffer and the cluster buffers from a frame packet, for a target of the given size
+    void Bind(FramePacket const& packet, float targetWidth, float targetHeight, ID3D11DeviceContext* context);
     
     // Public Setter for the scene to be able to change the ambient color in the light buffer
     inline void SetAmbient(DirectX::XMFLOAT3A ambientColor)
@@ -28,17 +65,33 @@ public:
     }
 
 private:
-    // Initializes the data for each directional light
+    // Initializes the ambient and directional light
     void InitLights(DirectX::XMFLOAT3A cameraPos);
 
-    // Updates the data in each directional light
-    void UpdateLights(float dt, DirectX::XMFLOAT3A cameraPos, ID3D11DeviceContext* context);
+    // Updates the directional light and moves the others about where they started
+    void UpdateLights(float totalTime, DirectX::XMFLOAT3A cameraPos);
 
 private:
     ConstantBufferBindPacket mBindPacket;
 
+    // Lights, light indices and each cluster's range of them
+    StructuredBufferBindPacket mClusterLightsBuffer;
+    StructuredBufferBindPacket mClusterRangesBuffer;
+    StructuredBufferBindPacket mLightIndicesBuffer;
+
     // Constant buffer struct
     cbLighting mLightData;
+
+    // Point and spot lights, and where each one circles around
+    LightSet           mLights;
+    std::vector<float> mOriginsX;
+    std::vector<float> mOriginsZ;
+
+    // Simulation thread only
+    LightBinner        mBinner;
+
+    // Backs the packets' light lists
+    Core::LinearArena  mPacketMemory;
 };
 
 }
@@ -8,12 +8,8 @@ Description : Material class for shader information
 
 #include "DXCore.h"
 #include "CBufferStructs.h"
-
-namespace Renderer
-{
-struct VertexShader;
-struct PixelShader;
-}
+#include "PipelineState.h"
+#include "Shader.h"
 
 namespace Renderer {
 
@@ -32,16 +28,26 @@ struct ResourceBindChord
     ID3D11ShaderResourceView*  SRVs[(UINT)TextureSlots::COUNT];
 };
 
-// Materials own both VS and PS because they must match in the pipeline
+// Standalone texture sets and whole texture banks live in the same table
+typedef ResourceHandle<ResourceBindChord> TextureHandle;
+
+// Location of a texture set packed into a bank of Texture2DArrays (one array per slot)
+struct TextureBankSlice
+{
+    TextureHandle Bank;
+    uint32_t      Slice;
+};
+
+// The pipeline state holds the VS and PS, because they must match, along with every fixed function state.
+// Materials hold handles rather than pointers, so the codex tables are free to grow after materials exist.
 struct Material
 {
-    const VertexShader*         VS = nullptr;
-    const PixelShader*          PS = nullptr;;
-    const ResourceBindChord*    Resources = nullptr;
-    ID3D11RasterizerState*      RasterStateOverride = nullptr;
-    ID3D11DepthStencilState*    DepthStencilStateOverride = nullptr;
+    PipelineStateHandle         Pipeline;
+    TextureHandle               Resources;
     cbMaterialParams            Description;
 };
+
+typedef ResourceHandle<Material> MaterialHandle;
     
 
 }
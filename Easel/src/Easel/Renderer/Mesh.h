@@ -6,18 +6,24 @@ Description : Mesh stores the vertex,index buffers ready to be drawn by DirectX
 #ifndef EASEL_MESH_H
 #define EASEL_MESH_H
 
+#include "Culling.h"
 #include "DXCore.h"
+#include "ResourceTable.h"
 #include "Shader.h"
 
 namespace Renderer {
 struct Mesh
 {
-    ID3D11Buffer* VertexBuffer;
-    ID3D11Buffer* IndexBuffer;
-    UINT          IndexCount;
-    UINT          Stride;
+    ID3D11Buffer*  VertexBuffer;
+    ID3D11Buffer*  IndexBuffer;
+    UINT           IndexCount;
+    UINT           VertexCount;
+    UINT           Stride;
+    BoundingSphere Bounds;       // Model space
 };
 
+typedef ResourceHandle<Mesh> MeshHandle;
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,483 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of OcclusionCulling.h
+----------------------------------------------*/
+#include "OcclusionCulling.h"
+
+#include <Easel/Core/Clock.h>
+#include <Easel/Core/Profiler.h>
+#include <Easel/Core/WorkerPool.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <emmintrin.h>
+
+namespace Renderer {
+
+namespace {
+
+// Occluder instances set up by one job
+static const uint32_t kSetupBatch = 64;
+
+// Past this many viewports off to the side, float edge functions stop being trustworthy. Only triangles
+// nearly touching the near plane get that far, and those are dropped, which only costs some occlusion.
+static const float kGuardBand = 1000.0f;
+
+void ForEach(Core::WorkerPool* pPool, uint32_t count, void (*func)(void* pContext, uint32_t index), void* pContext)
+{
+    if (pPool)
+    {
+        pPool->Dispatch(count, func, pContext);
+        return;
+    }
+
+    for (uint32_t i = 0; i != count; ++i)
+        func(pContext, i);
+}
+
+void Multiply(const float* a, const float* b, float* out)
+{
+    for (int row = 0; row != 4; ++row)
+        for (int col = 0; col != 4; ++col)
+            out[row * 4 + col] = a[row * 4 + 0] * b[0 * 4 + col] + a[row * 4 + 1] * b[1 * 4 + col] +
+                                 a[row * 4 + 2] * b[2 * 4 + col] + a[row * 4 + 3] * b[3 * 4 + col];
+}
+
+}
+
+void OcclusionCuller::Init(uint32_t width, uint32_t height)
+{
+    assert(width && height);
+
+    mWidth = (width + kBandHeight - 1) / kBandHeight * kBandHeight;
+    mHeight = (height + kBandHeight - 1) / kBandHeight * kBandHeight;
+
+    mLevels.clear();
+    mLevelWidths.clear();
+    mLevelHeights.clear();
+    for (uint32_t w = mWidth, h = mHeight; ; w = (w + 1) / 2, h = (h + 1) / 2)
+    {
+        mLevels.emplace_back((size_t)w * h, 1.0f);
+        mLevelWidths.push_back(w);
+        mLevelHeights.push_back(h);
+        if (w == 1 && h == 1)
+            break;
+    }
+}
+
+uint32_t OcclusionCuller::AddOccluderMesh(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+    assert(indexCount % 3 == 0);
+
+    OccluderMesh mesh;
+    mesh.Positions.assign(positions, positions + vertexCount * 3);
+    mesh.Indices.assign(indices, indices + indexCount);
+    mMeshes.push_back(std::move(mesh));
+    return (uint32_t)mMeshes.size() - 1;
+}
+
+void OcclusionCuller::BeginFrame(const float* viewProjection)
+{
+    memcpy(mViewProjection, viewProjection, sizeof(mViewProjection));
+    mDraws.clear();
+    mStats = OcclusionStats();
+}
+
+void OcclusionCuller::AddOccluders(uint32_t mesh, const float* worldMatrices, const uint32_t* instances, uint32_t count)
+{
+    assert(mesh < mMeshes.size());
+    if (count)
+        mDraws.push_back({ mesh, worldMatrices, instances, count });
+}
+
+void OcclusionCuller::RasterizeOccluders(Core::WorkerPool* pPool)
+{
+    ESL_PROFILE_ZONE("OcclusionCuller::RasterizeOccluders");
+    assert(!mLevels.empty() && "Init the culler first");
+
+    const uint64_t start = Core::Clock::Now();
+
+    mJobCount = 0;
+    for (uint32_t d = 0; d != (uint32_t)mDraws.size(); ++d)
+    {
+        for (uint32_t first = 0; first < mDraws[d].Count; first += kSetupBatch)
+        {
+            if (mJobCount == mJobs.size())
+                mJobs.emplace_back();
+
+            SetupJob& job = mJobs[mJobCount++];
+            job.Draw = d;
+            job.First = first;
+            job.Count = std::min(kSetupBatch, mDraws[d].Count - first);
+        }
+    }
+
+    // Setup, then every band clears and fills its own rows, so no two threads ever write the same pixel
+    ForEach(pPool, mJobCount, &OcclusionCuller::RunSetupJob, this);
+    ForEach(pPool, mHeight / kBandHeight, &OcclusionCuller::RunBandJob, this);
+    BuildPyramid();
+
+    for (uint32_t j = 0; j != mJobCount; ++j)
+        mStats.OccluderTriangles += (uint32_t)mJobs[j].Triangles.size();
+    mStats.RasterMs = Core::Clock::TicksToSeconds(Core::Clock::Now() - start) * 1000.0;
+}
+
+void OcclusionCuller::RunSetupJob(void* pContext, uint32_t job)
+{
+    OcclusionCuller* self = static_cast<OcclusionCuller*>(pContext);
+    self->SetupOccluders(self->mJobs[job]);
+}
+
+void OcclusionCuller::RunBandJob(void* pContext, uint32_t band)
+{
+    static_cast<OcclusionCuller*>(pContext)->RasterizeBand(band);
+}
+
+void OcclusionCuller::SetupOccluders(SetupJob& job)
+{
+    const OccluderDraw& draw = mDraws[job.Draw];
+    const OccluderMesh& mesh = mMeshes[draw.Mesh];
+    const uint32_t vertexCount = (uint32_t)mesh.Positions.size() / 3;
+
+    job.Triangles.clear();
+    job.Clip.resize(vertexCount * 4);
+
+    const float width = (float)mWidth;
+    const float height = (float)mHeight;
+
+    for (uint32_t i = job.First; i != job.First + job.Count; ++i)
+    {
+        const uint32_t instance = draw.Instances ? draw.Instances[i] : i;
+
+        // World and view projection in one, so every vertex is a single transform
+        float m[16];
+        Multiply(draw.WorldMatrices + instance * 16, mViewProjection, m);
+        for (uint32_t v = 0; v != vertexCount; ++v)
+        {
+            const float* p = &mesh.Positions[v * 3];
+            float* clip = &job.Clip[v * 4];
+            for (uint32_t k = 0; k != 4; ++k)
+                clip[k] = p[0] * m[k] + p[1] * m[4 + k] + p[2] * m[8 + k] + m[12 + k];
+        }
+
+        for (size_t t = 0; t < mesh.Indices.size(); t += 3)
+        {
+            float x[3], y[3], z[3];
+            bool usable = true;
+            for (uint32_t v = 0; v != 3; ++v)
+            {
+                const float* clip = &job.Clip[mesh.Indices[t + v] * 4];
+
+                // Not clipped: a triangle poking through the near plane is dropped, it only occludes less.
+                // z >= 0 also means w > 0.
+                if (clip[2] < 0.0f)
+                {
+                    usable = false;
+                    break;
+                }
+
+                const float invW = 1.0f / clip[3];
+                const float ndcX = clip[0] * invW;
+                const float ndcY = clip[1] * invW;
+                if (fabsf(ndcX) > kGuardBand || fabsf(ndcY) > kGuardBand)
+                {
+                    usable = false;
+                    break;
+                }
+
+                x[v] = (ndcX * 0.5f + 0.5f) * width;
+                y[v] = (0.5f - ndcY * 0.5f) * height;
+                z[v] = clip[2] * invW;
+            }
+            if (!usable)
+                continue;
+
+            // Clockwise is the front, as with SoftwareRasterizer. Back faces of a closed hull are behind its front faces.
+            const float dx1 = x[1] - x[0];
+            const float dy1 = y[1] - y[0];
+            const float dx2 = x[2] - x[0];
+            const float dy2 = y[2] - y[0];
+            const float area = dx1 * dy2 - dx2 * dy1;
+            if (!(area > 0.0f))
+                continue;
+
+            // Pixels whose centre could be inside
+            Triangle triangle;
+            triangle.MinX = std::max((int32_t)ceilf(std::min({ x[0], x[1], x[2] }) - 0.5f), 0);
+            triangle.MinY = std::max((int32_t)ceilf(std::min({ y[0], y[1], y[2] }) - 0.5f), 0);
+            triangle.MaxX = std::min((int32_t)floorf(std::max({ x[0], x[1], x[2] }) - 0.5f), (int32_t)mWidth - 1);
+            triangle.MaxY = std::min((int32_t)floorf(std::max({ y[0], y[1], y[2] }) - 0.5f), (int32_t)mHeight - 1);
+            if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+                continue;
+
+            // Everything relative to the centre of the first pixel in the box, so the constants stay small
+            const double originX = triangle.MinX + 0.5;
+            const double originY = triangle.MinY + 0.5;
+            for (uint32_t e = 0; e != 3; ++e)
+            {
+                const uint32_t next = e != 2 ? e + 1 : 0;
+                const float a = y[e] - y[next];
+                const float b = x[next] - x[e];
+                triangle.EdgeA[e] = a;
+                triangle.EdgeB[e] = b;
+                triangle.EdgeC[e] = (float)((double)a * (originX - x[e]) + (double)b * (originY - y[e]));
+            }
+
+            // The plane is pushed back by as much as it can change within half a pixel, so a pixel's depth is never
+            // nearer than the farthest the triangle gets inside it. It never goes past the farthest corner either.
+            const float invArea = 1.0f / area;
+            const float dz1 = z[1] - z[0];
+            const float dz2 = z[2] - z[0];
+            triangle.DepthA = (dz1 * dy2 - dz2 * dy1) * invArea;
+            triangle.DepthB = (dx1 * dz2 - dx2 * dz1) * invArea;
+            triangle.DepthC = z[0] + triangle.DepthA * (float)(originX - x[0]) + triangle.DepthB * (float)(originY - y[0]) +
+                              0.5f * (fabsf(triangle.DepthA) + fabsf(triangle.DepthB));
+            triangle.MaxDepth = std::max({ z[0], z[1], z[2] });
+
+            job.Triangles.push_back(triangle);
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeBand(uint32_t band)
+{
+    const int32_t bandMinY = (int32_t)(band * kBandHeight);
+    const int32_t bandMaxY = bandMinY + (int32_t)kBandHeight - 1;
+
+    float* depth = mLevels[0].data();
+    std::fill(depth + bandMinY * mWidth, depth + (bandMaxY + 1) * mWidth, 1.0f);
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    for (uint32_t j = 0; j != mJobCount; ++j)
+    {
+        for (const Triangle& triangle : mJobs[j].Triangles)
+        {
+            if (triangle.MaxY < bandMinY || triangle.MinY > bandMaxY)
+                continue;
+
+            // Four pixels at a time from a multiple of four, the width is one too so it never runs over a row
+            const int32_t startX = triangle.MinX & ~3;
+            const __m128 offsetX = _mm_add_ps(_mm_set1_ps((float)(startX - triangle.MinX)), lanes);
+
+            __m128 stepA[3], rowA[3];
+            for (uint32_t e = 0; e != 3; ++e)
+            {
+                stepA[e] = _mm_set1_ps(triangle.EdgeA[e] * 4.0f);
+                rowA[e] = _mm_mul_ps(_mm_set1_ps(triangle.EdgeA[e]), offsetX);
+            }
+            const __m128 depthStep = _mm_set1_ps(triangle.DepthA * 4.0f);
+            const __m128 depthRow = _mm_mul_ps(_mm_set1_ps(triangle.DepthA), offsetX);
+            const __m128 maxDepth = _mm_set1_ps(triangle.MaxDepth);
+
+            const int32_t minY = std::max(triangle.MinY, bandMinY);
+            const int32_t maxY = std::min(triangle.MaxY, bandMaxY);
+            for (int32_t y = minY; y <= maxY; ++y)
+            {
+                const float dy = (float)(y - triangle.MinY);
+                __m128 e0 = _mm_add_ps(_mm_set1_ps(triangle.EdgeC[0] + triangle.EdgeB[0] * dy), rowA[0]);
+                __m128 e1 = _mm_add_ps(_mm_set1_ps(triangle.EdgeC[1] + triangle.EdgeB[1] * dy), rowA[1]);
+                __m128 e2 = _mm_add_ps(_mm_set1_ps(triangle.EdgeC[2] + triangle.EdgeB[2] * dy), rowA[2]);
+                __m128 z = _mm_add_ps(_mm_set1_ps(triangle.DepthC + triangle.DepthB * dy), depthRow);
+
+                float* row = depth + y * mWidth;
+                for (int32_t x = startX; x <= triangle.MaxX; x += 4)
+                {
+                    const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                    if (_mm_movemask_ps(inside))
+                    {
+                        const __m128 current = _mm_loadu_ps(row + x);
+                        const __m128 nearest = _mm_min_ps(current, _mm_min_ps(z, maxDepth));
+                        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+                    }
+
+                    e0 = _mm_add_ps(e0, stepA[0]);
+                    e1 = _mm_add_ps(e1, stepA[1]);
+                    e2 = _mm_add_ps(e2, stepA[2]);
+                    z = _mm_add_ps(z, depthStep);
+                }
+            }
+        }
+    }
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+    // A few thousand texels past level 0, so one thread does them all
+    for (size_t level = 1; level != mLevels.size(); ++level)
+    {
+        const float* src = mLevels[level - 1].data();
+        const uint32_t srcWidth = mLevelWidths[level - 1];
+        const uint32_t srcHeight = mLevelHeights[level - 1];
+        float* dst = mLevels[level].data();
+
+        for (uint32_t y = 0; y != mLevelHeights[level]; ++y)
+        {
+            const float* row0 = src + (y * 2) * srcWidth;
+            const float* row1 = src + std::min(y * 2 + 1, srcHeight - 1) * srcWidth;
+            for (uint32_t x = 0; x != mLevelWidths[level]; ++x)
+            {
+                const uint32_t x0 = x * 2;
+                const uint32_t x1 = std::min(x0 + 1, srcWidth - 1);
+                dst[y * mLevelWidths[level] + x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(BoundingSphere const& sphere) const
+{
+    uint8_t visible;
+    const uint32_t index = 0;
+    TestSpheres(&sphere, &index, 1, &visible);
+    return visible != 0;
+}
+
+void OcclusionCuller::TestSpheres(const BoundingSphere* spheres, const uint32_t* indices, uint32_t count, uint8_t* out_visible) const
+{
+    const float* m = mViewProjection;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 width = _mm_set1_ps((float)mWidth);
+    const __m128 height = _mm_set1_ps((float)mHeight);
+
+    for (uint32_t first = 0; first < count; first += 4)
+    {
+        // One sphere per lane, the last one repeated to fill a short group
+        const BoundingSphere* lane[4];
+        for (uint32_t l = 0; l != 4; ++l)
+            lane[l] = &spheres[indices[std::min(first + l, count - 1)]];
+        const __m128 x = _mm_setr_ps(lane[0]->X, lane[1]->X, lane[2]->X, lane[3]->X);
+        const __m128 y = _mm_setr_ps(lane[0]->Y, lane[1]->Y, lane[2]->Y, lane[3]->Y);
+        const __m128 z = _mm_setr_ps(lane[0]->Z, lane[1]->Z, lane[2]->Z, lane[3]->Z);
+        const __m128 r = _mm_setr_ps(lane[0]->Radius, lane[1]->Radius, lane[2]->Radius, lane[3]->Radius);
+
+        // The box around each sphere in clip space: its centre, and where a step of the radius along each world axis goes
+        __m128 centre[4], axis[3][4];
+        for (uint32_t k = 0; k != 4; ++k)
+        {
+            centre[k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(m[k])), _mm_mul_ps(y, _mm_set1_ps(m[4 + k]))),
+                                   _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(m[8 + k])), _mm_set1_ps(m[12 + k])));
+            for (uint32_t a = 0; a != 3; ++a)
+                axis[a][k] = _mm_mul_ps(r, _mm_set1_ps(m[a * 4 + k]));
+        }
+
+        // Every corner, since depth over a box is only ever nearest at one of them. Built up an axis at a time.
+        __m128 corners[8][4];
+        for (uint32_t k = 0; k != 4; ++k)
+        {
+            const __m128 alongZ[2] = { _mm_add_ps(centre[k], axis[2][k]), _mm_sub_ps(centre[k], axis[2][k]) };
+            for (uint32_t i = 0; i != 2; ++i)
+            {
+                const __m128 alongY[2] = { _mm_add_ps(alongZ[i], axis[1][k]), _mm_sub_ps(alongZ[i], axis[1][k]) };
+                for (uint32_t j = 0; j != 2; ++j)
+                {
+                    corners[i * 4 + j * 2 + 0][k] = _mm_add_ps(alongY[j], axis[0][k]);
+                    corners[i * 4 + j * 2 + 1][k] = _mm_sub_ps(alongY[j], axis[0][k]);
+                }
+            }
+        }
+
+        __m128 minClipZ = _mm_set1_ps(FLT_MAX);
+        __m128 minNdcX = _mm_set1_ps(FLT_MAX), maxNdcX = _mm_set1_ps(-FLT_MAX);
+        __m128 minNdcY = _mm_set1_ps(FLT_MAX), maxNdcY = _mm_set1_ps(-FLT_MAX);
+        __m128 minNdcZ = _mm_set1_ps(FLT_MAX);
+        for (const __m128* clip : corners)
+        {
+            const __m128 invW = _mm_div_ps(one, clip[3]);
+            const __m128 ndcX = _mm_mul_ps(clip[0], invW);
+            const __m128 ndcY = _mm_mul_ps(clip[1], invW);
+            minClipZ = _mm_min_ps(minClipZ, clip[2]);
+            minNdcX = _mm_min_ps(minNdcX, ndcX);
+            maxNdcX = _mm_max_ps(maxNdcX, ndcX);
+            minNdcY = _mm_min_ps(minNdcY, ndcY);
+            maxNdcY = _mm_max_ps(maxNdcY, ndcY);
+            minNdcZ = _mm_min_ps(minNdcZ, _mm_mul_ps(clip[2], invW));
+        }
+
+        // Any corner in front of the near plane and the camera could be inside it. z >= 0 also means w > 0.
+        const int crossesNear = _mm_movemask_ps(_mm_cmplt_ps(minClipZ, zero));
+
+        float minX[4], maxX[4], minY[4], maxY[4], nearestZ[4];
+        _mm_storeu_ps(minX, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(minNdcX, half), half), width));
+        _mm_storeu_ps(maxX, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(maxNdcX, half), half), width));
+        _mm_storeu_ps(minY, _mm_mul_ps(_mm_sub_ps(half, _mm_mul_ps(maxNdcY, half)), height));
+        _mm_storeu_ps(maxY, _mm_mul_ps(_mm_sub_ps(half, _mm_mul_ps(minNdcY, half)), height));
+        _mm_storeu_ps(nearestZ, minNdcZ);
+
+        for (uint32_t l = 0; l != 4 && first + l != count; ++l)
+        {
+            // Off screen is for frustum culling to decide
+            if ((crossesNear & (1 << l)) || maxX[l] < 0.0f || maxY[l] < 0.0f || minX[l] >= (float)mWidth || minY[l] >= (float)mHeight)
+            {
+                out_visible[first + l] = 1;
+                continue;
+            }
+
+            // Every pixel the box touches, then the finest level where that's at most 2x2 texels
+            uint32_t x0 = (uint32_t)std::max(minX[l], 0.0f);
+            uint32_t y0 = (uint32_t)std::max(minY[l], 0.0f);
+            uint32_t x1 = (uint32_t)std::min(maxX[l], (float)mWidth - 1.0f);
+            uint32_t y1 = (uint32_t)std::min(maxY[l], (float)mHeight - 1.0f);
+            size_t level = 0;
+            while ((x1 - x0 > 1 || y1 - y0 > 1) && level + 1 != mLevels.size())
+            {
+                x0 >>= 1;
+                y0 >>= 1;
+                x1 >>= 1;
+                y1 >>= 1;
+                ++level;
+            }
+
+            const float* depth = mLevels[level].data();
+            const uint32_t levelWidth = mLevelWidths[level];
+            const float farthest = std::max(std::max(depth[y0 * levelWidth + x0], depth[y0 * levelWidth + x1]),
+                                            std::max(depth[y1 * levelWidth + x0], depth[y1 * levelWidth + x1]));
+            out_visible[first + l] = nearestZ[l] <= farthest ? 1 : 0;
+        }
+    }
+}
+
+uint32_t OcclusionCuller::CullSpheres(const BoundingSphere* spheres, uint32_t* inout_indices, uint32_t count, Core::WorkerPool* pPool)
+{
+    ESL_PROFILE_ZONE("OcclusionCuller::CullSpheres");
+
+    const uint64_t start = Core::Clock::Now();
+    if (mVisible.size() < count)
+        mVisible.resize(count);
+
+    TestContext context = { this, spheres, inout_indices, count };
+    ForEach(pPool, (count + kTestBatch - 1) / kTestBatch, &OcclusionCuller::RunTestJob, &context);
+
+    // Same branchless compaction as Culling::CullSpheres
+    uint32_t visibleCount = 0;
+    for (uint32_t i = 0; i != count; ++i)
+    {
+        inout_indices[visibleCount] = inout_indices[i];
+        visibleCount += mVisible[i];
+    }
+
+    mStats.Tested += count;
+    mStats.Occluded += count - visibleCount;
+    mStats.TestMs += Core::Clock::TicksToSeconds(Core::Clock::Now() - start) * 1000.0;
+    return visibleCount;
+}
+
+void OcclusionCuller::RunTestJob(void* pContext, uint32_t batch)
+{
+    const TestContext* context = static_cast<const TestContext*>(pContext);
+    OcclusionCuller* self = context->pCuller;
+
+    const uint32_t first = batch * kTestBatch;
+    const uint32_t last = std::min(first + kTestBatch, context->Count);
+    self->TestSpheres(context->pSpheres, context->pIndices + first, last - first, &self->mVisible[first]);
+}
+
+}
@@ -0,0 +1,160 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Device independent occlusion culling against a coarse depth
+buffer. Designated occluders, closed hulls that lie inside what they stand
+for, are rasterized on the CPU at low resolution, four pixels at a time,
+in horizontal bands spread over a WorkerPool. The nearest depth in every
+pixel is then reduced into a max pyramid, so a box can be tested with at
+most four reads: it's hidden when its nearest point is behind the farthest
+occluder depth over the pixels it covers.
+Coverage is taken at pixel centres, like the GPU does, so something that
+peeks out past an occluder's silhouette by less than a coarse pixel can be
+culled. Depth is made conservative over each pixel.
+Like Culling.h, matrices are row-major float[16] in the DirectXMath convention.
+----------------------------------------------*/
+#ifndef EASEL_OCCLUSIONCULLING_H
+#define EASEL_OCCLUSIONCULLING_H
+
+#include "Culling.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace Core
+{
+class WorkerPool;
+}
+
+namespace Renderer {
+
+struct OcclusionStats
+{
+    uint32_t OccluderTriangles = 0;     // Front facing and in front of the near plane
+    uint32_t Tested = 0;
+    uint32_t Occluded = 0;
+    double   RasterMs = 0.0;            // Occluder setup, rasterization and the pyramid
+    double   TestMs = 0.0;
+};
+
+class OcclusionCuller
+{
+public:
+    // Rows rasterized by one job. Both dimensions are rounded up to a multiple of it.
+    static constexpr uint32_t kBandHeight = 16;
+
+    OcclusionCuller() = default;
+
+    // The depth buffer size. It only has to be coarse: 256x128 is plenty for a 1080p view.
+    void Init(uint32_t width, uint32_t height);
+
+    // xyz model space positions and a clockwise triangle list. It has to be closed and lie inside
+    // whatever draws with it, or things behind it get culled that shouldn't. Returns the index to add it with.
+    uint32_t AddOccluderMesh(const float* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+    // Forgets last frame's occluders
+    void BeginFrame(const float* viewProjection);
+
+    // worldMatrices[instances[i]] for every i, or the first count matrices without a list.
+    // Nothing is copied, so the matrices and the list have to stay put until RasterizeOccluders.
+    void AddOccluders(uint32_t mesh, const float* worldMatrices, const uint32_t* instances, uint32_t count);
+
+    // Draws every occluder and builds the pyramid. pPool may be null or have no workers.
+    void RasterizeOccluders(Core::WorkerPool* pPool);
+
+    // Tests the box around a world space sphere. True unless it's certainly hidden.
+    bool IsVisible(BoundingSphere const& sphere) const;
+
+    // Keeps the indices whose sphere isn't hidden, in order, and returns how many there are.
+    // It's meant to run on what frustum culling kept, boxes that leave the screen are kept.
+    uint32_t CullSpheres(const BoundingSphere* spheres, uint32_t* inout_indices, uint32_t count, Core::WorkerPool* pPool);
+
+    uint32_t GetWidth() const  { return mWidth; }
+    uint32_t GetHeight() const { return mHeight; }
+
+    // Nearest occluder depth per pixel, 1 where there is none. Row after row, GetWidth() floats each.
+    const float* GetDepth() const { return mLevels.empty() ? nullptr : mLevels[0].data(); }
+
+    OcclusionStats const& GetStats() const { return mStats; }
+
+private:
+    struct OccluderMesh
+    {
+        std::vector<float>    Positions;
+        std::vector<uint32_t> Indices;
+    };
+
+    struct OccluderDraw
+    {
+        uint32_t        Mesh;
+        const float*    WorldMatrices;
+        const uint32_t* Instances;
+        uint32_t        Count;
+    };
+
+    // Edge functions and depth in pixels, evaluated at pixel centres
+    struct Triangle
+    {
+        float   EdgeA[3];
+        float   EdgeB[3];
+        float   EdgeC[3];
+        float   DepthA, DepthB, DepthC;     // Already pushed back to the farthest depth inside the pixel
+        float   MaxDepth;
+        int32_t MinX, MinY, MaxX, MaxY;     // Inclusive and on screen
+    };
+
+    // A run of occluder instances, set up by whichever thread claims it
+    struct SetupJob
+    {
+        uint32_t              Draw;
+        uint32_t              First;
+        uint32_t              Count;
+        std::vector<Triangle> Triangles;
+        std::vector<float>    Clip;         // One instance's vertices at a time
+    };
+
+    struct TestContext
+    {
+        OcclusionCuller*      pCuller;
+        const BoundingSphere* pSpheres;
+        const uint32_t*       pIndices;
+        uint32_t              Count;
+    };
+
+    static constexpr uint32_t kTestBatch = 512;
+
+    static void RunSetupJob(void* pContext, uint32_t job);
+    static void RunBandJob(void* pContext, uint32_t band);
+    static void RunTestJob(void* pContext, uint32_t batch);
+
+    void SetupOccluders(SetupJob& job);
+    void RasterizeBand(uint32_t band);
+    void BuildPyramid();
+
+    // spheres[indices[i]] for every i, four at a time. 1 for the ones that could be visible.
+    void TestSpheres(const BoundingSphere* spheres, const uint32_t* indices, uint32_t count, uint8_t* out_visible) const;
+
+    uint32_t                     mWidth = 0;
+    uint32_t                     mHeight = 0;
+    std::vector<OccluderMesh>    mMeshes;
+
+    float                        mViewProjection[16];
+    std::vector<OccluderDraw>    mDraws;
+    std::vector<SetupJob>        mJobs;         // Kept between frames with their capacity, only mJobCount are live
+    uint32_t                     mJobCount = 0;
+
+    // Level 0 is the depth buffer, every next one the max of 2x2 from the one before, down to a single pixel
+    std::vector<std::vector<float>> mLevels;
+    std::vector<uint32_t>        mLevelWidths;
+    std::vector<uint32_t>        mLevelHeights;
+
+    std::vector<uint8_t>         mVisible;      // CullSpheres' verdicts, one per index it was given
+    OcclusionStats               mStats;
+
+public:
+    OcclusionCuller(OcclusionCuller const&)            = delete;
+    OcclusionCuller& operator=(OcclusionCuller const&) = delete;
+};
+
+}
+#endif
@@ -0,0 +1,40 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of PipelineState.h
+----------------------------------------------*/
+#include "PipelineState.h"
+
+#include "hash_util.h"
+
+#include <string.h>
+
+namespace Renderer {
+
+uint32_t PipelineStateDesc::GetRasterKey() const
+{
+    if (Fill == D3D11_FILL_SOLID && Cull == D3D11_CULL_BACK && DepthClip)
+        return 0;
+
+    return (uint32_t)Fill | ((uint32_t)Cull << 8) | ((uint32_t)DepthClip << 16);
+}
+
+uint32_t PipelineStateDesc::GetDepthStencilKey() const
+{
+    if (DepthEnable && DepthWrite && DepthFunc == D3D11_COMPARISON_LESS)
+        return 0;
+
+    return (uint32_t)DepthEnable | ((uint32_t)DepthWrite << 8) | ((uint32_t)DepthFunc << 16);
+}
+
+uint64_t PipelineStateDesc::GetHash() const
+{
+    return fnv1a_64(this, sizeof(*this));
+}
+
+bool PipelineStateDesc::operator==(const PipelineStateDesc& other) const
+{
+    return !memcmp(this, &other, sizeof(*this));
+}
+
+}
@@ -0,0 +1,74 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Everything a draw binds besides its buffers and textures:
+input layout, shaders, raster, depth-stencil and blend state, as one
+immutable object. The codex keeps one per distinct desc, so materials
+that want the same pipeline share it, and each distinct raster, depth or
+blend state is only created once however many pipelines use it.
+----------------------------------------------*/
+#ifndef EASEL_PIPELINESTATE_H
+#define EASEL_PIPELINESTATE_H
+
+#include "DXCore.h"
+#include "ResourceTable.h"
+#include "Shader.h"
+
+#include <stdint.h>
+
+namespace Renderer {
+
+enum class PipelineBlend : uint8_t
+{
+    NONE,       // Writes replace the target
+    ALPHA,      // src * srcAlpha + dst * (1 - srcAlpha)
+    ADDITIVE    // src + dst
+};
+
+// Packed so descs hash and compare as bytes. The state fields hold D3D11's enum values and
+// default to D3D11's defaults, which bind as null rather than as a state object of their own.
+struct PipelineStateDesc
+{
+    VertexShaderHandle VS;
+    PixelShaderHandle  PS;
+
+    // Raster
+    uint8_t       Fill        = D3D11_FILL_SOLID;
+    uint8_t       Cull        = D3D11_CULL_BACK;
+    uint8_t       DepthClip   = TRUE;
+
+    // Depth-stencil
+    uint8_t       DepthEnable = TRUE;
+    uint8_t       DepthWrite  = TRUE;
+    uint8_t       DepthFunc   = D3D11_COMPARISON_LESS;
+
+    PipelineBlend Blend       = PipelineBlend::NONE;
+    uint8_t       Unused      = 0;
+
+    // Keys of the state objects this desc wants, zero for D3D11's default
+    uint32_t GetRasterKey() const;
+    uint32_t GetDepthStencilKey() const;
+    uint32_t GetBlendKey() const { return (uint32_t)Blend; }
+
+    uint64_t GetHash() const;
+    bool operator==(const PipelineStateDesc& other) const;
+};
+static_assert(sizeof(PipelineStateDesc) == 16, "PipelineStateDesc is hashed as bytes, it can't have padding");
+
+// Nothing in it changes after creation, except that a hot reloaded pixel shader is patched into every
+// pipeline using it. The shaders are referenced through the desc's handles, the states are owned by the codex.
+struct PipelineState
+{
+    PipelineStateDesc        Desc;
+    ID3D11InputLayout*       InputLayout = nullptr;
+    ID3D11VertexShader*      VertexShader = nullptr;
+    ID3D11PixelShader*       PixelShader = nullptr;
+    ID3D11RasterizerState*   RasterState = nullptr;         // Null for D3D11's defaults
+    ID3D11DepthStencilState* DepthStencilState = nullptr;
+    ID3D11BlendState*        BlendState = nullptr;
+};
+
+typedef ResourceHandle<PipelineState> PipelineStateHandle;
+
+}
+#endif
@@ -34,7 +34,25 @@ enum class PS_REGISTERS : UINT
 {
     // ESS_PS
     LIGHTS   = 10,
-    MATERIAL = 11
+    MATERIAL = 11,
+    SHADOWS  = 12
+};
+
+// Reserved Shader Resource Registers for Pixel Shader Stage, clear of the material's TextureSlots
+enum class PS_RESOURCE_REGISTERS : UINT
+{
+    // ESS_PS
+    SHADOW_MAP      = 7,
+    CLUSTER_LIGHTS  = 8,
+    CLUSTER_RANGES  = 9,
+    LIGHT_INDICES   = 10
+};
+
+// Reserved Sampler Registers for Pixel Shader Stage, s0 is the material's
+enum class PS_SAMPLER_REGISTERS : UINT
+{
+    // ESS_PS
+    SHADOW = 1
 };
 
 
@@ -0,0 +1,128 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of ResidencyManager.h
+----------------------------------------------*/
+#include "ResidencyManager.h"
+
+#include "ResourceTable.h"
+
+#include <algorithm>
+
+namespace Renderer {
+
+uint32_t ResidencyManager::GetIndex(uint32_t handleValue)
+{
+    return handleValue & kHandleIndexMask;
+}
+
+void ResidencyManager::Track(ResidencyKind kind, uint32_t handleValue, uint64_t bytes, bool evictable, uint64_t frame)
+{
+    Untrack(kind, handleValue);
+
+    std::vector<Entry>& entries = mEntries[(uint32_t)kind];
+    const uint32_t index = GetIndex(handleValue);
+    if (index >= entries.size())
+        entries.resize(index + 1);
+
+    Entry& entry = entries[index];
+    entry.HandleValue = handleValue;
+    entry.Bytes = bytes;
+    entry.LastUsedFrame = frame;
+    entry.Evictable = evictable;
+
+    mCurrentBytes += bytes;
+    mBytesPerKind[(uint32_t)kind] += bytes;
+    mPeakBytes = std::max(mPeakBytes, mCurrentBytes);
+}
+
+void ResidencyManager::Untrack(ResidencyKind kind, uint32_t handleValue)
+{
+    std::vector<Entry>& entries = mEntries[(uint32_t)kind];
+    const uint32_t index = GetIndex(handleValue);
+    if (index >= entries.size() || entries[index].HandleValue != handleValue)
+        return;
+
+    Entry& entry = entries[index];
+    mCurrentBytes -= entry.Bytes;
+    mBytesPerKind[(uint32_t)kind] -= entry.Bytes;
+    entry = Entry();
+}
+
+bool ResidencyManager::IsResident(ResidencyKind kind, uint32_t handleValue) const
+{
+    const std::vector<Entry>& entries = mEntries[(uint32_t)kind];
+    const uint32_t index = GetIndex(handleValue);
+    return index < entries.size() && entries[index].HandleValue == handleValue;
+}
+
+void ResidencyManager::SelectEvictions(uint64_t frame, uint32_t minIdleFrames, std::vector<ResidencyKey>* out_victims) const
+{
+    if (!IsOverBudget())
+        return;
+
+    struct Candidate
+    {
+        uint64_t     LastUsedFrame;
+        uint64_t     Bytes;
+        ResidencyKey Key;
+    };
+
+    // Only runs when over budget, so a scan and a sort is fine
+    std::vector<Candidate> candidates;
+    for (uint32_t kind = 0; kind != (uint32_t)ResidencyKind::COUNT; ++kind)
+    {
+        for (const Entry& entry : mEntries[kind])
+        {
+            if (!entry.HandleValue || !entry.Evictable || entry.LastUsedFrame + minIdleFrames > frame)
+                continue;
+
+            Candidate c;
+            c.LastUsedFrame = entry.LastUsedFrame;
+            c.Bytes = entry.Bytes;
+            c.Key.Kind = (ResidencyKind)kind;
+            c.Key.HandleValue = entry.HandleValue;
+            candidates.push_back(c);
+        }
+    }
+
+    // Oldest first, and the bigger one on ties so fewer things have to come back later
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+    {
+        return a.LastUsedFrame != b.LastUsedFrame ? a.LastUsedFrame < b.LastUsedFrame : a.Bytes > b.Bytes;
+    });
+
+    uint64_t remaining = mCurrentBytes;
+    for (const Candidate& c : candidates)
+    {
+        if (remaining <= mBudget)
+            break;
+
+        out_victims->push_back(c.Key);
+        remaining -= c.Bytes;
+    }
+}
+
+uint64_t ResidencyManager::ComputeMeshBytes(uint32_t vertexCount, uint32_t stride, uint32_t indexCount)
+{
+    return (uint64_t)vertexCount * stride + (uint64_t)indexCount * sizeof(uint32_t);
+}
+
+uint64_t ResidencyManager::ComputeTextureBytes(uint32_t width, uint32_t height, uint32_t arraySize, uint32_t mipLevels, uint32_t bitsPerPixel, bool blockCompressed)
+{
+    uint64_t total = 0;
+    for (uint32_t mip = 0; mip != mipLevels; ++mip)
+    {
+        uint64_t w = std::max(width >> mip, 1u);
+        uint64_t h = std::max(height >> mip, 1u);
+        if (blockCompressed)
+        {
+            w = (w + 3) & ~3ull;
+            h = (h + 3) & ~3ull;
+        }
+        total += w * h * bitsPerPixel / 8;
+    }
+    return total * arraySize;
+}
+
+}
@@ -0,0 +1,92 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Byte accounting and LRU eviction policy for codex resources.
+Only bookkeeping lives here, no D3D, so the policy can run anywhere.
+The codex reports what each resource occupies and when it was last used,
+and asks for victims whenever the footprint goes over budget.
+----------------------------------------------*/
+#ifndef EASEL_RESIDENCYMANAGER_H
+#define EASEL_RESIDENCYMANAGER_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace Renderer {
+
+enum class ResidencyKind : uint8_t
+{
+    MESH,
+    TEXTURE,
+    VERTEX_SHADER,
+    PIXEL_SHADER,
+    COUNT
+};
+
+struct ResidencyKey
+{
+    ResidencyKind Kind;
+    uint32_t      HandleValue;
+};
+
+class ResidencyManager
+{
+public:
+    static constexpr uint64_t kUnlimited = 0;
+
+    void     SetBudget(uint64_t bytes) { mBudget = bytes; }
+    uint64_t GetBudget() const         { return mBudget; }
+
+    // (Re)records what a resource occupies. Only evictable ones are ever picked by SelectEvictions.
+    void Track(ResidencyKind kind, uint32_t handleValue, uint64_t bytes, bool evictable, uint64_t frame);
+
+    // Its memory is gone, either evicted or destroyed
+    void Untrack(ResidencyKind kind, uint32_t handleValue);
+
+    // Hot path: a store, no searching
+    void Touch(ResidencyKind kind, uint32_t handleValue, uint64_t frame)
+    {
+        std::vector<Entry>& entries = mEntries[(uint32_t)kind];
+        const uint32_t index = GetIndex(handleValue);
+        if (index < entries.size() && entries[index].HandleValue == handleValue)
+            entries[index].LastUsedFrame = frame;
+    }
+
+    bool     IsResident(ResidencyKind kind, uint32_t handleValue) const;
+    uint64_t GetCurrentBytes() const               { return mCurrentBytes; }
+    uint64_t GetPeakBytes() const                  { return mPeakBytes; }
+    uint64_t GetBytes(ResidencyKind kind) const    { return mBytesPerKind[(uint32_t)kind]; }
+    bool     IsOverBudget() const                  { return mBudget != kUnlimited && mCurrentBytes > mBudget; }
+
+    // Least recently used first, until dropping them brings the footprint back under budget.
+    // Anything used within the last minIdleFrames is skipped, the GPU may still be reading it.
+    void SelectEvictions(uint64_t frame, uint32_t minIdleFrames, std::vector<ResidencyKey>* out_victims) const;
+
+    // Size of a mesh's vertex buffer plus its 32-bit index buffer
+    static uint64_t ComputeMeshBytes(uint32_t vertexCount, uint32_t stride, uint32_t indexCount);
+
+    // Size of a full mip chain. blockCompressed formats store 4x4 blocks, at bitsPerPixel per texel.
+    static uint64_t ComputeTextureBytes(uint32_t width, uint32_t height, uint32_t arraySize, uint32_t mipLevels, uint32_t bitsPerPixel, bool blockCompressed);
+
+private:
+    struct Entry
+    {
+        uint32_t HandleValue = 0; // Zero when nothing is resident in this slot
+        uint64_t Bytes = 0;
+        uint64_t LastUsedFrame = 0;
+        bool     Evictable = false;
+    };
+
+    static uint32_t GetIndex(uint32_t handleValue);
+
+    // Indexed like the codex tables, by handle index
+    std::vector<Entry> mEntries[(uint32_t)ResidencyKind::COUNT];
+
+    uint64_t mBudget = kUnlimited;
+    uint64_t mCurrentBytes = 0;
+    uint64_t mPeakBytes = 0;
+    uint64_t mBytesPerKind[(uint32_t)ResidencyKind::COUNT] = {};
+};
+
+}
+#endif
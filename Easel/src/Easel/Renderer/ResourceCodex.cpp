@@ -5,30 +5,162 @@ Description : Master Resource Distributor
 ----------------------------------------------*/
 #include "ResourceCodex.h"
 
+#include <Easel/Assets/AssetCache.h>
+#include <Easel/Core/MemoryTracker.h>
 #include <Easel/Core/PathMacros.h>
+#include <Easel/Core/Profiler.h>
 
 #include "Factories.h"
+#include "HotReloader.h"
 #include "Material.h"
 #include "Mesh.h"
 #include "Shader.h"
 
 #include "hash_util.h"
 
+#include <filesystem>
+
 namespace Renderer {
 
+// What each kind owns, shared by Destroy(), deferred releases and eviction
+static void FreeMesh(Mesh& m)
+{
+    if(m.VertexBuffer) m.VertexBuffer->Release();
+    if(m.IndexBuffer) m.IndexBuffer->Release();
+    m.VertexBuffer = nullptr;
+    m.IndexBuffer = nullptr;
+}
+
+static void FreeVertexShader(VertexShader& vs)
+{
+    vs.InputLayout->Release();
+    free(vs.VertexDesc.SemanticsArr);
+    free(vs.VertexDesc.ByteOffsets);
+    vs.Shader->Release();
+}
+
+static void FreePixelShader(PixelShader& ps)
+{
+    if(ps.SamplerState) ps.SamplerState->Release();
+    if(ps.Shader) ps.Shader->Release();
+}
+
+static void FreeChord(ResourceBindChord& chord)
+{
+    for(ID3D11ShaderResourceView*& srv : chord.SRVs)
+    {
+        if(srv) srv->Release();
+        srv = nullptr;
+    }
+}
+
+// Only the formats the factories create
+static uint32_t GetBitsPerPixel(DXGI_FORMAT format, bool* out_blockCompressed)
+{
+    *out_blockCompressed = false;
+    switch (format)
+    {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC4_UNORM:
+            *out_blockCompressed = true;
+            return 4;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+        case DXGI_FORMAT_BC5_UNORM:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            *out_blockCompressed = true;
+            return 8;
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            return 64;
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return 128;
+        default:
+            return 32;
+    }
+}
+
+static uint64_t GetTextureBytes(ID3D11ShaderResourceView* pSRV)
+{
+    if (!pSRV)
+        return 0;
+
+    ID3D11Resource* pResource = nullptr;
+    pSRV->GetResource(&pResource);
+
+    ID3D11Texture2D* pTexture = nullptr;
+    uint64_t bytes = 0;
+    if (SUCCEEDED(pResource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&pTexture)))
+    {
+        D3D11_TEXTURE2D_DESC desc;
+        pTexture->GetDesc(&desc);
+
+        bool blockCompressed;
+        const uint32_t bpp = GetBitsPerPixel(desc.Format, &blockCompressed);
+        bytes = ResidencyManager::ComputeTextureBytes(desc.Width, desc.Height, desc.ArraySize, desc.MipLevels, bpp, blockCompressed);
+        pTexture->Release();
+    }
+    pResource->Release();
+    return bytes;
+}
+
+static uint64_t GetShaderFileBytes(const wchar_t* path)
+{
+    std::error_code ec;
+    const uintmax_t size = std::filesystem::file_size(path, ec);
+    return ec ? 0 : (uint64_t)size;
+}
+
+template<typename TState>
+static void FreeStates(std::unordered_map<uint32_t, TState*>& states)
+{
+    for (auto& entry : states)
+    {
+        if (entry.second)
+            entry.second->Release();
+    }
+    states.clear();
+}
+
+// The state object a key was first created for, or a new one
+template<typename TState>
+static TState* FindOrCreateState(std::unordered_map<uint32_t, TState*>& states, uint32_t key, const PipelineStateDesc& desc, ID3D11Device* pDevice, HRESULT (*create)(ID3D11Device*, const PipelineStateDesc&, TState**))
+{
+    auto itFind = states.find(key);
+    if (itFind != states.end())
+        return itFind->second;
+
+    TState* pState = nullptr;
+    COM_EXCEPT(create(pDevice, desc, &pState));
+    states.insert(std::pair<uint32_t, TState*>(key, pState));
+    return pState;
+}
 
 MeshID ResourceCodex::AddMeshFromFile(const char* fileName, const VertexBufferDescription* vertAttr, ID3D11Device* pDevice)
 {
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RESOURCE_CODEX);
+    ESL_PROFILE_ZONE("ResourceCodex::AddMeshFromFile");
+
     ResourceCodex& codexInstance = GetSingleton();
 
     Mesh mesh;
     MeshID id = MeshFactory::CreateMesh(fileName, vertAttr, pDevice, &mesh);
-    auto& hashtable = codexInstance.mMeshMap;
-    
-    if (hashtable.find(id) == hashtable.end())
+    if (!codexInstance.mMeshes.Find(id).IsValid())
     {
-        const Mesh c_Mesh = mesh;
-        codexInstance.mMeshMap.insert(std::pair<MeshID, const Mesh>(id, c_Mesh));
+        const MeshHandle handle = codexInstance.mMeshes.Insert(id, mesh);
+
+        #if defined(ESL_DEBUG)
+        RegisterResourceName(ResourceKind::MESH, id, fileName);
+        #endif
+
+        MeshSource source;
+        source.FileName = fileName;
+        source.Layout = vertAttr;
+        codexInstance.mMeshSources.insert(std::pair<MeshID, MeshSource>(id, source));
+        codexInstance.TrackMesh(handle);
     }
     else
     {
@@ -40,137 +172,641 @@ MeshID ResourceCodex::AddMeshFromFile(const char* fileName, const VertexBufferDe
     return id;
 }
 
-void ResourceCodex::Init(ID3D11Device* device, ID3D11DeviceContext* context)
+void ResourceCodex::Init(ID3D11Device* device, ID3D11DeviceContext* context, Core::WorkerPool* pPool)
 {
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RESOURCE_CODEX);
+    ESL_PROFILE_ZONE("ResourceCodex::Init");
+
     ResourceCodex& codexInstance = GetSingleton();
+    codexInstance.mpDevice = device;
+    codexInstance.mpWorkerPool = pPool;
+
+    // Cooked meshes and textures are served from here on warm starts
+    Assets::AssetCache::GetSingleton().Init(CACHEPATH);
     
-    TextureFactory::LoadAllTextures(device, context, codexInstance);
+    TextureFactory::LoadAllTextures(device, codexInstance, pPool);
     ShaderFactory::LoadAllShaders(device, codexInstance);
     MaterialFactory::CreateAllMaterials(device, codexInstance);
+
+    #if defined(ESL_HOT_RELOAD)
+    codexInstance.mpHotReloader = new HotReloader(device);
+    if (!codexInstance.mpHotReloader->Start())
+    {
+        delete codexInstance.mpHotReloader;
+        codexInstance.mpHotReloader = nullptr;
+    }
+    #endif
+}
+
+void ResourceCodex::InitHeadless()
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RESOURCE_CODEX);
+    ESL_PROFILE_ZONE("ResourceCodex::InitHeadless");
+
+    ResourceCodex& codexInstance = GetSingleton();
+    codexInstance.mpDevice = nullptr;
+
+    // Meshes still come through the cache, for their bounds
+    Assets::AssetCache::GetSingleton().Init(CACHEPATH);
+}
+
+void ResourceCodex::ProcessHotReload(ID3D11DeviceContext* context)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RESOURCE_CODEX);
+    ESL_PROFILE_ZONE("ResourceCodex::ProcessHotReload");
+
+    ResourceCodex& codexInstance = GetSingleton();
+    if (codexInstance.mpHotReloader)
+        codexInstance.mpHotReloader->Update(codexInstance, context);
 }
 
 void ResourceCodex::Destroy()
 {
     ResourceCodex& codexInstance = GetSingleton();
 
-    for (auto const& m : codexInstance.mMeshMap)
+    // Stop reloading before anything it could touch goes away. Finished-but-unapplied results are released with it.
+    delete codexInstance.mpHotReloader;
+    codexInstance.mpHotReloader = nullptr;
+
+    Assets::AssetCache::GetSingleton().Shutdown();
+
+    // Reference counts don't matter anymore, everything goes
+    codexInstance.mMeshes.ForEach([](MeshHandle, Mesh& m) { FreeMesh(m); });
+    codexInstance.mVertexShaders.ForEach([](VertexShaderHandle, VertexShader& vs) { FreeVertexShader(vs); });
+    codexInstance.mPixelShaders.ForEach([](PixelShaderHandle, PixelShader& ps) { FreePixelShader(ps); });
+    codexInstance.mTextures.ForEach([](TextureHandle, ResourceBindChord& chord) { FreeChord(chord); }); // Texture banks included
+
+    // Anyone releasing a handle after this finds it stale and does nothing
+    codexInstance.mMeshes.Clear();
+    codexInstance.mMaterials.Clear();
+    codexInstance.mPipelineStates.Clear();
+    codexInstance.mPipelineStateIndex.clear();
+    FreeStates(codexInstance.mRasterStates);
+    FreeStates(codexInstance.mDepthStencilStates);
+    FreeStates(codexInstance.mBlendStates);
+    codexInstance.mVertexShaders.Clear();
+    codexInstance.mPixelShaders.Clear();
+    codexInstance.mTextures.Clear();
+    codexInstance.mTextureSlices.clear();
+    codexInstance.mMeshSources.clear();
+    codexInstance.mTextureSources.clear();
+    codexInstance.mDeferredReleases.clear();
+    codexInstance.mResidency = ResidencyManager();
+    codexInstance.mpDevice = nullptr;
+    codexInstance.mpWorkerPool = nullptr;
+}
+
+void ResourceCodex::EndFrame()
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RESOURCE_CODEX);
+    ESL_PROFILE_ZONE("ResourceCodex::EndFrame");
+
+    ResourceCodex& codexInstance = GetSingleton();
+    ++codexInstance.mFrameIndex;
+
+    if (!codexInstance.mDeferredReleases.empty())
     {
-        m.second.VertexBuffer->Release();
-        m.second.IndexBuffer->Release();
+        // Destroying a material can defer its dependencies, so pull the expired entries out first
+        std::vector<DeferredRelease>& pending = codexInstance.mDeferredReleases;
+        std::vector<DeferredRelease>& expired = codexInstance.mExpiredScratch;
+        expired.clear();
+        for (size_t i = 0; i != pending.size();)
+        {
+            if (pending[i].ReleaseFrame <= codexInstance.mFrameIndex)
+            {
+                expired.push_back(pending[i]);
+                pending[i] = pending.back();
+                pending.pop_back();
+            }
+            else
+                ++i;
+        }
+
+        for (const DeferredRelease& entry : expired)
+            codexInstance.DestroyNow(entry);
     }
 
-    for (auto const& m : codexInstance.mMaterials)
+    // Anything idle long enough to be out of flight can go
+    if (codexInstance.mResidency.IsOverBudget())
     {
-        if (m.RasterStateOverride)
-            m.RasterStateOverride->Release();
+        std::vector<ResidencyKey>& victims = codexInstance.mEvictionScratch;
+        victims.clear();
+        codexInstance.mResidency.SelectEvictions(codexInstance.mFrameIndex, kDeferredReleaseFrames, &victims);
+        for (const ResidencyKey& key : victims)
+            codexInstance.Evict(key);
 
-        if (m.DepthStencilStateOverride)
-            m.DepthStencilStateOverride->Release();
+        #if defined(ESL_DEBUG)
+        if (codexInstance.mResidency.IsOverBudget())
+            OutputDebugStringA("WARNING: Resources in use don't fit the memory budget\n");
+        #endif
     }
+}
+
+void ResourceCodex::AddRef(MeshHandle handle)         { mMeshes.AddRef(handle); }
+void ResourceCodex::AddRef(TextureHandle handle)      { mTextures.AddRef(handle); }
+void ResourceCodex::AddRef(VertexShaderHandle handle) { mVertexShaders.AddRef(handle); }
+void ResourceCodex::AddRef(PixelShaderHandle handle)  { mPixelShaders.AddRef(handle); }
+void ResourceCodex::AddRef(PipelineStateHandle handle) { mPipelineStates.AddRef(handle); }
+void ResourceCodex::AddRef(MaterialHandle handle)     { mMaterials.AddRef(handle); }
+
+void ResourceCodex::Release(MeshHandle handle)
+{
+    if (mMeshes.GetRefCount(handle) && !mMeshes.Release(handle))
+        Defer(DeferredKind::MESH, handle.Value);
+}
+
+void ResourceCodex::Release(TextureHandle handle)
+{
+    if (mTextures.GetRefCount(handle) && !mTextures.Release(handle))
+        Defer(DeferredKind::TEXTURE, handle.Value);
+}
+
+void ResourceCodex::Release(VertexShaderHandle handle)
+{
+    if (mVertexShaders.GetRefCount(handle) && !mVertexShaders.Release(handle))
+        Defer(DeferredKind::VERTEX_SHADER, handle.Value);
+}
 
-    for (auto const& s : codexInstance.mVertexShaders)
+void ResourceCodex::Release(PixelShaderHandle handle)
+{
+    if (mPixelShaders.GetRefCount(handle) && !mPixelShaders.Release(handle))
+        Defer(DeferredKind::PIXEL_SHADER, handle.Value);
+}
+
+void ResourceCodex::Release(PipelineStateHandle handle)
+{
+    if (mPipelineStates.GetRefCount(handle) && !mPipelineStates.Release(handle))
+        Defer(DeferredKind::PIPELINE_STATE, handle.Value);
+}
+
+void ResourceCodex::Release(MaterialHandle handle)
+{
+    if (mMaterials.GetRefCount(handle) && !mMaterials.Release(handle))
+        Defer(DeferredKind::MATERIAL, handle.Value);
+}
+
+void ResourceCodex::Defer(DeferredKind kind, uint32_t handleValue)
+{
+    // Released, re-acquired and released again: the clock starts over from the latest release
+    const uint64_t releaseFrame = mFrameIndex + kDeferredReleaseFrames;
+    for (DeferredRelease& entry : mDeferredReleases)
     {
-        const VertexShader& vs = s.second;
-        vs.InputLayout->Release();
-        free(vs.VertexDesc.SemanticsArr);
-        free(vs.VertexDesc.ByteOffsets);
-        vs.Shader->Release();
+        if (entry.Kind == kind && entry.HandleValue == handleValue)
+        {
+            entry.ReleaseFrame = releaseFrame;
+            return;
+        }
     }
 
-    std::unordered_map<ShaderID, const PixelShader>::iterator it = codexInstance.mPixelShaders.begin();
+    DeferredRelease entry;
+    entry.Kind = kind;
+    entry.HandleValue = handleValue;
+    entry.ReleaseFrame = releaseFrame;
+    mDeferredReleases.push_back(entry);
+}
 
-    while (it != codexInstance.mPixelShaders.end())
+void ResourceCodex::DestroyNow(const DeferredRelease& entry)
+{
+    switch (entry.Kind)
     {
-        if(it->second.SamplerState) it->second.SamplerState->Release();
-        if(it->second.Shader) it->second.Shader->Release();
-        ++it;
+        case DeferredKind::MESH:
+        {
+            MeshHandle handle;
+            handle.Value = entry.HandleValue;
+
+            // Someone took a new reference while it was waiting
+            Mesh* pMesh = mMeshes.Get(handle);
+            if (!pMesh || mMeshes.GetRefCount(handle))
+                return;
+
+            FreeMesh(*pMesh);
+            mResidency.Untrack(ResidencyKind::MESH, handle.Value);
+            mMeshSources.erase(mMeshes.GetName(handle));
+            mMeshes.Remove(handle);
+            break;
+        }
+        case DeferredKind::TEXTURE:
+        {
+            TextureHandle handle;
+            handle.Value = entry.HandleValue;
+
+            ResourceBindChord* pChord = mTextures.Get(handle);
+            if (!pChord || mTextures.GetRefCount(handle))
+                return;
+
+            FreeChord(*pChord);
+            mResidency.Untrack(ResidencyKind::TEXTURE, handle.Value);
+            mTextureSources.erase(mTextures.GetName(handle));
+            mTextures.Remove(handle);
+
+            // A bank takes every texture set packed into it along
+            for (auto it = mTextureSlices.begin(); it != mTextureSlices.end();)
+            {
+                if (it->second.Bank == handle)
+                    it = mTextureSlices.erase(it);
+                else
+                    ++it;
+            }
+            break;
+        }
+        case DeferredKind::VERTEX_SHADER:
+        {
+            VertexShaderHandle handle;
+            handle.Value = entry.HandleValue;
+
+            VertexShader* pShader = mVertexShaders.Get(handle);
+            if (!pShader || mVertexShaders.GetRefCount(handle))
+                return;
+
+            FreeVertexShader(*pShader);
+            mResidency.Untrack(ResidencyKind::VERTEX_SHADER, handle.Value);
+            mVertexShaders.Remove(handle);
+            break;
+        }
+        case DeferredKind::PIXEL_SHADER:
+        {
+            PixelShaderHandle handle;
+            handle.Value = entry.HandleValue;
+
+            PixelShader* pShader = mPixelShaders.Get(handle);
+            if (!pShader || mPixelShaders.GetRefCount(handle))
+                return;
+
+            FreePixelShader(*pShader);
+            mResidency.Untrack(ResidencyKind::PIXEL_SHADER, handle.Value);
+            mPixelShaders.Remove(handle);
+            break;
+        }
+        case DeferredKind::PIPELINE_STATE:
+        {
+            PipelineStateHandle handle;
+            handle.Value = entry.HandleValue;
+
+            PipelineState* pState = mPipelineStates.Get(handle);
+            if (!pState || mPipelineStates.GetRefCount(handle))
+                return;
+
+            // Its state objects stay cached for the next pipeline that wants them, its shaders only lose a reference
+            const PipelineStateDesc desc = pState->Desc;
+            auto itFind = mPipelineStateIndex.find(desc.GetHash());
+            if (itFind != mPipelineStateIndex.end() && itFind->second == handle)
+                mPipelineStateIndex.erase(itFind);
+
+            mPipelineStates.Remove(handle);
+            Release(desc.VS);
+            Release(desc.PS);
+            break;
+        }
+        case DeferredKind::MATERIAL:
+        {
+            MaterialHandle handle;
+            handle.Value = entry.HandleValue;
+
+            Material* pMaterial = mMaterials.Get(handle);
+            if (!pMaterial || mMaterials.GetRefCount(handle))
+                return;
+
+            // The GPU is done with the material, but its pipeline state and textures may still be shared, so those only lose a reference
+            Material material = *pMaterial;
+            mMaterials.Remove(handle);
+            ReleaseDependencies(material);
+            break;
+        }
     }
+}
 
-    for (auto const& t : codexInstance.mTextureMap)
-        for(ID3D11ShaderResourceView* srv : t.second.SRVs)
-            if(srv) srv->Release();
+void ResourceCodex::TrackMesh(MeshHandle handle)
+{
+    // From the counts rather than the buffers, so headless meshes weigh what they would have uploaded
+    const Mesh* pMesh = mMeshes.Get(handle);
+    const uint64_t bytes = ResidencyManager::ComputeMeshBytes(pMesh->VertexCount, pMesh->Stride, pMesh->IndexCount);
+
+    // Every mesh came from a file, so every mesh can come back
+    mResidency.Track(ResidencyKind::MESH, handle.Value, bytes, true, mFrameIndex);
 }
 
-const Mesh* ResourceCodex::GetMesh(MeshID UID) const
+void ResourceCodex::TrackTexture(TextureHandle handle)
 {
-    if(mMeshMap.find(UID) != mMeshMap.end())
-        return &mMeshMap.at(UID);
-    else
-        return nullptr;
+    const ResourceBindChord* pChord = mTextures.Get(handle);
+
+    uint64_t bytes = 0;
+    for (ID3D11ShaderResourceView* srv : pChord->SRVs)
+        bytes += GetTextureBytes(srv);
+
+    // Banks aren't named and have no single source to reload from, so they stay resident
+    const bool evictable = mTextureSources.find(mTextures.GetName(handle)) != mTextureSources.end();
+    mResidency.Track(ResidencyKind::TEXTURE, handle.Value, bytes, evictable, mFrameIndex);
 }
 
-const Material* ResourceCodex::GetMaterial(uint8_t materialIndex) const
+void ResourceCodex::Evict(const ResidencyKey& key)
 {
-    if (materialIndex > mMaterials.size())
-        return nullptr;
+    switch (key.Kind)
+    {
+        case ResidencyKind::MESH:
+        {
+            MeshHandle handle;
+            handle.Value = key.HandleValue;
+            if (!mMeshes.GetRefCount(handle))
+            {
+                // Nobody wants it anymore, no point waiting for the deferred release
+                DeferredRelease entry = { DeferredKind::MESH, key.HandleValue, mFrameIndex };
+                DestroyNow(entry);
+                return;
+            }
 
-    return &mMaterials.at(materialIndex);
+            // The slot stays, so handles keep working and UseMesh brings it back
+            FreeMesh(*mMeshes.Get(handle));
+            mResidency.Untrack(ResidencyKind::MESH, key.HandleValue);
+            break;
+        }
+        case ResidencyKind::TEXTURE:
+        {
+            TextureHandle handle;
+            handle.Value = key.HandleValue;
+            if (!mTextures.GetRefCount(handle))
+            {
+                DeferredRelease entry = { DeferredKind::TEXTURE, key.HandleValue, mFrameIndex };
+                DestroyNow(entry);
+                return;
+            }
+
+            FreeChord(*mTextures.Get(handle));
+            mResidency.Untrack(ResidencyKind::TEXTURE, key.HandleValue);
+            break;
+        }
+        default:
+            // Shaders are tracked, but never marked evictable
+            assert(false);
+            break;
+    }
 }
 
-const ResourceBindChord* ResourceCodex::GetTexture(TextureID UID) const
+bool ResourceCodex::MakeResident(MeshHandle handle, Mesh* pMesh)
 {
-    if(mTextureMap.find(UID) != mTextureMap.end())
-        return &mTextureMap.at(UID);
-    else
-        return nullptr;
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RESOURCE_CODEX);
+    ESL_PROFILE_ZONE("ResourceCodex::MakeResident(Mesh)");
+
+    auto itSource = mMeshSources.find(mMeshes.GetName(handle));
+    if (itSource == mMeshSources.end())
+        return false;
+
+    Mesh mesh;
+    if (!MeshFactory::CreateMesh(itSource->second.FileName.c_str(), itSource->second.Layout, mpDevice, &mesh))
+        return false;
+
+    *pMesh = mesh;
+    TrackMesh(handle);
+    ++mMeshVersion;
+    return true;
 }
 
-const VertexShader* ResourceCodex::GetVertexShader(ShaderID UID) const
+bool ResourceCodex::MakeResident(TextureHandle handle, ResourceBindChord* pChord)
 {
-    if(mVertexShaders.find(UID) != mVertexShaders.end())
-        return &mVertexShaders.at(UID);
-    else
-        return nullptr;
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RESOURCE_CODEX);
+    ESL_PROFILE_ZONE("ResourceCodex::MakeResident(Texture)");
+
+    auto itSource = mTextureSources.find(mTextures.GetName(handle));
+    if (itSource == mTextureSources.end())
+        return false;
+
+    const TextureSource& source = itSource->second;
+    for (UINT slot = 0; slot != (UINT)TextureSlots::COUNT; ++slot)
+    {
+        if (source.Files[slot].empty())
+            continue;
+
+        if (FAILED(TextureFactory::CreateTextureFromFile(mpDevice, source.Files[slot], slot, source.IsDDS[slot], &pChord->SRVs[slot], mpWorkerPool)))
+        {
+            FreeChord(*pChord);
+            return false;
+        }
+    }
+
+    TrackTexture(handle);
+    return true;
 }
 
-const PixelShader* ResourceCodex::GetPixelShader(ShaderID UID) const
+void ResourceCodex::AddRefDependencies(const Material& material)
 {
-    if(mPixelShaders.find(UID) != mPixelShaders.end())
-        return &mPixelShaders.at(UID);
-    else
-        return nullptr;
+    AddRef(material.Pipeline);
+    AddRef(material.Resources);
 }
 
-void ResourceCodex::AddVertexShader(ShaderID hash, const wchar_t* path, ID3D11Device* pDevice)
+void ResourceCodex::ReleaseDependencies(const Material& material)
+{
+    Release(material.Pipeline);
+    Release(material.Resources);
+}
+
+bool ResourceCodex::GetTextureSlice(TextureID UID, TextureHandle* out_bank, uint32_t* out_slice) const
+{
+    auto itFind = mTextureSlices.find(UID);
+    if (itFind == mTextureSlices.end())
+        return false;
+
+    *out_bank = itFind->second.Bank;
+    *out_slice = itFind->second.Slice;
+    return true;
+}
+
+VertexShaderHandle ResourceCodex::AddVertexShader(ShaderID hash, const wchar_t* path, ID3D11Device* pDevice)
 {
     VertexShader shader;
     ShaderFactory::CreateVertexShader(path, &shader, pDevice);
-    const VertexShader cShader = shader;
-    mVertexShaders.insert(std::pair<ShaderID, const VertexShader>(hash, cShader));
+    const VertexShaderHandle handle = mVertexShaders.Insert(hash, shader);
+    mResidency.Track(ResidencyKind::VERTEX_SHADER, handle.Value, GetShaderFileBytes(path), false, mFrameIndex);
+    return handle;
 }
 
-void ResourceCodex::AddPixelShader(ShaderID hash, const wchar_t* path, ID3D11Device* pDevice)
+PixelShaderHandle ResourceCodex::AddPixelShader(ShaderID hash, const wchar_t* path, ID3D11Device* pDevice)
 {   
     PixelShader shader;
     ShaderFactory::CreatePixelShader(path, &shader, pDevice);
-    const PixelShader cShader = shader;
-    mPixelShaders.insert(std::pair<ShaderID, const PixelShader>(hash, cShader));
+    const PixelShaderHandle handle = mPixelShaders.Insert(hash, shader);
+    mResidency.Track(ResidencyKind::PIXEL_SHADER, handle.Value, GetShaderFileBytes(path), false, mFrameIndex);
+    return handle;
 }
 
 void ResourceCodex::InsertTexture(TextureID UID, UINT slot, ID3D11ShaderResourceView* pSRV)
 {
-    auto itFind = mTextureMap.find(UID);
-    if (itFind != mTextureMap.end())
+    TextureHandle handle = mTextures.Find(UID);
+    if (ResourceBindChord* pChord = mTextures.Get(handle))
     {
-        ResourceBindChord& chord = itFind->second;
-        if(chord.SRVs[slot])
-            chord.SRVs[slot]->Release();
+        // Evicted: the next UseTexture loads every slot from disk, this one included
+        if (!mResidency.IsResident(ResidencyKind::TEXTURE, handle.Value))
+        {
+            pSRV->Release();
+            return;
+        }
+
+        if(pChord->SRVs[slot])
+            pChord->SRVs[slot]->Release();
 
-        mTextureMap[UID].SRVs[slot] = pSRV;
+        pChord->SRVs[slot] = pSRV;
     }
     else
     {
-        // TODO: This could probably avoid creating a temp variable
         ResourceBindChord rbc = {0};
         rbc.SRVs[slot] = pSRV;
-        mTextureMap.insert(std::pair<TextureID, ResourceBindChord>(UID, rbc));
+        handle = mTextures.Insert(UID, rbc);
+    }
+
+    TrackTexture(handle);
+}
+
+void ResourceCodex::SetTextureSource(TextureID UID, UINT slot, const std::wstring& path, bool isDDS)
+{
+    TextureSource& source = mTextureSources[UID];
+    source.Files[slot] = path;
+    source.IsDDS[slot] = isDDS;
+}
+
+TextureHandle ResourceCodex::InsertTextureBank(const ResourceBindChord& bank)
+{
+    const TextureHandle handle = mTextures.Insert(bank);
+    TrackTexture(handle);
+    return handle;
+}
+
+void ResourceCodex::InsertTextureSlice(TextureID UID, TextureHandle bank, uint32_t slice)
+{
+    TextureBankSlice tbs;
+    tbs.Bank = bank;
+    tbs.Slice = slice;
+    mTextureSlices[UID] = tbs;
+}
+
+const ResourceCodex::MeshSource* ResourceCodex::GetMeshSource(MeshID UID) const
+{
+    auto itFind = mMeshSources.find(UID);
+    return itFind != mMeshSources.end() ? &itFind->second : nullptr;
+}
+
+void ResourceCodex::ReplaceMesh(MeshID UID, const Mesh& mesh)
+{
+    const MeshHandle handle = mMeshes.Find(UID);
+    Mesh* pCurrent = mMeshes.Get(handle);
+    if (!pCurrent)
+    {
+        // Unloaded while it was being re-imported
+        Mesh incoming = mesh;
+        FreeMesh(incoming);
+        return;
+    }
+
+    // D3D11 keeps anything still bound alive until the GPU is done with it, so the old buffers can go right away.
+    // An evicted mesh simply becomes resident again.
+    FreeMesh(*pCurrent);
+    *pCurrent = mesh;
+    TrackMesh(handle);
+    ++mMeshVersion;
+}
+
+void ResourceCodex::ReplacePixelShader(ShaderID UID, const PixelShader& shader)
+{
+    PixelShader incoming = shader;
+    PixelShader* pCurrent = mPixelShaders.Get(mPixelShaders.Find(UID));
+    if (!pCurrent)
+    {
+        FreePixelShader(incoming);
+        return;
+    }
+
+    FreePixelShader(*pCurrent);
+    *pCurrent = incoming;
+
+    // Pipeline states point straight at the shader, so every one using it is patched
+    const PixelShaderHandle handle = mPixelShaders.Find(UID);
+    mPipelineStates.ForEach([&](PipelineStateHandle, PipelineState& state)
+    {
+        if (state.Desc.PS == handle)
+            state.PixelShader = incoming.Shader;
+    });
+}
+
+void ResourceCodex::ReplaceTextureBankSRV(TextureHandle bank, UINT slot, ID3D11ShaderResourceView* pSRV)
+{
+    ResourceBindChord* pChord = mTextures.Get(bank);
+    if (!pChord)
+    {
+        pSRV->Release();
+        return;
     }
+
+    if (pChord->SRVs[slot])
+        pChord->SRVs[slot]->Release();
+
+    pChord->SRVs[slot] = pSRV;
+    TrackTexture(bank);
+}
+
+bool ResourceCodex::GetTextureBankIndex(TextureID UID, TextureBankSlice* out_location) const
+{
+    auto itFind = mTextureSlices.find(UID);
+    if (itFind == mTextureSlices.end())
+        return false;
+
+    *out_location = itFind->second;
+    return true;
+}
+
+MaterialHandle ResourceCodex::InsertMaterial(MaterialID UID, const Material& material)
+{
+    #if defined(ESL_DEBUG)
+    if (mMaterials.Find(UID).IsValid())
+        OutputDebugStringA("ERROR: Two materials share a name, the second one shadows the first\n");
+    #endif
+
+    AddRefDependencies(material);
+    return mMaterials.Insert(UID, material);
+}
+
+void ResourceCodex::ReplaceMaterial(MaterialHandle handle, const Material& material)
+{
+    Material* pCurrent = mMaterials.Get(handle);
+    assert(pCurrent);
+
+    // Take the new references first, so a dependency shared by both versions never touches zero
+    AddRefDependencies(material);
+    ReleaseDependencies(*pCurrent);
+    *pCurrent = material;
 }
 
-MaterialIndex ResourceCodex::PushMaterial(const Material& material)
+PipelineStateHandle ResourceCodex::AcquirePipelineState(const PipelineStateDesc& desc, ID3D11Device* pDevice)
 {
-    mMaterials.push_back(material);
-    return (MaterialIndex)(mMaterials.size() - 1);
+    const uint64_t hash = desc.GetHash();
+    auto itFind = mPipelineStateIndex.find(hash);
+    if (itFind != mPipelineStateIndex.end())
+    {
+        const PipelineState* pExisting = mPipelineStates.Get(itFind->second);
+        if (pExisting && pExisting->Desc == desc)
+        {
+            AddRef(itFind->second);
+            return itFind->second;
+        }
+    }
+
+    const VertexShader* pVS = mVertexShaders.Get(desc.VS);
+    const PixelShader* pPS = mPixelShaders.Get(desc.PS);
+    assert(pVS && pPS);
+
+    PipelineState state;
+    state.Desc = desc;
+    state.InputLayout = pVS->InputLayout;
+    state.VertexShader = pVS->Shader;
+    state.PixelShader = pPS->Shader;
+    state.RasterState = FindOrCreateState(mRasterStates, desc.GetRasterKey(), desc, pDevice, &PipelineStateFactory::CreateRasterState);
+    state.DepthStencilState = FindOrCreateState(mDepthStencilStates, desc.GetDepthStencilKey(), desc, pDevice, &PipelineStateFactory::CreateDepthStencilState);
+    state.BlendState = FindOrCreateState(mBlendStates, desc.GetBlendKey(), desc, pDevice, &PipelineStateFactory::CreateBlendState);
+
+    // The table's initial reference is the caller's, the shaders get one from the pipeline
+    const PipelineStateHandle handle = mPipelineStates.Insert(state);
+    AddRef(desc.VS);
+    AddRef(desc.PS);
+
+    // A hash collision keeps the first desc indexed, the second still works but isn't shared
+    mPipelineStateIndex.insert(std::pair<uint64_t, PipelineStateHandle>(hash, handle));
+    return handle;
 }
 
 }
\ No newline at end of file
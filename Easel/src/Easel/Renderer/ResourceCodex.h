@@ -10,60 +10,227 @@ Description : Loads and distributes all static resources (materials, textures, e
 
 #include "Material.h"
 #include "Mesh.h"
+#include "PipelineState.h"
+#include "ResidencyManager.h"
+#include "ResourceIDs.h"
+#include "ResourceTable.h"
 #include "Shader.h"
+#include "ShaderPermutations.h"
 
+#include <string>
 #include <unordered_map>
 
+namespace Core {
+class WorkerPool;
+}
+
 namespace Renderer {
 
 struct MeshFactory;
 struct ShaderFactory;
 struct TextureFactory;
+class HotReloader;
 }
 
 namespace Renderer {
 
-typedef uint32_t id_type;
-typedef id_type ShaderID;
-typedef id_type MeshID;
-typedef id_type TextureID;
-
-enum MaterialIndex
-{
-    MI_LUNAR = 0,
-    MI_SKY,
-    MI_WIREFRAME,
-    MI_COUNT
-};
+// Frames a resource survives after its last reference is released, so GPU work already submitted with it can finish
+static const uint32_t kDeferredReleaseFrames = 3;
 
 class alignas(8) ResourceCodex
 {
 public:
+    // Without a device the mesh is imported but never uploaded, so it has bounds and counts but no buffers
     static MeshID AddMeshFromFile(const char* fileName, const VertexBufferDescription* vertAttr, ID3D11Device* pDevice);
     
     // Singleton Stuff
-    static void Init(ID3D11Device* device, ID3D11DeviceContext* context);
+    // The pool generates texture mips, at load time and when evicted textures come back. It must outlive the codex's use of it.
+    static void Init(ID3D11Device* device, ID3D11DeviceContext* context, Core::WorkerPool* pPool);
+
+    // For runs without a device: only meshes can be added, and only without one. No textures, shaders or materials.
+    static void InitHeadless();
     static void Destroy();
 
+    // Swaps in any assets that were re-imported since the last call. Call once per frame, before anything is drawn.
+    static void ProcessHotReload(ID3D11DeviceContext* context);
+
+    // Frees whatever was released long enough ago. Call once per frame, after Present.
+    static void EndFrame();
+
     inline static ResourceCodex& GetSingleton() { static ResourceCodex codexInstance; return codexInstance; }
 
-    const Mesh* GetMesh(MeshID UID) const;
-    const Material* GetMaterial(uint8_t materialIndex) const;
-    const ResourceBindChord* GetTexture(TextureID UID) const;
-    const VertexShader* GetVertexShader(ShaderID UID) const;
-    const PixelShader* GetPixelShader(ShaderID UID) const;
+    // Name -> handle resolution hashes, so do it once at load time and keep the handle
+    MeshHandle         FindMesh(MeshID UID) const                 { return mMeshes.Find(UID); }
+    TextureHandle      FindTexture(TextureID UID) const           { return mTextures.Find(UID); }
+    VertexShaderHandle FindVertexShader(ShaderID UID) const       { return mVertexShaders.Find(UID); }
+    PixelShaderHandle  FindPixelShader(ShaderID UID) const        { return mPixelShaders.Find(UID); }
+    MaterialHandle     FindMaterial(MaterialID UID) const         { return mMaterials.Find(UID); }
+
+    // Variants of a permutation family, by the family's name without the key ("PhongPS"). Only the stage's bits of
+    // the key are looked at. Invalid if that combination wasn't compiled.
+    VertexShaderHandle FindVertexShader(ShaderID family, PermutationKey key) const
+    {
+        return mVertexShaderVariants.Get(mVertexShaderVariants.FindFamily(family), key & ShaderPermutations::kVertexMask);
+    }
+    PixelShaderHandle  FindPixelShader(ShaderID family, PermutationKey key) const
+    {
+        return mPixelShaderVariants.Get(mPixelShaderVariants.FindFamily(family), key & ShaderPermutations::kPixelMask);
+    }
+
+    // Hot path: a bounds check and an indexed load. Null for stale handles.
+    const Mesh*              GetMesh(MeshHandle handle) const                 { return mMeshes.Get(handle); }
+    const ResourceBindChord* GetTexture(TextureHandle handle) const           { return mTextures.Get(handle); }
+    const VertexShader*      GetVertexShader(VertexShaderHandle handle) const { return mVertexShaders.Get(handle); }
+    const PixelShader*       GetPixelShader(PixelShaderHandle handle) const   { return mPixelShaders.Get(handle); }
+    const Material*          GetMaterial(MaterialHandle handle) const         { return mMaterials.Get(handle); }
+
+    // Changes whenever any mesh is loaded again, by a hot reload or coming back from eviction, so its bounds may have too
+    uint32_t GetMeshVersion() const { return mMeshVersion; }
+    const PipelineState*     GetPipelineState(PipelineStateHandle handle) const { return mPipelineStates.Get(handle); }
+
+    // A single compare when the pipeline is already the bound one, otherwise binds all of it, null states as D3D11's defaults.
+    // Other passes change state behind the tracker's back, so start each pass with an invalid io_bound.
+    // False for a stale handle, in which case nothing is bound.
+    inline bool BindPipelineState(ID3D11DeviceContext* context, PipelineStateHandle handle, PipelineStateHandle* io_bound) const
+    {
+        if (handle == *io_bound)
+            return true;
+
+        const PipelineState* pState = mPipelineStates.Get(handle);
+        if (!pState)
+            return false;
+
+        context->IASetInputLayout(pState->InputLayout);
+        context->VSSetShader(pState->VertexShader, nullptr, 0);
+        context->PSSetShader(pState->PixelShader, nullptr, 0);
+        context->RSSetState(pState->RasterState);
+        context->OMSetDepthStencilState(pState->DepthStencilState, 0);
+        context->OMSetBlendState(pState->BlendState, nullptr, 0xFFFFFFFF);
+        *io_bound = handle;
+        return true;
+    }
+
+    // Draw time access: marks the resource as used this frame, and if it was evicted, loads it back first.
+    // That reload is synchronous, though usually served from the asset cache.
+    inline const Mesh* UseMesh(MeshHandle handle)
+    {
+        Mesh* pMesh = mMeshes.Get(handle);
+        if (!pMesh || (!mResidency.IsResident(ResidencyKind::MESH, handle.Value) && !MakeResident(handle, pMesh)))
+            return nullptr;
+
+        mResidency.Touch(ResidencyKind::MESH, handle.Value, mFrameIndex);
+        return pMesh;
+    }
+
+    inline const ResourceBindChord* UseTexture(TextureHandle handle)
+    {
+        ResourceBindChord* pChord = mTextures.Get(handle);
+        if (!pChord || (!mResidency.IsResident(ResidencyKind::TEXTURE, handle.Value) && !MakeResident(handle, pChord)))
+            return nullptr;
+
+        mResidency.Touch(ResidencyKind::TEXTURE, handle.Value, mFrameIndex);
+        return pChord;
+    }
+
+    // Buffers, textures and shader bytecode created through the factories count against the budget, which is unlimited by default.
+    // Going over evicts least recently used meshes and standalone textures at the end of a frame.
+    static void SetMemoryBudget(uint64_t bytes) { GetSingleton().mResidency.SetBudget(bytes); }
+    uint64_t GetMemoryFootprint() const         { return mResidency.GetCurrentBytes(); }
+    uint64_t GetPeakMemoryFootprint() const     { return mResidency.GetPeakBytes(); }
+    const ResidencyManager& GetResidency() const { return mResidency; }
+
+    // Everything starts with one reference, owned by whoever loaded it (the factories, for startup assets).
+    // Anything that keeps a handle across frames should hold its own reference.
+    // When the last one is released the resource is destroyed kDeferredReleaseFrames later,
+    // and a destroyed material releases its pipeline state and textures in turn, the pipeline state its shaders.
+    void AddRef(MeshHandle handle);
+    void AddRef(TextureHandle handle);
+    void AddRef(VertexShaderHandle handle);
+    void AddRef(PixelShaderHandle handle);
+    void AddRef(PipelineStateHandle handle);
+    void AddRef(MaterialHandle handle);
+
+    void Release(MeshHandle handle);
+    void Release(TextureHandle handle);
+    void Release(VertexShaderHandle handle);
+    void Release(PixelShaderHandle handle);
+    void Release(PipelineStateHandle handle);
+    void Release(MaterialHandle handle);
+    
+    // For textures packed into arrays: the shared bank chord and the slice this texture set lives in
+    bool GetTextureSlice(TextureID UID, TextureHandle* out_bank, uint32_t* out_slice) const;
 
 private:
 
-    std::unordered_map<ShaderID, const VertexShader>  mVertexShaders;
-    std::unordered_map<ShaderID, const PixelShader>   mPixelShaders;
-    std::unordered_map<MeshID, const Mesh>            mMeshMap;
-    std::unordered_map<TextureID, ResourceBindChord>   mTextureMap;
+    ResourceTable<VertexShader>      mVertexShaders;
+    ResourceTable<PixelShader>       mPixelShaders;
+    ResourceTable<Mesh>              mMeshes;
+
+    // Handles into the two tables above, for shaders compiled as permutations
+    PermutationTable<VertexShaderHandle> mVertexShaderVariants;
+    PermutationTable<PixelShaderHandle>  mPixelShaderVariants;
+
+    // Standalone texture sets are named, Texture2DArray banks are only reachable through mTextureSlices
+    ResourceTable<ResourceBindChord>                mTextures;
+    std::unordered_map<TextureID, TextureBankSlice> mTextureSlices;
+
+    ResourceTable<Material>          mMaterials;
+
+    // Pipeline states are unnamed and found by the hash of their desc. The state objects they point to
+    // are shared between them by key (see PipelineStateDesc) and live as long as the codex.
+    ResourceTable<PipelineState>                              mPipelineStates;
+    std::unordered_map<uint64_t, PipelineStateHandle>         mPipelineStateIndex;
+    std::unordered_map<uint32_t, ID3D11RasterizerState*>      mRasterStates;
+    std::unordered_map<uint32_t, ID3D11DepthStencilState*>    mDepthStencilStates;
+    std::unordered_map<uint32_t, ID3D11BlendState*>           mBlendStates;
+
+    // What each mesh was imported from, so it can be imported again when the file changes
+    struct MeshSource
+    {
+        std::string                    FileName;
+        const VertexBufferDescription* Layout;
+    };
+    std::unordered_map<MeshID, MeshSource> mMeshSources;
 
-    // Materials are queried by index rather than by ID since it's done at runtime 
-    // TODO: Need to do this for meshes as well.
-    // TODO: Use fixed_vector?
-    std::vector<Material> mMaterials;
+    // Same for standalone textures, per slot, so evicted ones can be loaded again
+    struct TextureSource
+    {
+        std::wstring Files[(UINT)TextureSlots::COUNT];
+        bool         IsDDS[(UINT)TextureSlots::COUNT];
+    };
+    std::unordered_map<TextureID, TextureSource> mTextureSources;
+
+    ResidencyManager  mResidency;
+    ID3D11Device*     mpDevice = nullptr;
+    Core::WorkerPool* mpWorkerPool = nullptr;
+
+    // Resources whose count reached zero, oldest first
+    enum class DeferredKind : uint8_t
+    {
+        MESH,
+        TEXTURE,
+        VERTEX_SHADER,
+        PIXEL_SHADER,
+        PIPELINE_STATE,
+        MATERIAL
+    };
+
+    struct DeferredRelease
+    {
+        DeferredKind Kind;
+        uint32_t     HandleValue;
+        uint64_t     ReleaseFrame;
+    };
+    std::vector<DeferredRelease> mDeferredReleases;
+    uint64_t                     mFrameIndex = 0;
+    uint32_t                     mMeshVersion = 0;
+
+    // Reused every frame so releasing and eviction don't allocate once they have warmed up
+    std::vector<DeferredRelease> mExpiredScratch;
+    std::vector<ResidencyKey>    mEvictionScratch;
+
+    // Only exists in builds with ESL_HOT_RELOAD
+    HotReloader* mpHotReloader = nullptr;
 
     // Singleton stuff
     static ResourceCodex* CodexInstance;
@@ -71,13 +238,43 @@ private:
 private:
     friend struct TextureFactory;
     void InsertTexture(TextureID hash, UINT slot, ID3D11ShaderResourceView* pSRV);
+    TextureHandle InsertTextureBank(const ResourceBindChord& bank);
+    void InsertTextureSlice(TextureID hash, TextureHandle bank, uint32_t slice);
+    void SetTextureSource(TextureID hash, UINT slot, const std::wstring& path, bool isDDS);
     
     friend struct MaterialFactory;
-    MaterialIndex PushMaterial(const Material& material);
+    // Both take a reference on the material's pipeline state and textures
+    MaterialHandle InsertMaterial(MaterialID UID, const Material& material);
+    void ReplaceMaterial(MaterialHandle handle, const Material& material);
+
+    // The pipeline state already made from an identical desc, or a new one. Either way the caller owns a reference.
+    // Both shaders must be loaded.
+    PipelineStateHandle AcquirePipelineState(const PipelineStateDesc& desc, ID3D11Device* pDevice);
 
     friend struct ShaderFactory;
-    void AddVertexShader(ShaderID hash, const wchar_t* path, ID3D11Device* pDevice);
-    void AddPixelShader(ShaderID hash, const wchar_t* path, ID3D11Device* pDevice);
+    VertexShaderHandle AddVertexShader(ShaderID hash, const wchar_t* path, ID3D11Device* pDevice);
+    PixelShaderHandle AddPixelShader(ShaderID hash, const wchar_t* path, ID3D11Device* pDevice);
+
+    // Hot reload swaps resources in place, so every handle handed out (and every material) stays valid
+    friend class HotReloader;
+    const MeshSource* GetMeshSource(MeshID UID) const;
+    void ReplaceMesh(MeshID UID, const Mesh& mesh);
+    void ReplacePixelShader(ShaderID UID, const PixelShader& shader);
+    void ReplaceTextureBankSRV(TextureHandle bank, UINT slot, ID3D11ShaderResourceView* pSRV);
+    bool GetTextureBankIndex(TextureID UID, TextureBankSlice* out_location) const;
+
+    // Lifetime
+    void Defer(DeferredKind kind, uint32_t handleValue);
+    void DestroyNow(const DeferredRelease& entry);
+    void AddRefDependencies(const Material& material);
+    void ReleaseDependencies(const Material& material);
+
+    // Residency
+    void TrackMesh(MeshHandle handle);
+    void TrackTexture(TextureHandle handle);
+    void Evict(const ResidencyKey& key);
+    bool MakeResident(MeshHandle handle, Mesh* pMesh);
+    bool MakeResident(TextureHandle handle, ResourceBindChord* pChord);
 };
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of ResourceIDs.h
+----------------------------------------------*/
+#include "ResourceIDs.h"
+
+#if defined(ESL_DEBUG)
+
+#include <assert.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Renderer {
+
+namespace {
+
+struct NameRegistry
+{
+    std::mutex                                   Mutex;
+    std::unordered_map<id_type, std::string>     Names[(size_t)ResourceKind::COUNT];
+};
+
+NameRegistry& GetRegistry()
+{
+    static NameRegistry registry;
+    return registry;
+}
+
+}
+
+void RegisterResourceName(ResourceKind kind, id_type id, std::string_view name)
+{
+    NameRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+
+    auto& names = registry.Names[(size_t)kind];
+    auto itFind = names.find(id);
+    if (itFind == names.end())
+    {
+        names.emplace(id, std::string(name));
+        return;
+    }
+
+    // Same name again is fine (hot reload, duplicate loads), a different one means two resources share an ID
+    assert(itFind->second == name && "Resource ID collision between two runtime names");
+}
+
+const char* GetResourceName(ResourceKind kind, id_type id)
+{
+    for (const RegisteredID& reg : kRegisteredIDs)
+    {
+        if (reg.Kind == kind && reg.ID == id)
+            return reg.Name;
+    }
+
+    NameRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+
+    auto& names = registry.Names[(size_t)kind];
+    auto itFind = names.find(id);
+    return itFind != names.end() ? itFind->second.c_str() : nullptr;
+}
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Compile-time resource IDs generated from ResourceIDs.inl.
+Any two names of the same kind that hash to the same ID fail the build.
+Debug builds can map IDs (including ones loaded at runtime) back to names.
+----------------------------------------------*/
+#ifndef EASEL_RESOURCEIDS_H
+#define EASEL_RESOURCEIDS_H
+
+#include "hash_util.h"
+
+#include <stdint.h>
+#include <string_view>
+
+namespace Renderer {
+
+typedef uint32_t id_type;
+typedef id_type ShaderID;
+typedef id_type MeshID;
+typedef id_type TextureID;
+typedef id_type MaterialID;
+
+enum class ResourceKind : uint8_t
+{
+    SHADER,
+    MESH,
+    TEXTURE,
+    MATERIAL,
+    COUNT
+};
+
+namespace IDs {
+#define ESL_RESOURCE_ID(kind, ident, name) constexpr id_type ident = fnv1a(name);
+#include "ResourceIDs.inl"
+#undef ESL_RESOURCE_ID
+}
+
+struct RegisteredID
+{
+    ResourceKind Kind;
+    id_type      ID;
+    const char*  Name;
+};
+
+constexpr RegisteredID kRegisteredIDs[] =
+{
+#define ESL_RESOURCE_ID(kind, ident, name) { ResourceKind::kind, IDs::ident, name },
+#include "ResourceIDs.inl"
+#undef ESL_RESOURCE_ID
+};
+
+constexpr size_t kRegisteredIDCount = sizeof(kRegisteredIDs) / sizeof(kRegisteredIDs[0]);
+
+constexpr bool HasRegisteredIDCollision()
+{
+    for (size_t i = 0; i != kRegisteredIDCount; ++i)
+    {
+        for (size_t j = i + 1; j != kRegisteredIDCount; ++j)
+        {
+            const RegisteredID& a = kRegisteredIDs[i];
+            const RegisteredID& b = kRegisteredIDs[j];
+            if (a.Kind == b.Kind && a.ID == b.ID && std::string_view(a.Name) != std::string_view(b.Name))
+                return true;
+        }
+    }
+    return false;
+}
+
+static_assert(!HasRegisteredIDCollision(), "Two resource names in ResourceIDs.inl hash to the same ID, rename one of them");
+
+#if defined(ESL_DEBUG)
+// Records a name loaded at runtime. Asserts if a different name of the same kind already owns the ID.
+void RegisterResourceName(ResourceKind kind, id_type id, std::string_view name);
+
+// Name behind an ID, or nullptr if it was never registered
+const char* GetResourceName(ResourceKind kind, id_type id);
+#endif
+
+}
+#endif
@@ -0,0 +1,30 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Registry of every resource name referenced from code.
+ESL_RESOURCE_ID(Kind, Identifier, "Name") becomes Renderer::IDs::Identifier,
+hashed at compile time. Names only need to be unique within their kind.
+Deliberately no include guard: ResourceIDs.h includes this several times.
+----------------------------------------------*/
+
+// Shaders, by compiled file name
+ESL_RESOURCE_ID(SHADER,   WireframePS,           "WireframePS.cso")
+ESL_RESOURCE_ID(SHADER,   SkyVS,                 "SkyVS.cso")
+ESL_RESOURCE_ID(SHADER,   SkyPS,                 "SkyPS.cso")
+
+// Shader permutation families, by name without the key
+ESL_RESOURCE_ID(SHADER,   PhongVS,               "PhongVS")
+ESL_RESOURCE_ID(SHADER,   PhongPS,               "PhongPS")
+
+// Meshes, by model file name
+ESL_RESOURCE_ID(MESH,     CubeMesh,              "cube.obj")
+ESL_RESOURCE_ID(MESH,     SphereMesh,            "sphere.obj")
+
+// Texture sets, by the name before the underscore
+ESL_RESOURCE_ID(TEXTURE,  LunarTextures,         "Lunar")
+ESL_RESOURCE_ID(TEXTURE,  SpaceTextures,         "Space")
+
+// Materials, by their name in materials.xml
+ESL_RESOURCE_ID(MATERIAL, LunarMaterial,         "Lunar")
+ESL_RESOURCE_ID(MATERIAL, SkyMaterial,           "Sky")
+ESL_RESOURCE_ID(MATERIAL, WireframeMaterial,     "Wireframe")
@@ -0,0 +1,193 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Dense resource storage addressed by generational handles.
+A handle packs a slot index and the slot's generation into 32 bits, so a
+lookup is a bounds check, a generation compare and an indexed load. The
+name hash is only used once, to resolve a handle at load time.
+Pointers returned by Get() are invalidated by Insert(), handles never are.
+Each slot also carries a reference count. The table only does the counting,
+what happens when it reaches zero is up to the owner (see ResourceCodex).
+----------------------------------------------*/
+#ifndef EASEL_RESOURCETABLE_H
+#define EASEL_RESOURCETABLE_H
+
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Renderer {
+
+static const uint32_t kHandleIndexBits      = 20;   // Up to ~1M live resources per table
+static const uint32_t kHandleIndexMask      = (1u << kHandleIndexBits) - 1;
+static const uint32_t kHandleGenerationMask = (1u << (32 - kHandleIndexBits)) - 1;
+
+// Typed so a mesh handle can't be passed where a texture is expected. Zero is never a valid handle.
+template<typename T>
+struct ResourceHandle
+{
+    uint32_t Value = 0;
+
+    bool     IsValid() const       { return Value != 0; }
+    uint32_t GetIndex() const      { return Value & kHandleIndexMask; }
+    uint32_t GetGeneration() const { return Value >> kHandleIndexBits; }
+
+    bool operator==(ResourceHandle other) const { return Value == other.Value; }
+    bool operator!=(ResourceHandle other) const { return Value != other.Value; }
+
+    static ResourceHandle Make(uint32_t index, uint32_t generation)
+    {
+        ResourceHandle h;
+        h.Value = (generation << kHandleIndexBits) | index;
+        return h;
+    }
+};
+
+template<typename T>
+class ResourceTable
+{
+public:
+    typedef ResourceHandle<T> Handle;
+
+    // Resource IDs are fnv1a hashes, which are never zero for the names we use
+    static constexpr uint32_t kUnnamed = 0;
+
+    // Starts with one reference, owned by whoever inserted it.
+    // Names are optional: unnamed entries (texture banks) are only reachable through their handle.
+    Handle Insert(const T& value)
+    {
+        return Insert(kUnnamed, value);
+    }
+
+    Handle Insert(uint32_t nameId, const T& value)
+    {
+        uint32_t index;
+        if (!mFreeList.empty())
+        {
+            index = mFreeList.back();
+            mFreeList.pop_back();
+            mItems[index] = value;
+        }
+        else
+        {
+            index = (uint32_t)mItems.size();
+            mItems.push_back(value);
+            mGenerations.push_back(1);
+            mRefCounts.push_back(0);
+            mNames.push_back(kUnnamed);
+            mAlive.push_back(false);
+        }
+
+        mRefCounts[index] = 1;
+        mNames[index] = nameId;
+        mAlive[index] = true;
+
+        const Handle h = Handle::Make(index, mGenerations[index]);
+        if (nameId != kUnnamed)
+            mLookup[nameId] = h;
+        return h;
+    }
+
+    // Load time only. Invalid handle when the name was never inserted.
+    Handle Find(uint32_t nameId) const
+    {
+        auto itFind = mLookup.find(nameId);
+        return itFind != mLookup.end() ? itFind->second : Handle();
+    }
+
+    // Hot path
+    const T* Get(Handle h) const
+    {
+        const uint32_t index = h.GetIndex();
+        if (index >= mGenerations.size() || mGenerations[index] != h.GetGeneration())
+            return nullptr;
+        return &mItems[index];
+    }
+
+    T* Get(Handle h)
+    {
+        return const_cast<T*>(static_cast<const ResourceTable*>(this)->Get(h));
+    }
+
+    // Both return the new count, and zero for stale handles.
+    // Reaching zero doesn't free anything, the entry stays resolvable until Remove().
+    uint32_t AddRef(Handle h)
+    {
+        if (!Get(h))
+            return 0;
+        return ++mRefCounts[h.GetIndex()];
+    }
+
+    uint32_t Release(Handle h)
+    {
+        if (!Get(h) || mRefCounts[h.GetIndex()] == 0)
+            return 0;
+        return --mRefCounts[h.GetIndex()];
+    }
+
+    uint32_t GetRefCount(Handle h) const { return Get(h) ? mRefCounts[h.GetIndex()] : 0; }
+
+    // The name the entry was inserted with, kUnnamed if none
+    uint32_t GetName(Handle h) const { return Get(h) ? mNames[h.GetIndex()] : kUnnamed; }
+
+    // Frees the slot regardless of its count. Every outstanding handle to it stops resolving, the caller releases whatever T owns.
+    bool Remove(Handle h)
+    {
+        if (!Get(h))
+            return false;
+
+        const uint32_t index = h.GetIndex();
+
+        // Skip generation 0 on wrap so the all-zero handle stays invalid
+        uint32_t next = (mGenerations[index] + 1) & kHandleGenerationMask;
+        mGenerations[index] = next ? next : 1;
+        mRefCounts[index] = 0;
+        mAlive[index] = false;
+        mItems[index] = T();
+        mFreeList.push_back(index);
+
+        // Only forget the name if it hasn't been re-inserted under a newer handle since
+        auto itFind = mLookup.find(mNames[index]);
+        if (itFind != mLookup.end() && itFind->second == h)
+            mLookup.erase(itFind);
+        mNames[index] = kUnnamed;
+        return true;
+    }
+
+    // Visits every live entry as func(handle, item)
+    template<typename TFunc>
+    void ForEach(const TFunc& func)
+    {
+        for (uint32_t i = 0; i != (uint32_t)mItems.size(); ++i)
+        {
+            if (mAlive[i])
+                func(Handle::Make(i, mGenerations[i]), mItems[i]);
+        }
+    }
+
+    uint32_t GetCount() const { return (uint32_t)(mItems.size() - mFreeList.size()); }
+
+    void Clear()
+    {
+        mItems.clear();
+        mGenerations.clear();
+        mRefCounts.clear();
+        mNames.clear();
+        mAlive.clear();
+        mFreeList.clear();
+        mLookup.clear();
+    }
+
+private:
+    std::vector<T>                       mItems;
+    std::vector<uint32_t>                mGenerations;
+    std::vector<uint32_t>                mRefCounts;
+    std::vector<uint32_t>                mNames;
+    std::vector<bool>                    mAlive;
+    std::vector<uint32_t>                mFreeList;
+    std::unordered_map<uint32_t, Handle> mLookup;
+};
+
+}
+#endif
@@ -7,35 +7,12 @@ Description : Wrapper for Vertex/Pixel/other shader code
 #define SHADER_H
 
 #include "DXCore.h"
+#include "ResourceTable.h"
 #include "ThrowMacros.h"
+#include "VertexFormat.h"
 
 namespace Renderer {
 
-#pragma region VertexShader Stuff
-typedef uint8_t semantic_t;
-enum class Semantics : semantic_t
-{
-    POSITION,
-    NORMAL,
-    TEXCOORD,
-    TANGENT,
-    BINORMAL,
-    COLOR,
-    BLENDINDICES,
-    BLENDWEIGHTS,
-    WORLDMATRIX,
-    COUNT
-};
-
-struct VertexBufferDescription
-{
-    Semantics* SemanticsArr;
-    uint16_t*  ByteOffsets;
-    uint16_t   AttrCount;
-    uint16_t   ByteSize;
-};
-#pragma endregion
-
 struct VertexShader
 {
     ID3D11InputLayout*  InputLayout;
@@ -50,6 +27,9 @@ struct PixelShader
     ID3D11SamplerState* SamplerState;
     ID3D11PixelShader*  Shader;
 };
+
+typedef ResourceHandle<VertexShader> VertexShaderHandle;
+typedef ResourceHandle<PixelShader>  PixelShaderHandle;
 }
 
 #endif
\ No newline at end of file
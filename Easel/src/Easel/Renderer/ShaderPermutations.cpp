@@ -0,0 +1,56 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of ShaderPermutations.h
+----------------------------------------------*/
+#include "ShaderPermutations.h"
+
+namespace Renderer {
+
+const char* const ShaderPermutations::kFeatureDefines[kFeatureCount] = { "NORMAL_MAP", "TEXTURE_ARRAY", "ALPHA_TEST", "INSTANCED" };
+const char* const ShaderPermutations::kLightClassNames[(uint32_t)LightClass::COUNT] = { "ambient", "sun", "clustered" };
+
+bool ShaderPermutations::ParseVariantName(std::wstring_view fileName, std::wstring_view* out_family, PermutationKey* out_key)
+{
+    const size_t dot = fileName.rfind(L'.');
+    const std::wstring_view stem = fileName.substr(0, dot);
+    const size_t marker = stem.rfind(L"_p");
+    if (marker == std::wstring_view::npos || marker == 0 || marker + 2 == stem.size())
+        return false;
+
+    // Hex digits only, and within the key's bits
+    PermutationKey key = 0;
+    for (const wchar_t c : stem.substr(marker + 2))
+    {
+        uint32_t digit;
+        if (c >= L'0' && c <= L'9')
+            digit = c - L'0';
+        else if (c >= L'a' && c <= L'f')
+            digit = c - L'a' + 10;
+        else
+            return false;
+
+        key = key * 16 + digit;
+        if (key >= kKeyCount)
+            return false;
+    }
+
+    *out_family = stem.substr(0, marker);
+    *out_key = key;
+    return true;
+}
+
+bool ShaderPermutations::ParseLightClass(std::string_view name, LightClass* out_lights)
+{
+    for (uint32_t i = 0; i != (uint32_t)LightClass::COUNT; ++i)
+    {
+        if (name == kLightClassNames[i])
+        {
+            *out_lights = (LightClass)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,112 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Shader permutations. One source file is compiled once per
+combination of the features it supports, each with the matching defines,
+so features cost nothing at runtime instead of branching in the shader.
+A permutation key packs the features into a few bits, and every variant
+is named after its family and key: PhongPS_p23.cso is PhongPS with key
+0x23. The codex keeps each family's variants in a flat table indexed by
+key, so picking one is a single indexed load.
+The Shaders project in premake5.lua generates the variants and has to
+agree with the bit layout here.
+----------------------------------------------*/
+#ifndef EASEL_SHADERPERMUTATIONS_H
+#define EASEL_SHADERPERMUTATIONS_H
+
+#include <stdint.h>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Renderer {
+
+typedef uint32_t PermutationKey;
+
+// One bit each, defined to 1 in the variants that have them
+enum class ShaderFeature : PermutationKey
+{
+    NORMAL_MAP    = 1u << 0,
+    TEXTURE_ARRAY = 1u << 1,    // Textures come from a bank, indexed by the material's slice
+    ALPHA_TEST    = 1u << 2,
+    INSTANCED     = 1u << 3,    // World matrices come in per instance rather than from a cbuffer
+};
+
+// Which lights a variant shades with, two bits above the features. LIGHT_CLASS in the shaders.
+enum class LightClass : PermutationKey
+{
+    AMBIENT,
+    SUN,                        // The directional light and its shadows
+    CLUSTERED,                  // And the point and spot lights binned into the pixel's cluster
+    COUNT
+};
+
+struct ShaderPermutations final
+{
+    static constexpr uint32_t       kFeatureCount   = 4;
+    static constexpr uint32_t       kLightClassShift = kFeatureCount;
+    static constexpr uint32_t       kKeyBits        = kFeatureCount + 2;
+    static constexpr PermutationKey kKeyCount       = 1u << kKeyBits;
+    static constexpr PermutationKey kLightClassMask = 3u << kLightClassShift;
+
+    // The only bits each stage's variants differ by. Materials have one key for both, each stage looks up its own part.
+    static constexpr PermutationKey kVertexMask     = (PermutationKey)ShaderFeature::INSTANCED;
+    static constexpr PermutationKey kPixelMask      = (PermutationKey)ShaderFeature::NORMAL_MAP | (PermutationKey)ShaderFeature::TEXTURE_ARRAY |
+                                                      (PermutationKey)ShaderFeature::ALPHA_TEST | kLightClassMask;
+
+    // In bit order, as the shaders spell them
+    static const char* const        kFeatureDefines[kFeatureCount];
+    static const char* const        kLightClassNames[(uint32_t)LightClass::COUNT];
+
+    static PermutationKey MakeKey(PermutationKey features, LightClass lights)
+    {
+        return features | ((PermutationKey)lights << kLightClassShift);
+    }
+
+    static LightClass GetLightClass(PermutationKey key) { return (LightClass)((key & kLightClassMask) >> kLightClassShift); }
+
+    // Splits "PhongPS_p23.cso" into "PhongPS" and 0x23. False for anything that isn't a variant.
+    static bool ParseVariantName(std::wstring_view fileName, std::wstring_view* out_family, PermutationKey* out_key);
+
+    // "ambient", "sun" or "clustered"
+    static bool ParseLightClass(std::string_view name, LightClass* out_lights);
+};
+
+// Every family's variants back to back, kKeyCount handles each. Empty slots are invalid handles.
+template<typename THandle>
+class PermutationTable
+{
+public:
+    static constexpr uint32_t kInvalidFamily = ~0u;
+
+    // Load time only, hashes the family name
+    uint32_t FindFamily(uint32_t familyId) const
+    {
+        auto it = mFamilies.find(familyId);
+        return it == mFamilies.end() ? kInvalidFamily : it->second;
+    }
+
+    THandle Get(uint32_t family, PermutationKey key) const
+    {
+        return family == kInvalidFamily ? THandle() : mVariants[family * ShaderPermutations::kKeyCount + key];
+    }
+
+    void Insert(uint32_t familyId, PermutationKey key, THandle handle)
+    {
+        uint32_t family = FindFamily(familyId);
+        if (family == kInvalidFamily)
+        {
+            family = (uint32_t)mFamilies.size();
+            mFamilies.emplace(familyId, family);
+            mVariants.resize(mVariants.size() + ShaderPermutations::kKeyCount);
+        }
+        mVariants[family * ShaderPermutations::kKeyCount + key] = handle;
+    }
+
+private:
+    std::unordered_map<uint32_t, uint32_t> mFamilies;
+    std::vector<THandle>                   mVariants;
+};
+
+}
+#endif
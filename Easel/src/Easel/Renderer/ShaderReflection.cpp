@@ -0,0 +1,335 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of ShaderReflection.h
+----------------------------------------------*/
+#include "ShaderReflection.h"
+
+#include "hash_util.h"
+
+#include <Easel/Assets/AssetCache.h>
+#include <Easel/Core/MappedFile.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <d3d11shader.h>
+#include <d3dcompiler.h>
+
+#pragma comment(lib, "d3dcompiler.lib")
+#endif
+
+namespace Renderer {
+
+namespace {
+
+static const uint32_t kMagic = 0x46525345; // "ESRF"
+
+// Indexed by Semantics. Instance inputs have the same names behind an INSTANCE_ prefix.
+const char* const kSemanticNames[] =
+{
+    "POSITION",
+    "NORMAL",
+    "TEXCOORD",
+    "TANGENT",
+    "BINORMAL",
+    "COLOR",
+    "BLENDINDICES",
+    "BLENDWEIGHTS",
+    "WORLDMATRIX"
+};
+static_assert(sizeof(kSemanticNames) / sizeof(kSemanticNames[0]) == (size_t)Semantics::COUNT, "A semantic is missing its name");
+
+const char kInstancePrefix[] = "INSTANCE_";
+
+// Formats by component count, then type
+const InputFormat kFormats[4][3] =
+{
+    { InputFormat::R32_UINT,          InputFormat::R32_SINT,          InputFormat::R32_FLOAT },
+    { InputFormat::R32G32_UINT,       InputFormat::R32G32_SINT,       InputFormat::R32G32_FLOAT },
+    { InputFormat::R32G32B32_UINT,    InputFormat::R32G32B32_SINT,    InputFormat::R32G32B32_FLOAT },
+    { InputFormat::R32G32B32A32_UINT, InputFormat::R32G32B32A32_SINT, InputFormat::R32G32B32A32_FLOAT }
+};
+
+// Truncates, always terminated
+void CopyName(const char* name, char (&out_name)[kReflectedNameLength])
+{
+    uint32_t i = 0;
+    for (; name && name[i] && i != kReflectedNameLength - 1; ++i)
+        out_name[i] = name[i];
+    memset(out_name + i, 0, kReflectedNameLength - i);
+}
+
+struct FileHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t BytecodeHash;
+    uint32_t InputCount;
+    uint32_t InstanceStart;
+    uint16_t VertexByteSize;
+    uint16_t InstanceByteSize;
+    uint32_t CBufferCount;
+    uint32_t VariableCount;
+};
+
+template<typename T>
+bool ReadArray(Assets::BlobReader& reader, uint32_t count, std::vector<T>* out_values)
+{
+    if ((size_t)(reader.End - reader.Cursor) / sizeof(T) < count)
+        return false;
+
+    out_values->resize(count);
+    return reader.ReadBytes(out_values->data(), sizeof(T) * count);
+}
+
+}
+
+std::string ShaderReflector::GetReflectionPath(const std::string& shaderPath)
+{
+    const size_t dot = shaderPath.find_last_of('.');
+    const size_t slash = shaderPath.find_last_of("/\\");
+    const bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    return (hasExtension ? shaderPath.substr(0, dot) : shaderPath) + ".refl";
+}
+
+bool ShaderReflector::BuildInputs(const SignatureParameter* params, uint32_t count, ShaderReflection* out_reflection)
+{
+    out_reflection->Inputs.resize(count);
+    out_reflection->InstanceStart = count;
+    out_reflection->VertexByteSize = 0;
+    out_reflection->InstanceByteSize = 0;
+
+    bool perInstance = false;
+    for (uint32_t i = 0; i != count; ++i)
+    {
+        const SignatureParameter& param = params[i];
+        ReflectedInput& input = out_reflection->Inputs[i];
+        CopyName(param.SemanticName, input.SemanticName);
+        input.SemanticIndex = param.SemanticIndex;
+
+        // By convention the regular vertex attributes are done once the first instanced one shows up
+        const char* name = param.SemanticName;
+        if (!strncmp(name, kInstancePrefix, sizeof(kInstancePrefix) - 1))
+        {
+            name += sizeof(kInstancePrefix) - 1;
+            if (!perInstance)
+                out_reflection->InstanceStart = i;
+            perInstance = true;
+        }
+        input.PerInstance = perInstance;
+
+        semantic_t s = 0;
+        while (s != (semantic_t)Semantics::COUNT && strcmp(name, kSemanticNames[s]))
+            ++s;
+        if (s == (semantic_t)Semantics::COUNT)
+            return false;
+        input.Semantic = (Semantics)s;
+
+        // Highest component used decides the width, same as the shader's own declaration
+        const uint32_t components = param.Mask > 7 ? 4 : param.Mask > 3 ? 3 : param.Mask > 1 ? 2 : 1;
+        const bool knownType = param.Type != ComponentType::UNKNOWN;
+        input.Format = knownType ? kFormats[components - 1][(uint32_t)param.Type - 1] : InputFormat::UNKNOWN;
+
+        uint16_t& byteSize = perInstance ? out_reflection->InstanceByteSize : out_reflection->VertexByteSize;
+        input.ByteOffset = byteSize;
+        byteSize += (uint16_t)(components * 4);
+    }
+
+    return true;
+}
+
+void ShaderReflector::Serialize(const ShaderReflection& reflection, std::vector<uint8_t>* out_blob)
+{
+    FileHeader header = {};
+    header.Magic = kMagic;
+    header.Version = kVersion;
+    header.BytecodeHash = reflection.BytecodeHash;
+    header.InputCount = (uint32_t)reflection.Inputs.size();
+    header.InstanceStart = reflection.InstanceStart;
+    header.VertexByteSize = reflection.VertexByteSize;
+    header.InstanceByteSize = reflection.InstanceByteSize;
+    header.CBufferCount = (uint32_t)reflection.CBuffers.size();
+    header.VariableCount = (uint32_t)reflection.Variables.size();
+
+    // Everything is plain data, so each array goes out as is
+    Assets::BlobWriter writer(out_blob);
+    writer.Write(header);
+    writer.WriteBytes(reflection.Inputs.data(), sizeof(ReflectedInput) * reflection.Inputs.size());
+    writer.WriteBytes(reflection.CBuffers.data(), sizeof(ReflectedCBuffer) * reflection.CBuffers.size());
+    writer.WriteBytes(reflection.Variables.data(), sizeof(ReflectedVariable) * reflection.Variables.size());
+}
+
+bool ShaderReflector::Deserialize(const uint8_t* data, size_t size, ShaderReflection* out_reflection)
+{
+    Assets::BlobReader reader(data, size);
+
+    FileHeader header;
+    if (!reader.Read(&header) || header.Magic != kMagic || header.Version != kVersion || header.InstanceStart > header.InputCount)
+        return false;
+
+    ShaderReflection reflection;
+    reflection.BytecodeHash = header.BytecodeHash;
+    reflection.InstanceStart = header.InstanceStart;
+    reflection.VertexByteSize = header.VertexByteSize;
+    reflection.InstanceByteSize = header.InstanceByteSize;
+    if (!ReadArray(reader, header.InputCount, &reflection.Inputs) ||
+        !ReadArray(reader, header.CBufferCount, &reflection.CBuffers) ||
+        !ReadArray(reader, header.VariableCount, &reflection.Variables))
+        return false;
+
+    // Names are read back into fixed arrays, make sure they end
+    for (ReflectedInput& input : reflection.Inputs)
+    {
+        input.SemanticName[kReflectedNameLength - 1] = 0;
+        if ((semantic_t)input.Semantic >= (semantic_t)Semantics::COUNT)
+            return false;
+    }
+    for (ReflectedCBuffer& cbuffer : reflection.CBuffers)
+    {
+        cbuffer.Name[kReflectedNameLength - 1] = 0;
+        if (cbuffer.FirstVariable > header.VariableCount || cbuffer.VariableCount > header.VariableCount - cbuffer.FirstVariable)
+            return false;
+    }
+    for (ReflectedVariable& variable : reflection.Variables)
+        variable.Name[kReflectedNameLength - 1] = 0;
+
+    *out_reflection = std::move(reflection);
+    return true;
+}
+
+bool ShaderReflector::Load(const std::string& path, uint64_t bytecodeHash, ShaderReflection* out_reflection)
+{
+    Core::MappedFile file;
+    if (!file.Open(path))
+        return false;
+
+    ShaderReflection reflection;
+    if (!Deserialize((const uint8_t*)file.GetData(), file.GetSize(), &reflection) || reflection.BytecodeHash != bytecodeHash)
+        return false;
+
+    *out_reflection = std::move(reflection);
+    return true;
+}
+
+bool ShaderReflector::Save(const std::string& path, const ShaderReflection& reflection)
+{
+    std::vector<uint8_t> blob;
+    Serialize(reflection, &blob);
+
+    // Through a temp file, so a running game never maps half of one
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write((const char*)blob.data(), (std::streamsize)blob.size()))
+            return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+        std::filesystem::remove(tempPath, ec);
+    return !ec;
+}
+
+bool ShaderReflector::CheckCBuffer(const ShaderReflection& reflection, const ReflectedCBuffer& cbuffer, const CBufferLayout& layout, std::string* out_error)
+{
+    auto fail = [&](const std::string& msg)
+    {
+        if (out_error)
+            *out_error = std::string(cbuffer.Name) + ": " + msg;
+        return false;
+    };
+
+    // Shaders may stop short of the end, but never read past what's uploaded
+    if (cbuffer.Size > layout.Size)
+        return fail("is " + std::to_string(cbuffer.Size) + " bytes, C++ uploads " + std::to_string(layout.Size));
+
+    for (uint32_t i = 0; i != cbuffer.VariableCount; ++i)
+    {
+        const ReflectedVariable& variable = reflection.Variables[cbuffer.FirstVariable + i];
+        for (uint32_t f = 0; f != layout.FieldCount; ++f)
+        {
+            const CBufferField& field = layout.Fields[f];
+            if (strcmp(field.Name, variable.Name))
+                continue;
+
+            if (field.Offset != variable.Offset)
+                return fail(std::string(variable.Name) + " is at " + std::to_string(variable.Offset) + ", C++ has it at " + std::to_string(field.Offset));
+            if (field.Size < variable.Size)
+                return fail(std::string(variable.Name) + " is " + std::to_string(variable.Size) + " bytes, C++ has " + std::to_string(field.Size));
+        }
+    }
+
+    return true;
+}
+
+#if defined(_WIN32)
+bool ShaderReflector::Reflect(const void* bytecode, size_t size, ShaderReflection* out_reflection)
+{
+    ID3D11ShaderReflection* pReflection = nullptr;
+    if (FAILED(D3DReflect(bytecode, size, IID_ID3D11ShaderReflection, reinterpret_cast<void**>(&pReflection))))
+        return false;
+
+    D3D11_SHADER_DESC shaderDesc;
+    pReflection->GetDesc(&shaderDesc);
+
+    ShaderReflection reflection;
+    reflection.BytecodeHash = fnv1a_64(bytecode, size);
+
+    // Only vertex shaders have inputs anyone binds a layout for
+    bool succeeded = true;
+    if (D3D11_SHVER_GET_TYPE(shaderDesc.Version) == D3D11_SHVER_VERTEX_SHADER)
+    {
+        std::vector<SignatureParameter> params(shaderDesc.InputParameters);
+        for (UINT i = 0; i != shaderDesc.InputParameters; ++i)
+        {
+            D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+            pReflection->GetInputParameterDesc(i, &paramDesc);
+            params[i] = { paramDesc.SemanticName, paramDesc.SemanticIndex, paramDesc.Mask, (ComponentType)paramDesc.ComponentType };
+        }
+        succeeded = BuildInputs(params.data(), (uint32_t)params.size(), &reflection);
+    }
+
+    for (UINT i = 0; succeeded && i != shaderDesc.ConstantBuffers; ++i)
+    {
+        ID3D11ShaderReflectionConstantBuffer* pCBuffer = pReflection->GetConstantBufferByIndex(i);
+        D3D11_SHADER_BUFFER_DESC bufferDesc;
+        pCBuffer->GetDesc(&bufferDesc);
+
+        // Structured buffers show up here too
+        D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+        if (bufferDesc.Type != D3D_CT_CBUFFER || FAILED(pReflection->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc)))
+            continue;
+
+        ReflectedCBuffer cbuffer;
+        CopyName(bufferDesc.Name, cbuffer.Name);
+        cbuffer.Register = bindDesc.BindPoint;
+        cbuffer.Size = bufferDesc.Size;
+        cbuffer.FirstVariable = (uint32_t)reflection.Variables.size();
+        cbuffer.VariableCount = bufferDesc.Variables;
+        reflection.CBuffers.push_back(cbuffer);
+
+        for (UINT v = 0; v != bufferDesc.Variables; ++v)
+        {
+            D3D11_SHADER_VARIABLE_DESC variableDesc;
+            pCBuffer->GetVariableByIndex(v)->GetDesc(&variableDesc);
+
+            ReflectedVariable variable;
+            CopyName(variableDesc.Name, variable.Name);
+            variable.Offset = variableDesc.StartOffset;
+            variable.Size = variableDesc.Size;
+            reflection.Variables.push_back(variable);
+        }
+    }
+
+    pReflection->Release();
+    if (succeeded)
+        *out_reflection = std::move(reflection);
+    return succeeded;
+}
+#endif
+
+}
@@ -0,0 +1,146 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : What D3DReflect says about a compiled shader, in a flat
+device independent form: the vertex inputs with their formats, offsets and
+which buffer they come from, and every constant buffer's variables.
+The ShaderReflector tool writes one next to each .cso when the Shaders
+project builds, so startup reads a few hundred bytes instead of reflecting,
+and tools that can't call D3DReflect can still see the layouts.
+Each file carries a hash of its .cso, so a stale one is never used.
+----------------------------------------------*/
+#ifndef EASEL_SHADERREFLECTION_H
+#define EASEL_SHADERREFLECTION_H
+
+#include "VertexFormat.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Renderer {
+
+// Values of the matching DXGI_FORMAT, which ShaderFactory checks where dxgiformat.h is around
+enum class InputFormat : uint32_t
+{
+    UNKNOWN            = 0,
+    R32G32B32A32_FLOAT = 2,
+    R32G32B32A32_UINT  = 3,
+    R32G32B32A32_SINT  = 4,
+    R32G32B32_FLOAT    = 6,
+    R32G32B32_UINT     = 7,
+    R32G32B32_SINT     = 8,
+    R32G32_FLOAT       = 16,
+    R32G32_UINT        = 17,
+    R32G32_SINT        = 18,
+    R32_FLOAT          = 41,
+    R32_UINT           = 42,
+    R32_SINT           = 43
+};
+
+// Values of D3D_REGISTER_COMPONENT_TYPE
+enum class ComponentType : uint8_t
+{
+    UNKNOWN,
+    UINT32,
+    SINT32,
+    FLOAT32
+};
+
+// One input of the signature the way D3D11_SIGNATURE_PARAMETER_DESC has it, before formats and offsets are worked out
+struct SignatureParameter
+{
+    const char*   SemanticName;
+    uint32_t      SemanticIndex;
+    uint8_t       Mask;             // Components used, xyzw from the low bit
+    ComponentType Type;
+};
+
+static const uint32_t kReflectedNameLength = 32;
+
+struct ReflectedInput
+{
+    char        SemanticName[kReflectedNameLength];     // As the input layout wants it, prefix and all
+    uint32_t    SemanticIndex;
+    InputFormat Format;
+    uint16_t    ByteOffset;         // Into its own buffer
+    Semantics   Semantic;
+    uint8_t     PerInstance;        // Read from the instance buffer in slot 1, not the vertex buffer in slot 0
+};
+
+struct ReflectedVariable
+{
+    char     Name[kReflectedNameLength];
+    uint32_t Offset;
+    uint32_t Size;
+};
+
+struct ReflectedCBuffer
+{
+    char     Name[kReflectedNameLength];
+    uint32_t Register;              // b#
+    uint32_t Size;                  // Rounded up to 16 bytes
+    uint32_t FirstVariable;         // Into ShaderReflection::Variables
+    uint32_t VariableCount;
+};
+
+struct ShaderReflection
+{
+    uint64_t                       BytecodeHash = 0;    // fnv1a_64 of the .cso it was reflected from
+    std::vector<ReflectedInput>    Inputs;              // Vertex shaders only. Per vertex first, then per instance.
+    uint32_t                       InstanceStart = 0;   // First per instance input, Inputs.size() when there are none
+    uint16_t                       VertexByteSize = 0;
+    uint16_t                       InstanceByteSize = 0;
+    std::vector<ReflectedCBuffer>  CBuffers;
+    std::vector<ReflectedVariable> Variables;
+
+    bool IsInstanced() const { return InstanceStart != Inputs.size(); }
+};
+
+// Where the C++ side expects an HLSL cbuffer's variables, see CBufferStructs.h
+struct CBufferField
+{
+    const char* Name;               // The HLSL variable's
+    uint32_t    Offset;
+    uint32_t    Size;               // Of the C++ member, which may include padding HLSL packs into
+};
+
+struct CBufferLayout
+{
+    const char*         Name;       // The HLSL cbuffer's
+    uint32_t            Size;
+    const CBufferField* Fields;
+    uint32_t            FieldCount;
+};
+
+struct ShaderReflector final
+{
+    static constexpr uint32_t kVersion = 1;
+
+    // Foo.cso -> Foo.refl
+    static std::string GetReflectionPath(const std::string& shaderPath);
+
+    // Semantics, formats, offsets and the vertex/instance split. Once an input's semantic starts with INSTANCE_,
+    // it and every input after it come from the instance buffer. False for semantics Easel doesn't know.
+    static bool BuildInputs(const SignatureParameter* params, uint32_t count, ShaderReflection* out_reflection);
+
+    static void Serialize(const ShaderReflection& reflection, std::vector<uint8_t>* out_blob);
+    static bool Deserialize(const uint8_t* data, size_t size, ShaderReflection* out_reflection);
+
+    // Load fails if the file is missing, from another version, or was reflected from different bytecode
+    static bool Load(const std::string& path, uint64_t bytecodeHash, ShaderReflection* out_reflection);
+    static bool Save(const std::string& path, const ShaderReflection& reflection);
+
+    // Whether a reflected cbuffer matches what C++ uploads into it. Variables C++ doesn't name are ignored.
+    // On a mismatch out_error says which variable, if given.
+    static bool CheckCBuffer(const ShaderReflection& reflection, const ReflectedCBuffer& cbuffer, const CBufferLayout& layout, std::string* out_error = nullptr);
+
+    #if defined(_WIN32)
+    // Through D3DReflect. Only used when there's no up to date .refl, and by the tool that writes them.
+    static bool Reflect(const void* bytecode, size_t size, ShaderReflection* out_reflection);
+    #endif
+};
+
+}
+#endif
@@ -0,0 +1,131 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of ShadowRenderer.h
+----------------------------------------------*/
+#include "ShadowRenderer.h"
+
+#include "Camera.h"
+#include "CBufferStructs.h"
+#include "EntityRenderer.h"
+#include "FramePacket.h"
+#include "ThrowMacros.h"
+
+#include <Easel/Core/MemoryTracker.h>
+#include <Easel/Core/Profiler.h>
+
+#include <string.h>
+
+namespace Renderer {
+
+void ShadowRenderer::Init(ID3D11Device* device, uint32_t resolution, uint32_t cascadeCount)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+
+    assert(cascadeCount && cascadeCount <= CascadedShadows::kMaxCascades);
+    Resolution = resolution;
+    CascadeCount = cascadeCount;
+
+    // Typeless, so it can be written as depth and read as plain floats
+    CD3D11_TEXTURE2D_DESC mapDesc(DXGI_FORMAT_R32_TYPELESS, resolution, resolution, cascadeCount, 1,
+                                  D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE);
+    COM_EXCEPT(device->CreateTexture2D(&mapDesc, nullptr, &ShadowMap));
+
+    for (uint32_t i = 0; i != cascadeCount; ++i)
+    {
+        CD3D11_DEPTH_STENCIL_VIEW_DESC viewDesc(D3D11_DSV_DIMENSION_TEXTURE2DARRAY, DXGI_FORMAT_D32_FLOAT, 0, i, 1);
+        COM_EXCEPT(device->CreateDepthStencilView(ShadowMap, &viewDesc, &CascadeViews[i]));
+    }
+
+    CD3D11_SHADER_RESOURCE_VIEW_DESC readDesc(D3D11_SRV_DIMENSION_TEXTURE2DARRAY, DXGI_FORMAT_R32_FLOAT, 0, 1, 0, cascadeCount);
+    COM_EXCEPT(device->CreateShaderResourceView(ShadowMap, &readDesc, &ShadowMapView));
+
+    // Bias in units of the map's depth precision, more on slopes, where one texel covers a longer run of depth
+    D3D11_RASTERIZER_DESC rastDesc = {};
+    rastDesc.FillMode = D3D11_FILL_SOLID;
+    rastDesc.CullMode = D3D11_CULL_NONE;
+    rastDesc.DepthBias = 1000;
+    rastDesc.SlopeScaledDepthBias = 2.0f;
+    rastDesc.DepthClipEnable = FALSE;
+    COM_EXCEPT(device->CreateRasterizerState(&rastDesc, &CasterRasterState));
+
+    D3D11_SAMPLER_DESC samplerDesc = {};
+    samplerDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+    samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+    samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+    samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+    samplerDesc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
+    samplerDesc.BorderColor[0] = samplerDesc.BorderColor[1] = samplerDesc.BorderColor[2] = samplerDesc.BorderColor[3] = 1.0f;
+    samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+    COM_EXCEPT(device->CreateSamplerState(&samplerDesc, &ComparisonSampler));
+
+    ConstantBufferUpdateManager::Populate(sizeof(cbShadows), (UINT)PS_REGISTERS::SHADOWS, EASEL_SHADER_STAGE::ESS_PS, device, &ShadowCB);
+}
+
+void ShadowRenderer::Draw(ID3D11DeviceContext* context, FramePacket const& packet, EntityRenderer& entities, Camera& camera)
+{
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+    ESL_PROFILE_ZONE("ShadowRenderer::Draw");
+
+    assert(packet.CascadeCount <= CascadeCount);
+
+    // Last frame's map is still bound for reading, and is about to be written
+    ID3D11ShaderResourceView* const nullView = nullptr;
+    context->PSSetShaderResources((UINT)PS_RESOURCE_REGISTERS::SHADOW_MAP, 1, &nullView);
+
+    ID3D11RasterizerState* pCurrRasterState = nullptr;
+    context->RSGetState(&pCurrRasterState);
+    context->RSSetState(CasterRasterState);
+
+    const D3D11_VIEWPORT viewport = { 0.0f, 0.0f, (float)Resolution, (float)Resolution, 0.0f, 1.0f };
+    context->RSSetViewports(1, &viewport);
+
+    cbShadows cb = {};
+    for (uint32_t i = 0; i != packet.CascadeCount; ++i)
+    {
+        const ShadowCascade& cascade = packet.Cascades[i];
+        memcpy(&cb.cascadeViewProjection[i], cascade.ViewProjection, sizeof(cascade.ViewProjection));
+        (&cb.cascadeSplits.x)[i] = cascade.SplitFar;
+
+        context->ClearDepthStencilView(CascadeViews[i], D3D11_CLEAR_DEPTH, 1.0f, 0);
+        context->OMSetRenderTargets(0, nullptr, CascadeViews[i]);
+
+        camera.BindViewProjection(cb.cascadeViewProjection[i], context);
+        entities.DrawShadowCasters(context, packet, i);
+    }
+
+    // Past the last cascade there's no shadow
+    for (uint32_t i = packet.CascadeCount; i != CascadedShadows::kMaxCascades; ++i)
+        (&cb.cascadeSplits.x)[i] = packet.CascadeCount ? packet.Cascades[packet.CascadeCount - 1].SplitFar : 0.0f;
+    cb.shadowParams = DirectX::XMFLOAT4(1.0f / (float)Resolution, (float)packet.CascadeCount, 0.0f, 0.0f);
+
+    context->RSSetState(pCurrRasterState);
+    if (pCurrRasterState)
+        pCurrRasterState->Release();
+    context->OMSetRenderTargets(0, nullptr, nullptr);
+
+    ConstantBufferUpdateManager::MapUnmap(&ShadowCB, &cb, context);
+    ConstantBufferUpdateManager::Bind(&ShadowCB, context);
+    context->PSSetShaderResources((UINT)PS_RESOURCE_REGISTERS::SHADOW_MAP, 1, &ShadowMapView);
+    context->PSSetSamplers((UINT)PS_SAMPLER_REGISTERS::SHADOW, 1, &ComparisonSampler);
+}
+
+ShadowRenderer::~ShadowRenderer()
+{
+    ConstantBufferUpdateManager::Cleanup(&ShadowCB);
+    if (ComparisonSampler)
+        ComparisonSampler->Release();
+    if (CasterRasterState)
+        CasterRasterState->Release();
+    if (ShadowMapView)
+        ShadowMapView->Release();
+    for (ID3D11DepthStencilView* pView : CascadeViews)
+    {
+        if (pView)
+            pView->Release();
+    }
+    if (ShadowMap)
+        ShadowMap->Release();
+}
+
+}
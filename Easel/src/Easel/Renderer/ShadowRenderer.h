@@ -0,0 +1,62 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Draws the sun's shadow cascades. Each cascade is a slice of
+one depth texture array, filled with the casters culled into the packet
+for it, then the whole array is bound for the pixel shaders to filter.
+Casters are drawn with depth clamped instead of clipped, so those between
+the sun and a cascade's box still land in it, flattened onto its near side.
+----------------------------------------------*/
+#ifndef EASEL_SHADOWRENDERER_H
+#define EASEL_SHADOWRENDERER_H
+
+#include "CascadedShadows.h"
+#include "ConstantBuffer.h"
+#include "DXCore.h"
+
+namespace Renderer
+{
+class Camera;
+class EntityRenderer;
+struct FramePacket;
+}
+
+namespace Renderer {
+
+class ShadowRenderer
+{
+public:
+    ShadowRenderer() = default;
+    ~ShadowRenderer();
+
+    // A square depth slice per cascade, resolution texels wide
+    void Init(ID3D11Device* device, uint32_t resolution, uint32_t cascadeCount);
+
+    // Render thread, before the frame's target is bound: draws every cascade in the packet, then binds the shadow map,
+    // its sampler and the cascades for the passes that follow. Leaves no target bound, and the camera holding the
+    // last cascade's view-projection.
+    void Draw(ID3D11DeviceContext* context, FramePacket const& packet, EntityRenderer& entities, Camera& camera);
+
+private:
+    uint32_t                  Resolution = 0;
+    uint32_t                  CascadeCount = 0;
+
+    ID3D11Texture2D*          ShadowMap = nullptr;
+    ID3D11DepthStencilView*   CascadeViews[CascadedShadows::kMaxCascades] = {};
+    ID3D11ShaderResourceView* ShadowMapView = nullptr;
+
+    // Depth biased, clamped rather than clipped, and nothing culled
+    ID3D11RasterizerState*    CasterRasterState = nullptr;
+
+    // Compares against the map, lit outside it
+    ID3D11SamplerState*       ComparisonSampler = nullptr;
+
+    ConstantBufferBindPacket  ShadowCB = {};
+
+public:
+    ShadowRenderer(ShadowRenderer const&)            = delete;
+    ShadowRenderer& operator=(ShadowRenderer const&) = delete;
+};
+
+}
+#endif
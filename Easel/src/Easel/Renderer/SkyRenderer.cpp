@@ -12,78 +12,84 @@ Description : Handles the rendering of the sky backdrop
 #include "Shader.h"
 #include "Material.h"
 
+#include <Easel/Core/MemoryTracker.h>
+#include <Easel/Core/Profiler.h>
+
 namespace Renderer {
 
 void SkyRenderer::Init(ID3D11Device* device)
 {
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+
     // Mesh, texture, and shaders
-    ResourceCodex const& codex = ResourceCodex::GetSingleton();
-    const MeshID kSkyMeshID = 0x4a986f37;
+    ResourceCodex& codex = ResourceCodex::GetSingleton();
+
+    SkyMaterial = codex.FindMaterial(IDs::SkyMaterial);
+    CubeMesh = codex.FindMesh(IDs::CubeMesh);
 
-    // Query the resource codex to get the bindables directly.
-    const Material* pSkyMaterial = codex.GetMaterial(MI_SKY);
-    if (!pSkyMaterial)
+    const Material* pSkyMaterial = codex.GetMaterial(SkyMaterial);
+    if (!pSkyMaterial || !CubeMesh.IsValid())
     {
         // failed to get skybox material
         assert(false);
         return;
     }
 
-    SkyMaterialCopy = *pSkyMaterial;
-    CubeMesh = codex.GetMesh(kSkyMeshID);
+    // Front face culling and a less_equal depth test, both from materials.xml
+    const PipelineState* pSkyPipeline = codex.GetPipelineState(pSkyMaterial->Pipeline);
+    assert(pSkyPipeline);
+    assert(pSkyPipeline->RasterState);
+    assert(pSkyPipeline->DepthStencilState);
+    assert(pSkyMaterial->Resources.IsValid());
 
-    assert(SkyMaterialCopy.VS);
-    assert(SkyMaterialCopy.PS);
-    assert(SkyMaterialCopy.RasterStateOverride);
-    assert(SkyMaterialCopy.DepthStencilStateOverride);
-    assert(SkyMaterialCopy.Resources);
-    assert(SkyMaterialCopy.Resources->SRVs);
-
-    SkyMaterialCopy.RasterStateOverride->AddRef();
-    SkyMaterialCopy.DepthStencilStateOverride->AddRef();
+    codex.AddRef(SkyMaterial);
+    codex.AddRef(CubeMesh);
 }
 
 void SkyRenderer::Draw(ID3D11DeviceContext* context)
 {
-    // Set backface culling
-    ID3D11DepthStencilState* pCurrDepthStencilState = nullptr;
-    context->OMGetDepthStencilState(&pCurrDepthStencilState, nullptr);
-    context->OMSetDepthStencilState(SkyMaterialCopy.DepthStencilStateOverride, 0);
+    ESL_MEMORY_SCOPE(Core::MemoryTag::RENDERER);
+    ESL_PROFILE_ZONE("SkyRenderer::Draw");
+
+    // Resolved every frame, so material hot reloads show up here too
+    ResourceCodex& codex = ResourceCodex::GetSingleton();
+    const Material& mat = *codex.GetMaterial(SkyMaterial);
 
-    ID3D11RasterizerState* pCurrRasterState = nullptr;
-    context->RSGetState(&pCurrRasterState);
-    context->RSSetState(SkyMaterialCopy.RasterStateOverride);
+    // Either can fail to be made resident, in which case there's no sky this frame
+    const Mesh* pMesh = codex.UseMesh(CubeMesh);
+    const ResourceBindChord* pResources = codex.UseTexture(mat.Resources);
+    if (!pMesh || !pResources)
+        return;
+
+    // Shaders, input layout, front face culling and the depth test
+    PipelineStateHandle boundPipeline;
+    if (!codex.BindPipelineState(context, mat.Pipeline, &boundPipeline))
+        return;
 
     UINT offsets = 0;
 
     // Bind the Cube Mesh
-    const Mesh mesh = *CubeMesh;
+    const Mesh mesh = *pMesh;
     context->IASetVertexBuffers(0, 1, &mesh.VertexBuffer, &mesh.Stride, &offsets);
     context->IASetIndexBuffer(mesh.IndexBuffer, DXGI_FORMAT_R32_UINT, 0);
 
-    // Set Vertex Shader and Input
-    context->IASetInputLayout(SkyMaterialCopy.VS->InputLayout);
-    context->VSSetShader(SkyMaterialCopy.VS->Shader, 0, 0);
-
-    // Set Pixel Shader and Bind Textures
-    context->PSSetShaderResources(0, (UINT)TextureSlots::COUNT, SkyMaterialCopy.Resources->SRVs);
-    context->PSSetShader(SkyMaterialCopy.PS->Shader, 0, 0);
+    // Bind Textures
+    context->PSSetShaderResources(0, (UINT)TextureSlots::COUNT, pResources->SRVs);
 
     // Submit Draw Call
     context->DrawIndexed(mesh.IndexCount, 0, 0);
 
-    // Reset states back to previous
-    context->OMSetDepthStencilState(pCurrDepthStencilState, 0);
-    context->RSSetState(0);
+    // Back to D3D11's defaults for anything drawn without a pipeline state
+    context->OMSetDepthStencilState(nullptr, 0);
+    context->RSSetState(nullptr);
 }
 
 SkyRenderer::~SkyRenderer()
 {
-    if (SkyMaterialCopy.RasterStateOverride)
-        SkyMaterialCopy.RasterStateOverride->Release();
-
-    if (SkyMaterialCopy.DepthStencilStateOverride)
-        SkyMaterialCopy.DepthStencilStateOverride->Release();
+    // No-ops if the codex was already destroyed
+    ResourceCodex& codex = ResourceCodex::GetSingleton();
+    codex.Release(SkyMaterial);
+    codex.Release(CubeMesh);
 }
 
 }
\ No newline at end of file
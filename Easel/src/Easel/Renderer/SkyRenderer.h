@@ -8,12 +8,12 @@ Description : Handles the rendering of the sky backdrop
 
 #include "DXCore.h"
 #include "Material.h"
+#include "Mesh.h"
 
 namespace Renderer
 {
 struct VertexShader;
 struct PixelShader;
-struct Mesh;
 struct ResourceBindChord;
 }
 
@@ -28,8 +28,9 @@ public:
     ~SkyRenderer();
 
 private:
-    const Mesh* CubeMesh;
-    Material    SkyMaterialCopy;
+    // Both hold a reference
+    MeshHandle      CubeMesh;
+    MaterialHandle  SkyMaterial;
 };
 
 }
@@ -0,0 +1,1002 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Implementation of SoftwareRasterizer.h
+----------------------------------------------*/
+#include "SoftwareRasterizer.h"
+
+#include <Easel/Assets/MeshImporter.h>
+#include <Easel/Assets/MipGenerator.h>
+#include <Easel/Core/Clock.h>
+#include <Easel/Core/Profiler.h>
+#include <Easel/Core/WorkerPool.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+    #define ESL_RASTER_AVX2 1
+    #include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+    #define ESL_RASTER_AVX2 0
+    #include <emmintrin.h>
+#else
+    #error "SoftwareRasterizer needs SSE2"
+#endif
+
+namespace Renderer {
+
+namespace {
+
+// Eight lanes, one per pixel of a span. With AVX2 that's one register, otherwise two SSE2 halves.
+#if ESL_RASTER_AVX2
+struct F8 { __m256  V; };
+struct I8 { __m256i V; };
+
+inline F8 Splat(float f)                { return { _mm256_set1_ps(f) }; }
+inline F8 Load(const float* p)          { return { _mm256_loadu_ps(p) }; }
+inline void Store(float* p, F8 a)       { _mm256_storeu_ps(p, a.V); }
+inline F8 operator+(F8 a, F8 b)         { return { _mm256_add_ps(a.V, b.V) }; }
+inline F8 operator-(F8 a, F8 b)         { return { _mm256_sub_ps(a.V, b.V) }; }
+inline F8 operator*(F8 a, F8 b)         { return { _mm256_mul_ps(a.V, b.V) }; }
+inline F8 operator/(F8 a, F8 b)         { return { _mm256_div_ps(a.V, b.V) }; }
+inline F8 Min(F8 a, F8 b)               { return { _mm256_min_ps(a.V, b.V) }; }
+inline F8 Max(F8 a, F8 b)               { return { _mm256_max_ps(a.V, b.V) }; }
+inline F8 Sqrt(F8 a)                    { return { _mm256_sqrt_ps(a.V) }; }
+inline F8 Floor(F8 a)                   { return { _mm256_floor_ps(a.V) }; }
+inline F8 CmpLt(F8 a, F8 b)             { return { _mm256_cmp_ps(a.V, b.V, _CMP_LT_OQ) }; }
+inline F8 CmpGt(F8 a, F8 b)             { return { _mm256_cmp_ps(a.V, b.V, _CMP_GT_OQ) }; }
+inline F8 And(F8 a, F8 b)               { return { _mm256_and_ps(a.V, b.V) }; }
+inline F8 Select(F8 mask, F8 a, F8 b)   { return { _mm256_blendv_ps(b.V, a.V, mask.V) }; }
+inline uint32_t MoveMask(F8 a)          { return (uint32_t)_mm256_movemask_ps(a.V); }
+
+inline I8 SplatI(int32_t i)             { return { _mm256_set1_epi32(i) }; }
+inline I8 LoadI(const void* p)          { return { _mm256_loadu_si256((const __m256i*)p) }; }
+inline void StoreI(void* p, I8 a)       { _mm256_storeu_si256((__m256i*)p, a.V); }
+inline I8 operator+(I8 a, I8 b)         { return { _mm256_add_epi32(a.V, b.V) }; }
+inline I8 operator-(I8 a, I8 b)         { return { _mm256_sub_epi32(a.V, b.V) }; }
+inline I8 operator|(I8 a, I8 b)         { return { _mm256_or_si256(a.V, b.V) }; }
+inline I8 operator&(I8 a, I8 b)         { return { _mm256_and_si256(a.V, b.V) }; }
+inline I8 CmpEq(I8 a, I8 b)             { return { _mm256_cmpeq_epi32(a.V, b.V) }; }
+template<int N> inline I8 ShiftLeft(I8 a)  { return { _mm256_slli_epi32(a.V, N) }; }
+template<int N> inline I8 ShiftRight(I8 a) { return { _mm256_srli_epi32(a.V, N) }; }
+inline I8 ToInt(F8 a)                   { return { _mm256_cvttps_epi32(a.V) }; }
+inline F8 ToFloat(I8 a)                 { return { _mm256_cvtepi32_ps(a.V) }; }
+inline I8 AsInt(F8 a)                   { return { _mm256_castps_si256(a.V) }; }
+inline F8 AsFloat(I8 a)                 { return { _mm256_castsi256_ps(a.V) }; }
+#else
+struct F8 { __m128  L, H; };
+struct I8 { __m128i L, H; };
+
+inline F8 Splat(float f)                { const __m128 v = _mm_set1_ps(f); return { v, v }; }
+inline F8 Load(const float* p)          { return { _mm_loadu_ps(p), _mm_loadu_ps(p + 4) }; }
+inline void Store(float* p, F8 a)       { _mm_storeu_ps(p, a.L); _mm_storeu_ps(p + 4, a.H); }
+inline F8 operator+(F8 a, F8 b)         { return { _mm_add_ps(a.L, b.L), _mm_add_ps(a.H, b.H) }; }
+inline F8 operator-(F8 a, F8 b)         { return { _mm_sub_ps(a.L, b.L), _mm_sub_ps(a.H, b.H) }; }
+inline F8 operator*(F8 a, F8 b)         { return { _mm_mul_ps(a.L, b.L), _mm_mul_ps(a.H, b.H) }; }
+inline F8 operator/(F8 a, F8 b)         { return { _mm_div_ps(a.L, b.L), _mm_div_ps(a.H, b.H) }; }
+inline F8 Min(F8 a, F8 b)               { return { _mm_min_ps(a.L, b.L), _mm_min_ps(a.H, b.H) }; }
+inline F8 Max(F8 a, F8 b)               { return { _mm_max_ps(a.L, b.L), _mm_max_ps(a.H, b.H) }; }
+inline F8 Sqrt(F8 a)                    { return { _mm_sqrt_ps(a.L), _mm_sqrt_ps(a.H) }; }
+inline F8 CmpLt(F8 a, F8 b)             { return { _mm_cmplt_ps(a.L, b.L), _mm_cmplt_ps(a.H, b.H) }; }
+inline F8 CmpGt(F8 a, F8 b)             { return { _mm_cmpgt_ps(a.L, b.L), _mm_cmpgt_ps(a.H, b.H) }; }
+inline F8 And(F8 a, F8 b)               { return { _mm_and_ps(a.L, b.L), _mm_and_ps(a.H, b.H) }; }
+inline uint32_t MoveMask(F8 a)          { return (uint32_t)(_mm_movemask_ps(a.L) | (_mm_movemask_ps(a.H) << 4)); }
+
+inline F8 Select(F8 mask, F8 a, F8 b)
+{
+    return { _mm_or_ps(_mm_and_ps(mask.L, a.L), _mm_andnot_ps(mask.L, b.L)),
+             _mm_or_ps(_mm_and_ps(mask.H, a.H), _mm_andnot_ps(mask.H, b.H)) };
+}
+
+// No SSE4.1 round, so truncate and step back one where that went up
+inline F8 Floor(F8 a)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 l = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.L));
+    const __m128 h = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.H));
+    return { _mm_sub_ps(l, _mm_and_ps(_mm_cmpgt_ps(l, a.L), one)), _mm_sub_ps(h, _mm_and_ps(_mm_cmpgt_ps(h, a.H), one)) };
+}
+
+inline I8 SplatI(int32_t i)             { const __m128i v = _mm_set1_epi32(i); return { v, v }; }
+inline I8 LoadI(const void* p)          { return { _mm_loadu_si128((const __m128i*)p), _mm_loadu_si128((const __m128i*)p + 1) }; }
+inline void StoreI(void* p, I8 a)       { _mm_storeu_si128((__m128i*)p, a.L); _mm_storeu_si128((__m128i*)p + 1, a.H); }
+inline I8 operator+(I8 a, I8 b)         { return { _mm_add_epi32(a.L, b.L), _mm_add_epi32(a.H, b.H) }; }
+inline I8 operator-(I8 a, I8 b)         { return { _mm_sub_epi32(a.L, b.L), _mm_sub_epi32(a.H, b.H) }; }
+inline I8 operator|(I8 a, I8 b)         { return { _mm_or_si128(a.L, b.L), _mm_or_si128(a.H, b.H) }; }
+inline I8 operator&(I8 a, I8 b)         { return { _mm_and_si128(a.L, b.L), _mm_and_si128(a.H, b.H) }; }
+inline I8 CmpEq(I8 a, I8 b)             { return { _mm_cmpeq_epi32(a.L, b.L), _mm_cmpeq_epi32(a.H, b.H) }; }
+template<int N> inline I8 ShiftLeft(I8 a)  { return { _mm_slli_epi32(a.L, N), _mm_slli_epi32(a.H, N) }; }
+template<int N> inline I8 ShiftRight(I8 a) { return { _mm_srli_epi32(a.L, N), _mm_srli_epi32(a.H, N) }; }
+inline I8 ToInt(F8 a)                   { return { _mm_cvttps_epi32(a.L), _mm_cvttps_epi32(a.H) }; }
+inline F8 ToFloat(I8 a)                 { return { _mm_cvtepi32_ps(a.L), _mm_cvtepi32_ps(a.H) }; }
+inline I8 AsInt(F8 a)                   { return { _mm_castps_si128(a.L), _mm_castps_si128(a.H) }; }
+inline F8 AsFloat(I8 a)                 { return { _mm_castsi128_ps(a.L), _mm_castsi128_ps(a.H) }; }
+#endif
+
+alignas(32) const float   kLaneOffsets[8] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+alignas(32) const int32_t kLaneBits[8]    = { 1, 2, 4, 8, 16, 32, 64, 128 };
+
+// Lanes whose bit is set come back all ones
+inline F8 MaskFromBits(uint32_t bits)
+{
+    const I8 laneBits = LoadI(kLaneBits);
+    return AsFloat(CmpEq(SplatI((int32_t)bits) & laneBits, laneBits));
+}
+
+// Sign bit of every lane, i.e. which edge values came out negative
+inline uint32_t SignBits(I8 a)
+{
+    return MoveMask(AsFloat(a));
+}
+
+inline F8 Dot(F8 const* a, F8 const* b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+inline void Normalize(F8* v)
+{
+    const F8 invLength = Splat(1.0f) / Sqrt(Dot(v, v));
+    v[0] = v[0] * invLength;
+    v[1] = v[1] * invLength;
+    v[2] = v[2] * invLength;
+}
+
+inline F8 Saturate(F8 a)
+{
+    // NaN comes out as 0: max hands back its second operand when either is NaN
+    return Min(Max(a, Splat(0.0f)), Splat(1.0f));
+}
+
+// Minimax polynomials for the mantissa, good to about 1e-5, which is plenty for a specular lobe.
+// Only for x > 0.
+inline F8 Log2(F8 x)
+{
+    const I8 bits = AsInt(x);
+    const F8 exponent = ToFloat(ShiftRight<23>(bits) - SplatI(127));
+    const F8 m = AsFloat((bits & SplatI(0x007FFFFF)) | SplatI(0x3F800000));
+
+    F8 p = Splat(-3.4436006e-2f);
+    p = p * m + Splat(3.1821337e-1f);
+    p = p * m + Splat(-1.2315303f);
+    p = p * m + Splat(2.5988452f);
+    p = p * m + Splat(-3.3241990f);
+    p = p * m + Splat(3.1157899f);
+    return p * (m - Splat(1.0f)) + exponent;
+}
+
+inline F8 Exp2(F8 x)
+{
+    x = Min(Max(x, Splat(-126.99f)), Splat(127.0f));
+    const F8 whole = Floor(x);
+    const F8 fraction = x - whole;
+    const F8 scale = AsFloat(ShiftLeft<23>(ToInt(whole) + SplatI(127)));
+
+    F8 p = Splat(1.8775767e-3f);
+    p = p * fraction + Splat(8.9893397e-3f);
+    p = p * fraction + Splat(5.5826318e-2f);
+    p = p * fraction + Splat(2.4015361e-1f);
+    p = p * fraction + Splat(6.9315308e-1f);
+    p = p * fraction + Splat(9.9999994e-1f);
+    return p * scale;
+}
+
+// pow for a base in [0, 1]. A zero base gives (almost) zero rather than NaN, like the GPU would.
+inline F8 Pow(F8 base, float exponent)
+{
+    return Exp2(Log2(Max(base, Splat(1e-30f))) * Splat(exponent));
+}
+
+inline uint32_t CountBits(uint32_t bits)
+{
+    uint32_t count = 0;
+    for (; bits; bits &= bits - 1)
+        ++count;
+    return count;
+}
+
+inline uint32_t LowestBit(uint32_t bits)
+{
+    uint32_t index = 0;
+    while (!(bits & (1u << index)))
+        ++index;
+    return index;
+}
+
+uint32_t PackColor(const float* rgba)
+{
+    uint32_t packed = 0;
+    for (uint32_t i = 0; i != 4; ++i)
+    {
+        const float c = rgba[i] < 0.0f ? 0.0f : (rgba[i] > 1.0f ? 1.0f : rgba[i]);
+        packed |= (uint32_t)(c * 255.0f + 0.5f) << (i * 8);
+    }
+    return packed;
+}
+
+// Where in the attributes shading finds each input
+const uint32_t kNormal = 0;
+const uint32_t kUV = 3;
+const uint32_t kWorldPosition = 5;
+const uint32_t kTangent = 8;
+const uint32_t kBinormal = 11;
+
+// Pixels beyond the screen a triangle may reach before it gets clipped. With kMaxDimension this
+// keeps snapped positions within 2^14 pixels either way.
+const float kGuardBand = 4096.0f;
+
+const uint32_t kSubpixelBits = 4;
+const int32_t  kSubpixels = 1 << kSubpixelBits;
+
+// Enough instances per geometry job that every core gets a few, without a job per cube
+const uint32_t kTrianglesPerJob = 1024;
+
+// Three vertices, plus one for every plane clipped against
+const uint32_t kMaxClipVertices = 3 + 5;
+
+struct TextureLevel
+{
+    const uint8_t* pTexels;
+    uint32_t       Width;
+    uint32_t       Height;
+    uint32_t       RowPitch;
+};
+
+// Nearest mip for the footprint of one pixel, given how fast uv changes across the screen
+TextureLevel SelectLevel(Assets::MipChain const& chain, float dudx, float dvdx, float dudy, float dvdy)
+{
+    const Assets::MipLevel& top = chain.Levels[0];
+    const float w = (float)top.Width;
+    const float h = (float)top.Height;
+    const float alongX = dudx * dudx * w * w + dvdx * dvdx * h * h;
+    const float alongY = dudy * dudy * w * w + dvdy * dvdy * h * h;
+    const float footprint = alongX > alongY ? alongX : alongY;
+
+    // log2 of the footprint in texels, off its square
+    uint32_t level = 0;
+    if (footprint > 1.0f)
+    {
+        const float lod = 0.5f * log2f(footprint) + 0.5f;
+        level = (uint32_t)std::min(lod, (float)(chain.Levels.size() - 1));
+    }
+
+    const Assets::MipLevel& mip = chain.Levels[level];
+    return { chain.GetLevelData(level), mip.Width, mip.Height, mip.RowPitch };
+}
+
+// Red, green and blue of eight RGBA8 texels, 0 to 1
+inline void UnpackRGB(I8 texels, F8* out_rgb)
+{
+    const I8 byte = SplatI(0xFF);
+    const F8 scale = Splat(1.0f / 255.0f);
+    out_rgb[0] = ToFloat(texels & byte) * scale;
+    out_rgb[1] = ToFloat(ShiftRight<8>(texels) & byte) * scale;
+    out_rgb[2] = ToFloat(ShiftRight<16>(texels) & byte) * scale;
+}
+
+// Bilinear with WRAP addressing. Coordinates and weights are worked out eight wide, only the fetches are
+// one lane at a time. Lanes outside 'valid' read texel 0 and shouldn't be used.
+void SampleBilinear(TextureLevel const& level, F8 u, F8 v, F8 valid, F8* out_rgb)
+{
+    const F8 one = Splat(1.0f);
+    const F8 width = Splat((float)level.Width);
+    const F8 height = Splat((float)level.Height);
+
+    // Texel centers sit on the half
+    const F8 x = u * width - Splat(0.5f);
+    const F8 y = v * height - Splat(0.5f);
+    const F8 left = Floor(x);
+    const F8 top = Floor(y);
+    const F8 tx = x - left;
+    const F8 ty = y - top;
+
+    // Wrapped into the level, then the neighbour to the right and below, which wraps back to 0 at the far edge
+    const F8 x0 = And(Min(left - width * Floor(left / width), width - one), valid);
+    const F8 y0 = And(Min(top - height * Floor(top / height), height - one), valid);
+    const F8 x1 = And(x0 + one, CmpLt(x0 + one, width));
+    const F8 y1 = And(y0 + one, CmpLt(y0 + one, height));
+
+    alignas(32) int32_t columns[2][8];
+    alignas(32) int32_t rows[2][8];
+    StoreI(columns[0], ToInt(x0));
+    StoreI(columns[1], ToInt(x1));
+    StoreI(rows[0], ToInt(y0));
+    StoreI(rows[1], ToInt(y1));
+
+    alignas(32) uint32_t texels[4][8];
+    for (uint32_t lane = 0; lane != 8; ++lane)
+    {
+        const uint8_t* row0 = level.pTexels + (size_t)rows[0][lane] * level.RowPitch;
+        const uint8_t* row1 = level.pTexels + (size_t)rows[1][lane] * level.RowPitch;
+        memcpy(&texels[0][lane], row0 + columns[0][lane] * 4, 4);
+        memcpy(&texels[1][lane], row0 + columns[1][lane] * 4, 4);
+        memcpy(&texels[2][lane], row1 + columns[0][lane] * 4, 4);
+        memcpy(&texels[3][lane], row1 + columns[1][lane] * 4, 4);
+    }
+
+    F8 corners[4][3];
+    for (uint32_t c = 0; c != 4; ++c)
+        UnpackRGB(LoadI(texels[c]), corners[c]);
+
+    for (uint32_t c = 0; c != 3; ++c)
+    {
+        const F8 above = corners[0][c] + (corners[1][c] - corners[0][c]) * tx;
+        const F8 below = corners[2][c] + (corners[3][c] - corners[2][c]) * tx;
+        out_rgb[c] = above + (below - above) * ty;
+    }
+}
+
+}
+
+void SoftwareRasterizer::Init(uint32_t width, uint32_t height, Core::WorkerPool* pPool)
+{
+    assert(width && height && width <= kMaxDimension && height <= kMaxDimension);
+
+    mWidth = width;
+    mHeight = height;
+    mTilesX = (width + kTileSize - 1) / kTileSize;
+    mTilesY = (height + kTileSize - 1) / kTileSize;
+    mpPool = pPool;
+
+    const size_t paddedPixels = (size_t)mTilesX * mTilesY * kTileSize * kTileSize;
+    mColor.assign(paddedPixels, 0);
+    mDepth.assign(paddedPixels, 1.0f);
+    mTileStarts.assign(mTilesX * mTilesY + 1, 0);
+}
+
+uint32_t SoftwareRasterizer::AddMesh(Assets::CookedMesh const& cooked, VertexBufferDescription const& layout)
+{
+    // Byte offset of everything shading reads, or -1 if the layout doesn't have it
+    int32_t position = -1;
+    int32_t attributeOffsets[kAttributeCount];
+    for (int32_t& offset : attributeOffsets)
+        offset = -1;
+
+    for (uint16_t i = 0; i != layout.AttrCount; ++i)
+    {
+        const int32_t offset = layout.ByteOffsets[i];
+        switch (layout.SemanticsArr[i])
+        {
+            case Semantics::POSITION:
+                position = offset;
+                break;
+            case Semantics::NORMAL:
+                for (uint32_t c = 0; c != 3; ++c)
+                    attributeOffsets[kNormal + c] = offset + c * sizeof(float);
+                break;
+            case Semantics::TEXCOORD:
+                for (uint32_t c = 0; c != 2; ++c)
+                    attributeOffsets[kUV + c] = offset + c * sizeof(float);
+                break;
+            case Semantics::TANGENT:
+                for (uint32_t c = 0; c != 3; ++c)
+                    attributeOffsets[kTangent + c] = offset + c * sizeof(float);
+                break;
+            case Semantics::BINORMAL:
+                for (uint32_t c = 0; c != 3; ++c)
+                    attributeOffsets[kBinormal + c] = offset + c * sizeof(float);
+                break;
+            default:
+                break;
+        }
+    }
+    assert(position >= 0 && "Meshes need a position to be drawn");
+    assert(cooked.Indices.size() % 3 == 0);
+
+    Mesh mesh;
+    const size_t vertexCount = cooked.Stride ? cooked.Vertices.size() / cooked.Stride : 0;
+    mesh.Vertices.resize(vertexCount);
+    for (size_t v = 0; v != vertexCount; ++v)
+    {
+        const uint8_t* pSource = cooked.Vertices.data() + v * cooked.Stride;
+        Vertex& vertex = mesh.Vertices[v];
+        memcpy(vertex.Position, pSource + position, sizeof(vertex.Position));
+        for (uint32_t a = 0; a != kAttributeCount; ++a)
+        {
+            vertex.Attributes[a] = 0.0f;
+            if (attributeOffsets[a] >= 0)
+                memcpy(&vertex.Attributes[a], pSource + attributeOffsets[a], sizeof(float));
+        }
+    }
+    mesh.Indices = cooked.Indices;
+
+    mMeshes.push_back(std::move(mesh));
+    return (uint32_t)mMeshes.size() - 1;
+}
+
+void SoftwareRasterizer::BeginFrame(const float* viewProjection, SoftwareLighting const& lighting, const float* clearColor)
+{
+    memcpy(mViewProjection, viewProjection, sizeof(mViewProjection));
+    mLighting = lighting;
+    mClearColor = PackColor(clearColor);
+    mDraws.clear();
+}
+
+void SoftwareRasterizer::DrawInstanced(uint32_t mesh, SoftwareMaterial const& material, const float* worldMatrices, uint32_t instanceCount)
+{
+    assert(mesh < mMeshes.size() && material.pDiffuse && !material.pDiffuse->Levels.empty());
+    if (instanceCount)
+        mDraws.push_back({ mesh, &material, worldMatrices, instanceCount });
+}
+
+void SoftwareRasterizer::EndFrame()
+{
+    ESL_PROFILE_ZONE("SoftwareRasterizer::EndFrame");
+
+    mStats = SoftwareRasterStats();
+    const uint32_t tileCount = mTilesX * mTilesY;
+
+    // Cut every draw into runs of instances. Jobs go in submission order, which is the order a tile draws them in.
+    mJobCount = 0;
+    for (uint32_t d = 0; d != (uint32_t)mDraws.size(); ++d)
+    {
+        const Draw& draw = mDraws[d];
+        const uint32_t triangles = (uint32_t)mMeshes[draw.Mesh].Indices.size() / 3;
+        const uint32_t perJob = std::max(1u, kTrianglesPerJob / std::max(1u, triangles));
+        for (uint32_t first = 0; first < draw.InstanceCount; first += perJob)
+        {
+            if (mJobCount == mJobs.size())
+                mJobs.emplace_back();
+
+            GeometryJob& job = mJobs[mJobCount++];
+            job.Draw = d;
+            job.FirstInstance = first;
+            job.InstanceCount = std::min(perJob, draw.InstanceCount - first);
+        }
+    }
+
+    const uint64_t geometryStart = Core::Clock::Now();
+    ForEach(mJobCount, &SoftwareRasterizer::RunGeometryJob);
+
+    // Every tile gets one contiguous run of bins, filled job by job
+    uint32_t binned = 0;
+    for (uint32_t tile = 0; tile != tileCount; ++tile)
+    {
+        mTileStarts[tile] = binned;
+        for (uint32_t j = 0; j != mJobCount; ++j)
+        {
+            const uint32_t count = mJobs[j].TileCounts[tile];
+            mJobs[j].TileCounts[tile] = binned;
+            binned += count;
+        }
+    }
+    mTileStarts[tileCount] = binned;
+
+    if (mBinned.size() < binned)
+        mBinned.resize(binned);
+    ForEach(mJobCount, &SoftwareRasterizer::RunScatterJob);
+
+    const uint64_t rasterStart = Core::Clock::Now();
+    mShadedPixels.store(0, std::memory_order_relaxed);
+    ForEach(tileCount, &SoftwareRasterizer::RunTileJob);
+    const uint64_t rasterEnd = Core::Clock::Now();
+
+    for (uint32_t j = 0; j != mJobCount; ++j)
+    {
+        mStats.Triangles += mJobs[j].SubmittedTriangles;
+        mStats.SetupTriangles += mJobs[j].Triangles.size();
+    }
+    mStats.BinEntries = binned;
+    mStats.ShadedPixels = mShadedPixels.load(std::memory_order_relaxed);
+    mStats.GeometryMs = Core::Clock::TicksToSeconds(rasterStart - geometryStart) * 1000.0;
+    mStats.RasterMs = Core::Clock::TicksToSeconds(rasterEnd - rasterStart) * 1000.0;
+}
+
+void SoftwareRasterizer::ForEach(uint32_t count, void (*func)(void* pContext, uint32_t index))
+{
+    if (mpPool)
+    {
+        mpPool->Dispatch(count, func, this);
+        return;
+    }
+
+    for (uint32_t i = 0; i != count; ++i)
+        func(this, i);
+}
+
+void SoftwareRasterizer::RunGeometryJob(void* pContext, uint32_t job)
+{
+    SoftwareRasterizer* self = static_cast<SoftwareRasterizer*>(pContext);
+    self->ProcessGeometry(self->mJobs[job]);
+}
+
+void SoftwareRasterizer::RunScatterJob(void* pContext, uint32_t job)
+{
+    SoftwareRasterizer* self = static_cast<SoftwareRasterizer*>(pContext);
+    GeometryJob& geometry = self->mJobs[job];
+
+    // TileCounts now holds where this job writes next in every tile
+    for (const TileEntry& entry : geometry.Entries)
+        self->mBinned[geometry.TileCounts[entry.Tile]++] = { job, entry.Triangle };
+}
+
+void SoftwareRasterizer::RunTileJob(void* pContext, uint32_t tile)
+{
+    static_cast<SoftwareRasterizer*>(pContext)->RasterizeTile(tile);
+}
+
+void SoftwareRasterizer::ProcessGeometry(GeometryJob& job)
+{
+    const Draw& draw = mDraws[job.Draw];
+    const Mesh& mesh = mMeshes[draw.Mesh];
+    const uint32_t* indices = mesh.Indices.data();
+    const uint32_t indexCount = (uint32_t)mesh.Indices.size();
+
+    job.Triangles.clear();
+    job.Entries.clear();
+    job.TileCounts.assign(mTilesX * mTilesY, 0);
+    job.Transformed.resize(mesh.Vertices.size());
+    job.SubmittedTriangles = (uint64_t)job.InstanceCount * (indexCount / 3);
+
+    for (uint32_t instance = job.FirstInstance; instance != job.FirstInstance + job.InstanceCount; ++instance)
+    {
+        const float* w = draw.WorldMatrices + instance * 16;
+
+        // World then view projection, as one matrix for the clip position
+        const float* vp = mViewProjection;
+        float wvp[16];
+        for (uint32_t r = 0; r != 4; ++r)
+        {
+            for (uint32_t c = 0; c != 4; ++c)
+                wvp[r * 4 + c] = w[r * 4] * vp[c] + w[r * 4 + 1] * vp[4 + c] + w[r * 4 + 2] * vp[8 + c] + w[r * 4 + 3] * vp[12 + c];
+        }
+
+        for (size_t v = 0; v != mesh.Vertices.size(); ++v)
+        {
+            const Vertex& in = mesh.Vertices[v];
+            ClipVertex& out = job.Transformed[v];
+            const float x = in.Position[0];
+            const float y = in.Position[1];
+            const float z = in.Position[2];
+            for (uint32_t c = 0; c != 4; ++c)
+                out.Clip[c] = x * wvp[c] + y * wvp[4 + c] + z * wvp[8 + c] + wvp[12 + c];
+
+            // Directions get the upper 3x3 like PhongVS. The world position keeps its translation,
+            // so lighting matches what culling and the clip position see.
+            const float* a = in.Attributes;
+            float* o = out.Attributes;
+            for (uint32_t c = 0; c != 3; ++c)
+            {
+                o[kNormal + c]        = a[kNormal] * w[c] + a[kNormal + 1] * w[4 + c] + a[kNormal + 2] * w[8 + c];
+                o[kWorldPosition + c] = x * w[c] + y * w[4 + c] + z * w[8 + c] + w[12 + c];
+                o[kTangent + c]       = a[kTangent] * w[c] + a[kTangent + 1] * w[4 + c] + a[kTangent + 2] * w[8 + c];
+                o[kBinormal + c]      = a[kBinormal] * w[c] + a[kBinormal + 1] * w[4 + c] + a[kBinormal + 2] * w[8 + c];
+            }
+            o[kUV] = a[kUV];
+            o[kUV + 1] = a[kUV + 1];
+        }
+
+        // How far past the screen edges, in clip space, the guard band reaches
+        const float guardX = 1.0f + 2.0f * kGuardBand / (float)mWidth;
+        const float guardY = 1.0f + 2.0f * kGuardBand / (float)mHeight;
+
+        for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            const ClipVertex* corners[3] = { &job.Transformed[indices[i]], &job.Transformed[indices[i + 1]], &job.Transformed[indices[i + 2]] };
+
+            // Gone if every corner is outside the same side of the frustum
+            uint32_t outsideAll = 0x3F;
+            uint32_t needsClip = 0;
+            for (const ClipVertex* corner : corners)
+            {
+                const float* c = corner->Clip;
+                uint32_t outside = 0;
+                outside |= c[0] < -c[3] ? 1 : 0;
+                outside |= c[0] >  c[3] ? 2 : 0;
+                outside |= c[1] < -c[3] ? 4 : 0;
+                outside |= c[1] >  c[3] ? 8 : 0;
+                outside |= c[2] <  0.0f ? 16 : 0;
+                outside |= c[2] >  c[3] ? 32 : 0;
+                outsideAll &= outside;
+
+                needsClip |= c[2] < 0.0f ? 1 : 0;
+                needsClip |= c[0] >  guardX * c[3] ? 2 : 0;
+                needsClip |= c[0] < -guardX * c[3] ? 4 : 0;
+                needsClip |= c[1] >  guardY * c[3] ? 8 : 0;
+                needsClip |= c[1] < -guardY * c[3] ? 16 : 0;
+            }
+            if (outsideAll)
+                continue;
+
+            if (!needsClip)
+            {
+                SetupTriangle(job, corners, draw.pMaterial);
+                continue;
+            }
+
+            // Sutherland-Hodgman against only the planes something crosses. Near first, so nothing after sees w <= 0.
+            ClipVertex buffers[2][kMaxClipVertices];
+            ClipVertex* polygon = buffers[0];
+            ClipVertex* clipped = buffers[1];
+            uint32_t count = 3;
+            for (uint32_t c = 0; c != 3; ++c)
+                polygon[c] = *corners[c];
+
+            for (uint32_t plane = 0; plane != 5 && count >= 3; ++plane)
+            {
+                if (!(needsClip & (1u << plane)))
+                    continue;
+
+                auto Distance = [plane, guardX, guardY](const ClipVertex& v)
+                {
+                    switch (plane)
+                    {
+                        case 0:  return v.Clip[2];
+                        case 1:  return guardX * v.Clip[3] - v.Clip[0];
+                        case 2:  return guardX * v.Clip[3] + v.Clip[0];
+                        case 3:  return guardY * v.Clip[3] - v.Clip[1];
+                        default: return guardY * v.Clip[3] + v.Clip[1];
+                    }
+                };
+
+                uint32_t out = 0;
+                for (uint32_t v = 0; v != count; ++v)
+                {
+                    const ClipVertex& current = polygon[v];
+                    const ClipVertex& next = polygon[v + 1 != count ? v + 1 : 0];
+                    const float dCurrent = Distance(current);
+                    const float dNext = Distance(next);
+
+                    if (dCurrent >= 0.0f)
+                        clipped[out++] = current;
+                    if ((dCurrent >= 0.0f) != (dNext >= 0.0f))
+                    {
+                        const float t = dCurrent / (dCurrent - dNext);
+                        ClipVertex& split = clipped[out++];
+                        for (uint32_t c = 0; c != 4; ++c)
+                            split.Clip[c] = current.Clip[c] + (next.Clip[c] - current.Clip[c]) * t;
+                        for (uint32_t a = 0; a != kAttributeCount; ++a)
+                            split.Attributes[a] = current.Attributes[a] + (next.Attributes[a] - current.Attributes[a]) * t;
+                    }
+                }
+                std::swap(polygon, clipped);
+                count = out;
+            }
+
+            for (uint32_t v = 1; v + 1 < count; ++v)
+            {
+                const ClipVertex* fan[3] = { &polygon[0], &polygon[v], &polygon[v + 1] };
+                SetupTriangle(job, fan, draw.pMaterial);
+            }
+        }
+    }
+}
+
+void SoftwareRasterizer::SetupTriangle(GeometryJob& job, const ClipVertex* const* corners, const SoftwareMaterial* pMaterial)
+{
+    // Project and snap to the subpixel grid
+    float invW[3];
+    float screenX[3];
+    float screenY[3];
+    int32_t x[3];
+    int32_t y[3];
+    for (uint32_t v = 0; v != 3; ++v)
+    {
+        const float* c = corners[v]->Clip;
+        invW[v] = 1.0f / c[3];
+        x[v] = (int32_t)floorf(((c[0] * invW[v]) * 0.5f + 0.5f) * (float)mWidth * kSubpixels + 0.5f);
+        y[v] = (int32_t)floorf((0.5f - (c[1] * invW[v]) * 0.5f) * (float)mHeight * kSubpixels + 0.5f);
+        screenX[v] = (float)x[v] * (1.0f / kSubpixels);
+        screenY[v] = (float)y[v] * (1.0f / kSubpixels);
+    }
+
+    // Clockwise on screen is the front, like the default D3D rasterizer state. With y down that's a positive area.
+    const int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(x[2] - x[0]) * (y[1] - y[0]);
+    if (area <= 0)
+        return;
+
+    // Pixels whose center could be inside
+    const int32_t half = kSubpixels / 2;
+    Triangle triangle;
+    triangle.MinX = std::max((std::min({ x[0], x[1], x[2] }) - half + kSubpixels - 1) >> kSubpixelBits, 0);
+    triangle.MinY = std::max((std::min({ y[0], y[1], y[2] }) - half + kSubpixels - 1) >> kSubpixelBits, 0);
+    triangle.MaxX = std::min((std::max({ x[0], x[1], x[2] }) - half) >> kSubpixelBits, (int32_t)mWidth - 1);
+    triangle.MaxY = std::min((std::max({ y[0], y[1], y[2] }) - half) >> kSubpixelBits, (int32_t)mHeight - 1);
+    if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+        return;
+
+    for (uint32_t e = 0; e != 3; ++e)
+    {
+        const uint32_t next = e != 2 ? e + 1 : 0;
+        const int32_t a = y[e] - y[next];
+        const int32_t b = x[next] - x[e];
+
+        // Top-left rule: samples exactly on an edge only belong to the triangle if it's a left or a top edge
+        const bool topLeft = a > 0 || (a == 0 && b > 0);
+        triangle.EdgeA[e] = a;
+        triangle.EdgeB[e] = b;
+        triangle.EdgeC[e] = -((int64_t)a * x[e] + (int64_t)b * y[e]) - (topLeft ? 0 : 1);
+    }
+
+    // Planes through the snapped corners, so they agree with coverage
+    const float dx1 = screenX[1] - screenX[0];
+    const float dy1 = screenY[1] - screenY[0];
+    const float dx2 = screenX[2] - screenX[0];
+    const float dy2 = screenY[2] - screenY[0];
+    const float invDeterminant = 1.0f / (dx1 * dy2 - dx2 * dy1);
+    auto SetPlane = [&](float* out_plane, float f0, float f1, float f2)
+    {
+        const float df1 = f1 - f0;
+        const float df2 = f2 - f0;
+        out_plane[0] = f0;
+        out_plane[1] = (df1 * dy2 - df2 * dy1) * invDeterminant;
+        out_plane[2] = (dx1 * df2 - dx2 * df1) * invDeterminant;
+    };
+
+    triangle.RefX = screenX[0];
+    triangle.RefY = screenY[0];
+    SetPlane(triangle.Planes[0], corners[0]->Clip[2] * invW[0], corners[1]->Clip[2] * invW[1], corners[2]->Clip[2] * invW[2]);
+    SetPlane(triangle.Planes[1], invW[0], invW[1], invW[2]);
+    for (uint32_t a = 0; a != kAttributeCount; ++a)
+        SetPlane(triangle.Planes[2 + a], corners[0]->Attributes[a] * invW[0], corners[1]->Attributes[a] * invW[1], corners[2]->Attributes[a] * invW[2]);
+    triangle.pMaterial = pMaterial;
+
+    const uint32_t index = (uint32_t)job.Triangles.size();
+    job.Triangles.push_back(triangle);
+
+    // Bin by bounds, the raster phase throws out tiles the edges miss
+    for (uint32_t ty = (uint32_t)triangle.MinY / kTileSize; ty <= (uint32_t)triangle.MaxY / kTileSize; ++ty)
+    {
+        for (uint32_t tx = (uint32_t)triangle.MinX / kTileSize; tx <= (uint32_t)triangle.MaxX / kTileSize; ++tx)
+        {
+            const uint32_t tile = ty * mTilesX + tx;
+            job.Entries.push_back({ tile, index });
+            ++job.TileCounts[tile];
+        }
+    }
+}
+
+void SoftwareRasterizer::RasterizeTile(uint32_t tile)
+{
+    const int32_t tileX = (int32_t)((tile % mTilesX) * kTileSize);
+    const int32_t tileY = (int32_t)((tile / mTilesX) * kTileSize);
+    const uint32_t pitch = GetPitch();
+
+    // Clearing here rather than up front keeps the tile in this core's cache for what follows
+    for (uint32_t row = 0; row != kTileSize; ++row)
+    {
+        const size_t start = (size_t)(tileY + row) * pitch + tileX;
+        std::fill_n(&mColor[start], kTileSize, mClearColor);
+        std::fill_n(&mDepth[start], kTileSize, 1.0f);
+    }
+
+    uint64_t shaded = 0;
+    for (uint32_t i = mTileStarts[tile]; i != mTileStarts[tile + 1]; ++i)
+    {
+        const BinnedTriangle& binned = mBinned[i];
+        shaded += RasterizeTriangle(mJobs[binned.Job].Triangles[binned.Triangle], tileX, tileY);
+    }
+    mShadedPixels.fetch_add(shaded, std::memory_order_relaxed);
+}
+
+uint32_t SoftwareRasterizer::RasterizeTriangle(Triangle const& triangle, int32_t tileX, int32_t tileY)
+{
+    const int32_t x0 = std::max(triangle.MinX, tileX);
+    const int32_t y0 = std::max(triangle.MinY, tileY);
+    const int32_t x1 = std::min(triangle.MaxX, tileX + (int32_t)kTileSize - 1);
+    const int32_t y1 = std::min(triangle.MaxY, tileY + (int32_t)kTileSize - 1);
+    if (x0 > x1 || y0 > y1)
+        return 0;
+
+    // Spans start on multiples of 8, tiles are 64 aligned so they never leave the tile
+    const int32_t spanX0 = x0 & ~7;
+    const int64_t sampleX = (int64_t)spanX0 * kSubpixels + kSubpixels / 2;
+    const int64_t sampleY = (int64_t)y0 * kSubpixels + kSubpixels / 2;
+
+    // Edges that are inside over the whole rectangle are skipped. The rest cross it, which keeps their
+    // values within 32 bits anywhere in it.
+    I8       rows[3];
+    I8       spanSteps[3];
+    I8       rowSteps[3];
+    uint32_t partialCount = 0;
+    for (uint32_t e = 0; e != 3; ++e)
+    {
+        const int64_t a = triangle.EdgeA[e];
+        const int64_t b = triangle.EdgeB[e];
+        const int64_t atSpan = a * sampleX + b * sampleY + triangle.EdgeC[e];
+        const int64_t atX0 = atSpan + a * kSubpixels * (x0 - spanX0);
+        const int64_t acrossX = a * kSubpixels * (x1 - x0);
+        const int64_t acrossY = b * kSubpixels * (y1 - y0);
+        const int64_t lowest = atX0 + std::min<int64_t>(acrossX, 0) + std::min<int64_t>(acrossY, 0);
+        const int64_t highest = atX0 + std::max<int64_t>(acrossX, 0) + std::max<int64_t>(acrossY, 0);
+        if (highest < 0)
+            return 0;
+        if (lowest >= 0)
+            continue;
+
+        alignas(32) int32_t lanes[8];
+        for (int32_t lane = 0; lane != 8; ++lane)
+            lanes[lane] = (int32_t)(atSpan + a * kSubpixels * lane);
+        rows[partialCount] = LoadI(lanes);
+        spanSteps[partialCount] = SplatI((int32_t)(a * kSubpixels * 8));
+        rowSteps[partialCount] = SplatI((int32_t)(b * kSubpixels));
+        ++partialCount;
+    }
+
+    const uint32_t pitch = GetPitch();
+    uint32_t shaded = 0;
+    for (int32_t y = y0; y <= y1; ++y)
+    {
+        uint32_t* pColor = &mColor[(size_t)y * pitch];
+        float* pDepth = &mDepth[(size_t)y * pitch];
+
+        I8 edges[3];
+        for (uint32_t e = 0; e != partialCount; ++e)
+            edges[e] = rows[e];
+
+        for (int32_t x = spanX0; x <= x1; x += 8)
+        {
+            // Lanes inside the rectangle, then inside every edge that crosses it
+            const int32_t first = std::max(x0 - x, 0);
+            const int32_t last = std::min(x1 - x, 7);
+            uint32_t bits = (0xFFu << first) & (0xFFu >> (7 - last));
+            if (partialCount)
+            {
+                I8 negative = edges[0];
+                for (uint32_t e = 1; e != partialCount; ++e)
+                    negative = negative | edges[e];
+                bits &= ~SignBits(negative);
+
+                for (uint32_t e = 0; e != partialCount; ++e)
+                    edges[e] = edges[e] + spanSteps[e];
+            }
+
+            if (bits)
+                shaded += ShadeSpan(triangle, x, y, bits & 0xFF, pColor + x, pDepth + x);
+        }
+
+        for (uint32_t e = 0; e != partialCount; ++e)
+            rows[e] = rows[e] + rowSteps[e];
+    }
+    return shaded;
+}
+
+uint32_t SoftwareRasterizer::ShadeSpan(Triangle const& triangle, int32_t x, int32_t y, uint32_t bits, uint32_t* pColor, float* pDepth) const
+{
+    const float dx = (float)x + 0.5f - triangle.RefX;
+    const float dy = (float)y + 0.5f - triangle.RefY;
+    const F8 lanes = Load(kLaneOffsets);
+    auto Plane = [&](uint32_t i)
+    {
+        const float* p = triangle.Planes[i];
+        return Splat(p[0] + p[1] * dx + p[2] * dy) + lanes * Splat(p[1]);
+    };
+
+    // Depth test, LESS against a buffer cleared to 1 like the default depth state
+    const F8 z = Plane(0);
+    const F8 depth = Load(pDepth);
+    const F8 pass = And(CmpLt(z, depth), MaskFromBits(bits));
+    const uint32_t passBits = MoveMask(pass);
+    if (!passBits)
+        return 0;
+    Store(pDepth, Select(pass, z, depth));
+
+    // Perspective correct attributes
+    const F8 w = Splat(1.0f) / Plane(1);
+    F8 attributes[kAttributeCount];
+    for (uint32_t a = 0; a != kAttributeCount; ++a)
+        attributes[a] = Plane(2 + a) * w;
+
+    // One mip per span, picked from the analytic uv derivatives at its first pixel
+    const SoftwareMaterial& material = *triangle.pMaterial;
+    const float px = dx + (float)LowestBit(passBits);
+    const float* pw = triangle.Planes[1];
+    const float* pu = triangle.Planes[2 + kUV];
+    const float* pv = triangle.Planes[2 + kUV + 1];
+    const float invW = pw[0] + pw[1] * px + pw[2] * dy;
+    const float u = pu[0] + pu[1] * px + pu[2] * dy;
+    const float v = pv[0] + pv[1] * px + pv[2] * dy;
+    const float toUV = 1.0f / (invW * invW);
+    const float dudx = (pu[1] * invW - u * pw[1]) * toUV;
+    const float dudy = (pu[2] * invW - u * pw[2]) * toUV;
+    const float dvdx = (pv[1] * invW - v * pw[1]) * toUV;
+    const float dvdy = (pv[2] * invW - v * pw[2]) * toUV;
+
+    F8 surface[3];
+    SampleBilinear(SelectLevel(*material.pDiffuse, dudx, dvdx, dudy, dvdy), attributes[kUV], attributes[kUV + 1], pass, surface);
+
+    F8 normal[3] = { attributes[kNormal], attributes[kNormal + 1], attributes[kNormal + 2] };
+    Normalize(normal);
+
+    // PhongPS with NORMAL_MAP: the sampled normal through the TBN, tangent re-orthogonalized against the normal first
+    if (material.pNormal)
+    {
+        F8 sampled[3];
+        SampleBilinear(SelectLevel(*material.pNormal, dudx, dvdx, dudy, dvdy), attributes[kUV], attributes[kUV + 1], pass, sampled);
+        for (F8& c : sampled)
+            c = c * Splat(2.0f) - Splat(1.0f);
+
+        F8 tangent[3] = { attributes[kTangent], attributes[kTangent + 1], attributes[kTangent + 2] };
+        const F8 along = Dot(tangent, normal);
+        for (uint32_t c = 0; c != 3; ++c)
+            tangent[c] = tangent[c] - along * normal[c];
+        Normalize(tangent);
+
+        F8 binormal[3] = { attributes[kBinormal], attributes[kBinormal + 1], attributes[kBinormal + 2] };
+        Normalize(binormal);
+
+        for (uint32_t c = 0; c != 3; ++c)
+            normal[c] = sampled[0] * tangent[c] + sampled[1] * binormal[c] + sampled[2] * normal[c];
+    }
+
+    const SoftwareLighting& lighting = mLighting;
+    F8 toCamera[3];
+    for (uint32_t c = 0; c != 3; ++c)
+        toCamera[c] = Splat(lighting.CameraPosition[c]) - attributes[kWorldPosition + c];
+    Normalize(toCamera);
+
+    // DiffuseAmount doesn't normalize toLight, and neither does this
+    const F8 toLight[3] = { Splat(lighting.ToLight[0]), Splat(lighting.ToLight[1]), Splat(lighting.ToLight[2]) };
+    const F8 diffuse = Saturate(Dot(toLight, normal));
+
+    // SpecularPhong: reflect the normalized light direction about the normal
+    F8 lightDirection[3] = { Splat(-lighting.ToLight[0]), Splat(-lighting.ToLight[1]), Splat(-lighting.ToLight[2]) };
+    Normalize(lightDirection);
+    const F8 twiceAlong = Splat(2.0f) * Dot(normal, lightDirection);
+    F8 reflected[3];
+    for (uint32_t c = 0; c != 3; ++c)
+        reflected[c] = lightDirection[c] - twiceAlong * normal[c];
+
+    // The any(diffuseLighting) term: no highlight on the side facing away
+    const F8 specular = And(Pow(Saturate(Dot(reflected, toCamera)), material.Specularity), CmpGt(diffuse, Splat(0.0f)));
+
+    I8 packed = SplatI((int32_t)0xFF000000);
+    for (uint32_t c = 0; c != 3; ++c)
+    {
+        const F8 light = Splat(lighting.LightColor[c]) * (diffuse + specular) + Splat(lighting.Ambient[c]);
+        const I8 channel = ToInt(Saturate(light * surface[c]) * Splat(255.0f) + Splat(0.5f));
+        packed = packed | (c == 0 ? channel : (c == 1 ? ShiftLeft<8>(channel) : ShiftLeft<16>(channel)));
+    }
+
+    const F8 previous = AsFloat(LoadI(pColor));
+    StoreI(pColor, AsInt(Select(pass, AsFloat(packed), previous)));
+    return CountBits(passBits);
+}
+
+bool SoftwareRasterizer::WriteTGA(const char* path) const
+{
+    FILE* pFile = nullptr;
+    #if defined(_MSC_VER)
+    fopen_s(&pFile, path, "wb");
+    #else
+    pFile = fopen(path, "wb");
+    #endif
+    if (!pFile)
+        return false;
+
+    // Uncompressed true color, 8 bits of alpha, rows top to bottom
+    uint8_t header[18] = {};
+    header[2] = 2;
+    header[12] = (uint8_t)(mWidth & 0xFF);
+    header[13] = (uint8_t)(mWidth >> 8);
+    header[14] = (uint8_t)(mHeight & 0xFF);
+    header[15] = (uint8_t)(mHeight >> 8);
+    header[16] = 32;
+    header[17] = 0x28;
+    fwrite(header, sizeof(header), 1, pFile);
+
+    // TGA wants BGRA
+    std::vector<uint8_t> row(mWidth * 4);
+    for (uint32_t y = 0; y != mHeight; ++y)
+    {
+        const uint32_t* pSource = &mColor[(size_t)y * GetPitch()];
+        for (uint32_t x = 0; x != mWidth; ++x)
+        {
+            const uint32_t rgba = pSource[x];
+            row[x * 4 + 0] = (uint8_t)(rgba >> 16);
+            row[x * 4 + 1] = (uint8_t)(rgba >> 8);
+            row[x * 4 + 2] = (uint8_t)rgba;
+            row[x * 4 + 3] = (uint8_t)(rgba >> 24);
+        }
+        fwrite(row.data(), row.size(), 1, pFile);
+    }
+
+    fclose(pFile);
+    return true;
+}
+
+}
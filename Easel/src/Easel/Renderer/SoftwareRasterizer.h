@@ -0,0 +1,215 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : CPU rendering backend, for when there is no GPU to draw on.
+It takes the same cooked meshes, mip chains and instance matrices as
+EntityRenderer and shades like PhongPS, with or without NORMAL_MAP.
+Drawing is deferred to EndFrame, which runs two parallel phases. First,
+instances are transformed, clipped, set up and binned into 64x64 tiles.
+Then each tile is rasterized start to finish by one thread, so its color
+and depth stay in that core's cache. Inside a tile, edge functions are
+stepped in fixed point eight pixels at a time, and shading is eight wide.
+Like Culling.h, matrices are row-major float[16] in the DirectXMath convention.
+----------------------------------------------*/
+#ifndef EASEL_SOFTWARERASTERIZER_H
+#define EASEL_SOFTWARERASTERIZER_H
+
+#include "VertexFormat.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+namespace Assets
+{
+struct CookedMesh;
+struct MipChain;
+}
+
+namespace Core
+{
+class WorkerPool;
+}
+
+namespace Renderer {
+
+// Material parameters the software path reads. The chains are RGBA8, sampled bilinear with WRAP addressing.
+struct SoftwareMaterial
+{
+    const Assets::MipChain* pDiffuse = nullptr;     // Required
+    const Assets::MipChain* pNormal = nullptr;      // Shades like PhongPS with NORMAL_MAP when set, without otherwise
+    float                   Specularity = 0.0f;     // cbMaterialParams::specularExp
+};
+
+// cbLighting, without the DirectXMath types
+struct SoftwareLighting
+{
+    float Ambient[3];
+    float LightColor[3];
+    float ToLight[3];
+    float CameraPosition[3];
+};
+
+struct SoftwareRasterStats
+{
+    uint64_t Triangles = 0;         // Submitted, every instance counted
+    uint64_t SetupTriangles = 0;    // Survived culling and clipping
+    uint64_t BinEntries = 0;        // Triangle-tile pairs
+    uint64_t ShadedPixels = 0;      // Passed the depth test
+    double   GeometryMs = 0.0;
+    double   RasterMs = 0.0;
+};
+
+class SoftwareRasterizer
+{
+public:
+    static constexpr uint32_t kTileSize = 64;
+
+    // Keeps fixed point screen positions, edge functions and their steps inside 32 bits
+    static constexpr uint32_t kMaxDimension = 8192;
+
+    SoftwareRasterizer() = default;
+
+    // pPool may be null or have no workers, both phases then run on the calling thread
+    void Init(uint32_t width, uint32_t height, Core::WorkerPool* pPool);
+
+    // Copies what shading needs out of a mesh cooked for any layout with a POSITION. Attributes the layout
+    // doesn't have are zero. Returns the index to draw it with.
+    uint32_t AddMesh(Assets::CookedMesh const& mesh, VertexBufferDescription const& layout);
+
+    void BeginFrame(const float* viewProjection, SoftwareLighting const& lighting, const float* clearColor);
+
+    // Nothing is copied, so the material, its chains and the matrices have to stay put until EndFrame
+    void DrawInstanced(uint32_t mesh, SoftwareMaterial const& material, const float* worldMatrices, uint32_t instanceCount);
+
+    // Draws everything since BeginFrame and returns once the image is complete
+    void EndFrame();
+
+    uint32_t GetWidth() const  { return mWidth; }
+    uint32_t GetHeight() const { return mHeight; }
+
+    // RGBA8, GetPitch() pixels from one row to the next
+    const uint32_t* GetPixels() const { return mColor.data(); }
+    uint32_t        GetPitch() const  { return mTilesX * kTileSize; }
+
+    SoftwareRasterStats const& GetStats() const { return mStats; }
+
+    // Uncompressed 32 bit TGA of the last frame. False if the file couldn't be opened.
+    bool WriteTGA(const char* path) const;
+
+private:
+    // What shading interpolates, in this order: normal, uv, world position, tangent, binormal
+    static constexpr uint32_t kAttributeCount = 14;
+
+    struct Vertex
+    {
+        float Position[3];
+        float Attributes[kAttributeCount];
+    };
+
+    struct ClipVertex
+    {
+        float Clip[4];
+        float Attributes[kAttributeCount];
+    };
+
+    struct Mesh
+    {
+        std::vector<Vertex>   Vertices;
+        std::vector<uint32_t> Indices;
+    };
+
+    struct Draw
+    {
+        uint32_t                Mesh;
+        const SoftwareMaterial* pMaterial;
+        const float*            WorldMatrices;
+        uint32_t                InstanceCount;
+    };
+
+    // Ready to rasterize. Planes give a value at RefX/RefY and its screen space derivatives.
+    struct Triangle
+    {
+        int32_t                 EdgeA[3];
+        int32_t                 EdgeB[3];
+        int64_t                 EdgeC[3];       // Fill rule folded in: a sample is inside when every A*x + B*y + C >= 0
+        int32_t                 MinX, MinY, MaxX, MaxY;     // Pixels, inclusive and on screen
+        float                   RefX, RefY;
+        float                   Planes[2 + kAttributeCount][3];     // z, 1/w, then every attribute over w
+        const SoftwareMaterial* pMaterial;
+    };
+
+    // Binned triangle, in the triangles of one geometry job
+    struct TileEntry
+    {
+        uint32_t Tile;
+        uint32_t Triangle;
+    };
+
+    // A run of instances of one draw, transformed and binned by whichever thread claims it
+    struct GeometryJob
+    {
+        uint32_t                Draw;
+        uint32_t                FirstInstance;
+        uint32_t                InstanceCount;
+
+        std::vector<Triangle>   Triangles;
+        std::vector<TileEntry>  Entries;
+        std::vector<uint32_t>   TileCounts;     // Then where this job's entries start in every tile
+        std::vector<ClipVertex> Transformed;    // One instance's vertices at a time
+        uint64_t                SubmittedTriangles = 0;
+    };
+
+    struct BinnedTriangle
+    {
+        uint32_t Job;
+        uint32_t Triangle;
+    };
+
+    // On the pool when there is one
+    void ForEach(uint32_t count, void (*func)(void* pContext, uint32_t index));
+
+    static void RunGeometryJob(void* pContext, uint32_t job);
+    static void RunScatterJob(void* pContext, uint32_t job);
+    static void RunTileJob(void* pContext, uint32_t tile);
+
+    void ProcessGeometry(GeometryJob& job);
+    void SetupTriangle(GeometryJob& job, const ClipVertex* const* corners, const SoftwareMaterial* pMaterial);
+    void RasterizeTile(uint32_t tile);
+
+    // Both return how many pixels passed the depth test
+    uint32_t RasterizeTriangle(Triangle const& triangle, int32_t tileX, int32_t tileY);
+    uint32_t ShadeSpan(Triangle const& triangle, int32_t x, int32_t y, uint32_t bits, uint32_t* pColor, float* pDepth) const;
+
+    uint32_t                    mWidth = 0;
+    uint32_t                    mHeight = 0;
+    uint32_t                    mTilesX = 0;
+    uint32_t                    mTilesY = 0;
+    Core::WorkerPool*           mpPool = nullptr;
+
+    std::vector<Mesh>           mMeshes;
+
+    // Padded out to whole tiles
+    std::vector<uint32_t>       mColor;
+    std::vector<float>          mDepth;
+
+    float                       mViewProjection[16];
+    SoftwareLighting            mLighting;
+    uint32_t                    mClearColor = 0;
+
+    std::vector<Draw>           mDraws;
+    std::vector<GeometryJob>    mJobs;      // Kept between frames with their capacity, only mJobCount are live
+    uint32_t                    mJobCount = 0;
+    std::vector<uint32_t>       mTileStarts;    // Into mBinned, one past the end for the last tile
+    std::vector<BinnedTriangle> mBinned;
+
+    std::atomic<uint64_t>       mShadedPixels{0};
+    SoftwareRasterStats         mStats;
+
+public:
+    SoftwareRasterizer(SoftwareRasterizer const&)            = delete;
+    SoftwareRasterizer& operator=(SoftwareRasterizer const&) = delete;
+};
+
+}
+#endif
@@ -0,0 +1,86 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Dynamic structured buffers read by the pixel shader, the
+StructuredBuffer<T> counterpart to ConstantBuffer.h. Sized for the most
+elements it will ever hold, and rewritten whole or in part every frame.
+----------------------------------------------*/
+#ifndef EASEL_STRUCTUREDBUFFER_H
+#define EASEL_STRUCTUREDBUFFER_H
+
+#include "DXCore.h"
+#include "RenderingParams.h"
+
+#include "ThrowMacros.h"
+
+#include <assert.h>
+
+namespace Renderer {
+
+struct StructuredBufferBindPacket
+{
+    ID3D11Buffer*             Buffer;
+    ID3D11ShaderResourceView* View;
+    UINT                      ElementSize;
+    UINT                      Capacity;     // In elements
+    UINT                      BindSlot;
+};
+
+struct StructuredBufferUpdateManager
+{
+    static void Populate(UINT elementSize, UINT capacity, PS_RESOURCE_REGISTERS slot, ID3D11Device* device, StructuredBufferBindPacket* out_packet)
+    {
+        D3D11_BUFFER_DESC dynamicDesc = {0};
+        dynamicDesc.Usage = D3D11_USAGE_DYNAMIC;
+        dynamicDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        dynamicDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        dynamicDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        dynamicDesc.StructureByteStride = elementSize;
+        dynamicDesc.ByteWidth = elementSize * capacity;
+
+        StructuredBufferBindPacket sbp;
+        COM_EXCEPT(device->CreateBuffer(&dynamicDesc, nullptr, &sbp.Buffer));
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+        viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+        viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        viewDesc.Buffer.FirstElement = 0;
+        viewDesc.Buffer.NumElements = capacity;
+        COM_EXCEPT(device->CreateShaderResourceView(sbp.Buffer, &viewDesc, &sbp.View));
+
+        sbp.ElementSize = elementSize;
+        sbp.Capacity    = capacity;
+        sbp.BindSlot    = (UINT)slot;
+
+        *out_packet     = sbp;
+    }
+
+    // The first 'count' elements. Whatever is past them is undefined until written again.
+    static void MapUnmap(StructuredBufferBindPacket* packet, const void* newData, UINT count, ID3D11DeviceContext* context)
+    {
+        assert(count <= packet->Capacity);
+
+        D3D11_MAPPED_SUBRESOURCE mappedBuffer = {0};
+        COM_EXCEPT(context->Map(packet->Buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer));
+        memcpy(mappedBuffer.pData, newData, (size_t)count * packet->ElementSize);
+        context->Unmap(packet->Buffer, 0);
+    }
+
+    static void Bind(StructuredBufferBindPacket* packet, ID3D11DeviceContext* context)
+    {
+        context->PSSetShaderResources(packet->BindSlot, 1, &packet->View);
+    }
+
+    // Headless packets never had a buffer
+    static void Cleanup(StructuredBufferBindPacket* packet)
+    {
+        if (packet->View)
+            packet->View->Release();
+        if (packet->Buffer)
+            packet->Buffer->Release();
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,38 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Device independent description of vertex layouts,
+shared by shader reflection and mesh importing
+----------------------------------------------*/
+#ifndef EASEL_VERTEXFORMAT_H
+#define EASEL_VERTEXFORMAT_H
+
+#include <stdint.h>
+
+namespace Renderer {
+
+typedef uint8_t semantic_t;
+enum class Semantics : semantic_t
+{
+    POSITION,
+    NORMAL,
+    TEXCOORD,
+    TANGENT,
+    BINORMAL,
+    COLOR,
+    BLENDINDICES,
+    BLENDWEIGHTS,
+    WORLDMATRIX,
+    COUNT
+};
+
+struct VertexBufferDescription
+{
+    Semantics* SemanticsArr;
+    uint16_t*  ByteOffsets;
+    uint16_t   AttrCount;
+    uint16_t   ByteSize;
+};
+
+}
+#endif
@@ -1,30 +1,117 @@
 /*----------------------------------------------
 Ruben Young (rubenaryo@gmail.com)
 Date : 2020/10
-Description : Material class for shader information
+Description : FNV-1a hashing for resource IDs and content hashes.
+Everything is constexpr so IDs can be computed at compile time.
+Wide strings are hashed as their UTF-8 encoding, so L"Name" and
+"Name" (or a UTF-8 name read from a data file) always agree.
 ----------------------------------------------*/
 #ifndef EASEL_HASH_UTIL_H
 #define EASEL_HASH_UTIL_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <string_view>
 
-// Helper function for hashing c strings
-inline uint32_t fnv1a(const char* text, uint32_t hash = 0x811C9DC5, uint32_t prime = 0x01000193)
+static constexpr uint32_t kFnv1aBasis = 0x811C9DC5;
+static constexpr uint32_t kFnv1aPrime = 0x01000193;
+
+namespace HashDetail
 {
-    const unsigned char* ptr = (const unsigned char*)text;
-    while (*ptr)
-        hash = (*ptr++ ^ hash) * prime;
+constexpr uint32_t HashByte(uint32_t hash, uint32_t byte)
+{
+    return ((byte & 0xFF) ^ hash) * kFnv1aPrime;
+}
+
+// Feeds the UTF-8 encoding of one code point
+constexpr uint32_t HashCodePoint(uint32_t hash, uint32_t cp)
+{
+    if (cp < 0x80)
+        return HashByte(hash, cp);
+
+    if (cp < 0x800)
+    {
+        hash = HashByte(hash, 0xC0 | (cp >> 6));
+        return HashByte(hash, 0x80 | (cp & 0x3F));
+    }
+
+    if (cp < 0x10000)
+    {
+        hash = HashByte(hash, 0xE0 | (cp >> 12));
+        hash = HashByte(hash, 0x80 | ((cp >> 6) & 0x3F));
+        return HashByte(hash, 0x80 | (cp & 0x3F));
+    }
+
+    hash = HashByte(hash, 0xF0 | (cp >> 18));
+    hash = HashByte(hash, 0x80 | ((cp >> 12) & 0x3F));
+    hash = HashByte(hash, 0x80 | ((cp >> 6) & 0x3F));
+    return HashByte(hash, 0x80 | (cp & 0x3F));
+}
+}
+
+// Narrow strings are taken to be UTF-8 already
+constexpr uint32_t fnv1a(std::string_view text, uint32_t hash = kFnv1aBasis)
+{
+    for (const char c : text)
+        hash = HashDetail::HashByte(hash, (unsigned char)c);
+
+    return hash;
+}
+
+constexpr uint32_t fnv1a(const char* text, uint32_t hash = kFnv1aBasis)
+{
+    return fnv1a(std::string_view(text), hash);
+}
+
+// UTF-16 on Windows, UTF-32 elsewhere. Either way, hashed as UTF-8.
+constexpr uint32_t fnv1a(std::wstring_view text, uint32_t hash = kFnv1aBasis)
+{
+    for (size_t i = 0; i != text.size(); ++i)
+    {
+        uint32_t cp = (uint32_t)text[i];
+
+        // Join surrogate pairs. A lone surrogate is hashed as is rather than failing.
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 != text.size())
+        {
+            const uint32_t low = (uint32_t)text[i + 1];
+            if (low >= 0xDC00 && low <= 0xDFFF)
+            {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            }
+        }
+
+        hash = HashDetail::HashCodePoint(hash, cp);
+    }
 
     return hash;
 }
 
-inline uint32_t fnv1a(const wchar_t* text, uint32_t hash = 0x811C9DC5, uint32_t prime = 0x01000193)
+constexpr uint32_t fnv1a(const wchar_t* text, uint32_t hash = kFnv1aBasis)
+{
+    return fnv1a(std::wstring_view(text), hash);
+}
+
+// "cube.obj"_id. Use it to initialize a constexpr to guarantee it's folded at compile time.
+constexpr uint32_t operator""_id(const char* text, size_t length)
+{
+    return fnv1a(std::string_view(text, length));
+}
+
+constexpr uint32_t operator""_id(const wchar_t* text, size_t length)
+{
+    return fnv1a(std::wstring_view(text, length));
+}
+
+// 64-bit variant over raw bytes, for content hashing. Pass the previous result as 'hash' to continue a stream.
+inline uint64_t fnv1a_64(const void* data, size_t size, uint64_t hash = 0xCBF29CE484222325ull, uint64_t prime = 0x00000100000001B3ull)
 {
-    const wchar_t* ptr = (const wchar_t*)text;
-    while (*ptr)
+    const unsigned char* ptr = (const unsigned char*)data;
+    const unsigned char* end = ptr + size;
+    while (ptr != end)
         hash = (*ptr++ ^ hash) * prime;
 
     return hash;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -20,6 +20,12 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif 
 
+    // Batch simulation and perf runs: no window, no device, e.g. IsoDungeon.exe -headless -unthrottled -frames 3600
+    // Add -check-allocations to a Debug run to fail it when a warmed up frame allocates, -stress-lights 1024 to load the light binner
+    Core::HeadlessSettings headless;
+    if (Core::Headless::ParseCommandLine(lpCmdLine, &headless))
+        exit(Core::Headless::Run(headless) ? EXIT_SUCCESS : EXIT_FAILURE);
+
     {
         // Create the window
         Core::GameWindow window;
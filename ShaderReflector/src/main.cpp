@@ -0,0 +1,114 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Runs after the Shaders project builds. Reflects every .cso
+in the folder it's given into a .refl next to it, skipping those that are
+already up to date, then checks every cbuffer it finds against the structs
+in CBufferStructs.h. A mismatch is reported the way Visual Studio lists
+errors and fails the build.
+    ShaderReflector <shader folder>
+----------------------------------------------*/
+#include <Easel/Core/MappedFile.h>
+#include <Easel/Renderer/CBufferStructs.h>
+#include <Easel/Renderer/ShaderReflection.h>
+#include <Easel/Renderer/hash_util.h>
+
+#include <filesystem>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+namespace {
+
+using Renderer::CBufferLayout;
+using Renderer::ShaderReflection;
+using Renderer::ShaderReflector;
+
+const CBufferLayout* FindLayout(const char* name)
+{
+    for (const CBufferLayout& layout : Renderer::kCBufferLayouts)
+    {
+        if (!strcmp(layout.Name, name))
+            return &layout;
+    }
+    return nullptr;
+}
+
+// False if the shader couldn't be reflected or doesn't agree with C++
+bool ProcessShader(const std::string& shaderPath, uint32_t* out_reflected)
+{
+    Core::MappedFile bytecode;
+    if (!bytecode.Open(shaderPath))
+    {
+        printf("%s : error : couldn't be read\n", shaderPath.c_str());
+        return false;
+    }
+
+    const std::string reflectionPath = ShaderReflector::GetReflectionPath(shaderPath);
+    const uint64_t bytecodeHash = fnv1a_64(bytecode.GetData(), bytecode.GetSize());
+
+    ShaderReflection reflection;
+    if (!ShaderReflector::Load(reflectionPath, bytecodeHash, &reflection))
+    {
+        if (!ShaderReflector::Reflect(bytecode.GetData(), bytecode.GetSize(), &reflection))
+        {
+            printf("%s : error : couldn't be reflected, or has an input semantic Easel doesn't know\n", shaderPath.c_str());
+            return false;
+        }
+
+        if (!ShaderReflector::Save(reflectionPath, reflection))
+        {
+            printf("%s : error : couldn't be written\n", reflectionPath.c_str());
+            return false;
+        }
+        ++*out_reflected;
+    }
+
+    // Cbuffers only C++ knows the layout of are the ones that can drift. Anything else is left to the shader.
+    bool matches = true;
+    for (const Renderer::ReflectedCBuffer& cbuffer : reflection.CBuffers)
+    {
+        const CBufferLayout* pLayout = FindLayout(cbuffer.Name);
+        std::string error;
+        if (pLayout && !ShaderReflector::CheckCBuffer(reflection, cbuffer, *pLayout, &error))
+        {
+            printf("%s : error : %s, see CBufferStructs.h\n", shaderPath.c_str(), error.c_str());
+            matches = false;
+        }
+    }
+    return matches;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        printf("usage: ShaderReflector <shader folder>\n");
+        return 1;
+    }
+
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    uint32_t shaders = 0;
+    uint32_t reflected = 0;
+    bool succeeded = true;
+    for (const fs::directory_entry& entry : fs::directory_iterator(argv[1], ec))
+    {
+        if (entry.path().extension() != ".cso")
+            continue;
+
+        succeeded &= ProcessShader(entry.path().string(), &reflected);
+        ++shaders;
+    }
+
+    if (ec)
+    {
+        printf("%s : error : %s\n", argv[1], ec.message().c_str());
+        return 1;
+    }
+
+    printf("ShaderReflector: %u shaders, %u reflected again\n", shaders, reflected);
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Heap allocations made by work handed to the WorkerPool or a
+TaskGraph are counted on the thread that handed it out, so the frame
+loops' HeapAllocationScope sees what their workers allocate.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <Easel/Core/Allocators.h>
+#include <Easel/Core/TaskGraph.h>
+#include <Easel/Core/WorkerPool.h>
+
+#include <chrono>
+#include <thread>
+
+#if defined(ESL_COUNT_ALLOCATIONS)
+
+namespace {
+
+static const uint32_t kItems = 256;
+
+// Called directly, since the optimizer may drop a new expression whose result goes unused.
+// Slow enough that the calling thread can't finish every item before the workers wake up.
+void AllocateOnce(void*, uint32_t)
+{
+    ::operator delete(::operator new(sizeof(int)));
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+}
+
+}
+
+ESL_TEST(AllocationCount_DispatchCountsOnTheCaller)
+{
+    Core::WorkerPool pool;
+    pool.Init(4);
+
+    for (int run = 0; run != 4; ++run)
+    {
+        Core::HeapAllocationScope allocations;
+        pool.Dispatch(kItems, &AllocateOnce, nullptr);
+        ESL_CHECK(allocations.GetCount() == kItems);
+    }
+
+    pool.Shutdown();
+}
+
+ESL_TEST(AllocationCount_TaskGraphCountsOnTheCaller)
+{
+    Core::WorkerPool pool;
+    pool.Init(4);
+
+    // Independent tasks, so they spread over the workers, one of them dispatching more work of its own
+    Core::TaskGraph graph;
+    for (uint32_t i = 0; i != 8; ++i)
+        graph.AddTask("Allocate", 0, 1ull << i, []() { AllocateOnce(nullptr, 0); });
+    graph.AddTask("Dispatch", 0, 1ull << 8, [&pool]() { pool.Dispatch(kItems, &AllocateOnce, nullptr); });
+    graph.Compile();
+
+    // The first run also sets up the workers' profiler buffers
+    graph.Run(&pool);
+
+    // Nothing is left on the workers' own counts for a later scope to pick up
+    for (int run = 0; run != 4; ++run)
+    {
+        Core::HeapAllocationScope allocations;
+        graph.Run(&pool);
+        ESL_CHECK(allocations.GetCount() == 8 + kItems);
+    }
+
+    pool.Shutdown();
+}
+
+#endif
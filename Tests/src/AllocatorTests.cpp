@@ -0,0 +1,205 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Arena alignment, exhaustion and rewinding, the frame arena's
+two frame lifetime, and fixed-size pool reuse.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <Easel/Core/Allocators.h>
+
+#include <string.h>
+
+namespace {
+
+bool IsAligned(const void* p, size_t alignment)
+{
+    return ((uintptr_t)p & (alignment - 1)) == 0;
+}
+
+struct Counted
+{
+    explicit Counted(int value) : Value(value) { ++sLive; }
+    ~Counted() { --sLive; }
+
+    int        Value;
+    static int sLive;
+};
+
+int Counted::sLive = 0;
+
+}
+
+ESL_TEST(LinearArena_AlignsEveryAllocation)
+{
+    Core::LinearArena arena(1024);
+
+    // An odd sized allocation first, so the next one has to be padded
+    void* pByte = arena.Allocate(1, 1);
+    ESL_CHECK(pByte != nullptr);
+
+    void* pDefault = arena.Allocate(8);
+    ESL_CHECK(IsAligned(pDefault, Core::kDefaultAlignment));
+
+    arena.Allocate(3, 1);
+    void* pWide = arena.Allocate(16, 64);
+    ESL_CHECK(IsAligned(pWide, 64));
+
+    double* pDoubles = arena.AllocateArray<double>(4);
+    ESL_CHECK(IsAligned(pDoubles, Core::kDefaultAlignment));
+    ESL_CHECK((uint8_t*)pDoubles >= (uint8_t*)pWide + 16);
+}
+
+ESL_TEST(LinearArena_TryAllocateFailsWhenFull)
+{
+    Core::LinearArena arena(256);
+
+    ESL_CHECK(arena.TryAllocate(200) != nullptr);
+    const size_t used = arena.GetUsed();
+
+    // Doesn't fit, and a failed allocation leaves the arena as it was
+    ESL_CHECK(arena.TryAllocate(100) == nullptr);
+    ESL_CHECK(arena.GetUsed() == used);
+
+    // Exactly what's left still fits
+    ESL_CHECK(arena.TryAllocate(256 - used, 1) != nullptr);
+    ESL_CHECK(arena.GetUsed() == arena.GetCapacity());
+    ESL_CHECK(arena.TryAllocate(1, 1) == nullptr);
+
+    Core::LinearArena empty;
+    ESL_CHECK(empty.TryAllocate(1) == nullptr);
+}
+
+ESL_TEST(LinearArena_ResetAndRewindReuseMemory)
+{
+    Core::LinearArena arena(1024);
+
+    void* pFirst = arena.Allocate(100);
+    const size_t marker = arena.GetMarker();
+    void* pSecond = arena.Allocate(300);
+
+    arena.Rewind(marker);
+    ESL_CHECK(arena.GetUsed() == marker);
+    ESL_CHECK(arena.Allocate(300) == pSecond);
+
+    arena.Reset();
+    ESL_CHECK(arena.GetUsed() == 0);
+    ESL_CHECK(arena.Allocate(100) == pFirst);
+
+    // The high water mark remembers the peak across resets
+    ESL_CHECK(arena.GetHighWater() >= 400);
+}
+
+ESL_TEST(FrameArena_PreviousFrameSurvivesTheFlip)
+{
+    Core::FrameArena frames;
+    frames.Init(256);
+
+    frames.BeginFrame();
+    char* pFrameA = (char*)frames.Allocate(16);
+    strcpy(pFrameA, "frame a");
+
+    // Built while frame A is drawn, A's data has to stay readable
+    frames.BeginFrame();
+    char* pFrameB = (char*)frames.Allocate(16);
+    strcpy(pFrameB, "frame b");
+    ESL_CHECK(pFrameB != pFrameA);
+    ESL_CHECK(strcmp(pFrameA, "frame a") == 0);
+
+    // Two flips later A's arena is reset and handed out again, B's is still intact
+    frames.BeginFrame();
+    ESL_CHECK(frames.GetCurrent().GetUsed() == 0);
+    char* pFrameC = (char*)frames.Allocate(16);
+    ESL_CHECK(pFrameC == pFrameA);
+    strcpy(pFrameC, "frame c");
+    ESL_CHECK(strcmp(pFrameB, "frame b") == 0);
+
+    frames.Destroy();
+}
+
+ESL_TEST(ScopedScratch_RewindsOnScopeExit)
+{
+    Core::LinearArena& scratchArena = Core::GetThreadScratchArena();
+    const size_t before = scratchArena.GetUsed();
+
+    void* pOuter = nullptr;
+    {
+        Core::ScopedScratch outer;
+        pOuter = outer.AllocateArray<uint32_t>(64);
+        ESL_CHECK(pOuter != nullptr);
+        const size_t outerUsed = scratchArena.GetUsed();
+        ESL_CHECK(outerUsed > before);
+
+        {
+            Core::ScopedScratch inner;
+            inner.Allocate(1024);
+            ESL_CHECK(scratchArena.GetUsed() > outerUsed);
+        }
+        ESL_CHECK(scratchArena.GetUsed() == outerUsed);
+    }
+    ESL_CHECK(scratchArena.GetUsed() == before);
+
+    // The next scope starts where the last one did
+    Core::ScopedScratch again;
+    ESL_CHECK(again.AllocateArray<uint32_t>(64) == pOuter);
+}
+
+ESL_TEST(PoolAllocator_ReusesFreedBlocks)
+{
+    Core::PoolAllocator pool;
+    pool.Init(24, 32, 4);
+    ESL_CHECK(pool.GetCapacity() == 4);
+
+    void* blocks[4];
+    for (void*& pBlock : blocks)
+    {
+        pBlock = pool.Allocate();
+        ESL_CHECK(pBlock != nullptr);
+        ESL_CHECK(IsAligned(pBlock, 32));
+        ESL_CHECK(pool.Owns(pBlock));
+    }
+    ESL_CHECK(pool.GetLiveCount() == 4);
+    ESL_CHECK(pool.Allocate() == nullptr);
+
+    // Blocks never overlap
+    for (int i = 0; i != 4; ++i)
+        memset(blocks[i], i, 24);
+    for (int i = 0; i != 4; ++i)
+        ESL_CHECK(((uint8_t*)blocks[i])[23] == i);
+
+    pool.Free(blocks[2]);
+    ESL_CHECK(pool.GetLiveCount() == 3);
+    ESL_CHECK(pool.Allocate() == blocks[2]);
+
+    int outside;
+    ESL_CHECK(!pool.Owns(&outside));
+    ESL_CHECK(!pool.Owns((uint8_t*)blocks[0] + 1));
+
+    for (void* pBlock : blocks)
+        pool.Free(pBlock);
+    ESL_CHECK(pool.GetLiveCount() == 0);
+}
+
+ESL_TEST(ObjectPool_ConstructsAndDestroys)
+{
+    Core::ObjectPool<Counted> pool;
+    pool.Init(2);
+
+    Counted* pA = pool.Create(1);
+    Counted* pB = pool.Create(2);
+    ESL_CHECK(pA && pB && pA->Value == 1 && pB->Value == 2);
+    ESL_CHECK(Counted::sLive == 2);
+    ESL_CHECK(pool.Create(3) == nullptr);
+    ESL_CHECK(Counted::sLive == 2);
+
+    pool.Destroy(pA);
+    ESL_CHECK(Counted::sLive == 1);
+    ESL_CHECK(pool.GetLiveCount() == 1);
+
+    Counted* pC = pool.Create(3);
+    ESL_CHECK(pC == pA && pC->Value == 3);
+
+    pool.Destroy(pB);
+    pool.Destroy(pC);
+    ESL_CHECK(Counted::sLive == 0);
+}
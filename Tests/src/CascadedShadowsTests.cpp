@@ -0,0 +1,139 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Cascade splits, the texel snapping that keeps shadow edges
+from crawling, and the caster volume EntityRenderer::CullShadowCasters
+culls against.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <Easel/Renderer/CascadedShadows.h>
+
+#include <math.h>
+#include <string.h>
+
+namespace {
+
+using Renderer::BoundingSphere;
+using Renderer::CascadedShadows;
+using Renderer::Culling;
+using Renderer::ShadowCascade;
+
+static const uint32_t kResolution = 2048;
+
+// A 60 degree 16:9 view, and the sun straight overhead
+struct View
+{
+    float InverseView[16] = { 1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1, 0,   0, 2, 0, 1 };
+    float ProjX;
+    float ProjY;
+    float ToLight[3] = { 0.0f, 1.0f, 0.0f };
+
+    View()
+    {
+        ProjY = 1.0f / tanf(0.5235988f);
+        ProjX = ProjY * 9.0f / 16.0f;
+    }
+
+    void MoveTo(float x, float z)
+    {
+        InverseView[12] = x;
+        InverseView[14] = z;
+    }
+
+    void Fit(ShadowCascade* out_cascade) const
+    {
+        CascadedShadows::FitCascade(InverseView, ProjX, ProjY, 0.1f, 10.0f, ToLight, kResolution, out_cascade);
+    }
+};
+
+}
+
+ESL_TEST(CascadedShadows_SplitsAreMonotonic)
+{
+    const float lambdas[] = { 0.0f, 0.5f, 0.75f, 1.0f };
+    for (float lambda : lambdas)
+    {
+        for (uint32_t count = 1; count <= CascadedShadows::kMaxCascades; ++count)
+        {
+            float splits[CascadedShadows::kMaxCascades + 1];
+            CascadedShadows::ComputeSplits(0.1f, 60.0f, lambda, count, splits);
+
+            ESL_CHECK(splits[0] == 0.1f);
+            ESL_CHECK(splits[count] == 60.0f);
+            for (uint32_t i = 0; i != count; ++i)
+                ESL_CHECK(splits[i] < splits[i + 1]);
+        }
+    }
+
+    // The two ends of the blend: even spacing, and a constant ratio
+    float splits[5];
+    CascadedShadows::ComputeSplits(1.0f, 81.0f, 0.0f, 4, splits);
+    ESL_CHECK(fabsf(splits[1] - 21.0f) < 1e-4f && fabsf(splits[2] - 41.0f) < 1e-4f && fabsf(splits[3] - 61.0f) < 1e-4f);
+    CascadedShadows::ComputeSplits(1.0f, 81.0f, 1.0f, 4, splits);
+    ESL_CHECK(fabsf(splits[1] - 3.0f) < 1e-4f && fabsf(splits[2] - 9.0f) < 1e-4f && fabsf(splits[3] - 27.0f) < 1e-3f);
+}
+
+ESL_TEST(CascadedShadows_SnapsToWholeTexels)
+{
+    View view;
+    ShadowCascade cascade;
+    view.Fit(&cascade);
+    ESL_CHECK(cascade.TexelSize > 0.0f);
+
+    // The light view is a rotation, so the last row is the projection's offset: minus the light space centre over the radius
+    const float texelsX = -cascade.ViewProjection[12] * (float)kResolution * 0.5f;
+    const float texelsY = -cascade.ViewProjection[13] * (float)kResolution * 0.5f;
+    ESL_CHECK(fabsf(texelsX - roundf(texelsX)) < 1e-2f);
+    ESL_CHECK(fabsf(texelsY - roundf(texelsY)) < 1e-2f);
+
+    // Step along world X, which is light space Y with the sun overhead, until the cascade jumps a texel
+    const float step = cascade.TexelSize / 16.0f;
+    float x = 0.0f;
+    ShadowCascade previous = cascade;
+    for (int i = 0; i != 32; ++i)
+    {
+        x += step;
+        view.MoveTo(x, 0.0f);
+        view.Fit(&cascade);
+        if (memcmp(cascade.ViewProjection, previous.ViewProjection, sizeof(cascade.ViewProjection)))
+            break;
+    }
+    ESL_CHECK(memcmp(cascade.ViewProjection, previous.ViewProjection, sizeof(cascade.ViewProjection)) != 0);
+
+    // Just past a texel boundary, so anything short of the next one leaves the projection exactly as it is
+    const ShadowCascade snapped = cascade;
+    for (int i = 0; i != 12; ++i)
+    {
+        x += step;
+        view.MoveTo(x, 0.0f);
+        view.Fit(&cascade);
+        ESL_CHECK(!memcmp(cascade.ViewProjection, snapped.ViewProjection, sizeof(cascade.ViewProjection)));
+    }
+}
+
+ESL_TEST(CascadedShadows_CastersIncludeEverythingTowardsTheSun)
+{
+    View view;
+    ShadowCascade cascade;
+    view.Fit(&cascade);
+
+    // The camera looks down +Z from (0, 2, 0), so the slice is around (0, 2, 5)
+    const BoundingSphere inside       = { 0.0f,   2.0f,   5.0f, 0.5f };
+    const BoundingSphere towardsSun   = { 0.0f,   502.0f, 5.0f, 0.5f };
+    const BoundingSphere beside       = { 200.0f, 2.0f,   5.0f, 0.5f };
+    const BoundingSphere belowFarEnd  = { 0.0f,  -498.0f, 5.0f, 0.5f };
+
+    ESL_CHECK(Culling::IsVisible(cascade.Casters, inside));
+    ESL_CHECK(Culling::IsVisible(cascade.Casters, towardsSun));
+    ESL_CHECK(!Culling::IsVisible(cascade.Casters, beside));
+    ESL_CHECK(!Culling::IsVisible(cascade.Casters, belowFarEnd));
+
+    // Same answers through the batch path the renderer uses
+    const BoundingSphere spheres[] = { inside, beside, towardsSun, belowFarEnd };
+    uint32_t casters[4];
+    const uint32_t count = Culling::CullSpheres(cascade.Casters, spheres, 4, casters);
+    ESL_CHECK(count == 2);
+    if (count == 2)
+        ESL_CHECK(casters[0] == 0 && casters[1] == 2);
+}
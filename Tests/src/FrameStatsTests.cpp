@@ -0,0 +1,155 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Frame time statistics: exact mean and percentiles over a
+window, what a window reports before it has filled or after it wraps, an
+empty record, and the session histogram staying within its precision.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <Easel/Core/FrameStats.h>
+
+#include <math.h>
+#include <memory>
+
+namespace {
+
+using Core::FrameStats;
+using Core::FrameTimeHistogram;
+using Core::FrameTimeStats;
+
+bool Near(double a, double b)
+{
+    return fabs(a - b) < 1e-9;
+}
+
+// Within the histogram's 1/64, plus its half microsecond of bucket rounding
+bool WithinPrecision(uint64_t reported, uint64_t exact)
+{
+    const double error = fabs((double)reported - (double)exact);
+    return error <= (double)exact / 64.0 + 1.0;
+}
+
+}
+
+ESL_TEST(FrameStats_EmptyReportsZeros)
+{
+    std::unique_ptr<FrameStats> pStats(new FrameStats());
+
+    const FrameTimeStats window = pStats->GetWindowStats(120);
+    ESL_CHECK(window.Frames == 0 && window.Spikes == 0);
+    ESL_CHECK(window.MinMs == 0.0 && window.MeanMs == 0.0 && window.P50Ms == 0.0 && window.P99Ms == 0.0 && window.MaxMs == 0.0);
+
+    const FrameTimeStats session = pStats->GetSessionStats();
+    ESL_CHECK(session.Frames == 0 && session.Spikes == 0);
+    ESL_CHECK(session.MinMs == 0.0 && session.MeanMs == 0.0 && session.P50Ms == 0.0 && session.P99Ms == 0.0 && session.MaxMs == 0.0);
+
+    // And again once everything recorded is reset
+    pStats->Record(16000);
+    pStats->Reset();
+    ESL_CHECK(pStats->GetWindowStats(120).Frames == 0);
+    ESL_CHECK(pStats->GetSessionStats().Frames == 0 && pStats->GetSessionStats().MaxMs == 0.0);
+
+    // A zero frame window asks for nothing
+    pStats->Record(16000);
+    ESL_CHECK(pStats->GetWindowStats(0).Frames == 0);
+}
+
+ESL_TEST(FrameStats_WindowIsExact)
+{
+    std::unique_ptr<FrameStats> pStats(new FrameStats());
+
+    // 1ms to 100ms, out of order
+    for (uint32_t i = 0; i != 100; ++i)
+        pStats->Record((uint64_t)((i * 37) % 100 + 1) * 1000);
+
+    const FrameTimeStats stats = pStats->GetWindowStats(100);
+    ESL_CHECK(stats.Frames == 100);
+    ESL_CHECK(Near(stats.MinMs, 1.0));
+    ESL_CHECK(Near(stats.MeanMs, 50.5));
+    ESL_CHECK(Near(stats.P50Ms, 50.0));
+    ESL_CHECK(Near(stats.P95Ms, 95.0));
+    ESL_CHECK(Near(stats.P99Ms, 99.0));
+    ESL_CHECK(Near(stats.MaxMs, 100.0));
+
+    // Longer than 25ms
+    ESL_CHECK(stats.Spikes == 75);
+
+    // A shorter window only sees the newest frames: 53ms, 90ms, 27ms and 64ms came last
+    const FrameTimeStats last = pStats->GetWindowStats(4);
+    ESL_CHECK(last.Frames == 4 && last.Spikes == 4);
+    ESL_CHECK(Near(last.MinMs, 27.0) && Near(last.MaxMs, 90.0));
+    ESL_CHECK(Near(last.MeanMs, (53.0 + 90.0 + 27.0 + 64.0) / 4.0));
+    ESL_CHECK(Near(last.P50Ms, 53.0));
+}
+
+ESL_TEST(FrameStats_FewerSamplesThanTheWindow)
+{
+    std::unique_ptr<FrameStats> pStats(new FrameStats());
+
+    // Ten frames, one of them a hitch
+    const uint64_t frames[] = { 16000, 17000, 16500, 15000, 90000, 16200, 16800, 15500, 16100, 16000 };
+    for (uint64_t frame : frames)
+        pStats->Record(frame);
+
+    // Asking for two seconds gets the ten there are, and with ten samples p99 is the worst of them
+    const FrameTimeStats stats = pStats->GetWindowStats(120);
+    ESL_CHECK(stats.Frames == 10);
+    ESL_CHECK(stats.Spikes == 1);
+    ESL_CHECK(Near(stats.MinMs, 15.0));
+    ESL_CHECK(Near(stats.MeanMs, 23.51));
+    ESL_CHECK(Near(stats.P50Ms, 16.1));
+    ESL_CHECK(Near(stats.P99Ms, 90.0));
+    ESL_CHECK(Near(stats.MaxMs, 90.0));
+
+    // Once the ring wraps only the newest kWindowCapacity are kept, while the session still has everything
+    for (uint32_t i = 0; i != FrameStats::kWindowCapacity; ++i)
+        pStats->Record(10000);
+    const FrameTimeStats wrapped = pStats->GetWindowStats(FrameStats::kWindowCapacity + 100);
+    ESL_CHECK(wrapped.Frames == FrameStats::kWindowCapacity);
+    ESL_CHECK(wrapped.Spikes == 0 && Near(wrapped.MaxMs, 10.0) && Near(wrapped.MeanMs, 10.0));
+    ESL_CHECK(pStats->GetSessionStats().Frames == FrameStats::kWindowCapacity + 10);
+    ESL_CHECK(Near(pStats->GetSessionStats().MaxMs, 90.0));
+}
+
+ESL_TEST(FrameTimeHistogram_StaysWithinPrecision)
+{
+    std::unique_ptr<FrameTimeHistogram> pHistogram(new FrameTimeHistogram());
+    ESL_CHECK(pHistogram->GetValueAtPercentile(50.0) == 0 && pHistogram->GetMax() == 0 && pHistogram->GetMin() == 0);
+
+    // Every bucket starts where the one before it ends
+    for (uint32_t i = 1; i != FrameTimeHistogram::kBucketCount; ++i)
+        ESL_CHECK(FrameTimeHistogram::GetBucketLowerBound(i) == FrameTimeHistogram::GetBucketLowerBound(i - 1) + FrameTimeHistogram::GetBucketWidth(i - 1));
+    ESL_CHECK(FrameTimeHistogram::GetBucketIndex(127) == 127);
+    ESL_CHECK(FrameTimeHistogram::GetBucketIndex(16667) == FrameTimeHistogram::GetBucketIndex(FrameTimeHistogram::GetBucketLowerBound(FrameTimeHistogram::GetBucketIndex(16667))));
+    ESL_CHECK(FrameTimeHistogram::GetBucketIndex(UINT64_MAX) == FrameTimeHistogram::kBucketCount - 1);
+
+    // 1us to 100000us, so the percentiles are known exactly
+    uint64_t sum = 0;
+    for (uint64_t value = 1; value <= 100000; ++value)
+    {
+        pHistogram->Record(value);
+        sum += value;
+    }
+
+    ESL_CHECK(pHistogram->GetCount() == 100000);
+    ESL_CHECK(pHistogram->GetMin() == 1 && pHistogram->GetMax() == 100000);
+    ESL_CHECK(Near(pHistogram->GetMean(), (double)sum / 100000.0));
+    ESL_CHECK(WithinPrecision(pHistogram->GetValueAtPercentile(50.0), 50000));
+    ESL_CHECK(WithinPrecision(pHistogram->GetValueAtPercentile(95.0), 95000));
+    ESL_CHECK(WithinPrecision(pHistogram->GetValueAtPercentile(99.0), 99000));
+    ESL_CHECK(WithinPrecision(pHistogram->GetValueAtPercentile(100.0), 100000));
+
+    // Exact in the linear range, and never past what was recorded
+    pHistogram->Reset();
+    const uint64_t small[] = { 3, 5, 7, 9, 11 };
+    for (uint64_t value : small)
+        pHistogram->Record(value);
+    ESL_CHECK(pHistogram->GetValueAtPercentile(50.0) == 7);
+    ESL_CHECK(pHistogram->GetValueAtPercentile(99.0) == 11);
+    ESL_CHECK(pHistogram->GetValueAtPercentile(0.0) == 3);
+
+    pHistogram->Reset();
+    pHistogram->Record(1000001);
+    ESL_CHECK(pHistogram->GetValueAtPercentile(50.0) == 1000001);
+}
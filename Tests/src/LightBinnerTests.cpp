@@ -0,0 +1,262 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Which clusters LightBinner puts a light in: every cluster
+the sphere reaches into and none whose box it misses, nothing at all for a
+light outside the view, and the same lists with or without a pool.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <Easel/Core/WorkerPool.h>
+#include <Easel/Renderer/ClusteredLighting.h>
+
+#include <math.h>
+#include <set>
+#include <string.h>
+
+namespace {
+
+using Renderer::ClusteredLights;
+using Renderer::LightBinner;
+using Renderer::LightSet;
+
+// A camera at the origin looking down +Z with a 60 degree 16:9 view, so view space is world space
+static const float kView[16] = { 1, 0, 0, 0,   0, 1, 0, 0,   0, 0, 1, 0,   0, 0, 0, 1 };
+static const float kProjY = 1.0f / tanf(0.5235988f);
+static const float kProjX = kProjY * 9.0f / 16.0f;
+static const float kNear = 0.1f;
+static const float kFar = 100.0f;
+
+static const uint32_t kSliceClusters = LightBinner::kClustersX * LightBinner::kClustersY;
+
+struct Binned
+{
+    std::vector<uint8_t> Memory;
+    ClusteredLights      Lights;
+
+    Binned() : Memory(LightBinner::GetOutputBytes())
+    {
+        LightBinner::InitOutput(Memory.data(), &Lights);
+    }
+};
+
+void Bin(LightBinner& binner, LightSet const& lights, Binned* out_binned, Core::WorkerPool* pPool = nullptr)
+{
+    binner.Bin(lights, kView, kProjX, kProjY, kNear, kFar, &out_binned->Lights, pPool);
+}
+
+float SliceDepth(uint32_t slice)
+{
+    return kNear * powf(kFar / kNear, (float)slice / (float)LightBinner::kClustersZ);
+}
+
+// The clusters whose lists hold a light
+std::set<uint32_t> ClustersOf(ClusteredLights const& lights, uint32_t light)
+{
+    std::set<uint32_t> clusters;
+    for (uint32_t cluster = 0; cluster != LightBinner::kClusterCount; ++cluster)
+    {
+        const uint32_t first = lights.Ranges[2 * cluster + 0];
+        const uint32_t count = lights.Ranges[2 * cluster + 1];
+        for (uint32_t i = 0; i != count; ++i)
+        {
+            if (lights.Indices[first + i] == light)
+                clusters.insert(cluster);
+        }
+    }
+    return clusters;
+}
+
+// The cluster a point in the view falls in, the way a pixel finds it
+uint32_t ClusterAt(ClusteredLights const& lights, float x, float y, float z)
+{
+    if (z < kNear || z >= kFar)
+        return LightBinner::kClusterCount;
+
+    const float ndcX = kProjX * x / z;
+    const float ndcY = kProjY * y / z;
+    const int tileX = (int)floorf((ndcX + 1.0f) * 0.5f * LightBinner::kClustersX);
+    const int tileY = (int)floorf((1.0f - ndcY) * 0.5f * LightBinner::kClustersY);
+    const int slice = (int)floorf(logf(z) * lights.SliceScale + lights.SliceBias);
+    if (tileX < 0 || tileX >= (int)LightBinner::kClustersX || tileY < 0 || tileY >= (int)LightBinner::kClustersY ||
+        slice < 0 || slice >= (int)LightBinner::kClustersZ)
+        return LightBinner::kClusterCount;
+
+    return (uint32_t)slice * kSliceClusters + (uint32_t)tileY * LightBinner::kClustersX + (uint32_t)tileX;
+}
+
+// Every cluster a point inside the sphere lands in, on a grid fine enough to find them all
+std::set<uint32_t> ClustersReached(ClusteredLights const& lights, const float* center, float range)
+{
+    static const int kSteps = 40;
+    const float inside = range * 0.999f;
+
+    std::set<uint32_t> clusters;
+    for (int i = -kSteps; i <= kSteps; ++i)
+    for (int j = -kSteps; j <= kSteps; ++j)
+    for (int k = -kSteps; k <= kSteps; ++k)
+    {
+        const float offset[3] = { (float)i / kSteps, (float)j / kSteps, (float)k / kSteps };
+        const float lengthSq = offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2];
+        if (lengthSq > 1.0f)
+            continue;
+
+        const uint32_t cluster = ClusterAt(lights, center[0] + offset[0] * inside, center[1] + offset[1] * inside, center[2] + offset[2] * inside);
+        if (cluster != LightBinner::kClusterCount)
+            clusters.insert(cluster);
+    }
+    return clusters;
+}
+
+// Whether the sphere touches a cluster's view space box, spanning its tile at both of its slice's depths
+bool TouchesBox(uint32_t cluster, const float* center, float range)
+{
+    const uint32_t slice = cluster / kSliceClusters;
+    const uint32_t tileY = cluster % kSliceClusters / LightBinner::kClustersX;
+    const uint32_t tileX = cluster % LightBinner::kClustersX;
+    const float nearDepth = SliceDepth(slice);
+    const float farDepth = SliceDepth(slice + 1);
+
+    const float left = -1.0f + 2.0f * (float)tileX / LightBinner::kClustersX;
+    const float right = left + 2.0f / LightBinner::kClustersX;
+    const float top = 1.0f - 2.0f * (float)tileY / LightBinner::kClustersY;
+    const float bottom = top - 2.0f / LightBinner::kClustersY;
+
+    const float boxMin[3] = { fminf(left * nearDepth, left * farDepth) / kProjX, fminf(bottom * nearDepth, bottom * farDepth) / kProjY, nearDepth };
+    const float boxMax[3] = { fmaxf(right * nearDepth, right * farDepth) / kProjX, fmaxf(top * nearDepth, top * farDepth) / kProjY, farDepth };
+
+    float distanceSq = 0.0f;
+    for (int axis = 0; axis != 3; ++axis)
+    {
+        const float outside = fmaxf(fmaxf(boxMin[axis] - center[axis], center[axis] - boxMax[axis]), 0.0f);
+        distanceSq += outside * outside;
+    }
+
+    // A little slack for the binner's own rounding
+    return distanceSq <= range * range * 1.0001f;
+}
+
+}
+
+ESL_TEST(LightBinner_BinsTheClustersASphereOverlaps)
+{
+    static const float kWhite[3] = { 1.0f, 1.0f, 1.0f };
+    LightBinner binner;
+    Binned binned;
+
+    // A small light on the corner where four tiles meet a slice boundary touches those eight clusters and no others
+    {
+        const float depth = SliceDepth(12);
+        const float position[3] = { 0.0f, 0.0f, depth };
+        LightSet lights;
+        lights.AddPointLight(position, 0.01f, kWhite);
+        Bin(binner, lights, &binned);
+
+        ESL_CHECK(binned.Lights.LightCount == 1);
+        std::set<uint32_t> expected;
+        for (uint32_t slice = 11; slice <= 12; ++slice)
+        for (uint32_t tileY = 3; tileY <= 4; ++tileY)
+        for (uint32_t tileX = 7; tileX <= 8; ++tileX)
+            expected.insert(slice * kSliceClusters + tileY * LightBinner::kClustersX + tileX);
+        ESL_CHECK(ClustersOf(binned.Lights, 0) == expected);
+        ESL_CHECK(binned.Lights.IndexCount == 8);
+    }
+
+    // Bigger lights over many clusters, some hanging off the edge of the view or in front of the near plane:
+    // every cluster the sphere reaches into is listed, and every one listed has a box the sphere touches
+    const float cases[][4] =
+    {
+        { 1.0f, 0.5f, 6.0f, 1.5f },
+        { -3.0f, -1.2f, 4.0f, 0.7f },
+        { 6.5f, 2.0f, 9.0f, 2.0f },
+        { 0.2f, -0.1f, 0.3f, 0.5f },
+        { -20.0f, 5.0f, 40.0f, 8.0f },
+        { 0.0f, 0.0f, 97.0f, 5.0f }
+    };
+    for (const float* c : cases)
+    {
+        LightSet lights;
+        lights.AddPointLight(c, c[3], kWhite);
+        Bin(binner, lights, &binned);
+
+        ESL_CHECK(binned.Lights.LightCount == 1);
+        const std::set<uint32_t> listed = ClustersOf(binned.Lights, 0);
+        const std::set<uint32_t> reached = ClustersReached(binned.Lights, c, c[3]);
+        ESL_CHECK(!reached.empty());
+        for (uint32_t cluster : reached)
+            ESL_CHECK(listed.count(cluster) == 1);
+        for (uint32_t cluster : listed)
+            ESL_CHECK(TouchesBox(cluster, c, c[3]));
+    }
+}
+
+ESL_TEST(LightBinner_OutOfViewLightsBinNowhere)
+{
+    static const float kWhite[3] = { 1.0f, 1.0f, 1.0f };
+    static const float kOutside[][4] =
+    {
+        { 0.0f, 0.0f, -5.0f, 2.0f },        // Behind the camera
+        { 0.0f, 0.0f, 0.05f, 0.04f },       // Between the eye and the near plane
+        { 0.0f, 0.0f, 110.0f, 5.0f },       // Past the far plane
+        { 30.0f, 0.0f, 10.0f, 2.0f },       // Off to the right
+        { 0.0f, -20.0f, 10.0f, 2.0f }       // Below
+    };
+
+    LightSet lights;
+    for (const float* light : kOutside)
+        lights.AddPointLight(light, light[3], kWhite);
+
+    LightBinner binner;
+    Binned binned;
+    Bin(binner, lights, &binned);
+
+    ESL_CHECK(binned.Lights.LightCount == 0);
+    ESL_CHECK(binned.Lights.IndexCount == 0);
+    bool anyListed = false;
+    for (uint32_t cluster = 0; cluster != LightBinner::kClusterCount; ++cluster)
+        anyListed |= binned.Lights.Ranges[2 * cluster + 1] != 0;
+    ESL_CHECK(!anyListed);
+    ESL_CHECK(binner.GetStats().Lights == 5 && binner.GetStats().Visible == 0);
+
+    // One in view among them is the only one kept
+    const float inView[3] = { 0.0f, 0.0f, 10.0f };
+    lights.AddPointLight(inView, 1.0f, kWhite);
+    Bin(binner, lights, &binned);
+    ESL_CHECK(binned.Lights.LightCount == 1);
+    ESL_CHECK(binned.Lights.Lights[0].Position[2] == 10.0f);
+    ESL_CHECK(!ClustersOf(binned.Lights, 0).empty());
+}
+
+ESL_TEST(LightBinner_PoolMatchesSerial)
+{
+    // A grid of point and spot lights like the stress run's
+    LightSet lights;
+    for (uint32_t i = 0; i != 500; ++i)
+    {
+        const float position[3] = { (float)(i % 25) * 0.8f - 10.0f, (float)(i % 7) * 0.3f - 1.0f, (float)(i / 25) * 0.8f + 1.0f };
+        const float color[3] = { 1.0f, 0.5f, 0.25f };
+        if (i % 4 == 0)
+        {
+            const float down[3] = { 0.0f, -1.0f, 0.0f };
+            lights.AddSpotLight(position, 1.5f, color, down, 0.3f, 0.6f);
+        }
+        else
+            lights.AddPointLight(position, 1.0f, color);
+    }
+
+    Core::WorkerPool pool;
+    pool.Init(4);
+
+    LightBinner serialBinner, pooledBinner;
+    Binned serial, pooled;
+    Bin(serialBinner, lights, &serial);
+    Bin(pooledBinner, lights, &pooled, &pool);
+
+    ESL_CHECK(serial.Lights.LightCount == pooled.Lights.LightCount);
+    ESL_CHECK(serial.Lights.IndexCount == pooled.Lights.IndexCount);
+    ESL_CHECK(serial.Lights.IndexCount > serial.Lights.LightCount);
+    ESL_CHECK(memcmp(serial.Lights.Ranges, pooled.Lights.Ranges, sizeof(uint32_t) * 2 * LightBinner::kClusterCount) == 0);
+    ESL_CHECK(memcmp(serial.Lights.Indices, pooled.Lights.Indices, sizeof(uint32_t) * serial.Lights.IndexCount) == 0);
+
+    pool.Shutdown();
+}
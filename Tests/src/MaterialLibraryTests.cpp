@@ -0,0 +1,207 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : The in-situ XML parser (attributes, nesting, text, the parts
+it skips and entities it leaves alone), the errors it reports, and the
+material descriptions MaterialLibrary reads out of a document.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <Easel/Assets/MaterialLibrary.h>
+#include <Easel/Assets/XmlDocument.h>
+
+#include <string.h>
+
+namespace {
+
+using Assets::kInvalidXmlNode;
+using Assets::XmlDocument;
+
+bool Parse(XmlDocument& doc, const char* text, std::string* out_error = nullptr)
+{
+    return doc.Parse(text, strlen(text), out_error);
+}
+
+}
+
+ESL_TEST(Xml_ReadsAttributes)
+{
+    XmlDocument doc;
+    ESL_CHECK(Parse(doc, "<shader type=\"PS\" name='Phong PS.cso'  packed = \"\" />"));
+
+    const uint32_t shader = doc.FirstChild(XmlDocument::kDocumentNode);
+    ESL_CHECK(shader != kInvalidXmlNode);
+    if (shader == kInvalidXmlNode)
+        return;
+
+    ESL_CHECK(doc.GetNode(shader).Name == "shader");
+    ESL_CHECK(doc.GetNode(shader).AttributeCount == 3);
+    ESL_CHECK(doc.GetAttribute(shader, "type") == "PS");
+    ESL_CHECK(doc.GetAttribute(shader, "name") == "Phong PS.cso");
+
+    // Present but empty isn't the same as missing
+    ESL_CHECK(doc.HasAttribute(shader, "packed") && doc.GetAttribute(shader, "packed").empty());
+    ESL_CHECK(!doc.HasAttribute(shader, "missing") && doc.GetAttribute(shader, "missing").empty());
+
+    // Views straight into the source
+    const char* text = "<a b=\"c\"/>";
+    ESL_CHECK(Parse(doc, text));
+    ESL_CHECK(doc.GetAttribute(1, "b").data() == text + 6);
+}
+
+ESL_TEST(Xml_LinksNestedElements)
+{
+    const char* text =
+        "<?xml version=\"1.0\"?>\n"
+        "<!DOCTYPE materials>\n"
+        "<materials>\n"
+        "  <!-- <material name=\"commented out\"/> -->\n"
+        "  <material name=\"a\">\n"
+        "    <params><tint> 1,2,3 </tint><specular>8</specular></params>\n"
+        "  </material>\n"
+        "  <other/>\n"
+        "  <material name=\"b\"><![CDATA[<not a tag>]]></material>\n"
+        "</materials>\n";
+
+    XmlDocument doc;
+    std::string error;
+    ESL_CHECK(Parse(doc, text, &error));
+
+    // The document, materials, two materials, params, tint, specular and other
+    ESL_CHECK(doc.GetNodeCount() == 8);
+
+    const uint32_t root = doc.FirstChild(XmlDocument::kDocumentNode, "materials");
+    ESL_CHECK(root != kInvalidXmlNode);
+    ESL_CHECK(doc.NextSibling(root) == kInvalidXmlNode);
+
+    const uint32_t a = doc.FirstChild(root, "material");
+    const uint32_t other = doc.NextSibling(a);
+    const uint32_t b = doc.NextSibling(a, "material");
+    ESL_CHECK(doc.GetAttribute(a, "name") == "a");
+    ESL_CHECK(doc.GetNode(other).Name == "other");
+    ESL_CHECK(doc.GetAttribute(b, "name") == "b");
+    ESL_CHECK(doc.NextSibling(b) == kInvalidXmlNode);
+    ESL_CHECK(doc.GetNode(root).FirstChild == a && doc.GetNode(root).LastChild == b);
+
+    // Text is trimmed, CDATA is kept as it is
+    const uint32_t params = doc.FirstChild(a, "params");
+    const uint32_t tint = doc.FirstChild(params);
+    ESL_CHECK(doc.GetNode(tint).Text == "1,2,3");
+    ESL_CHECK(doc.GetNode(doc.NextSibling(tint, "specular")).Text == "8");
+    ESL_CHECK(doc.GetNode(b).Text == "<not a tag>");
+    ESL_CHECK(doc.FirstChild(b) == kInvalidXmlNode);
+}
+
+ESL_TEST(Xml_LeavesEntitiesEncoded)
+{
+    XmlDocument doc;
+    ESL_CHECK(Parse(doc, "<a name=\"Salt &amp; Pepper\">&lt;b&gt;</a>"));
+    ESL_CHECK(doc.GetAttribute(1, "name") == "Salt &amp; Pepper");
+    ESL_CHECK(doc.GetNode(1).Text == "&lt;b&gt;");
+    ESL_CHECK(doc.FirstChild(1) == kInvalidXmlNode);
+}
+
+ESL_TEST(Xml_ReportsMalformedInput)
+{
+    struct Case
+    {
+        const char* Text;
+        const char* Error;
+    };
+
+    const Case cases[] =
+    {
+        { "<a>\n<b>\n</a>",              "line 3: closing tag doesn't match the open element" },
+        { "<a>\n<b/>\n",                 "unclosed element at end of file" },
+        { "</a>",                        "line 1: closing tag doesn't match the open element" },
+        { "<a b=c/>",                    "line 1: attribute value must be quoted" },
+        { "<a\n\n b=\"c/>",              "line 3: unterminated attribute value" },
+        { "<a b/>",                      "line 1: expected attribute=\"value\"" },
+        { "<>",                          "line 1: element without a name" },
+        { "<a/ >",                       "line 1: expected '>' after '/'" },
+        { "<a>\n<!-- never closed",      "line 2: unterminated comment" },
+        { "<a><![CDATA[ never closed",   "line 1: unterminated CDATA section" },
+        { "<a",                          "line 1: unterminated element" }
+    };
+
+    for (const Case& c : cases)
+    {
+        XmlDocument doc;
+        std::string error;
+        ESL_CHECK(!Parse(doc, c.Text, &error));
+        ESL_CHECK(error.find(c.Error) != std::string::npos);
+    }
+
+    // Without an error string it still fails
+    XmlDocument doc;
+    ESL_CHECK(!Parse(doc, "<a>"));
+}
+
+ESL_TEST(MaterialLibrary_ReadsDescriptions)
+{
+    const char* text =
+        "<materials>\n"
+        "  <material name=\"Lunar\">\n"
+        "    <shader type=\"VS\" name=\"PhongVS\" />\n"
+        "    <shader type=\"PS\" name=\"PhongPS\" packed=\"PhongArrayPS\" />\n"
+        "    <textures name=\"Lunar\" />\n"
+        "    <params><tint>1.0, 0.5, 0.25</tint><specular>128</specular></params>\n"
+        "    <raster fill=\"wireframe\" cull=\"none\" depthclip=\"false\" />\n"
+        "    <depth func=\"less_equal\" write=\"false\" />\n"
+        "    <blend mode=\"alpha\" />\n"
+        "  </material>\n"
+        "  <material name=\"Plain\"><shader type=\"VS\" name=\"a.cso\"/><shader type=\"PS\" name=\"b.cso\"/></material>\n"
+        "</materials>\n";
+
+    Assets::MaterialLibrary library;
+    std::string error;
+    ESL_CHECK(library.LoadFromMemory(text, strlen(text), &error));
+
+    const std::vector<Assets::MaterialDesc>& materials = library.GetMaterials();
+    ESL_CHECK(materials.size() == 2);
+    if (materials.size() != 2)
+        return;
+
+    const Assets::MaterialDesc& lunar = materials[0];
+    ESL_CHECK(lunar.Name == "Lunar");
+    ESL_CHECK(lunar.VertexShader == "PhongVS" && lunar.PixelShader == "PhongPS" && lunar.PackedPixelShader == "PhongArrayPS");
+    ESL_CHECK(lunar.Textures == "Lunar");
+    ESL_CHECK(lunar.Tint[0] == 1.0f && lunar.Tint[1] == 0.5f && lunar.Tint[2] == 0.25f && lunar.Tint[3] == 1.0f);
+    ESL_CHECK(lunar.SpecularExp == 128.0f);
+    ESL_CHECK(lunar.HasRasterState && lunar.Raster.Fill == Assets::FillMode::WIREFRAME && lunar.Raster.Cull == Assets::CullMode::NONE && !lunar.Raster.DepthClip);
+    ESL_CHECK(lunar.HasDepthState && lunar.Depth.Func == Assets::CompareFunc::LESS_EQUAL && lunar.Depth.DepthEnable && !lunar.Depth.DepthWrite);
+    ESL_CHECK(lunar.HasBlendState && lunar.Blend.Mode == Assets::BlendMode::ALPHA);
+
+    // Anything left out keeps its default
+    const Assets::MaterialDesc& plain = materials[1];
+    ESL_CHECK(plain.Name == "Plain" && plain.PackedPixelShader.empty() && plain.Textures.empty());
+    ESL_CHECK(!plain.HasRasterState && !plain.HasDepthState && !plain.HasBlendState);
+}
+
+ESL_TEST(MaterialLibrary_ReportsBadMaterials)
+{
+    struct Case
+    {
+        const char* Text;
+        const char* Error;
+    };
+
+    const Case cases[] =
+    {
+        { "<library/>",                                                                              "missing <materials> root" },
+        { "<materials><material><shader type=\"VS\" name=\"a\"/></material></materials>",             "has no name" },
+        { "<materials><material name=\"m\"><shader type=\"VS\" name=\"a\"/></material></materials>",  "material 'm': needs both a VS and a PS" },
+        { "<materials><material name=\"m\"><shader type=\"GS\" name=\"a\"/></material></materials>",  "unknown shader type" },
+        { "<materials><material name=\"m\"><raster fill=\"dotted\"/></material></materials>",         "unknown fill mode" },
+        { "<materials><material name=\"m\"><params><tint>1,2</tint></params></material></materials>", "tint needs at least 3 components" },
+        { "<materials><material name=\"m\"></materials>",                                             "closing tag doesn't match" }
+    };
+
+    for (const Case& c : cases)
+    {
+        Assets::MaterialLibrary library;
+        std::string error;
+        ESL_CHECK(!library.LoadFromMemory(c.Text, strlen(c.Text), &error));
+        ESL_CHECK(error.find(c.Error) != std::string::npos);
+    }
+}
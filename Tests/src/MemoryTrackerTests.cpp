@@ -0,0 +1,147 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : TrackedMalloc and TrackedFree charge the tag of the scope a
+block was allocated in, live and peak, whoever frees it, and the header in
+front of every block keeps it 16 byte aligned.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <Easel/Core/MemoryTracker.h>
+
+#include <algorithm>
+#include <new>
+
+#if defined(ESL_TRACK_MEMORY)
+
+namespace {
+
+using Core::MemoryTag;
+using Core::MemoryTracker;
+
+// Nothing else in the tests opens a scope with these, so their counters only move here
+constexpr MemoryTag kTag = MemoryTag::INPUT;
+constexpr MemoryTag kOtherTag = MemoryTag::RESOURCE_CODEX;
+
+}
+
+ESL_TEST(MemoryTracker_ChargesLiveAndPeakBytesToTheTag)
+{
+    const Core::MemoryTagStats before = MemoryTracker::GetTagStats(kTag);
+    const Core::MemoryTagStats otherBefore = MemoryTracker::GetTagStats(kOtherTag);
+    ESL_CHECK(MemoryTracker::IsEnabled());
+
+    void* pSmall = nullptr;
+    void* pLarge = nullptr;
+    {
+        ESL_MEMORY_SCOPE(kTag);
+        pSmall = Core::TrackedMalloc(100);
+        pLarge = Core::TrackedMalloc(1000);
+    }
+
+    Core::MemoryTagStats stats = MemoryTracker::GetTagStats(kTag);
+    ESL_CHECK(stats.LiveBytes == before.LiveBytes + 1100);
+    ESL_CHECK(stats.PeakBytes == std::max(before.PeakBytes, before.LiveBytes + 1100));
+    ESL_CHECK(stats.TotalAllocations == before.TotalAllocations + 2);
+    const int64_t peak = stats.PeakBytes;
+
+    // Freed outside the scope and still taken off the tag it was charged to. The peak stays put.
+    Core::TrackedFree(pSmall);
+    stats = MemoryTracker::GetTagStats(kTag);
+    ESL_CHECK(stats.LiveBytes == before.LiveBytes + 1000);
+    ESL_CHECK(stats.PeakBytes == peak);
+
+    // An inner scope charges its own tag, and the outer one picks up again once it closes
+    void* pOther = nullptr;
+    void* pAfter = nullptr;
+    {
+        ESL_MEMORY_SCOPE(kTag);
+        {
+            ESL_MEMORY_SCOPE(kOtherTag);
+            pOther = Core::TrackedMalloc(64);
+        }
+        pAfter = Core::TrackedMalloc(32);
+    }
+    ESL_CHECK(MemoryTracker::GetTagStats(kOtherTag).LiveBytes == otherBefore.LiveBytes + 64);
+    ESL_CHECK(MemoryTracker::GetTagStats(kTag).LiveBytes == before.LiveBytes + 1032);
+    ESL_CHECK(MemoryTracker::GetTagStats(kTag).TotalAllocations == before.TotalAllocations + 3);
+
+    // operator new goes through the same path
+    void* pNew = nullptr;
+    {
+        ESL_MEMORY_SCOPE(kTag);
+        pNew = ::operator new(200);
+    }
+    ESL_CHECK(MemoryTracker::GetTagStats(kTag).LiveBytes == before.LiveBytes + 1232);
+    ::operator delete(pNew);
+
+    Core::TrackedFree(pLarge);
+    Core::TrackedFree(pOther);
+    Core::TrackedFree(pAfter);
+    Core::TrackedFree(nullptr);
+
+    stats = MemoryTracker::GetTagStats(kTag);
+    ESL_CHECK(stats.LiveBytes == before.LiveBytes);
+    ESL_CHECK(stats.PeakBytes == std::max(before.PeakBytes, before.LiveBytes + 1232));
+    ESL_CHECK(MemoryTracker::GetTagStats(kOtherTag).LiveBytes == otherBefore.LiveBytes);
+
+    // The scope's site holds the same counts as the tag
+    uint64_t siteAllocations = 0;
+    int64_t siteLiveBytes = 0;
+    MemoryTracker::ForEachSite([&](const Core::MemorySite& site)
+    {
+        if (site.Tag == kTag)
+        {
+            siteAllocations += site.Allocations.load();
+            siteLiveBytes += site.LiveBytes.load();
+        }
+    });
+    ESL_CHECK(siteAllocations == stats.TotalAllocations);
+    ESL_CHECK(siteLiveBytes == stats.LiveBytes);
+}
+
+ESL_TEST(MemoryTracker_CountsPerFrame)
+{
+    MemoryTracker::EndFrame();
+
+    void* blocks[3];
+    {
+        ESL_MEMORY_SCOPE(kTag);
+        for (void*& pBlock : blocks)
+            pBlock = Core::TrackedMalloc(48);
+    }
+    MemoryTracker::EndFrame();
+
+    Core::MemoryTagStats stats = MemoryTracker::GetTagStats(kTag);
+    ESL_CHECK(stats.LastFrameAllocations == 3);
+    ESL_CHECK(stats.LastFrameBytes == 3 * 48);
+    ESL_CHECK(stats.PeakFrameAllocations >= 3);
+
+    // Frees don't count against the frame
+    for (void* pBlock : blocks)
+        Core::TrackedFree(pBlock);
+    MemoryTracker::EndFrame();
+    stats = MemoryTracker::GetTagStats(kTag);
+    ESL_CHECK(stats.LastFrameAllocations == 0 && stats.LastFrameBytes == 0);
+    ESL_CHECK(stats.PeakFrameAllocations >= 3);
+}
+
+ESL_TEST(MemoryTracker_KeepsSixteenByteAlignment)
+{
+    ESL_MEMORY_SCOPE(kTag);
+
+    const size_t sizes[] = { 1, 3, 8, 15, 16, 17, 31, 100, 4096, 65537 };
+    for (size_t size : sizes)
+    {
+        void* p = Core::TrackedMalloc(size);
+        ESL_CHECK(p != nullptr);
+        ESL_CHECK(((uintptr_t)p & 15) == 0);
+        Core::TrackedFree(p);
+
+        void* pNew = ::operator new(size);
+        ESL_CHECK(((uintptr_t)pNew & 15) == 0);
+        ::operator delete(pNew);
+    }
+}
+
+#endif
@@ -0,0 +1,199 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Mip chain layout for odd sizes, box filter values, the same
+chain with or without a pool, and the cache blob round trip, including
+blobs that are cut short or point outside their pixels.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <Easel/Assets/MipGenerator.h>
+#include <Easel/Core/WorkerPool.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+std::vector<uint8_t> MakeNoise(uint32_t width, uint32_t height)
+{
+    std::vector<uint8_t> pixels((size_t)width * height * 4);
+    uint32_t state = 12345;
+    for (uint8_t& value : pixels)
+    {
+        state = state * 1664525u + 1013904223u;
+        value = (uint8_t)(state >> 24);
+    }
+    return pixels;
+}
+
+bool ChainsMatch(const Assets::MipChain& a, const Assets::MipChain& b)
+{
+    if (a.Levels.size() != b.Levels.size() || a.Pixels != b.Pixels)
+        return false;
+
+    for (size_t i = 0; i != a.Levels.size(); ++i)
+    {
+        const Assets::MipLevel& la = a.Levels[i];
+        const Assets::MipLevel& lb = b.Levels[i];
+        if (la.Width != lb.Width || la.Height != lb.Height || la.RowPitch != lb.RowPitch || la.Offset != lb.Offset)
+            return false;
+    }
+    return true;
+}
+
+}
+
+ESL_TEST(MipGenerator_NonPowerOfTwoLevels)
+{
+    ESL_CHECK(Assets::MipGenerator::CountMips(1, 1) == 1);
+    ESL_CHECK(Assets::MipGenerator::CountMips(5, 3) == 3);
+    ESL_CHECK(Assets::MipGenerator::CountMips(1, 7) == 3);
+    ESL_CHECK(Assets::MipGenerator::CountMips(640, 480) == 10);
+
+    const std::vector<uint8_t> source = MakeNoise(5, 3);
+    Assets::MipChain chain;
+    ESL_CHECK(Assets::MipGenerator::GenerateChain(source.data(), 5, 3, Assets::MipGenDesc(), &chain, nullptr));
+    ESL_CHECK(chain.Levels.size() == 3);
+    if (chain.Levels.size() != 3)
+        return;
+
+    // Each level halves and rounds down, stopping at one texel on each side
+    const uint32_t expected[3][2] = { { 5, 3 }, { 2, 1 }, { 1, 1 } };
+    size_t offset = 0;
+    for (uint32_t i = 0; i != 3; ++i)
+    {
+        const Assets::MipLevel& level = chain.Levels[i];
+        ESL_CHECK(level.Width == expected[i][0] && level.Height == expected[i][1]);
+        ESL_CHECK(level.RowPitch == level.Width * 4);
+        ESL_CHECK(level.Offset == offset);
+        offset += (size_t)level.RowPitch * level.Height;
+    }
+    ESL_CHECK(chain.Pixels.size() == offset);
+    ESL_CHECK(memcmp(chain.GetLevelData(0), source.data(), source.size()) == 0);
+
+    // MaxLevels cuts the chain short
+    Assets::MipGenDesc twoLevels;
+    twoLevels.MaxLevels = 2;
+    ESL_CHECK(Assets::MipGenerator::GenerateChain(source.data(), 5, 3, twoLevels, &chain, nullptr));
+    ESL_CHECK(chain.Levels.size() == 2);
+}
+
+ESL_TEST(MipGenerator_BoxFilterAverages)
+{
+    const uint8_t source[2 * 2 * 4] =
+    {
+          0,  40, 200, 255,    40,  80, 200, 255,
+         80, 120, 200, 255,   120, 160, 200,  55,
+    };
+
+    Assets::MipGenDesc desc;
+    desc.Filter = Assets::MipFilter::BOX;
+
+    Assets::MipChain chain;
+    ESL_CHECK(Assets::MipGenerator::GenerateChain(source, 2, 2, desc, &chain, nullptr));
+    ESL_CHECK(chain.Levels.size() == 2);
+    if (chain.Levels.size() != 2)
+        return;
+
+    const uint8_t* pTexel = chain.GetLevelData(1);
+    const int expected[4] = { 60, 100, 200, 205 };
+    for (int c = 0; c != 4; ++c)
+        ESL_CHECK(abs((int)pTexel[c] - expected[c]) <= 1);
+
+    // sRGB averages in linear space, so a black and white checker lands well above the gamma encoded midpoint
+    const uint8_t checker[2 * 2 * 4] =
+    {
+          0,   0,   0, 255,   255, 255, 255, 255,
+        255, 255, 255, 255,     0,   0,   0, 255,
+    };
+    desc.Flags = Assets::MF_SRGB;
+    ESL_CHECK(Assets::MipGenerator::GenerateChain(checker, 2, 2, desc, &chain, nullptr));
+    pTexel = chain.GetLevelData(1);
+    ESL_CHECK(abs((int)pTexel[0] - 188) <= 1);
+    ESL_CHECK(pTexel[3] == 255);
+}
+
+ESL_TEST(MipGenerator_PoolMatchesSerial)
+{
+    const uint32_t width = 300, height = 170;
+    const std::vector<uint8_t> source = MakeNoise(width, height);
+
+    Core::WorkerPool pool;
+    pool.Init(4);
+
+    for (uint8_t filter = 0; filter != (uint8_t)Assets::MipFilter::COUNT; ++filter)
+    {
+        Assets::MipGenDesc desc;
+        desc.Filter = (Assets::MipFilter)filter;
+        desc.Flags = Assets::MF_SRGB | Assets::MF_WRAP;
+
+        Assets::MipChain serial, pooled;
+        ESL_CHECK(Assets::MipGenerator::GenerateChain(source.data(), width, height, desc, &serial, nullptr));
+        ESL_CHECK(Assets::MipGenerator::GenerateChain(source.data(), width, height, desc, &pooled, &pool));
+        ESL_CHECK(ChainsMatch(serial, pooled));
+    }
+
+    pool.Shutdown();
+}
+
+ESL_TEST(MipGenerator_SerializeRoundTrip)
+{
+    const std::vector<uint8_t> source = MakeNoise(33, 17);
+    Assets::MipChain chain;
+    ESL_CHECK(Assets::MipGenerator::GenerateChain(source.data(), 33, 17, Assets::MipGenDesc(), &chain, nullptr));
+
+    std::vector<uint8_t> blob;
+    Assets::MipGenerator::Serialize(chain, &blob);
+
+    Assets::MipChain loaded;
+    ESL_CHECK(Assets::MipGenerator::Deserialize(blob.data(), blob.size(), &loaded));
+    ESL_CHECK(ChainsMatch(chain, loaded));
+
+    // Cut anywhere, including inside the level table and the pixels
+    const size_t cuts[] = { 0, 2, 4, 4 + sizeof(Assets::MipLevel), blob.size() / 2, blob.size() - 1 };
+    for (size_t cut : cuts)
+        ESL_CHECK(!Assets::MipGenerator::Deserialize(blob.data(), cut, &loaded));
+
+    // Trailing bytes mean it isn't the blob we wrote
+    std::vector<uint8_t> padded = blob;
+    padded.push_back(0);
+    ESL_CHECK(!Assets::MipGenerator::Deserialize(padded.data(), padded.size(), &loaded));
+}
+
+ESL_TEST(MipGenerator_RejectsCorruptBlobs)
+{
+    const std::vector<uint8_t> source = MakeNoise(16, 16);
+    Assets::MipChain chain;
+    ESL_CHECK(Assets::MipGenerator::GenerateChain(source.data(), 16, 16, Assets::MipGenDesc(), &chain, nullptr));
+
+    Assets::MipChain loaded;
+    std::vector<uint8_t> blob;
+
+    // A garbage level count is refused before anything is allocated for it
+    Assets::MipGenerator::Serialize(chain, &blob);
+    const uint32_t hugeCount = 0x40000000;
+    memcpy(blob.data(), &hugeCount, sizeof(hugeCount));
+    ESL_CHECK(!Assets::MipGenerator::Deserialize(blob.data(), blob.size(), &loaded));
+
+    // A level before the last one pointing past the pixels
+    Assets::MipChain corrupt = chain;
+    corrupt.Levels[1].Offset = chain.Pixels.size() - 4;
+    blob.clear();
+    Assets::MipGenerator::Serialize(corrupt, &blob);
+    ESL_CHECK(!Assets::MipGenerator::Deserialize(blob.data(), blob.size(), &loaded));
+
+    // Rows narrower than the texels they claim to hold
+    corrupt = chain;
+    corrupt.Levels[2].RowPitch = corrupt.Levels[2].Width * 4 - 4;
+    blob.clear();
+    Assets::MipGenerator::Serialize(corrupt, &blob);
+    ESL_CHECK(!Assets::MipGenerator::Deserialize(blob.data(), blob.size(), &loaded));
+
+    // Tall enough to run off the end even though the offset is fine
+    corrupt = chain;
+    corrupt.Levels[0].Height = 0x10000;
+    blob.clear();
+    Assets::MipGenerator::Serialize(corrupt, &blob);
+    ESL_CHECK(!Assets::MipGenerator::Deserialize(blob.data(), blob.size(), &loaded));
+}
@@ -0,0 +1,146 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : What the coarse depth buffer hides and what it has to keep:
+boxes behind an occluder go, boxes beside it stay, and anything crossing
+the near plane is always kept, whatever is drawn in front.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <Easel/Core/WorkerPool.h>
+#include <Easel/Renderer/OcclusionCulling.h>
+
+#include <math.h>
+
+namespace {
+
+using Renderer::BoundingSphere;
+using Renderer::OcclusionCuller;
+
+// Unit cube, clockwise from outside
+static const float kBoxPositions[] =
+{
+    -0.5f, -0.5f, -0.5f,   0.5f, -0.5f, -0.5f,  -0.5f, 0.5f, -0.5f,   0.5f, 0.5f, -0.5f,
+    -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,  -0.5f, 0.5f,  0.5f,   0.5f, 0.5f,  0.5f
+};
+static const uint32_t kBoxIndices[] =
+{
+    1, 3, 7, 1, 7, 5,   4, 6, 2, 4, 2, 0,   6, 7, 3, 6, 3, 2,
+    0, 1, 5, 0, 5, 4,   5, 7, 6, 5, 6, 4,   0, 2, 3, 0, 3, 1
+};
+
+static const float kUnitBoxRadius = 0.8660254f;
+
+// A camera at the origin looking down +Z, XMMatrixPerspectiveFovLH with a 60 degree 16:9 view.
+// The view is the identity, so this is the view projection too.
+struct Camera
+{
+    float ViewProjection[16] = {};
+
+    Camera()
+    {
+        const float yScale = 1.0f / tanf(0.5235988f);
+        const float range = 1000.0f / (1000.0f - 0.1f);
+        ViewProjection[0] = yScale * 9.0f / 16.0f;
+        ViewProjection[5] = yScale;
+        ViewProjection[10] = range;
+        ViewProjection[11] = 1.0f;
+        ViewProjection[14] = -range * 0.1f;
+    }
+};
+
+// The unit box scaled into a wall and moved to (x, y, z)
+void MakeWall(float width, float height, float thickness, float x, float y, float z, float* out_world)
+{
+    const float world[16] = { width, 0, 0, 0,   0, height, 0, 0,   0, 0, thickness, 0,   x, y, z, 1 };
+    for (int i = 0; i != 16; ++i)
+        out_world[i] = world[i];
+}
+
+void DrawWall(OcclusionCuller& culler, uint32_t box, const float* world, Core::WorkerPool* pPool)
+{
+    Camera camera;
+    culler.BeginFrame(camera.ViewProjection);
+    culler.AddOccluders(box, world, nullptr, 1);
+    culler.RasterizeOccluders(pPool);
+}
+
+}
+
+ESL_TEST(Occlusion_HidesWhatIsBehindAnOccluder)
+{
+    Core::WorkerPool pool;
+    pool.Init(2);
+
+    OcclusionCuller culler;
+    culler.Init(256, 128);
+    const uint32_t box = culler.AddOccluderMesh(kBoxPositions, 8, kBoxIndices, 36);
+
+    // Nothing drawn yet, nothing is hidden
+    float wall[16];
+    MakeWall(8.0f, 8.0f, 0.5f, 0.0f, 0.0f, 10.0f, wall);
+    Camera camera;
+    culler.BeginFrame(camera.ViewProjection);
+    culler.RasterizeOccluders(&pool);
+    ESL_CHECK(culler.IsVisible({ 0.0f, 0.0f, 20.0f, kUnitBoxRadius }));
+
+    // 8x8 at a depth of 10 covers 16x16 at 20, so a box straight behind it is hidden
+    DrawWall(culler, box, wall, &pool);
+    const BoundingSphere behind   = { 0.0f, 0.0f, 20.0f, kUnitBoxRadius };
+    const BoundingSphere corner   = { 4.0f, 4.0f, 20.0f, kUnitBoxRadius };
+    const BoundingSphere beside   = { 14.0f, 0.0f, 20.0f, kUnitBoxRadius };
+    const BoundingSphere above    = { 0.0f, 11.0f, 20.0f, kUnitBoxRadius };
+    const BoundingSphere inFront  = { 0.0f, 0.0f, 5.0f, kUnitBoxRadius };
+    const BoundingSphere pokesOut = { 0.0f, 0.0f, 9.75f, 0.2f };
+
+    ESL_CHECK(!culler.IsVisible(behind));
+    ESL_CHECK(!culler.IsVisible(corner));
+    ESL_CHECK(culler.IsVisible(beside));
+    ESL_CHECK(culler.IsVisible(above));
+    ESL_CHECK(culler.IsVisible(inFront));
+
+    // Mostly inside the wall, but sticking out of its front face
+    ESL_CHECK(culler.IsVisible(pokesOut));
+
+    // The batched path agrees and keeps the order
+    const BoundingSphere spheres[] = { behind, beside, corner, inFront, above };
+    uint32_t indices[] = { 0, 1, 2, 3, 4 };
+    const uint32_t kept = culler.CullSpheres(spheres, indices, 5, &pool);
+    ESL_CHECK(kept == 3);
+    ESL_CHECK(indices[0] == 1 && indices[1] == 3 && indices[2] == 4);
+
+    // And the same without any workers
+    uint32_t serialIndices[] = { 0, 1, 2, 3, 4 };
+    ESL_CHECK(culler.CullSpheres(spheres, serialIndices, 5, nullptr) == 3);
+
+    pool.Shutdown();
+}
+
+ESL_TEST(Occlusion_KeepsBoxesCrossingTheNearPlane)
+{
+    OcclusionCuller culler;
+    culler.Init(256, 128);
+    const uint32_t box = culler.AddOccluderMesh(kBoxPositions, 8, kBoxIndices, 36);
+
+    // A wall close enough to fill the whole view
+    float wall[16];
+    MakeWall(100.0f, 100.0f, 0.5f, 0.0f, 0.0f, 2.0f, wall);
+    DrawWall(culler, box, wall, nullptr);
+    ESL_CHECK(!culler.IsVisible({ 0.0f, 0.0f, 20.0f, kUnitBoxRadius }));
+    ESL_CHECK(!culler.IsVisible({ 30.0f, 10.0f, 40.0f, kUnitBoxRadius }));
+
+    // Part of each is behind the camera, so projecting their corners would put them anywhere on screen
+    const BoundingSphere crossing[] =
+    {
+        { 0.0f, 0.0f, 0.05f, kUnitBoxRadius },
+        { 0.0f, 0.0f, -0.5f, kUnitBoxRadius },
+        { 0.6f, -0.4f, -0.7f, kUnitBoxRadius },
+        { 5.0f, 0.0f, 0.0f, 1.0f },
+        { 0.0f, 0.0f, 1.0f, 5.0f }
+    };
+    for (const BoundingSphere& sphere : crossing)
+        ESL_CHECK(culler.IsVisible(sphere));
+
+    uint32_t indices[] = { 0, 1, 2, 3, 4 };
+    ESL_CHECK(culler.CullSpheres(crossing, indices, 5, nullptr) == 5);
+}
@@ -0,0 +1,127 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : ResidencyManager's accounting and eviction order, driven
+the way ResourceCodex drives it: Track on load, Touch on use, Untrack on
+eviction and Track again when a use finds the resource gone.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <Easel/Renderer/ResidencyManager.h>
+#include <Easel/Renderer/ResourceTable.h>
+
+#include <vector>
+
+namespace {
+
+using Renderer::ResidencyKey;
+using Renderer::ResidencyKind;
+using Renderer::ResidencyManager;
+
+// First generation of the given slot, like a freshly inserted handle
+uint32_t MakeHandleValue(uint32_t index)
+{
+    return (1u << Renderer::kHandleIndexBits) | index;
+}
+
+// What ResourceCodex::UseMesh does, with Track standing in for the reload
+void UseMesh(ResidencyManager& residency, uint32_t handleValue, uint64_t bytes, uint64_t frame)
+{
+    if (!residency.IsResident(ResidencyKind::MESH, handleValue))
+        residency.Track(ResidencyKind::MESH, handleValue, bytes, true, frame);
+    residency.Touch(ResidencyKind::MESH, handleValue, frame);
+}
+
+}
+
+ESL_TEST(Residency_MeshBytesFromCounts)
+{
+    // What a headless mesh weighs is what its buffers would have held
+    ESL_CHECK(ResidencyManager::ComputeMeshBytes(24, 32, 36) == 24 * 32 + 36 * 4);
+    ESL_CHECK(ResidencyManager::ComputeMeshBytes(0, 32, 0) == 0);
+
+    ResidencyManager residency;
+    residency.Track(ResidencyKind::MESH, MakeHandleValue(1), ResidencyManager::ComputeMeshBytes(24, 32, 36), true, 0);
+    ESL_CHECK(residency.GetBytes(ResidencyKind::MESH) == 912);
+    ESL_CHECK(residency.GetCurrentBytes() == 912);
+}
+
+ESL_TEST(Residency_EvictsLeastRecentlyUsedFirst)
+{
+    ResidencyManager residency;
+    residency.SetBudget(250);
+
+    // Loaded on frames 1 to 4, then the first one is used again
+    for (uint32_t i = 1; i <= 4; ++i)
+        residency.Track(ResidencyKind::MESH, MakeHandleValue(i), 100, true, i);
+    residency.Touch(ResidencyKind::MESH, MakeHandleValue(1), 10);
+    ESL_CHECK(residency.IsOverBudget());
+
+    // Two have to go to get from 400 to 250, the oldest two
+    std::vector<ResidencyKey> victims;
+    residency.SelectEvictions(20, 3, &victims);
+    ESL_CHECK(victims.size() == 2);
+    if (victims.size() == 2)
+    {
+        ESL_CHECK(victims[0].Kind == ResidencyKind::MESH && victims[0].HandleValue == MakeHandleValue(2));
+        ESL_CHECK(victims[1].Kind == ResidencyKind::MESH && victims[1].HandleValue == MakeHandleValue(3));
+    }
+}
+
+ESL_TEST(Residency_SkipsRecentAndPinned)
+{
+    ResidencyManager residency;
+    residency.SetBudget(100);
+
+    // Oldest, but never evictable, like a texture bank
+    residency.Track(ResidencyKind::TEXTURE, MakeHandleValue(1), 100, false, 0);
+    residency.Track(ResidencyKind::MESH, MakeHandleValue(2), 100, true, 5);
+    residency.Track(ResidencyKind::MESH, MakeHandleValue(3), 100, true, 9);
+
+    // Frame 9's mesh may still be in flight on the GPU
+    std::vector<ResidencyKey> victims;
+    residency.SelectEvictions(10, 3, &victims);
+    ESL_CHECK(victims.size() == 1);
+    if (victims.size() == 1)
+        ESL_CHECK(victims[0].HandleValue == MakeHandleValue(2));
+
+    // Under budget, nothing is picked at all
+    ResidencyManager roomy;
+    roomy.SetBudget(1000);
+    roomy.Track(ResidencyKind::MESH, MakeHandleValue(1), 100, true, 0);
+    victims.clear();
+    roomy.SelectEvictions(100, 3, &victims);
+    ESL_CHECK(victims.empty());
+}
+
+ESL_TEST(Residency_ReloadsOnUse)
+{
+    ResidencyManager residency;
+    residency.SetBudget(250);
+    for (uint32_t i = 1; i <= 3; ++i)
+        residency.Track(ResidencyKind::MESH, MakeHandleValue(i), 100, true, i);
+
+    // The codex evicts whatever is picked
+    std::vector<ResidencyKey> victims;
+    residency.SelectEvictions(10, 3, &victims);
+    ESL_CHECK(victims.size() == 1);
+    for (const ResidencyKey& key : victims)
+        residency.Untrack(key.Kind, key.HandleValue);
+
+    ESL_CHECK(!residency.IsResident(ResidencyKind::MESH, MakeHandleValue(1)));
+    ESL_CHECK(residency.GetCurrentBytes() == 200);
+    ESL_CHECK(!residency.IsOverBudget());
+
+    // Using it again brings it back, as the most recently used
+    UseMesh(residency, MakeHandleValue(1), 100, 11);
+    ESL_CHECK(residency.IsResident(ResidencyKind::MESH, MakeHandleValue(1)));
+    ESL_CHECK(residency.GetCurrentBytes() == 300);
+    ESL_CHECK(residency.GetPeakBytes() == 300);
+
+    // So the next one out is the next oldest, not the one just reloaded
+    victims.clear();
+    residency.SelectEvictions(20, 3, &victims);
+    ESL_CHECK(victims.size() == 1);
+    if (victims.size() == 1)
+        ESL_CHECK(victims[0].HandleValue == MakeHandleValue(2));
+}
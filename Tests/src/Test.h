@@ -0,0 +1,60 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Minimal unit test harness. Cases register themselves with
+ESL_TEST and are run by main(). ESL_CHECK reports a failed condition with
+where it came from and carries on, so one run shows every broken check.
+----------------------------------------------*/
+#ifndef EASEL_TEST_H
+#define EASEL_TEST_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Test {
+
+class Context
+{
+public:
+    void Fail(const char* condition, const char* file, int line);
+
+    uint32_t GetFailures() const { return mFailures; }
+
+private:
+    uint32_t mFailures = 0;
+};
+
+typedef void (*TestFunc)(Context& ctx);
+
+struct TestCase
+{
+    std::string Name;
+    TestFunc    Func;
+};
+
+inline std::vector<TestCase>& GetRegistry()
+{
+    static std::vector<TestCase> registry;
+    return registry;
+}
+
+struct Registrar
+{
+    Registrar(const char* name, TestFunc func) { GetRegistry().push_back({ name, func }); }
+};
+
+}
+
+#define ESL_TEST_CONCAT_INNER(a, b) a##b
+#define ESL_TEST_CONCAT(a, b) ESL_TEST_CONCAT_INNER(a, b)
+
+#define ESL_TEST(name)                                                                        \
+    static void name(Test::Context& ctx);                                                     \
+    static Test::Registrar ESL_TEST_CONCAT(s_Registrar_, name)(#name, &name);                 \
+    static void name(Test::Context& ctx)
+
+#define ESL_CHECK(condition)                                                                  \
+    do { if (!(condition)) ctx.Fail(#condition, __FILE__, __LINE__); } while (0)
+
+#endif
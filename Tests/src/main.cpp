@@ -0,0 +1,44 @@
+/*----------------------------------------------
+Ruben Young (rubenaryo@gmail.com)
+Date : 2024/6
+Description : Runs every registered test, or only those whose name
+contains one of the filters on the command line. Exits non-zero if any
+check failed, so it can gate a build.
+----------------------------------------------*/
+#include "Test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void Test::Context::Fail(const char* condition, const char* file, int line)
+{
+    fprintf(stderr, "    %s(%d): check failed: %s\n", file, line, condition);
+    ++mFailures;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t run = 0;
+    uint32_t failed = 0;
+    for (const Test::TestCase& test : Test::GetRegistry())
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i != argc && !selected; ++i)
+            selected = strstr(test.Name.c_str(), argv[i]) != nullptr;
+
+        if (!selected)
+            continue;
+
+        Test::Context ctx;
+        test.Func(ctx);
+        ++run;
+
+        const bool passed = !ctx.GetFailures();
+        failed += passed ? 0 : 1;
+        printf("%-48s %s\n", test.Name.c_str(), passed ? "passed" : "FAILED");
+        fflush(stdout);
+    }
+
+    printf("%u of %u tests passed\n", run - failed, run);
+    return failed ? 1 : 0;
+}
@@ -27,6 +27,7 @@ project "Easel"
     files
     {
         "%{prj.name}/src/**.h",
+        "%{prj.name}/src/**.inl",
         "%{prj.name}/src/**.cpp"
     }
 
@@ -71,7 +72,7 @@ project "Easel"
         }
 
     filter "configurations:Debug"
-        defines "ESL_DEBUG"
+        defines { "ESL_DEBUG", "ESL_HOT_RELOAD", "ESL_COUNT_ALLOCATIONS", "ESL_TRACK_MEMORY" }
         symbols "On"
         staticruntime "Off"
         shadermodel "5.0"
@@ -124,6 +125,51 @@ project "IsoDungeon"
         defines "ESL_RELEASE"
         optimize "On"
 
+-- Shader permutations: every source in Assets/Shaders/Permutations is compiled once per combination of its
+-- features, into <Name>_p<key>.cso. Bits and defines have to match ShaderPermutations.h.
+shaderFeatureBits =
+{
+    NORMAL_MAP    = 0,
+    TEXTURE_ARRAY = 1,
+    ALPHA_TEST    = 2,
+    INSTANCED     = 3
+}
+shaderLightClassShift = 4
+
+-- lightClasses is how many of ambient, sun and clustered the source is compiled for, none if it doesn't shade
+shaderPermutations =
+{
+    { name = "PhongPS", profile = "ps_5_0", features = { "NORMAL_MAP", "TEXTURE_ARRAY", "ALPHA_TEST" }, lightClasses = 3 },
+    { name = "PhongVS", profile = "vs_5_0", features = { "INSTANCED" } }
+}
+
+function shaderVariantCommands(permutation)
+    local commands = { "{MKDIR} \"%{!wks.location}/_bin/Shaders\"" }
+    local outputs = {}
+    local lightClasses = permutation.lightClasses or 1
+    for subset = 0, (1 << #permutation.features) - 1 do
+        for lights = 0, lightClasses - 1 do
+            local key = 0
+            local defines = ""
+            for i, feature in ipairs(permutation.features) do
+                local on = (subset >> (i - 1)) & 1
+                key = key | (on << shaderFeatureBits[feature])
+                defines = defines .. " /D " .. feature .. "=" .. on
+            end
+            if permutation.lightClasses then
+                key = key | (lights << shaderLightClassShift)
+                defines = defines .. " /D LIGHT_CLASS=" .. lights
+            end
+
+            local output = "%{!wks.location}/_bin/Shaders/" .. permutation.name .. string.format("_p%02x.cso", key)
+            table.insert(commands, "fxc /nologo /T " .. permutation.profile .. " /E main" .. defines ..
+                                   " %{cfg.buildcfg == 'Debug' and '/Od /Zi' or '/O3'} /Fo \"" .. output .. "\" \"%{file.abspath}\"")
+            table.insert(outputs, output)
+        end
+    end
+    return commands, outputs
+end
+
 project "Shaders"
     location "Assets/Shaders"
     kind "ConsoleApp"
@@ -138,8 +184,238 @@ project "Shaders"
         "%{!wks.location}/Assets/Shaders/**.hlsli"
     }
 
-    filter { "files:**PS.hlsl" }
+    -- Then reflect them all for ShaderFactory, and check them against CBufferStructs.h
+    filter "system:windows"
+        dependson { "ShaderReflector" }
+        postbuildcommands { "\"%{!wks.location}/_bin/" .. outputdir .. "/ShaderReflector/ShaderReflector.exe\" \"%{!wks.location}/_bin/Shaders\"" }
+
+    filter { "files:**PS.hlsl", "files:not **/Permutations/**" }
         shadertype "Pixel"
 
-    filter { "files:**VS.hlsl" }
+    filter { "files:**VS.hlsl", "files:not **/Permutations/**" }
         shadertype "Vertex"
+
+    for _, permutation in ipairs(shaderPermutations) do
+        local commands, outputs = shaderVariantCommands(permutation)
+        filter { "files:**/Permutations/" .. permutation.name .. ".hlsl" }
+            buildmessage ("Compiling " .. #outputs .. " variants of " .. permutation.name)
+            buildcommands (commands)
+            buildoutputs (outputs)
+            buildinputs { "%{!wks.location}/Assets/Shaders/PhongCommon.hlsli", "%{!wks.location}/Assets/Shaders/VS_Common.hlsli" }
+    end
+
+    filter {}
+
+-- Writes the .refl next to every compiled shader, see ShaderReflection.h. Needs D3DReflect, so Windows only.
+if os.istarget("windows") then
+project "ShaderReflector"
+    location "ShaderReflector"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+    systemversion "latest"
+
+    targetdir ("_bin/" .. outputdir .. "/%{prj.name}")
+    objdir ("_int/" .. outputdir .. "/%{prj.name}")
+
+    files
+    {
+        "%{prj.name}/src/**.cpp",
+        "Easel/src/Easel/Core/MappedFile.cpp",
+        "Easel/src/Easel/Renderer/ShaderReflection.cpp"
+    }
+
+    includedirs
+    {
+        "Easel/src"
+    }
+
+    defines
+    {
+        "ESL_PLATFORM_WINDOWS"
+    }
+
+    filter "configurations:Debug"
+        defines "ESL_DEBUG"
+        symbols "On"
+
+    filter "configurations:Release"
+        defines "ESL_RELEASE"
+        optimize "On"
+end
+
+project "Benchmarks"
+    location "Benchmarks"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+
+    targetdir ("_bin/" .. outputdir .. "/%{prj.name}")
+    objdir ("_int/" .. outputdir .. "/%{prj.name}")
+
+    -- Only exercises the platform independent parts of Easel, so it doesn't link the DLL.
+    -- Those that aren't header only are compiled in directly.
+    -- Builds on Windows, and on Linux with Assimp installed (libassimp-dev):
+    --   premake5 gmake2 && make Benchmarks config=release
+    files
+    {
+        "%{prj.name}/src/**.h",
+        "%{prj.name}/src/**.cpp",
+        "Easel/src/Easel/Assets/AssetCache.cpp",
+        "Easel/src/Easel/Assets/MaterialLibrary.cpp",
+        "Easel/src/Easel/Assets/MeshImporter.cpp",
+        "Easel/src/Easel/Assets/XmlDocument.cpp",
+        "Easel/src/Easel/Core/Allocators.cpp",
+        "Easel/src/Easel/Core/Clock.cpp",
+        "Easel/src/Easel/Core/FrameStats.cpp",
+        "Easel/src/Easel/Core/MappedFile.cpp",
+        "Easel/src/Easel/Core/MemoryTracker.cpp",
+        "Easel/src/Easel/Core/Profiler.cpp",
+        "Easel/src/Easel/Core/TaskGraph.cpp",
+        "Easel/src/Easel/Core/WorkerPool.cpp",
+        "Easel/src/Easel/Input/InputBinding.cpp",
+        "Easel/src/Easel/Renderer/CascadedShadows.cpp",
+        "Easel/src/Easel/Renderer/ClusteredLighting.cpp",
+        "Easel/src/Easel/Renderer/ClusteredLighting.cpp",
+        "Easel/src/Easel/Renderer/Culling.cpp",
+        "Easel/src/Easel/Renderer/OcclusionCulling.cpp",
+        "Easel/src/Easel/Renderer/ShaderPermutations.cpp",
+        "Easel/src/Easel/Renderer/ShaderReflection.cpp",
+        "Easel/src/Easel/Renderer/SoftwareRasterizer.cpp"
+    }
+
+    includedirs
+    {
+        "Easel/src"
+    }
+
+    defines
+    {
+        "ESL_BENCH_MESH_IMPORT"
+    }
+
+    -- Cases that load from Assets/ find it relative to here, or through --assets
+    debugdir "%{wks.location}"
+
+    filter "system:windows"
+        staticruntime "On"
+        systemversion "latest"
+
+        -- DirectXMath comes with the Windows SDK
+        files
+        {
+            "Easel/src/Easel/Core/Transform.cpp"
+        }
+
+        includedirs
+        {
+            "external/assimp/include"
+        }
+
+        libdirs
+        {
+            "external/assimp/"
+        }
+
+        links
+        {
+            "external/assimp/assimp"
+        }
+
+        defines
+        {
+            "ESL_PLATFORM_WINDOWS",
+            "ESL_BENCH_TRANSFORM"
+        }
+
+        postbuildcommands
+        {
+            ("{COPYFILE} %{!wks.location}/external/assimp/Assimp64.dll %{!cfg.buildtarget.directory}/Assimp64.dll")
+        }
+
+    filter "system:linux"
+        links
+        {
+            "assimp",
+            "pthread"
+        }
+
+    -- Numbers from a Debug build are meaningless, so both configurations optimize
+    filter "configurations:Debug"
+        defines "ESL_DEBUG"
+        symbols "On"
+        optimize "On"
+
+    filter "configurations:Release"
+        defines "ESL_RELEASE"
+        optimize "Full"
+
+project "Tests"
+    location "Tests"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+
+    targetdir ("_bin/" .. outputdir .. "/%{prj.name}")
+    objdir ("_int/" .. outputdir .. "/%{prj.name}")
+
+    -- Like Benchmarks, only the platform independent parts of Easel, compiled in directly.
+    -- Exits non-zero if any check fails:
+    --   premake5 gmake2 && make Tests && _bin/Debugx64/Tests/Tests
+    files
+    {
+        "%{prj.name}/src/**.h",
+        "%{prj.name}/src/**.cpp",
+        "Easel/src/Easel/Assets/MaterialLibrary.cpp",
+        "Easel/src/Easel/Assets/MipGenerator.cpp",
+        "Easel/src/Easel/Assets/XmlDocument.cpp",
+        "Easel/src/Easel/Core/Allocators.cpp",
+        "Easel/src/Easel/Core/Clock.cpp",
+        "Easel/src/Easel/Core/FrameStats.cpp",
+        "Easel/src/Easel/Core/MappedFile.cpp",
+        "Easel/src/Easel/Core/MemoryTracker.cpp",
+        "Easel/src/Easel/Core/Profiler.cpp",
+        "Easel/src/Easel/Core/TaskGraph.cpp",
+        "Easel/src/Easel/Core/WorkerPool.cpp",
+        "Easel/src/Easel/Renderer/CascadedShadows.cpp",
+        "Easel/src/Easel/Renderer/ClusteredLighting.cpp",
+        "Easel/src/Easel/Renderer/Culling.cpp",
+        "Easel/src/Easel/Renderer/OcclusionCulling.cpp",
+        "Easel/src/Easel/Renderer/ResidencyManager.cpp",
+        "Easel/src/Easel/Renderer/ShaderPermutations.cpp"
+    }
+
+    includedirs
+    {
+        "Easel/src"
+    }
+
+    -- So the allocation counting and memory tracking are tested in either configuration
+    defines
+    {
+        "ESL_COUNT_ALLOCATIONS",
+        "ESL_TRACK_MEMORY"
+    }
+
+    filter "system:windows"
+        staticruntime "On"
+        systemversion "latest"
+
+        defines
+        {
+            "ESL_PLATFORM_WINDOWS"
+        }
+
+    filter "system:linux"
+        links
+        {
+            "pthread"
+        }
+
+    filter "configurations:Debug"
+        defines "ESL_DEBUG"
+        symbols "On"
+
+    filter "configurations:Release"
+        defines "ESL_RELEASE"
+        optimize "On"